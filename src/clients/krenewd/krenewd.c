@@ -0,0 +1,271 @@
+/*
+ * clients/krenewd/krenewd.c
+ *
+ * Copyright 2000 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ *
+ * Keep the tickets in a set of credentials caches renewed, and
+ * prefetch service tickets into them, using krb5_renew_ccache().
+ */
+
+#include <krb5.h>
+#include <com_err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <syslog.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+extern int optind;
+extern char *optarg;
+
+#define DEFAULT_PERCENT	50
+#define MIN_SLEEP	60		/* never check more often than this */
+#define RETRY_SLEEP	(5 * 60)	/* after an error with no time given */
+#define MAX_SLEEP	(60 * 60)	/* notice a cache refreshed by kinit */
+
+struct watched {
+    char *name;
+    krb5_ccache ccache;
+    int percent;
+    krb5_principal *prefetch;
+    int nprefetch;
+};
+
+static char *progname;
+
+static void usage()
+{
+    fprintf(stderr, "usage: %s [-n] [-o] [-p percent] [-s service] "
+	    "[cache ...]\n", progname);
+    exit(1);
+}
+
+static void krenewd_com_err_proc(const char *whoami, long code,
+				 const char *fmt, va_list args)
+{
+    char error_buf[8096];
+
+    error_buf[0] = '\0';
+    if (fmt)
+	vsprintf(error_buf, fmt, args);
+    syslog(LOG_ERR, "%s%s%s%s%s", whoami ? whoami : "", whoami ? ": " : "",
+	   code ? error_message(code) : "", code ? " " : "", error_buf);
+}
+
+/* Add the space- or comma-separated principal names in str to w->prefetch. */
+static krb5_error_code add_prefetch(krb5_context context, struct watched *w,
+				    char *str)
+{
+    krb5_error_code ret;
+    krb5_principal *newp;
+    char *cp;
+
+    for (cp = strtok(str, " \t,"); cp; cp = strtok(NULL, " \t,")) {
+	newp = (krb5_principal *) realloc(w->prefetch, (w->nprefetch + 1) *
+					  sizeof(krb5_principal));
+	if (newp == NULL)
+	    return ENOMEM;
+	w->prefetch = newp;
+	ret = krb5_parse_name(context, cp, &w->prefetch[w->nprefetch]);
+	if (ret) {
+	    com_err(progname, ret, "while parsing service name %s", cp);
+	    return ret;
+	}
+	w->nprefetch++;
+    }
+    return 0;
+}
+
+/*
+ * Take the renewal percentage and the services to prefetch for w from
+ * [appdefaults] in the realm of the cache's principal, unless they
+ * were given on the command line.
+ */
+static krb5_error_code setup_watched(krb5_context context, struct watched *w,
+				     int percent, char **services,
+				     int nservices)
+{
+    krb5_error_code ret;
+    krb5_principal me;
+    char *str, numbuf[20];
+    int i;
+
+    if ((ret = krb5_cc_get_principal(context, w->ccache, &me)))
+	return ret;
+
+    if (percent) {
+	w->percent = percent;
+    } else {
+	sprintf(numbuf, "%d", DEFAULT_PERCENT);
+	krb5_appdefault_string(context, "krenewd", &me->realm,
+			       "renew_percent", numbuf, &str);
+	w->percent = atoi(str);
+	free(str);
+    }
+
+    if (nservices) {
+	for (i = 0, ret = 0; i < nservices && !ret; i++) {
+	    if ((str = strdup(services[i])) == NULL) {
+		ret = ENOMEM;
+		break;
+	    }
+	    ret = add_prefetch(context, w, str);
+	    free(str);
+	}
+    } else {
+	krb5_appdefault_string(context, "krenewd", &me->realm,
+			       "prefetch", "", &str);
+	ret = add_prefetch(context, w, str);
+	free(str);
+    }
+
+    krb5_free_principal(context, me);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    krb5_context context;
+    krb5_error_code ret;
+    struct watched *watched;
+    char **services = NULL;
+    int option, nwatched, nservices = 0, percent = 0;
+    int nofork = 0, once = 0, errors, i;
+    krb5_timestamp now, next, when;
+    long delay;
+
+    progname = strrchr(argv[0], '/');
+    progname = progname ? (progname + 1) : argv[0];
+
+    if ((ret = krb5_init_context(&context))) {
+	com_err(progname, ret, "while initializing krb5 library");
+	exit(1);
+    }
+
+    while ((option = getopt(argc, argv, "nop:s:")) != -1) {
+	switch (option) {
+	case 'n':
+	    nofork = 1;
+	    break;
+	case 'o':
+	    once = 1;
+	    break;
+	case 'p':
+	    percent = atoi(optarg);
+	    if (percent <= 0 || percent > 100)
+		usage();
+	    break;
+	case 's':
+	    services = (char **) realloc(services, (nservices + 1) *
+					 sizeof(char *));
+	    if (services == NULL) {
+		com_err(progname, ENOMEM, "while reading arguments");
+		exit(1);
+	    }
+	    services[nservices++] = optarg;
+	    break;
+	default:
+	    usage();
+	    break;
+	}
+    }
+
+    nwatched = (optind < argc) ? argc - optind : 1;
+    watched = (struct watched *) calloc(nwatched, sizeof(struct watched));
+    if (watched == NULL) {
+	com_err(progname, ENOMEM, "while reading arguments");
+	exit(1);
+    }
+    for (i = 0; i < nwatched; i++) {
+	if (optind < argc) {
+	    watched[i].name = argv[optind + i];
+	    ret = krb5_cc_resolve(context, watched[i].name,
+				  &watched[i].ccache);
+	} else {
+	    ret = krb5_cc_default(context, &watched[i].ccache);
+	    if (!ret)
+		watched[i].name = (char *)
+		    krb5_cc_get_name(context, watched[i].ccache);
+	}
+	if (ret) {
+	    com_err(progname, ret, "while opening ccache %s",
+		    watched[i].name ? watched[i].name : "");
+	    exit(1);
+	}
+	if ((ret = setup_watched(context, &watched[i], percent, services,
+				 nservices))) {
+	    com_err(progname, ret, "while setting up ccache %s",
+		    watched[i].name);
+	    exit(1);
+	}
+    }
+
+    if (!once && !nofork) {
+	if (daemon(0, 0)) {
+	    com_err(progname, errno, "while detaching from tty");
+	    exit(1);
+	}
+	openlog(progname, LOG_PID, LOG_DAEMON);
+	set_com_err_hook(krenewd_com_err_proc);
+    }
+
+    for (;;) {
+	errors = 0;
+	next = 0;
+	if (krb5_timeofday(context, &now))
+	    now = 0;
+	for (i = 0; i < nwatched; i++) {
+	    ret = krb5_renew_ccache(context, watched[i].ccache,
+				    watched[i].percent, watched[i].prefetch,
+				    watched[i].nprefetch, &when);
+	    if (ret) {
+		com_err(progname, ret, "while renewing tickets in %s",
+			watched[i].name);
+		errors++;
+		if (!when)
+		    when = now + RETRY_SLEEP;
+	    }
+	    if (when && (!next || when < next))
+		next = when;
+	}
+	if (once)
+	    break;
+
+	if (krb5_timeofday(context, &now))
+	    now = 0;
+	delay = (long) next - (long) now;
+	if (delay < MIN_SLEEP)
+	    delay = MIN_SLEEP;
+	if (delay > MAX_SLEEP)
+	    delay = MAX_SLEEP;
+	sleep(delay);
+    }
+
+    krb5_free_context(context);
+    exit(errors ? 1 : 0);
+}
@@ -513,6 +513,14 @@ krb5_error_code krb5_sendto_kdc
 		const krb5_data *,
 		krb5_data *,
 		int));
+krb5_error_code krb5int_sendto_kdc_multi
+	KRB5_PROTOTYPE((krb5_context,
+		int,
+		const krb5_data * const *,
+		const krb5_data * const *,
+		krb5_data *,
+		krb5_error_code *,
+		int));
 krb5_error_code krb5_get_krbhst
 	KRB5_PROTOTYPE((krb5_context,
 		const krb5_data *,
@@ -591,6 +599,16 @@ struct krb5_enc_provider {
 
     krb5_error_code (*make_key) KRB5_NPROTOTYPE
     ((krb5_const krb5_data *randombits, krb5_keyblock *key));
+
+    /* these operate in place on the HEADER, DATA and PADDING buffers
+       of the iov, in order.  They do not update ivec. */
+    krb5_error_code (*encrypt_iov) KRB5_NPROTOTYPE
+    ((krb5_const krb5_keyblock *key, krb5_const krb5_data *ivec,
+      krb5_crypto_iov *data, size_t num_data));
+
+    krb5_error_code (*decrypt_iov) KRB5_NPROTOTYPE
+    ((krb5_const krb5_keyblock *key, krb5_const krb5_data *ivec,
+      krb5_crypto_iov *data, size_t num_data));
 };
 
 struct krb5_hash_provider {
@@ -631,6 +649,23 @@ typedef krb5_error_code (*krb5_crypt_func) KRB5_NPROTOTYPE
   krb5_const krb5_data *ivec, 
   krb5_const krb5_data *input, krb5_data *output));
 
+typedef krb5_error_code (*krb5_crypto_length_func) KRB5_NPROTOTYPE
+((krb5_const struct krb5_enc_provider *enc,
+  krb5_const struct krb5_hash_provider *hash,
+  krb5_cryptotype type, size_t *size));
+
+typedef krb5_error_code (*krb5_crypt_iov_func) KRB5_NPROTOTYPE
+((krb5_const struct krb5_enc_provider *enc,
+  krb5_const struct krb5_hash_provider *hash,
+  krb5_const krb5_keyblock *key, krb5_keyusage usage,
+  krb5_const krb5_data *ivec,
+  krb5_crypto_iov *data, size_t num_data));
+
+typedef krb5_error_code (*krb5_crypt_batch_func) KRB5_NPROTOTYPE
+((krb5_const struct krb5_enc_provider *enc,
+  krb5_const struct krb5_hash_provider *hash,
+  krb5_crypto_job **jobs, size_t num_jobs));
+
 typedef krb5_error_code (*krb5_str2key_func) KRB5_NPROTOTYPE
 ((krb5_const struct krb5_enc_provider *enc, krb5_const krb5_data *string,
   krb5_const krb5_data *salt, krb5_keyblock *key));
@@ -645,6 +680,10 @@ struct krb5_keytypes {
     krb5_crypt_func encrypt;
     krb5_crypt_func decrypt;
     krb5_str2key_func str2key;
+    krb5_crypto_length_func crypto_length;
+    krb5_crypt_iov_func encrypt_iov;
+    krb5_crypt_iov_func decrypt_iov;
+    krb5_crypt_batch_func decrypt_batch;
 };
 
 struct krb5_cksumtypes {
@@ -682,6 +721,12 @@ KRB5_PROTOTYPE((krb5_const struct krb5_hash_provider *hash,
 		krb5_const krb5_keyblock *key, unsigned int icount,
 		krb5_const krb5_data *input, krb5_data *output));
 
+krb5_error_code krb5int_c_s2k_cache_init
+KRB5_PROTOTYPE((krb5_context context));
+
+void krb5int_c_s2k_cache_free
+KRB5_PROTOTYPE((krb5_context context));
+
 
 #ifdef KRB5_OLD_CRYPTO
 /* old provider api */
@@ -1030,12 +1075,19 @@ struct _krb5_context {
 #ifdef KRB5_DNS_LOOKUP
         krb5_boolean    profile_in_memory;
 #endif /* KRB5_DNS_LOOKUP */
+	void	      FAR *s2k_cache; /* recent string-to-key results, if
+					 started */
+	int		rd_req_cache_size;
+	void	      FAR *rd_req_cache; /* decrypted service tickets */
+	void	      FAR *realm_map; /* [domain_realm] and [capaths] */
+	void	      FAR *aname_cache; /* parsed auth_to_local rules */
 };
 
 /* could be used in a table to find an etype and initialize a block */
 
 
 #define KRB5_LIBOPT_SYNC_KDCTIME	0x0001
+#define KRB5_LIBOPT_CCACHE_REPLACE	0x0002
 
 /*
  * Begin "asn1.h"
@@ -1244,6 +1296,115 @@ krb5_error_code encode_krb5_sam_response
 krb5_error_code encode_krb5_predicted_sam_response
        KRB5_PROTOTYPE((const krb5_predicted_sam_response * , krb5_data **));
 
+/*
+   krb5_error_code encode_krb5_structure_into(const krb5_structure *rep,
+					      krb5_data *code);
+   requires  code->data is NULL or points to code->length octets
+   modifies  code->length, code->data[0..code->length-1]
+   effects   Writes the ASN.1 encoding of *rep to the start of code->data
+             and sets code->length to its length.  The exact length is
+	     computed first, so nothing is allocated.
+             Returns ASN1_OVERFLOW, and sets code->length to the length
+	     needed, if code->data is NULL or too small.
+             Returns ASN1_MISSING_FIELD if a required field is emtpy in *rep.
+*/
+
+krb5_error_code encode_krb5_authenticator_into
+	KRB5_PROTOTYPE((const krb5_authenticator *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_ticket_into
+	KRB5_PROTOTYPE((const krb5_ticket *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_encryption_key_into
+	KRB5_PROTOTYPE((const krb5_keyblock *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_enc_tkt_part_into
+	KRB5_PROTOTYPE((const krb5_enc_tkt_part *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_enc_kdc_rep_part_into
+	KRB5_PROTOTYPE((const krb5_enc_kdc_rep_part *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_as_rep_into
+	KRB5_PROTOTYPE((const krb5_kdc_rep *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_tgs_rep_into
+	KRB5_PROTOTYPE((const krb5_kdc_rep *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_ap_req_into
+	KRB5_PROTOTYPE((const krb5_ap_req *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_ap_rep_into
+	KRB5_PROTOTYPE((const krb5_ap_rep *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_ap_rep_enc_part_into
+	KRB5_PROTOTYPE((const krb5_ap_rep_enc_part *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_as_req_into
+	KRB5_PROTOTYPE((const krb5_kdc_req *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_tgs_req_into
+	KRB5_PROTOTYPE((const krb5_kdc_req *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_kdc_req_body_into
+	KRB5_PROTOTYPE((const krb5_kdc_req *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_safe_into
+	KRB5_PROTOTYPE((const krb5_safe *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_priv_into
+	KRB5_PROTOTYPE((const krb5_priv *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_enc_priv_part_into
+	KRB5_PROTOTYPE((const krb5_priv_enc_part *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_cred_into
+	KRB5_PROTOTYPE((const krb5_cred *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_enc_cred_part_into
+	KRB5_PROTOTYPE((const krb5_cred_enc_part *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_error_into
+	KRB5_PROTOTYPE((const krb5_error *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_authdata_into
+	KRB5_PROTOTYPE((const krb5_authdata **rep, krb5_data *code));
+
+krb5_error_code encode_krb5_alt_method_into
+	KRB5_PROTOTYPE((const krb5_alt_method *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_etype_info_into
+	KRB5_PROTOTYPE((const krb5_etype_info_entry **rep, krb5_data *code));
+
+krb5_error_code encode_krb5_enc_data_into
+	KRB5_PROTOTYPE((const krb5_enc_data *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_pa_enc_ts_into
+	KRB5_PROTOTYPE((const krb5_pa_enc_ts *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_pwd_sequence_into
+	KRB5_PROTOTYPE((const passwd_phrase_element *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_pwd_data_into
+	KRB5_PROTOTYPE((const krb5_pwd_data *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_padata_sequence_into
+	KRB5_PROTOTYPE((const krb5_pa_data **rep, krb5_data *code));
+
+krb5_error_code encode_krb5_sam_challenge_into
+	KRB5_PROTOTYPE((const krb5_sam_challenge *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_sam_key_into
+	KRB5_PROTOTYPE((const krb5_sam_key *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_enc_sam_response_enc_into
+	KRB5_PROTOTYPE((const krb5_enc_sam_response_enc *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_sam_response_into
+	KRB5_PROTOTYPE((const krb5_sam_response *rep, krb5_data *code));
+
+krb5_error_code encode_krb5_predicted_sam_response_into
+	KRB5_PROTOTYPE((const krb5_predicted_sam_response *rep, krb5_data *code));
+
 /*************************************************************************
  * End of prototypes for krb5_encode.c
  *************************************************************************/
@@ -1322,6 +1483,59 @@ krb5_error_code decode_krb5_tgs_req
 krb5_error_code decode_krb5_kdc_req_body
 	KRB5_PROTOTYPE((const krb5_data *output, krb5_kdc_req **rep));
 
+/*
+   krb5_error_code decode_krb5_structure_borrowed(const krb5_data *code,
+						  krb5_structure **rep);
+   requires  *code outlives **rep, and is not changed while **rep is used
+   effects   Decodes *code as decode_krb5_structure does, but takes all
+             storage for **rep from a single arena, and leaves strings
+	     in **rep pointing into *code.  The result must be freed with
+	     krb5_free_borrowed, not the usual krb5_free_ routine.
+*/
+
+krb5_error_code decode_krb5_as_req_borrowed
+	KRB5_PROTOTYPE((const krb5_data *code, krb5_kdc_req **rep));
+
+krb5_error_code decode_krb5_tgs_req_borrowed
+	KRB5_PROTOTYPE((const krb5_data *code, krb5_kdc_req **rep));
+
+void krb5_free_borrowed
+	KRB5_PROTOTYPE((krb5_context context, void *rep));
+
+/*
+ * The fields of a KDC request needed to route or refuse it, as read by
+ * decode_krb5_kdc_req_peek.  Strings point into the encoded request.
+ * sname_length and nktypes count every component and enctype present,
+ * even those beyond the ends of sname and ktype.
+ */
+#define KRB5_PEEK_MAX_SNAME	4
+#define KRB5_PEEK_MAX_ETYPES	16
+
+typedef struct _krb5_kdc_req_peek {
+    krb5_msgtype msg_type;
+    krb5_int32 nonce;
+    krb5_data realm;
+    krb5_int32 sname_type;
+    int sname_length;			/* 0 if no server name */
+    krb5_data sname[KRB5_PEEK_MAX_SNAME];
+    int nktypes;
+    krb5_enctype ktype[KRB5_PEEK_MAX_ETYPES];
+} krb5_kdc_req_peek;
+
+/*
+   krb5_error_code decode_krb5_kdc_req_peek(const krb5_data *code,
+					    krb5_kdc_req_peek *rep);
+   effects   Reads the message type, realm, server name, nonce and
+             enctypes of the AS-REQ or TGS-REQ in *code into *rep,
+	     skipping the preauthentication data and the other fields of
+	     the request body without decoding them.  Allocates nothing.
+	     Returns KRB5_BADMSGTYPE if *code is not a KDC request.
+	     Success does not mean that a full decode will succeed.
+*/
+
+krb5_error_code decode_krb5_kdc_req_peek
+	KRB5_PROTOTYPE((const krb5_data *code, krb5_kdc_req_peek *rep));
+
 krb5_error_code decode_krb5_safe
 	KRB5_PROTOTYPE((const krb5_data *output, krb5_safe **rep));
 
@@ -1518,9 +1732,31 @@ krb5_error_code KRB5_CALLCONV krb5_cc_retrieve_cred_default
 	KRB5_PROTOTYPE((krb5_context, krb5_ccache, krb5_flags,
 			krb5_creds *, krb5_creds *));
 
+krb5_error_code krb5int_cc_retrieve_creds
+	KRB5_PROTOTYPE((krb5_context, krb5_ccache, int, krb5_flags *,
+			krb5_creds *, krb5_creds *, krb5_error_code *));
+
+krb5_error_code krb5int_cc_store_creds
+	KRB5_PROTOTYPE((krb5_context, krb5_ccache, krb5_creds **));
+
 void krb5int_set_prompt_types
 	KRB5_PROTOTYPE((krb5_context, krb5_prompt_type *));
 
+void krb5int_rd_req_cache_free
+	KRB5_PROTOTYPE((krb5_context));
+
+krb5_error_code krb5int_domain_realm
+	KRB5_PROTOTYPE((krb5_context, const char *, char **));
+
+krb5_error_code krb5int_capaths
+	KRB5_PROTOTYPE((krb5_context, const char *, const char *, char ***));
+
+void krb5int_realm_map_free
+	KRB5_PROTOTYPE((krb5_context));
+
+void krb5int_aname_cache_free
+	KRB5_PROTOTYPE((krb5_context));
+
 #if defined(macintosh) && defined(__CFM68K__) && !defined(__USING_STATIC_LIBS__)
 #pragma import reset
 #endif
@@ -216,5 +216,8 @@ typedef struct __krb5_realm_params {
     unsigned int	realm_flags_valid:1;
     unsigned int	realm_filler:7;
     krb5_int32		realm_num_keysalts;
+    krb5_int32		realm_db_cachesize;	/* 0 if not set */
+    krb5_int32		realm_db_pagesize;	/* 0 if not set */
+    krb5_int32		realm_db_ffactor;	/* 0 if not set */
 } krb5_realm_params;
 #endif	/* KRB5_ADM_H__ */
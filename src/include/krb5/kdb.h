@@ -237,6 +237,11 @@ krb5_error_code krb5_db_iterate
 		   krb5_error_code (* ) KRB5_PROTOTYPE((krb5_pointer,
 						   krb5_db_entry *)),
 		   krb5_pointer ));
+krb5_error_code krb5_db_iterate_snapshot
+	KRB5_PROTOTYPE((krb5_context,
+		   krb5_error_code (* ) KRB5_PROTOTYPE((krb5_pointer,
+						   krb5_db_entry *)),
+		   krb5_pointer ));
 krb5_error_code krb5_db_verify_master_key
 	KRB5_PROTOTYPE((krb5_context,
 		   krb5_principal, 
@@ -274,6 +279,60 @@ krb5_error_code krb5_db_set_nonblocking
 krb5_boolean krb5_db_set_lockmode
 	KRB5_PROTOTYPE((krb5_context,
 		   krb5_boolean));
+krb5_error_code krb5_db_set_bulk_load
+	KRB5_PROTOTYPE((krb5_context,
+		   krb5_boolean));
+
+/* database cache tuning */
+typedef struct _krb5_db_cache_stats {
+    unsigned long	hits;		/* pages found in the cache */
+    unsigned long	misses;		/* pages read from the file */
+    unsigned long	evictions;	/* pages evicted to make room */
+    unsigned long	cached;		/* pages now in the cache */
+    unsigned long	maxcache;	/* pages cached before evicting */
+} krb5_db_cache_stats;
+
+krb5_error_code krb5_db_set_cache_params
+	KRB5_PROTOTYPE((krb5_context,
+		   krb5_int32,
+		   krb5_int32,
+		   krb5_int32));
+krb5_error_code krb5_db_get_cache_stats
+	KRB5_PROTOTYPE((krb5_context,
+		   krb5_db_cache_stats *));
+
+/* update log, for incremental propagation */
+#define KRB5_DB_LOG_EXT		".ulog"
+#define KRB5_DB_LOG_HEADER	"kdb5_util update_log version 1\t"
+
+krb5_error_code krb5_db_log_put
+	KRB5_PROTOTYPE((krb5_context,
+		   char *,
+		   krb5_db_entry *));
+krb5_error_code krb5_db_log_delete
+	KRB5_PROTOTYPE((krb5_context,
+		   char *,
+		   krb5_const_principal));
+krb5_error_code krb5_db_log_reset
+	KRB5_PROTOTYPE((krb5_context,
+		   char *));
+krb5_error_code krb5_db_log_position
+	KRB5_PROTOTYPE((krb5_context,
+		   char *,
+		   krb5_ui_4 *,
+		   krb5_ui_4 *,
+		   krb5_ui_4 *));
+krb5_error_code krb5_db_log_copy
+	KRB5_PROTOTYPE((krb5_context,
+		   char *,
+		   krb5_ui_4,
+		   krb5_ui_4,
+		   int,
+		   krb5_ui_4 *));
+krb5_error_code krb5_db_log_apply
+	KRB5_PROTOTYPE((krb5_context,
+		   char *));
+
 krb5_error_code	krb5_db_fetch_mkey
 	KRB5_PROTOTYPE((krb5_context,
 		   krb5_principal, 
@@ -28,6 +28,8 @@
  */
 
 #include <stdio.h>
+#include <ctype.h>
+#include <signal.h>
 #include <k5-int.h>
 #include <kadm5/admin.h>
 #include <kadm5/adb.h>
@@ -99,6 +101,8 @@ static int process_k5beta7_record PROTOTYPE((char *, krb5_context,
 					     FILE *, int, int *, void *));
 static int process_ov_record PROTOTYPE((char *, krb5_context,
 					FILE *, int, int *, void *));
+static int process_ulog_record PROTOTYPE((char *, krb5_context,
+					  FILE *, int, int *, void *));
 typedef krb5_error_code (*load_func)PROTOTYPE((char *, krb5_context,
 					       FILE *, int, int *, void *));
 
@@ -159,6 +163,17 @@ dump_version r1_3_version = {
      process_k5beta7_record,
 };
 
+/* Changes from a database's update log, sent by kprop to a slave. */
+dump_version ulog_version = {
+     "Kerberos version 5 update log",
+     KRB5_DB_LOG_HEADER,
+     1,
+     0,
+     NULL,
+     NULL,
+     process_ulog_record,
+};
+
 /* External data */
 extern char		*current_dbname;
 extern krb5_boolean	dbactive;
@@ -232,6 +247,12 @@ static const char dblock_err_fmt[] = "%s: cannot initialize database lock (%s)\n
 static const char dbname_err_fmt[] = "%s: cannot set database name to %s (%s)\n";
 static const char dbdelerr_fmt[] = "%s: cannot delete bad database %s (%s)\n";
 static const char dbunlockerr_fmt[] = "%s: cannot unlock database %s (%s)\n";
+static const char dblogerr_fmt[] = "%s: cannot reset update log %s (%s)\n";
+static const char interrupted_fmt[] = "%s: interrupted while loading from %s\n";
+static const char no_end_fmt[] = "%s: %s ended without an end-of-dump line\n";
+static const char after_end_fmt[] = "%s: %s has data after the end-of-dump line\n";
+static const char apply_err_fmt[] = "%s(%d): cannot apply update (%s)\n";
+static const char dbbulkerr_fmt[] = "%s: cannot store records in database %s (%s)\n";
 static const char dbrenerr_fmt[] = "%s: cannot rename database %s to %s (%s)\n";
 static const char dbcreaterr_fmt[] = "%s: cannot create database %s (%s)\n";
 static const char dfile_err_fmt[] = "%s: cannot open %s (%s)\n";
@@ -291,10 +312,43 @@ krb5_error_code master_key_convert(context, db_entry)
 }
 
 /*
- * Update the "ok" file.
+ * Set when a load from standard input is told to give up; whatever
+ * arrives on standard input after that is not the whole dump.
+ */
+static volatile int load_interrupted = 0;
+
+static krb5_sigtype
+load_interrupt(signo)
+    int signo;
+{
+    load_interrupted = 1;
+}
+
+/*
+ * The name of the update log of database dbname.
  */
-void update_ok_file (file_name)
+char *
+ulog_name(dbname)
+    char *dbname;
+{
+    char *logname;
+
+    logname = (char *) malloc(strlen(dbname) + strlen(KRB5_DB_LOG_EXT) + 1);
+    if (logname) {
+	strcpy(logname, dbname);
+	strcat(logname, KRB5_DB_LOG_EXT);
+    }
+    return logname;
+}
+
+/*
+ * Update the "ok" file.  If position is not null it is written to the
+ * file, so that kprop knows which update log entries are newer than
+ * the dump.
+ */
+void update_ok_file (file_name, position)
      char *file_name;
+     char *position;
 {
 	/* handle slave locking/failure stuff */
 	char *file_ok;
@@ -317,7 +371,10 @@ void update_ok_file (file_name)
 		free(file_ok);
 		return;
 	}
-	if (write(fd, "", 1) != 1) {
+	if (position == NULL)
+	    position = "";
+	if (write(fd, position, strlen(position) + 1) !=
+	    strlen(position) + 1) {
 	    com_err(progname, errno, "while writing to 'ok' file, '%s'",
 		    file_ok);
 	     exit_status++;
@@ -1019,6 +1076,8 @@ dump_db(argc, argv)
     krb5_boolean	locked;
     extern osa_adb_policy_t policy_db;
     char		*new_mkey_file = 0;
+    char		*logname, *position = NULL;
+    krb5_ui_4		log_gen, log_first, log_last;
 	
     /*
      * Parse the arguments.
@@ -1157,10 +1216,29 @@ dump_db(argc, argv)
 	fprintf(arglist.ofile, "%s", dump->header);
 	if (dump->header[strlen(dump->header)-1] != '\n')
 	     fputc('\n', arglist.ofile);
-	
-	if ((kret = krb5_db_iterate(util_context,
-				    dump->dump_princ,
-				    (krb5_pointer) &arglist))) {
+
+	/*
+	 * Note where the update log stands before dumping a whole
+	 * database; replaying later changes over the dump is harmless.
+	 */
+	if (ofile && !arglist.nnames && !mkey_convert &&
+	    (logname = ulog_name(global_params.dbname)) != NULL) {
+	     if (!krb5_db_log_position(util_context, logname, &log_gen,
+				       &log_first, &log_last) &&
+		 (position = (char *) malloc(strlen(logname) + 30)) != NULL)
+		  sprintf(position, "%lu\t%lu\t%s\n",
+			  (unsigned long) log_gen, (unsigned long) log_last,
+			  logname);
+	     free(logname);
+	}
+
+	/*
+	 * Dump from a copy of the database, so that kadmind is only kept
+	 * waiting while the copy is taken rather than for the whole dump.
+	 */
+	if ((kret = krb5_db_iterate_snapshot(util_context,
+					     dump->dump_princ,
+					     (krb5_pointer) &arglist))) {
 	     fprintf(stderr, dumprec_err,
 		     programname, dump->name, error_message(kret));
 	     exit_status++;
@@ -1174,8 +1252,10 @@ dump_db(argc, argv)
 	}
 	if (ofile && f != stdout && !exit_status) {
 	     fclose(f);
-	     update_ok_file(ofile);
+	     update_ok_file(ofile, position);
 	}
+	if (position)
+	     free(position);
     }
     if (locked)
 	(void) krb5_lock_file(util_context, fileno(f), KRB5_LOCKMODE_UNLOCK);
@@ -2020,11 +2100,84 @@ process_ov_record(fname, kcontext, filep, verbose, linenop, pol_db)
      return 0;
 }
 
+/*
+ * process_ulog_record()	- Apply one change from an update log.
+ *
+ * Returns -1 for end of file, 0 for success and 1 for failure.
+ */
+static int
+process_ulog_record(fname, kcontext, filep, verbose, linenop, pol_db)
+    char		*fname;
+    krb5_context	kcontext;
+    FILE		*filep;
+    int			verbose;
+    int			*linenop;
+    void		*pol_db;
+{
+    static char		*line = NULL;
+    static size_t	size = 0;
+    size_t		len;
+    char		*nline;
+    krb5_error_code	kret;
+
+    /* Entries are written out in hex, so lines can be long. */
+    len = 0;
+    do {
+	if (size - len < 2) {
+	    if ((nline = (char *) realloc(line, size + BUFSIZ)) == NULL) {
+		fprintf(stderr, no_mem_fmt, fname, *linenop);
+		return 1;
+	    }
+	    line = nline;
+	    size += BUFSIZ;
+	}
+	if (fgets(line + len, size - len, filep) == NULL)
+	    return (len == 0 && !ferror(filep)) ? -1 : 1;
+	len += strlen(line + len);
+    } while (line[len - 1] != '\n');
+
+    if (verbose)
+	fprintf(stderr, "%lu\n", strtoul(line, (char **) NULL, 10));
+    if ((kret = krb5_db_log_apply(kcontext, line))) {
+	fprintf(stderr, apply_err_fmt, fname, *linenop, error_message(kret));
+	return 1;
+    }
+    (*linenop)++;
+    return 0;
+}
+
+/*
+ * at_dump_end()	- Skip white space, and see if the next record is
+ *			  the "." line which ends a dump on standard input.
+ *
+ * Returns 1 if it is, having read the ".", and 0 if not.  No dump
+ * record starts with a ".".
+ */
+static int
+at_dump_end(f)
+    FILE		*f;
+{
+    int		c;
+
+    while ((c = getc(f)) != EOF && isspace(c))
+	 ;
+    if (c == '.')
+	 return 1;
+    if (c != EOF)
+	 (void) ungetc(c, f);
+    return 0;
+}
+
 /*
  * restore_dump()	- Restore the database from any version dump file.
+ *
+ * If marked is set the dump must end with a line holding only ".", so
+ * that a dump cut short, as by kpropd dying while it streams one in,
+ * is not taken for the whole of it.
  */
 static int
-restore_dump(programname, kcontext, dumpfile, f, verbose, dump, pol_db)
+restore_dump(programname, kcontext, dumpfile, f, verbose, dump, pol_db,
+	     marked)
     char		*programname;
     krb5_context	kcontext;
     char		*dumpfile;
@@ -2032,23 +2185,40 @@ restore_dump(programname, kcontext, dumpfile, f, verbose, dump, pol_db)
     int			verbose;
     dump_version	*dump;
     osa_adb_policy_t	pol_db;
+    int			marked;
 {
     int		error;	
     int		lineno;
+    int		ended;
 
     error = 0;
     lineno = 1;
+    ended = 0;
 
     /*
      * Process the records.
      */
-    while (!(error = (*dump->load_record)(dumpfile,
+    while (!(marked && (ended = at_dump_end(f))) &&
+	   !(error = (*dump->load_record)(dumpfile,
 					  kcontext, 
 					  f,
 					  verbose,
 					  &lineno,
 					  pol_db)))
 	 ;
+    /* Some formats have an end record of their own. */
+    if (marked && error == -1)
+	 ended = at_dump_end(f);
+    if (ended) {
+	 if (getc(f) == '\n' && getc(f) == EOF)
+	      return(0);
+	 fprintf(stderr, after_end_fmt, programname, dumpfile);
+	 return(1);
+    }
+    if (marked && error == -1) {
+	 fprintf(stderr, no_end_fmt, programname, dumpfile);
+	 return(1);
+    }
     if (error != -1)
 	 fprintf(stderr, err_line_fmt, programname, lineno, dumpfile);
     else
@@ -2077,6 +2247,7 @@ load_db(argc, argv)
     char		*dumpfile;
     char		*dbname;
     char		*dbname_tmp;
+    char		*logname;
     char		buf[BUFSIZ];
     dump_version	*load;
     int			update, verbose;
@@ -2121,6 +2292,17 @@ load_db(argc, argv)
 	return;
     }
     dumpfile = argv[aindex];
+    /*
+     * "-" loads from standard input, as when kpropd streams a dump in.
+     * The dump must then end with a "." line, which kpropd sends only
+     * once the whole transfer has arrived; kpropd also sends SIGTERM if
+     * the transfer fails, and the load is then abandoned however it
+     * ends.
+     */
+    if (!strcmp(dumpfile, "-")) {
+	dumpfile = (char *) NULL;
+	(void) signal(SIGTERM, load_interrupt);
+    }
 
     if (!(dbname_tmp = (char *) malloc(strlen(dbname)+
 				       strlen(dump_tmptrail)+1))) {
@@ -2169,7 +2351,8 @@ load_db(argc, argv)
     if (load) {
 	 /* only check what we know; some headers only contain a prefix */
 	 if (strncmp(buf, load->header, strlen(load->header)) != 0) {
-	      fprintf(stderr, head_bad_fmt, programname, dumpfile);
+	      fprintf(stderr, head_bad_fmt, programname,
+		      (dumpfile) ? dumpfile : stdin_name);
 	      exit_status++;
 	      if (dumpfile) fclose(f);
 	      return;
@@ -2187,8 +2370,12 @@ load_db(argc, argv)
 	 else if (strncmp(buf, ov_version.header,
 			  strlen(ov_version.header)) == 0)
 	      load = &ov_version;
+	 else if (strncmp(buf, ulog_version.header,
+			  strlen(ulog_version.header)) == 0)
+	      load = &ulog_version;
 	 else {
-	      fprintf(stderr, head_bad_fmt, programname, dumpfile);
+	      fprintf(stderr, head_bad_fmt, programname,
+		      (dumpfile) ? dumpfile : stdin_name);
 	      exit_status++;
 	      if (dumpfile) fclose(f);
 	      return;
@@ -2219,6 +2406,16 @@ load_db(argc, argv)
 	 }
     }
     
+    if ((kret = set_db_params(kcontext))) {
+	 fprintf(stderr, "%s: %s while setting database parameters\n",
+		 programname, error_message(kret));
+	 exit_status++;
+	 if (!update)
+	      kadm5_free_config_params(kcontext, &newparams);
+	 if (dumpfile) fclose(f);
+	 return;
+    }
+
     /*
      * If not an update restoration, create the temp database.  Always
      * create a temp policy db, even if we are not loading a dump file
@@ -2282,10 +2479,13 @@ load_db(argc, argv)
 	 goto error;
     }
     /* 
-     * grab an extra lock, since there are no other users
+     * grab an extra lock, since there are no other users, and buffer
+     * the records so they can be written in key order
      */
     if (!update) {
-	 kret = krb5_db_lock(kcontext, KRB5_LOCKMODE_EXCLUSIVE);
+	 kret = krb5_db_set_bulk_load(kcontext, TRUE);
+	 if (!kret)
+	      kret = krb5_db_lock(kcontext, KRB5_LOCKMODE_EXCLUSIVE);
 	 if (kret) {
 		 fprintf(stderr, dblock_err_fmt,
 			 programname, error_message(kret));
@@ -2295,12 +2495,21 @@ load_db(argc, argv)
     }
     
     if (restore_dump(programname, kcontext, (dumpfile) ? dumpfile : stdin_name,
-		     f, verbose, load, tmppol_db)) {
+		     f, verbose, load, tmppol_db, dumpfile == NULL)) {
 	 fprintf(stderr, restfail_fmt,
 		 programname, load->name);
 	 exit_status++;
     }
+    if (load_interrupted) {
+	 fprintf(stderr, interrupted_fmt, programname, stdin_name);
+	 exit_status++;
+    }
 
+    if (!update && (kret = krb5_db_set_bulk_load(kcontext, FALSE))) {
+	 fprintf(stderr, dbbulkerr_fmt,
+		 programname, dbname_tmp, error_message(kret));
+	 exit_status++;
+    }
     if (!update && (kret = krb5_db_unlock(kcontext))) {
 	 /* change this error? */
 	 fprintf(stderr, dbunlockerr_fmt,
@@ -2381,6 +2590,24 @@ error:
 	 }
     }
 
+    /*
+     * The database no longer matches its update log unless the log is
+     * what was loaded; slaves will need the whole database again.
+     */
+    if (!exit_status && load != &ulog_version) {
+	 if ((logname = ulog_name(dbname)) == NULL)
+	      kret = ENOMEM;
+	 else {
+	      kret = krb5_db_log_reset(kcontext, logname);
+	      free(logname);
+	 }
+	 if (kret) {
+	      fprintf(stderr, dblogerr_fmt, programname, dbname,
+		      error_message(kret));
+	      exit_status++;
+	 }
+    }
+
     if (dumpfile) {
 	 (void) krb5_lock_file(kcontext, fileno(f), KRB5_LOCKMODE_UNLOCK);
 	 fclose(f);
@@ -359,12 +359,12 @@ void dump_v4db(argc, argv)
 	  fprintf(f," 200001010459 197001020000 db_creation *\n");
 	}
 
-	(void) krb5_db_iterate(util_context, dump_v4_iterator, 
-			       (krb5_pointer) &arg);
+	(void) krb5_db_iterate_snapshot(util_context, dump_v4_iterator, 
+					(krb5_pointer) &arg);
 	if (argc == 2)
 		fclose(f);
 	if (argv[1])
-		update_ok_file(argv[1]);
+		update_ok_file(argv[1], NULL);
 }
 
 int handle_keys(arg)
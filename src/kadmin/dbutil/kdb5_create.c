@@ -57,6 +57,7 @@
 #include <k5-int.h>
 #include <kadm5/admin.h>
 #include <kadm5/adb.h>
+#include "kdb5_util.h"
 
 enum ap_op {
     NULL_KEY,				/* setup null keys */
@@ -155,6 +156,7 @@ void kdb5_create(argc, argv)
 
     krb5_error_code retval;
     char *mkey_fullname;
+    char *logname;
     char *pw_str = 0;
     int pw_size = 0;
     int do_stash = 0;
@@ -255,12 +257,21 @@ master key name '%s'\n",
 	com_err(argv[0], retval, "while initializing random key generator");
 	exit_status++; return;
     }
+    if ((retval = set_db_params(util_context))) {
+	com_err(argv[0], retval, "while setting database parameters");
+	exit_status++; return;
+    }
     if ((retval = krb5_db_create(util_context,
 				 global_params.dbname, crflags))) {
 	com_err(argv[0], retval, "while creating database '%s'",
 		global_params.dbname);
 	exit_status++; return;
     }
+    /* Any update log left from an old database no longer applies. */
+    if ((logname = ulog_name(global_params.dbname)) != NULL) {
+	(void) krb5_db_log_reset(util_context, logname);
+	free(logname);
+    }
     if (retval = krb5_db_fini(util_context)) {
         com_err(argv[0], retval, "while closing current database");
         exit_status++; return;
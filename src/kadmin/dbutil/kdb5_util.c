@@ -57,6 +57,7 @@
 #include <k5-int.h>
 #include <kadm5/admin.h>
 #include <kadm5/adb.h>
+#include <adm_proto.h>
 #include <time.h>
 #include "kdb5_util.h"
 
@@ -290,6 +291,28 @@ void set_dbname(argc, argv)
 }
 #endif
 
+/*
+ * Pass the database cache size, page size and fill factor given for
+ * the realm in kdc.conf on to the database library.
+ */
+krb5_error_code
+set_db_params(context)
+    krb5_context context;
+{
+    krb5_realm_params *rparams;
+    krb5_error_code retval;
+
+    if ((retval = krb5_read_realm_params(context, global_params.realm,
+					 (char *) NULL, (char *) NULL,
+					 &rparams)))
+	return retval;
+    retval = krb5_db_set_cache_params(context, rparams->realm_db_cachesize,
+				      rparams->realm_db_pagesize,
+				      rparams->realm_db_ffactor);
+    krb5_free_realm_params(context, rparams);
+    return retval;
+}
+
 /*
  * open_db_and_mkey: Opens the KDC and policy database, and sets the
  * global master_* variables.  Sets dbactive to TRUE if the databases
@@ -315,6 +338,11 @@ int open_db_and_mkey()
 	exit_status++;
 	return(1);
     } 
+    if ((retval = set_db_params(util_context))) {
+	com_err(progname, retval, "while setting database parameters");
+	exit_status++;
+	return(1);
+    }
     if ((retval = krb5_db_init(util_context))) {
 	com_err(progname, retval, "while initializing database");
 	exit_status++;
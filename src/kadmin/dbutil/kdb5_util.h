@@ -50,3 +50,9 @@ void parse_token
 
 int create_db_entry
 	PROTOTYPE((krb5_principal, krb5_db_entry *));
+
+char *ulog_name
+	PROTOTYPE((char *));
+
+krb5_error_code set_db_params
+	PROTOTYPE((krb5_context));
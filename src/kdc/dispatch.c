@@ -45,6 +45,7 @@ dispatch(pkt, from, portnum, response)
 
     krb5_error_code retval;
     krb5_kdc_req *as_req;
+    krb5_kdc_req_peek peek;
 
     /* decode incoming packet, and dispatch */
 
@@ -75,12 +76,20 @@ dispatch(pkt, from, portnum, response)
 	return 0;
     }
 #endif
+    /*
+     * Drop requests for realms we don't serve before decoding them.
+     * If the request can't be peeked at, decoding it reports why.
+     */
+    if (kdc_numrealms > 1 && !decode_krb5_kdc_req_peek(pkt, &peek) &&
+	!find_realm_data(peek.realm.data, (krb5_ui_4) peek.realm.length))
+	return KRB5KDC_ERR_WRONG_REALM;
+
     /* try TGS_REQ first; they are more common! */
 
     if (krb5_is_tgs_req(pkt)) {
 	retval = process_tgs_req(pkt, from, portnum, response);
     } else if (krb5_is_as_req(pkt)) {
-	if (!(retval = decode_krb5_as_req(pkt, &as_req))) {
+	if (!(retval = decode_krb5_as_req_borrowed(pkt, &as_req))) {
 	    /*
 	     * setup_server_realm() sets up the global realm-specific data
 	     * pointer.
@@ -88,7 +97,7 @@ dispatch(pkt, from, portnum, response)
 	    if (!(retval = setup_server_realm(as_req->server))) {
 		retval = process_as_req(as_req, from, portnum, response);
 	    }
-	    krb5_free_kdc_req(kdc_context, as_req);
+	    krb5_free_borrowed(kdc_context, as_req);
 	}
     }
 #ifdef KRB5_KRB4_COMPAT
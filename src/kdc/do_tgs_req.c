@@ -90,12 +90,18 @@ krb5_data **response;			/* filled in with a response packet */
     register int i;
     int firstpass = 1;
     const char	*status = 0;
+    krb5_principal orig_server = 0;
 
     session_key.contents = 0;
     
-    retval = decode_krb5_tgs_req(pkt, &request);
+    /*
+     * The request is decoded in place; its strings point into pkt, and
+     * its structure lives in a single arena freed by krb5_free_borrowed().
+     */
+    retval = decode_krb5_tgs_req_borrowed(pkt, &request);
     if (retval)
 	return retval;
+    orig_server = request->server;
 
     /*
      * setup_server_realm() sets up the global realm-specific data pointer.
@@ -637,8 +643,19 @@ cleanup:
     
     if (header_ticket)
 	krb5_free_ticket(kdc_context, header_ticket);
-    if (request)
-	krb5_free_kdc_req(kdc_context, request);
+    if (request) {
+	/* these were allocated after decoding, outside the arena */
+	if (request->unenc_authdata)
+	    krb5_free_authdata(kdc_context, request->unenc_authdata);
+	if (request->server != orig_server)
+	    krb5_free_principal(kdc_context, request->server);
+	if (request->second_ticket)
+	    for (i = 0; request->second_ticket[i]; i++)
+		if (request->second_ticket[i]->enc_part2)
+		    krb5_free_enc_tkt_part(kdc_context,
+					   request->second_ticket[i]->enc_part2);
+	krb5_free_borrowed(kdc_context, request);
+    }
     if (cname)
 	free(cname);
     if (sname)
@@ -762,7 +779,7 @@ int *nprincs;
 	    }
 	    krb5_princ_set_realm(kdc_context, *pl2, &tmp);
 
-	    krb5_free_principal(kdc_context, request->server);
+	    /* the old server is borrowed; process_tgs_req() frees this one */
 	    request->server = tmpprinc;
 	    if (krb5_unparse_name(kdc_context, request->server, &sname)) {
 		krb5_klog_syslog(LOG_INFO,
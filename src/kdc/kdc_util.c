@@ -208,7 +208,8 @@ kdc_process_tgs_req(request, from, pkt, ticket, subkey)
     krb5_ap_req 	* apreq;
     krb5_error_code 	  retval;
     krb5_data		  scratch1;
-    krb5_data 		* scratch = NULL;
+    krb5_data 		  scratch;
+    char		  scratchbuf[1024];
     krb5_boolean 	  foreign_server = FALSE;
     krb5_auth_context 	  auth_context = NULL;
     krb5_authenticator	* authenticator = NULL;
@@ -362,9 +363,19 @@ kdc_process_tgs_req(request, from, pkt, ticket, subkey)
     if (pkt && (fetch_asn1_field((unsigned char *) pkt->data,
 				 1, 4, &scratch1) >= 0)) {
 	if (comp_cksum(kdc_context, &scratch1, *ticket, his_cksum)) {
-	    if (!(retval = encode_krb5_kdc_req_body(request, &scratch))) 
-	        retval = comp_cksum(kdc_context, scratch, *ticket, his_cksum);
-	    krb5_free_data(kdc_context, scratch);
+	    scratch.data = scratchbuf;
+	    scratch.length = sizeof(scratchbuf);
+	    retval = encode_krb5_kdc_req_body_into(request, &scratch);
+	    if (retval == ASN1_OVERFLOW) {
+		if ((scratch.data = malloc(scratch.length)) == NULL)
+		    retval = ENOMEM;
+		else
+		    retval = encode_krb5_kdc_req_body_into(request, &scratch);
+	    }
+	    if (!retval)
+	        retval = comp_cksum(kdc_context, &scratch, *ticket, his_cksum);
+	    if (scratch.data && scratch.data != scratchbuf)
+		free(scratch.data);
 	}
     }
 
@@ -120,6 +120,8 @@ krb5_error_code kdc_initialize_rcache PROTOTYPE((krb5_context, char *));
 
 krb5_error_code setup_server_realm PROTOTYPE((krb5_principal));
 
+void log_db_stats PROTOTYPE((void));
+
 /* network.c */
 krb5_error_code listen_and_process PROTOTYPE((const char *));
 krb5_error_code setup_network PROTOTYPE((const char *));
@@ -44,8 +44,6 @@
 #include <netinet/in.h>
 #endif
 
-kdc_realm_t *find_realm_data PROTOTYPE((char *, krb5_ui_4));
-
 void usage PROTOTYPE((char *));
 
 krb5_sigtype request_exit PROTOTYPE((int));
@@ -96,7 +94,7 @@ setup_server_realm(sprinc)
     if (kdc_numrealms > 1) {
 	if (!(newrealm = find_realm_data(sprinc->realm.data,
 					 (krb5_ui_4) sprinc->realm.length)))
-	    kret = ENOENT;
+	    kret = KRB5KDC_ERR_WRONG_REALM;
 	else
 	    kdc_active_realm = newrealm;
     }
@@ -169,9 +167,11 @@ init_realm(progname, rdp, realm, def_dbname, def_mpname,
     krb5_key_data	*kdata;
     krb5_key_salt_tuple	*kslist;
     krb5_int32		nkslist;
+    krb5_int32		db_cachesize, db_pagesize, db_ffactor;
     int			i;
 
     db_inited = 0;
+    db_cachesize = db_pagesize = db_ffactor = 0;
     memset((char *) rdp, 0, sizeof(kdc_realm_t));
     if (!realm) {
 	kret = EINVAL;
@@ -266,6 +266,13 @@ init_realm(progname, rdp, realm, def_dbname, def_mpname,
 	}
     }
 
+    /* Handle database cache size, page size and fill factor */
+    if (rparams) {
+	db_cachesize = rparams->realm_db_cachesize;
+	db_pagesize = rparams->realm_db_pagesize;
+	db_ffactor = rparams->realm_db_ffactor;
+    }
+
     if (rparams)
 	krb5_free_realm_params(rdp->realm_context, rparams);
 
@@ -311,6 +318,13 @@ init_realm(progname, rdp, realm, def_dbname, def_mpname,
 		rdp->realm_dbname, realm);
 	goto whoops;
     }
+    if ((kret = krb5_db_set_cache_params(rdp->realm_context, db_cachesize,
+					 db_pagesize, db_ffactor))) {
+	com_err(progname, kret,
+		"while setting database cache parameters for realm %s",
+		realm);
+	goto whoops;
+    }
     if ((kret = krb5_db_init(rdp->realm_context))) {
 	com_err(progname, kret,
 		"while initializing database for realm %s", realm);
@@ -725,6 +739,25 @@ initialize_realms(kcontext, argc, argv)
     return;
 }
 
+/*
+ * Log how well the database cache of each realm is doing.
+ */
+void
+log_db_stats()
+{
+    krb5_db_cache_stats st;
+    int i;
+
+    for (i = 0; i < kdc_numrealms; i++) {
+	if (krb5_db_get_cache_stats(kdc_realmlist[i]->realm_context, &st))
+	    continue;
+	krb5_klog_syslog(LOG_INFO, "%s: database cache: %lu hits, "
+			 "%lu misses, %lu evictions, %lu/%lu pages",
+			 kdc_realmlist[i]->realm_name, st.hits, st.misses,
+			 st.evictions, st.cached, st.maxcache);
+    }
+}
+
 void
 finish_realms(prog)
     char *prog;
@@ -828,6 +861,7 @@ int main(argc, argv)
 	com_err(argv[0], retval, "while shutting down network");
 	errout++;
     }
+    log_db_stats();
     krb5_klog_syslog(LOG_INFO, "shutting down");
     krb5_klog_close(kdc_context);
     finish_realms(argv[0]);
@@ -546,6 +546,7 @@ const char *prog;
     
     while (!signal_requests_exit) {
 	if (signal_requests_hup) {
+	    log_db_stats();
 	    krb5_klog_reopen();
 	    signal_requests_hup = 0;
 	}
@@ -0,0 +1,329 @@
+/*
+ * lib/crypto/aead.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ * 
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ * 
+ *
+ * Internal helpers for the scatter/gather (krb5_crypto_iov) interfaces.
+ */
+
+#include "k5-int.h"
+#include "aead.h"
+
+/* return the single buffer of the given type, or NULL */
+
+krb5_crypto_iov *
+krb5int_c_locate_iov(data, num_data, type)
+     krb5_crypto_iov *data;
+     size_t num_data;
+     krb5_cryptotype type;
+{
+    size_t i;
+    krb5_crypto_iov *iov = NULL;
+
+    for (i = 0; i < num_data; i++) {
+	if (data[i].flags == type) {
+	    if (iov != NULL)
+		return(NULL);	/* can't be used twice */
+	    iov = &data[i];
+	}
+    }
+
+    return(iov);
+}
+
+/* total length of the encrypted (or, if sign, the signed) buffers */
+
+size_t
+krb5int_c_iov_length(data, num_data, sign)
+     krb5_const krb5_crypto_iov *data;
+     size_t num_data;
+     int sign;
+{
+    size_t i, len = 0;
+
+    for (i = 0; i < num_data; i++) {
+	if (sign ? SIGN_IOV(&data[i]) : ENCRYPT_IOV(&data[i]))
+	    len += data[i].data.length;
+    }
+
+    return(len);
+}
+
+/* Make a krb5_data vector pointing at the encrypted (or signed)
+   buffers, suitable for the multiple-input hash interfaces.  The
+   vector has at least one entry.  The caller frees *input. */
+
+krb5_error_code
+krb5int_c_iov_to_data(data, num_data, sign, icount, input)
+     krb5_const krb5_crypto_iov *data;
+     size_t num_data;
+     int sign;
+     unsigned int *icount;
+     krb5_data **input;
+{
+    size_t i;
+    unsigned int j;
+    krb5_data *d;
+
+    if ((d = (krb5_data *) malloc(sizeof(krb5_data)*(num_data+1))) == NULL)
+	return(ENOMEM);
+
+    for (i = 0, j = 0; i < num_data; i++) {
+	if (sign ? SIGN_IOV(&data[i]) : ENCRYPT_IOV(&data[i]))
+	    d[j++] = data[i].data;
+    }
+
+    if (j == 0) {
+	d[0].length = 0;
+	d[0].data = NULL;
+	j = 1;
+    }
+
+    *icount = j;
+    *input = d;
+
+    return(0);
+}
+
+/* copy the encrypted (or signed) buffers into one new buffer, for
+   the providers which only take a single input */
+
+krb5_error_code
+krb5int_c_iov_gather(data, num_data, sign, output)
+     krb5_const krb5_crypto_iov *data;
+     size_t num_data;
+     int sign;
+     krb5_data *output;
+{
+    size_t i, len;
+    char *p;
+
+    len = krb5int_c_iov_length(data, num_data, sign);
+
+    if ((output->data = (char *) malloc(len ? len : 1)) == NULL)
+	return(ENOMEM);
+    output->length = len;
+
+    for (i = 0, p = output->data; i < num_data; i++) {
+	if (sign ? SIGN_IOV(&data[i]) : ENCRYPT_IOV(&data[i])) {
+	    memcpy(p, data[i].data.data, data[i].data.length);
+	    p += data[i].data.length;
+	}
+    }
+
+    return(0);
+}
+
+/*
+ * Find the next span of cipher blocks.  If at least one whole block
+ * sits in the current buffer, *ptr and *len describe the longest run
+ * of whole blocks there, and they can be processed in place.
+ * Otherwise the next block straddles buffers; it is gathered into
+ * block, *ptr is set to block and *len to blocksize, and the caller
+ * must give it back with krb5int_c_iov_put_block using the cursor as
+ * it was before this call.  Returns 0 when there is no data left.
+ */
+
+int
+krb5int_c_iov_next_span(data, num_data, blocksize, cursor, block, ptr, len)
+     krb5_crypto_iov *data;
+     size_t num_data;
+     size_t blocksize;
+     struct krb5int_iov_cursor *cursor;
+     unsigned char *block;
+     unsigned char **ptr;
+     size_t *len;
+{
+    size_t i, n, avail;
+    krb5_crypto_iov *iov;
+
+    /* skip buffers which are not encrypted, or which are used up */
+    while (cursor->iov_pos < num_data) {
+	iov = &data[cursor->iov_pos];
+	if (ENCRYPT_IOV(iov) && cursor->data_pos < iov->data.length)
+	    break;
+	cursor->iov_pos++;
+	cursor->data_pos = 0;
+    }
+
+    if (cursor->iov_pos == num_data)
+	return(0);
+
+    iov = &data[cursor->iov_pos];
+    avail = iov->data.length - cursor->data_pos;
+
+    if (avail >= blocksize) {
+	*ptr = (unsigned char *) iov->data.data + cursor->data_pos;
+	*len = avail - (avail % blocksize);
+	cursor->data_pos += *len;
+	return(1);
+    }
+
+    /* gather a straddling block */
+    for (i = 0; i < blocksize && cursor->iov_pos < num_data; ) {
+	iov = &data[cursor->iov_pos];
+	if (!ENCRYPT_IOV(iov) || cursor->data_pos == iov->data.length) {
+	    cursor->iov_pos++;
+	    cursor->data_pos = 0;
+	    continue;
+	}
+	n = iov->data.length - cursor->data_pos;
+	if (n > blocksize - i)
+	    n = blocksize - i;
+	memcpy(block + i, iov->data.data + cursor->data_pos, n);
+	cursor->data_pos += n;
+	i += n;
+    }
+
+    /* short final blocks are rejected by the callers, but be safe */
+    if (i < blocksize)
+	memset(block + i, 0, blocksize - i);
+
+    *ptr = block;
+    *len = blocksize;
+    return(1);
+}
+
+/* scatter a block gathered by krb5int_c_iov_next_span back out */
+
+void
+krb5int_c_iov_put_block(data, num_data, blocksize, cursor, block)
+     krb5_crypto_iov *data;
+     size_t num_data;
+     size_t blocksize;
+     struct krb5int_iov_cursor *cursor;
+     unsigned char *block;
+{
+    size_t i, n;
+    krb5_crypto_iov *iov;
+
+    for (i = 0; i < blocksize && cursor->iov_pos < num_data; ) {
+	iov = &data[cursor->iov_pos];
+	if (!ENCRYPT_IOV(iov) || cursor->data_pos == iov->data.length) {
+	    cursor->iov_pos++;
+	    cursor->data_pos = 0;
+	    continue;
+	}
+	n = iov->data.length - cursor->data_pos;
+	if (n > blocksize - i)
+	    n = blocksize - i;
+	memcpy(iov->data.data + cursor->data_pos, block + i, n);
+	cursor->data_pos += n;
+	i += n;
+    }
+}
+
+/* copy out the last blocksize bytes of the encrypted buffers; this is
+   the CBC chaining value after encryption */
+
+void
+krb5int_c_iov_last_block(data, num_data, blocksize, block)
+     krb5_crypto_iov *data;
+     size_t num_data;
+     size_t blocksize;
+     unsigned char *block;
+{
+    size_t i, n, need;
+
+    need = blocksize;
+    for (i = num_data; i > 0 && need > 0; i--) {
+	if (!ENCRYPT_IOV(&data[i-1]))
+	    continue;
+	n = data[i-1].data.length;
+	if (n > need)
+	    n = need;
+	memcpy(block + need - n,
+	       data[i-1].data.data + data[i-1].data.length - n, n);
+	need -= n;
+    }
+
+    if (need)
+	memset(block, 0, need);
+}
+
+/*
+ * Check the iov layout against the header and trailer sizes of the
+ * enctype.  When encrypting, the header, trailer and padding buffers
+ * are trimmed to the sizes actually used, and the padding is zeroed;
+ * when decrypting, they must be the right size already and the
+ * encrypted buffers must hold a whole number of blocks.
+ */
+
+krb5_error_code
+krb5int_c_iov_prepare(data, num_data, headerlen, trailerlen, blocksize,
+		      encrypt, header, trailer)
+     krb5_crypto_iov *data;
+     size_t num_data;
+     size_t headerlen;
+     size_t trailerlen;
+     size_t blocksize;
+     int encrypt;
+     krb5_crypto_iov **header;
+     krb5_crypto_iov **trailer;
+{
+    size_t i, datalen, padlen;
+    krb5_crypto_iov *hiov, *tiov, *piov;
+
+    hiov = krb5int_c_locate_iov(data, num_data, KRB5_CRYPTO_TYPE_HEADER);
+    tiov = krb5int_c_locate_iov(data, num_data, KRB5_CRYPTO_TYPE_TRAILER);
+    piov = krb5int_c_locate_iov(data, num_data, KRB5_CRYPTO_TYPE_PADDING);
+
+    if (headerlen && (hiov == NULL || hiov->data.length < headerlen))
+	return(KRB5_BAD_MSIZE);
+    if (trailerlen && (tiov == NULL || tiov->data.length < trailerlen))
+	return(KRB5_BAD_MSIZE);
+
+    if (encrypt) {
+	datalen = headerlen;
+	for (i = 0; i < num_data; i++)
+	    if (data[i].flags == KRB5_CRYPTO_TYPE_DATA)
+		datalen += data[i].data.length;
+
+	padlen = krb5_roundup(datalen, blocksize) - datalen;
+
+	if (padlen) {
+	    if (piov == NULL || piov->data.length < padlen)
+		return(KRB5_BAD_MSIZE);
+	    memset(piov->data.data, 0, padlen);
+	}
+	if (piov != NULL)
+	    piov->data.length = padlen;
+	if (hiov != NULL)
+	    hiov->data.length = headerlen;
+	if (tiov != NULL)
+	    tiov->data.length = trailerlen;
+    } else {
+	if (hiov != NULL && hiov->data.length != headerlen)
+	    return(KRB5_BAD_MSIZE);
+	if (tiov != NULL && tiov->data.length != trailerlen)
+	    return(KRB5_BAD_MSIZE);
+	if (krb5int_c_iov_length(data, num_data, 0) % blocksize)
+	    return(KRB5_BAD_MSIZE);
+    }
+
+    *header = hiov;
+    *trailer = tiov;
+
+    return(0);
+}
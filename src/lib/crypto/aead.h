@@ -0,0 +1,85 @@
+/*
+ * lib/crypto/aead.h
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ * 
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ * 
+ *
+ * Internal helpers for the scatter/gather (krb5_crypto_iov) interfaces.
+ */
+
+#ifndef KRB5_CRYPTO_AEAD_H
+#define KRB5_CRYPTO_AEAD_H
+
+#include "k5-int.h"
+
+/* buffers which are run through the cipher */
+#define ENCRYPT_IOV(_iov)	((_iov)->flags == KRB5_CRYPTO_TYPE_HEADER || \
+				 (_iov)->flags == KRB5_CRYPTO_TYPE_DATA || \
+				 (_iov)->flags == KRB5_CRYPTO_TYPE_PADDING)
+
+/* buffers which are covered by the integrity check */
+#define SIGN_IOV(_iov)		(ENCRYPT_IOV(_iov) || \
+				 (_iov)->flags == KRB5_CRYPTO_TYPE_SIGN_ONLY)
+
+/* position of a block cursor within an iov array */
+struct krb5int_iov_cursor {
+    size_t iov_pos;		/* index into the iov array */
+    size_t data_pos;		/* offset within that buffer */
+};
+
+krb5_crypto_iov *krb5int_c_locate_iov
+KRB5_PROTOTYPE((krb5_crypto_iov *data, size_t num_data,
+		krb5_cryptotype type));
+
+size_t krb5int_c_iov_length
+KRB5_PROTOTYPE((krb5_const krb5_crypto_iov *data, size_t num_data,
+		int sign));
+
+krb5_error_code krb5int_c_iov_to_data
+KRB5_PROTOTYPE((krb5_const krb5_crypto_iov *data, size_t num_data,
+		int sign, unsigned int *icount, krb5_data **input));
+
+krb5_error_code krb5int_c_iov_gather
+KRB5_PROTOTYPE((krb5_const krb5_crypto_iov *data, size_t num_data,
+		int sign, krb5_data *output));
+
+int krb5int_c_iov_next_span
+KRB5_PROTOTYPE((krb5_crypto_iov *data, size_t num_data, size_t blocksize,
+		struct krb5int_iov_cursor *cursor, unsigned char *block,
+		unsigned char **ptr, size_t *len));
+
+void krb5int_c_iov_put_block
+KRB5_PROTOTYPE((krb5_crypto_iov *data, size_t num_data, size_t blocksize,
+		struct krb5int_iov_cursor *cursor, unsigned char *block));
+
+void krb5int_c_iov_last_block
+KRB5_PROTOTYPE((krb5_crypto_iov *data, size_t num_data, size_t blocksize,
+		unsigned char *block));
+
+krb5_error_code krb5int_c_iov_prepare
+KRB5_PROTOTYPE((krb5_crypto_iov *data, size_t num_data,
+		size_t headerlen, size_t trailerlen, size_t blocksize,
+		int encrypt, krb5_crypto_iov **header,
+		krb5_crypto_iov **trailer));
+
+#endif /* KRB5_CRYPTO_AEAD_H */
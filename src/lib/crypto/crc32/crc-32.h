@@ -63,6 +63,10 @@ void
 mit_crc32 PROTOTYPE((krb5_const krb5_pointer in, krb5_const size_t in_length,
 		     unsigned long *c));
 
+void
+mit_crc32_update PROTOTYPE((krb5_const krb5_pointer in,
+			    krb5_const size_t in_length, unsigned long *c));
+
 extern krb5_checksum_entry crc32_cksumtable_entry;
 
 #endif /* KRB5_CRC32__ */
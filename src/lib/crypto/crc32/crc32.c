@@ -151,9 +151,21 @@ mit_crc32(in, in_length, cksum)
     krb5_const krb5_pointer in;
     krb5_const size_t in_length;
     unsigned long *cksum;
+{
+    *cksum = 0;
+    mit_crc32_update(in, in_length, cksum);
+}
+
+/* continue a crc started by mit_crc32 (or from zero) over more data */
+
+void
+mit_crc32_update(in, in_length, cksum)
+    krb5_const krb5_pointer in;
+    krb5_const size_t in_length;
+    unsigned long *cksum;
 {
     register u_char *data;
-    register u_long c = 0;
+    register u_long c = *cksum;
     register int idx;
     size_t i;
 
@@ -0,0 +1,83 @@
+/*
+ * lib/crypto/crypto_length.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ * 
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ * krb5_c_crypto_length, krb5_c_padding_length: sizes of the buffers
+ * a caller must supply to krb5_c_encrypt_iov.
+ */
+
+#include "k5-int.h"
+#include "etypes.h"
+
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_c_crypto_length(context, enctype, type, size)
+     krb5_context context;
+     krb5_enctype enctype;
+     krb5_cryptotype type;
+     size_t *size;
+{
+    int i;
+
+    for (i=0; i<krb5_enctypes_length; i++) {
+	if (krb5_enctypes_list[i].etype == enctype)
+	    break;
+    }
+
+    if (i == krb5_enctypes_length)
+	return(KRB5_BAD_ENCTYPE);
+
+    if (krb5_enctypes_list[i].crypto_length == NULL)
+	return(KRB5_BAD_ENCTYPE);
+
+    return((*(krb5_enctypes_list[i].crypto_length))
+	   (krb5_enctypes_list[i].enc, krb5_enctypes_list[i].hash,
+	    type, size));
+}
+
+/* the padding depends on the header too, since the header is
+   encrypted along with the data */
+
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_c_padding_length(context, enctype, data_length, size)
+     krb5_context context;
+     krb5_enctype enctype;
+     size_t data_length;
+     size_t *size;
+{
+    krb5_error_code ret;
+    size_t headerlen, blocksize, len;
+
+    if ((ret = krb5_c_crypto_length(context, enctype,
+				    KRB5_CRYPTO_TYPE_HEADER, &headerlen)))
+	return(ret);
+    if ((ret = krb5_c_crypto_length(context, enctype,
+				    KRB5_CRYPTO_TYPE_PADDING, &blocksize)))
+	return(ret);
+
+    len = headerlen + data_length;
+
+    *size = krb5_roundup(len, blocksize) - len;
+
+    return(0);
+}
@@ -0,0 +1,111 @@
+/*
+ * lib/crypto/decrypt_batch.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ * 
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ * krb5_c_decrypt_batch: decrypt a batch of independent messages.
+ */
+
+#include "k5-int.h"
+#include "etypes.h"
+
+/* Jobs are grouped by enctype, and each group is handed to the
+   enctype's batch function if it has one, which can share work
+   between the jobs; otherwise they are decrypted one at a time.  The
+   return value is nonzero only if the batch could not be processed
+   at all; the outcome of each job is in its result field. */
+
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_c_decrypt_batch(context, jobs, num_jobs)
+     krb5_context context;
+     krb5_crypto_job *jobs;
+     size_t num_jobs;
+{
+    krb5_crypto_job **group;
+    char *done;
+    size_t i, j, n;
+    int e;
+    krb5_error_code ret;
+
+    if (num_jobs == 0)
+	return(0);
+
+    if ((group = (krb5_crypto_job **)
+	 malloc(num_jobs*sizeof(krb5_crypto_job *))) == NULL)
+	return(ENOMEM);
+    if ((done = (char *) malloc(num_jobs)) == NULL) {
+	free(group);
+	return(ENOMEM);
+    }
+    memset(done, 0, num_jobs);
+
+    ret = 0;
+
+    for (i=0; i<num_jobs; i++) {
+	if (done[i])
+	    continue;
+
+	for (e=0; e<krb5_enctypes_length; e++) {
+	    if (krb5_enctypes_list[e].etype == jobs[i].key->enctype)
+		break;
+	}
+
+	/* collect the rest of the jobs with this enctype */
+
+	n = 0;
+	for (j=i; j<num_jobs; j++) {
+	    if (done[j] || (jobs[j].key->enctype != jobs[i].key->enctype))
+		continue;
+	    done[j] = 1;
+
+	    if ((e == krb5_enctypes_length) ||
+		((jobs[j].input->enctype != ENCTYPE_UNKNOWN) &&
+		 (jobs[j].input->enctype != jobs[j].key->enctype)))
+		jobs[j].result = KRB5_BAD_ENCTYPE;
+	    else
+		group[n++] = &jobs[j];
+	}
+
+	if (n == 0)
+	    continue;
+
+	if (krb5_enctypes_list[e].decrypt_batch) {
+	    if ((ret = ((*(krb5_enctypes_list[e].decrypt_batch))
+			(krb5_enctypes_list[e].enc, krb5_enctypes_list[e].hash,
+			 group, n))))
+		break;
+	} else {
+	    for (j=0; j<n; j++)
+		group[j]->result =
+		    (*(krb5_enctypes_list[e].decrypt))
+		    (krb5_enctypes_list[e].enc, krb5_enctypes_list[e].hash,
+		     group[j]->key, group[j]->usage, group[j]->ivec,
+		     &group[j]->input->ciphertext, group[j]->output);
+	}
+    }
+
+    free(done);
+    free(group);
+
+    return(ret);
+}
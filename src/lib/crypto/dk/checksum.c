@@ -37,6 +37,20 @@ krb5_dk_make_checksum(hash, key, usage, input, output)
      krb5_keyusage usage;
      krb5_const krb5_data *input;
      krb5_data *output;
+{
+    return(krb5_dk_make_checksum_multi(hash, key, usage, 1, input, output));
+}
+
+/* this takes multiple inputs, like krb5_hmac, to avoid copying */
+
+krb5_error_code
+krb5_dk_make_checksum_multi(hash, key, usage, icount, input, output)
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     unsigned int icount;
+     krb5_const krb5_data *input;
+     krb5_data *output;
 {
     int i;
     const struct krb5_enc_provider *enc;
@@ -88,9 +102,7 @@ krb5_dk_make_checksum(hash, key, usage, input, output)
 
     /* hash the data */
 
-    datain = *input;
-
-    if ((ret = krb5_hmac(hash, &kc, 1, &datain, output)) != 0)
+    if ((ret = krb5_hmac(hash, &kc, icount, input, output)) != 0)
 	memset(output->data, 0, output->length);
 
     /* ret is set correctly by the prior call */
@@ -45,6 +45,30 @@ KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
 		krb5_const krb5_data *ivec, krb5_const krb5_data *input,
 		krb5_data *arg_output));
 
+krb5_error_code krb5_dk_decrypt_batch
+KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
+		krb5_const struct krb5_hash_provider *hash,
+		krb5_crypto_job **jobs, size_t num_jobs));
+
+krb5_error_code krb5_dk_crypto_length
+KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
+		krb5_const struct krb5_hash_provider *hash,
+		krb5_cryptotype type, size_t *size));
+
+krb5_error_code krb5_dk_encrypt_iov
+KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
+		krb5_const struct krb5_hash_provider *hash,
+		krb5_const krb5_keyblock *key, krb5_keyusage usage,
+		krb5_const krb5_data *ivec,
+		krb5_crypto_iov *data, size_t num_data));
+
+krb5_error_code krb5_dk_decrypt_iov
+KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
+		krb5_const struct krb5_hash_provider *hash,
+		krb5_const krb5_keyblock *key, krb5_keyusage usage,
+		krb5_const krb5_data *ivec,
+		krb5_crypto_iov *data, size_t num_data));
+
 krb5_error_code krb5_dk_string_to_key
 KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc, 
 		krb5_const krb5_data *string, krb5_const krb5_data *salt,
@@ -60,6 +84,12 @@ KRB5_PROTOTYPE((krb5_const struct krb5_hash_provider *hash,
 		krb5_const krb5_keyblock *key, krb5_keyusage usage,
 		krb5_const krb5_data *input, krb5_data *output));
 
+krb5_error_code krb5_dk_make_checksum_multi
+KRB5_PROTOTYPE((krb5_const struct krb5_hash_provider *hash,
+		krb5_const krb5_keyblock *key, krb5_keyusage usage,
+		unsigned int icount, krb5_const krb5_data *input,
+		krb5_data *output));
+
 #ifdef ATHENA_DES3_KLUDGE
 void krb5_marc_dk_encrypt_length
 KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
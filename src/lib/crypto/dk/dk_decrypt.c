@@ -26,9 +26,135 @@
 
 #include "k5-int.h"
 #include "dk.h"
+#include "aead.h"
 
 #define K5CLENGTH 5 /* 32 bit net byte order integer + one byte seed */
 
+/* derive the encryption and integrity keys for a usage.  The
+   contents of ke and ki must already be allocated, at the key length
+   of the enc provider. */
+
+static krb5_error_code
+dk_derive_keys(enc, key, usage, ke, ki)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     krb5_keyblock *ke;
+     krb5_keyblock *ki;
+{
+    krb5_error_code ret;
+    krb5_data d1;
+    unsigned char constantdata[K5CLENGTH];
+
+    d1.data = (char *) constantdata;
+    d1.length = K5CLENGTH;
+
+    d1.data[0] = (usage>>24)&0xff;
+    d1.data[1] = (usage>>16)&0xff;
+    d1.data[2] = (usage>>8)&0xff;
+    d1.data[3] = usage&0xff;
+
+    d1.data[4] = 0xAA;
+
+    if ((ret = krb5_derive_key(enc, key, ke, &d1)) != 0)
+	return(ret);
+
+    d1.data[4] = 0x55;
+
+    return(krb5_derive_key(enc, key, ki, &d1));
+}
+
+/* decrypt and verify with keys already derived */
+
+static krb5_error_code
+dk_decrypt_derived(enc, hash, ke, ki, ivec, input, output)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_const krb5_keyblock *ke;
+     krb5_const krb5_keyblock *ki;
+     krb5_const krb5_data *ivec;
+     krb5_const krb5_data *input;
+     krb5_data *output;
+{
+    krb5_error_code ret;
+    size_t hashsize, blocksize, enclen, plainlen;
+    unsigned char *plaindata, *cksum, *cn;
+    krb5_data d1, d2;
+
+    (*(hash->hash_size))(&hashsize);
+    (*(enc->block_size))(&blocksize);
+
+    if (input->length < blocksize+hashsize)
+	return(KRB5_BAD_MSIZE);
+
+    enclen = input->length - hashsize;
+
+    if ((plaindata = (unsigned char *) malloc(enclen)) == NULL)
+	return(ENOMEM);
+    if ((cksum = (unsigned char *) malloc(hashsize)) == NULL) {
+	free(plaindata);
+	return(ENOMEM);
+    }
+
+    /* decrypt the ciphertext */
+
+    d1.length = enclen;
+    d1.data = input->data;
+
+    d2.length = enclen;
+    d2.data = (char *) plaindata;
+
+    if ((ret = ((*(enc->decrypt))(ke, ivec, &d1, &d2))) != 0)
+	goto cleanup;
+
+    if (ivec != NULL && ivec->length == blocksize)
+	cn = (unsigned char *) d1.data + d1.length - blocksize;
+    else
+	cn = NULL;
+
+    /* verify the hash */
+
+    d1.length = hashsize;
+    d1.data = (char *) cksum;
+
+    if ((ret = krb5_hmac(hash, ki, 1, &d2, &d1)) != 0)
+	goto cleanup;
+
+    if (memcmp(cksum, input->data+enclen, hashsize) != 0) {
+	ret = KRB5KRB_AP_ERR_BAD_INTEGRITY;
+	goto cleanup;
+    }
+
+    /* because this encoding isn't self-describing wrt length, the
+       best we can do here is to compute the length minus the
+       confounder. */
+
+    plainlen = enclen - blocksize;
+
+    if (output->length < plainlen) {
+	ret = KRB5_BAD_MSIZE;
+	goto cleanup;
+    }
+
+    output->length = plainlen;
+
+    memcpy(output->data, d2.data+blocksize, output->length);
+
+    if (cn != NULL)
+	memcpy(ivec->data, cn, blocksize);
+
+    ret = 0;
+
+cleanup:
+    memset(plaindata, 0, enclen);
+    memset(cksum, 0, hashsize);
+
+    free(cksum);
+    free(plaindata);
+
+    return(ret);
+}
+
 krb5_error_code
 krb5_dk_decrypt(enc, hash, key, usage, ivec, input, output)
      krb5_const struct krb5_enc_provider *enc;
@@ -40,19 +166,153 @@ krb5_dk_decrypt(enc, hash, key, usage, ivec, input, output)
      krb5_data *output;
 {
     krb5_error_code ret;
-    size_t hashsize, blocksize, keybytes, keylength, enclen, plainlen;
-    unsigned char *plaindata, *kedata, *kidata, *cksum, *cn;
+    size_t keybytes, keylength;
+    unsigned char *kedata, *kidata;
     krb5_keyblock ke, ki;
-    krb5_data d1, d2;
-    unsigned char constantdata[K5CLENGTH];
 
-    /* allocate and set up ciphertext and to-be-derived keys */
+    /* allocate and set up to-be-derived keys */
+
+    (*(enc->keysize))(&keybytes, &keylength);
+
+    if ((kedata = (unsigned char *) malloc(keylength)) == NULL)
+	return(ENOMEM);
+    if ((kidata = (unsigned char *) malloc(keylength)) == NULL) {
+	free(kedata);
+	return(ENOMEM);
+    }
+
+    ke.contents = kedata;
+    ke.length = keylength;
+    ki.contents = kidata;
+    ki.length = keylength;
+
+    /* derive the keys */
+
+    if ((ret = dk_derive_keys(enc, key, usage, &ke, &ki)) == 0)
+	ret = dk_decrypt_derived(enc, hash, &ke, &ki, ivec, input, output);
+
+    memset(kedata, 0, keylength);
+    memset(kidata, 0, keylength);
+
+    free(kidata);
+    free(kedata);
+
+    return(ret);
+}
+
+/* Servers decrypt many messages with the same key and usage (the KDC
+   and its tickets, for instance), and deriving the keys costs about
+   as much as decrypting a small message, so derive them once for
+   each distinct key and usage in the batch. */
+
+struct dk_batch_keys {
+    krb5_const krb5_keyblock *key;
+    krb5_keyusage usage;
+    krb5_error_code ret;		/* from deriving the keys */
+    krb5_keyblock ke, ki;
+};
+
+static int
+dk_same_key(k1, k2)
+     krb5_const krb5_keyblock *k1;
+     krb5_const krb5_keyblock *k2;
+{
+    return((k1 == k2) ||
+	   ((k1->enctype == k2->enctype) && (k1->length == k2->length) &&
+	    (memcmp(k1->contents, k2->contents, k1->length) == 0)));
+}
+
+krb5_error_code
+krb5_dk_decrypt_batch(enc, hash, jobs, num_jobs)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_crypto_job **jobs;
+     size_t num_jobs;
+{
+    struct dk_batch_keys *keys, *k;
+    size_t i, j, nkeys, keybytes, keylength;
+    krb5_crypto_job *job;
+
+    (*(enc->keysize))(&keybytes, &keylength);
+
+    if ((keys = (struct dk_batch_keys *)
+	 malloc(num_jobs*sizeof(struct dk_batch_keys))) == NULL)
+	return(ENOMEM);
+
+    nkeys = 0;
+
+    for (i=0; i<num_jobs; i++) {
+	job = jobs[i];
+
+	for (j=0; j<nkeys; j++) {
+	    if ((keys[j].usage == job->usage) &&
+		dk_same_key(keys[j].key, job->key))
+		break;
+	}
+
+	k = &keys[j];
+
+	if (j == nkeys) {
+	    k->key = job->key;
+	    k->usage = job->usage;
+	    k->ke.length = keylength;
+	    k->ki.length = keylength;
+	    if ((k->ke.contents =
+		 (krb5_octet *) malloc(2*keylength)) == NULL) {
+		job->result = ENOMEM;
+		continue;
+	    }
+	    k->ki.contents = k->ke.contents + keylength;
+	    k->ret = dk_derive_keys(enc, job->key, job->usage, &k->ke, &k->ki);
+	    nkeys++;
+	}
+
+	if (k->ret)
+	    job->result = k->ret;
+	else
+	    job->result = dk_decrypt_derived(enc, hash, &k->ke, &k->ki,
+					     job->ivec,
+					     &job->input->ciphertext,
+					     job->output);
+    }
+
+    for (j=0; j<nkeys; j++) {
+	memset(keys[j].ke.contents, 0, 2*keylength);
+	free(keys[j].ke.contents);
+    }
+    free(keys);
+
+    return(0);
+}
+
+krb5_error_code
+krb5_dk_decrypt_iov(enc, hash, key, usage, ivec, data, num_data)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     krb5_const krb5_data *ivec;
+     krb5_crypto_iov *data;
+     size_t num_data;
+{
+    krb5_error_code ret;
+    size_t hashsize, blocksize, keybytes, keylength;
+    unsigned char *kedata, *kidata, *cksum, *cn;
+    krb5_keyblock ke, ki;
+    krb5_data d1, *hashin;
+    unsigned char constantdata[K5CLENGTH];
+    krb5_crypto_iov *header, *trailer;
+    unsigned int icount;
 
     (*(hash->hash_size))(&hashsize);
     (*(enc->block_size))(&blocksize);
     (*(enc->keysize))(&keybytes, &keylength);
 
-    enclen = input->length - hashsize;
+    if ((ret = krb5int_c_iov_prepare(data, num_data, blocksize, hashsize,
+				     blocksize, 0, &header, &trailer)))
+	return(ret);
+
+    /* allocate the to-be-derived keys */
 
     if ((kedata = (unsigned char *) malloc(keylength)) == NULL)
 	return(ENOMEM);
@@ -60,13 +320,13 @@ krb5_dk_decrypt(enc, hash, key, usage, ivec, input, output)
 	free(kedata);
 	return(ENOMEM);
     }
-    if ((plaindata = (unsigned char *) malloc(enclen)) == NULL) {
+    if ((cksum = (unsigned char *) malloc(hashsize)) == NULL) {
 	free(kidata);
 	free(kedata);
 	return(ENOMEM);
     }
-    if ((cksum = (unsigned char *) malloc(hashsize)) == NULL) {
-	free(plaindata);
+    if ((cn = (unsigned char *) malloc(blocksize)) == NULL) {
+	free(cksum);
 	free(kidata);
 	free(kedata);
 	return(ENOMEM);
@@ -79,7 +339,7 @@ krb5_dk_decrypt(enc, hash, key, usage, ivec, input, output)
 
     /* derive the keys */
 
-    d1.data = constantdata;
+    d1.data = (char *) constantdata;
     d1.length = K5CLENGTH;
 
     d1.data[0] = (usage>>24)&0xff;
@@ -97,49 +357,32 @@ krb5_dk_decrypt(enc, hash, key, usage, ivec, input, output)
     if ((ret = krb5_derive_key(enc, key, &ki, &d1)) != 0)
 	goto cleanup;
 
-    /* decrypt the ciphertext */
-
-    d1.length = enclen;
-    d1.data = input->data;
+    /* save the last ciphertext block, then decrypt in place */
 
-    d2.length = enclen;
-    d2.data = plaindata;
+    krb5int_c_iov_last_block(data, num_data, blocksize, cn);
 
-    if ((ret = ((*(enc->decrypt))(&ke, ivec, &d1, &d2))) != 0)
+    if ((ret = ((*(enc->decrypt_iov))(&ke, ivec, data, num_data))) != 0)
 	goto cleanup;
 
-    if (ivec != NULL && ivec->length == blocksize)
-	cn = d1.data + d1.length - blocksize;
-    else
-	cn = NULL;
-
     /* verify the hash */
 
+    if ((ret = krb5int_c_iov_to_data(data, num_data, 1, &icount, &hashin)))
+	goto cleanup;
+
     d1.length = hashsize;
-    d1.data = cksum;
+    d1.data = (char *) cksum;
 
-    if ((ret = krb5_hmac(hash, &ki, 1, &d2, &d1)) != 0)
+    ret = krb5_hmac(hash, &ki, icount, hashin, &d1);
+    free(hashin);
+    if (ret != 0)
 	goto cleanup;
 
-    if (memcmp(cksum, input->data+enclen, hashsize) != 0) {
+    if (memcmp(cksum, trailer->data.data, hashsize) != 0) {
 	ret = KRB5KRB_AP_ERR_BAD_INTEGRITY;
 	goto cleanup;
     }
 
-    /* because this encoding isn't self-describing wrt length, the
-       best we can do here is to compute the length minus the
-       confounder. */
-
-    plainlen = enclen - blocksize;
-
-    if (output->length < plainlen)
-	return(KRB5_BAD_MSIZE);
-
-    output->length = plainlen;
-
-    memcpy(output->data, d2.data+blocksize, output->length);
-
-    if (cn != NULL)
+    if (ivec != NULL && ivec->length == blocksize)
 	memcpy(ivec->data, cn, blocksize);
 
     ret = 0;
@@ -147,11 +390,10 @@ krb5_dk_decrypt(enc, hash, key, usage, ivec, input, output)
 cleanup:
     memset(kedata, 0, keylength);
     memset(kidata, 0, keylength);
-    memset(plaindata, 0, enclen);
     memset(cksum, 0, hashsize);
 
+    free(cn);
     free(cksum);
-    free(plaindata);
     free(kidata);
     free(kedata);
 
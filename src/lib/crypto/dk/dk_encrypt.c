@@ -26,6 +26,7 @@
 
 #include "k5-int.h"
 #include "dk.h"
+#include "aead.h"
 
 #define K5CLENGTH 5 /* 32 bit net byte order integer + one byte seed */
 
@@ -177,6 +178,142 @@ cleanup:
     return(ret);
 }
 
+krb5_error_code
+krb5_dk_crypto_length(enc, hash, type, size)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_cryptotype type;
+     size_t *size;
+{
+    switch (type) {
+    case KRB5_CRYPTO_TYPE_EMPTY:
+    case KRB5_CRYPTO_TYPE_DATA:
+    case KRB5_CRYPTO_TYPE_SIGN_ONLY:
+	*size = 0;
+	break;
+    case KRB5_CRYPTO_TYPE_HEADER:
+    case KRB5_CRYPTO_TYPE_PADDING:
+	/* the confounder, and the padding granularity, are one block */
+	(*(enc->block_size))(size);
+	break;
+    case KRB5_CRYPTO_TYPE_TRAILER:
+	(*(hash->hash_size))(size);
+	break;
+    default:
+	return(EINVAL);
+    }
+
+    return(0);
+}
+
+/* The hmac covers the SIGN_ONLY buffers as well as the encrypted ones,
+   in the order they appear in the iov.  With no SIGN_ONLY buffers,
+   the result is identical to krb5_dk_encrypt on the concatenation of
+   the DATA buffers. */
+
+krb5_error_code
+krb5_dk_encrypt_iov(enc, hash, key, usage, ivec, data, num_data)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     krb5_const krb5_data *ivec;
+     krb5_crypto_iov *data;
+     size_t num_data;
+{
+    size_t blocksize, keybytes, keylength, hashsize;
+    krb5_error_code ret;
+    unsigned char constantdata[K5CLENGTH];
+    krb5_data d1, d2, *hashin;
+    unsigned char *kedata, *kidata;
+    krb5_keyblock ke, ki;
+    krb5_crypto_iov *header, *trailer;
+    unsigned int icount;
+
+    (*(enc->block_size))(&blocksize);
+    (*(enc->keysize))(&keybytes, &keylength);
+    (*(hash->hash_size))(&hashsize);
+
+    if ((ret = krb5int_c_iov_prepare(data, num_data, blocksize, hashsize,
+				     blocksize, 1, &header, &trailer)))
+	return(ret);
+
+    /* allocate the to-be-derived keys */
+
+    if ((kedata = (unsigned char *) malloc(keylength)) == NULL)
+	return(ENOMEM);
+    if ((kidata = (unsigned char *) malloc(keylength)) == NULL) {
+	free(kedata);
+	return(ENOMEM);
+    }
+
+    ke.contents = kedata;
+    ke.length = keylength;
+    ki.contents = kidata;
+    ki.length = keylength;
+
+    /* derive the keys */
+
+    d1.data = (char *) constantdata;
+    d1.length = K5CLENGTH;
+
+    d1.data[0] = (usage>>24)&0xff;
+    d1.data[1] = (usage>>16)&0xff;
+    d1.data[2] = (usage>>8)&0xff;
+    d1.data[3] = usage&0xff;
+
+    d1.data[4] = 0xAA;
+
+    if ((ret = krb5_derive_key(enc, key, &ke, &d1)) != 0)
+	goto cleanup;
+
+    d1.data[4] = 0x55;
+
+    if ((ret = krb5_derive_key(enc, key, &ki, &d1)) != 0)
+	goto cleanup;
+
+    /* the confounder goes in the header; the data and padding are
+       already in place */
+
+    if ((ret = krb5_c_random_make_octets(/* XXX */ 0, &header->data)))
+	goto cleanup;
+
+    /* hash the plaintext into the trailer */
+
+    if ((ret = krb5int_c_iov_to_data(data, num_data, 1, &icount, &hashin)))
+	goto cleanup;
+
+    d2 = trailer->data;
+
+    ret = krb5_hmac(hash, &ki, icount, hashin, &d2);
+    free(hashin);
+    if (ret) {
+	memset(trailer->data.data, 0, trailer->data.length);
+	goto cleanup;
+    }
+
+    /* encrypt the plaintext in place */
+
+    if ((ret = ((*(enc->encrypt_iov))(&ke, ivec, data, num_data))) != 0)
+	goto cleanup;
+
+    /* update ivec */
+    if (ivec != NULL && ivec->length == blocksize)
+	krb5int_c_iov_last_block(data, num_data, blocksize,
+				 (unsigned char *) ivec->data);
+
+    /* ret is set correctly by the prior call */
+
+cleanup:
+    memset(kedata, 0, keylength);
+    memset(kidata, 0, keylength);
+
+    free(kidata);
+    free(kedata);
+
+    return(ret);
+}
+
 #ifdef ATHENA_DES3_KLUDGE
 void
 krb5_marc_dk_encrypt_length(enc, hash, inputlen, length)
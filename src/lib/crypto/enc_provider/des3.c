@@ -26,6 +26,7 @@
 
 #include "k5-int.h"
 #include "des_int.h"
+#include "aead.h"
 
 static const mit_des_cblock mit_des_zeroblock[8] /* = all zero */;
 
@@ -95,6 +96,84 @@ k5_des3_decrypt(krb5_const krb5_keyblock *key, krb5_const krb5_data *ivec,
     return(k5_des3_docrypt(key, ivec, input, output, 0));
 }
 
+static krb5_error_code
+k5_des3_docrypt_iov(krb5_const krb5_keyblock *key, krb5_const krb5_data *ivec,
+		    krb5_crypto_iov *data, size_t num_data, int encrypt)
+{
+    mit_des3_key_schedule schedule;
+    struct krb5int_iov_cursor cursor, saved;
+    mit_des_cblock iv, nextiv, block;
+    unsigned char *ptr;
+    size_t len;
+    int ret;
+
+    /* key->enctype was checked by the caller */
+
+    if (key->length != 24)
+	return(KRB5_BAD_KEYSIZE);
+    if ((krb5int_c_iov_length(data, num_data, 0)%8) != 0)
+	return(KRB5_BAD_MSIZE);
+    if (ivec && (ivec->length != 8))
+	return(KRB5_BAD_MSIZE);
+
+    switch (ret = mit_des3_key_sched(*(mit_des3_cblock *)key->contents,
+				     schedule)) {
+    case -1:
+	return(KRB5DES_BAD_KEYPAR);
+    case -2:
+	return(KRB5DES_WEAK_KEY);
+    }
+
+    memcpy(iv, ivec?ivec->data:(char *)mit_des_zeroblock, 8);
+
+    /* run the chain over each contiguous span in place, carrying the
+       chaining value across the spans by hand */
+
+    cursor.iov_pos = 0;
+    cursor.data_pos = 0;
+
+    for (saved = cursor;
+	 krb5int_c_iov_next_span(data, num_data, 8, &cursor, block,
+				 &ptr, &len);
+	 saved = cursor) {
+	if (!encrypt)
+	    memcpy(nextiv, ptr + len - 8, 8);
+
+	mit_des3_cbc_encrypt((krb5_pointer) ptr, (krb5_pointer) ptr, len,
+			     schedule[0], schedule[1], schedule[2],
+			     iv, encrypt);
+
+	if (encrypt)
+	    memcpy(iv, ptr + len - 8, 8);
+	else
+	    memcpy(iv, nextiv, 8);
+
+	if (ptr == block)
+	    krb5int_c_iov_put_block(data, num_data, 8, &saved, block);
+    }
+
+    memset(schedule, 0, sizeof(schedule));
+    memset(iv, 0, sizeof(iv));
+    memset(nextiv, 0, sizeof(nextiv));
+    memset(block, 0, sizeof(block));
+
+    return(0);
+}
+
+static krb5_error_code
+k5_des3_encrypt_iov(krb5_const krb5_keyblock *key, krb5_const krb5_data *ivec,
+		    krb5_crypto_iov *data, size_t num_data)
+{
+    return(k5_des3_docrypt_iov(key, ivec, data, num_data, 1));
+}
+
+static krb5_error_code
+k5_des3_decrypt_iov(krb5_const krb5_keyblock *key, krb5_const krb5_data *ivec,
+		    krb5_crypto_iov *data, size_t num_data)
+{
+    return(k5_des3_docrypt_iov(key, ivec, data, num_data, 0));
+}
+
 static krb5_error_code
 k5_des3_make_key(krb5_const krb5_data *randombits, krb5_keyblock *key)
 {
@@ -132,5 +211,7 @@ const struct krb5_enc_provider krb5_enc_des3 = {
     k5_des3_keysize,
     k5_des3_encrypt,
     k5_des3_decrypt,
-    k5_des3_make_key
+    k5_des3_make_key,
+    k5_des3_encrypt_iov,
+    k5_des3_decrypt_iov
 };
@@ -43,55 +43,75 @@ const struct krb5_keytypes krb5_enctypes_list[] = {
       "des-cbc-crc", "DES cbc mode with CRC-32",
       &krb5_enc_des, &krb5_hash_crc32,
       krb5_old_encrypt_length, krb5_old_encrypt, krb5_old_decrypt,
-      krb5_des_string_to_key },
+      krb5_des_string_to_key,
+      krb5_old_crypto_length, krb5_old_encrypt_iov, krb5_old_decrypt_iov,
+      NULL },
     { ENCTYPE_DES_CBC_MD4,
       "des-cbc-md4", "DES cbc mode with RSA-MD4",
       &krb5_enc_des, &krb5_hash_md4,
       krb5_old_encrypt_length, krb5_old_encrypt, krb5_old_decrypt,
-      krb5_des_string_to_key },
+      krb5_des_string_to_key,
+      krb5_old_crypto_length, krb5_old_encrypt_iov, krb5_old_decrypt_iov,
+      NULL },
     { ENCTYPE_DES_CBC_MD5,
       "des-cbc-md5", "DES cbc mode with RSA-MD5",
       &krb5_enc_des, &krb5_hash_md5,
       krb5_old_encrypt_length, krb5_old_encrypt, krb5_old_decrypt,
-      krb5_des_string_to_key },
+      krb5_des_string_to_key,
+      krb5_old_crypto_length, krb5_old_encrypt_iov, krb5_old_decrypt_iov,
+      NULL },
     { ENCTYPE_DES_CBC_MD5,
       "des", "DES cbc mode with RSA-MD5", /* alias */
       &krb5_enc_des, &krb5_hash_md5,
       krb5_old_encrypt_length, krb5_old_encrypt, krb5_old_decrypt,
-      krb5_des_string_to_key },
+      krb5_des_string_to_key,
+      krb5_old_crypto_length, krb5_old_encrypt_iov, krb5_old_decrypt_iov,
+      NULL },
 
     { ENCTYPE_DES_CBC_RAW,
       "des-cbc-raw", "DES cbc mode raw",
       &krb5_enc_des, NULL,
       krb5_raw_encrypt_length, krb5_raw_encrypt, krb5_raw_decrypt,
-      krb5_des_string_to_key },
+      krb5_des_string_to_key,
+      krb5_raw_crypto_length, krb5_raw_encrypt_iov, krb5_raw_decrypt_iov,
+      NULL },
     { ENCTYPE_DES3_CBC_RAW,
       "des3-cbc-raw", "Triple DES cbc mode raw",
       &krb5_enc_des3, NULL,
       krb5_raw_encrypt_length, krb5_raw_encrypt, krb5_raw_decrypt,
-      krb5_dk_string_to_key },
+      krb5_dk_string_to_key,
+      krb5_raw_crypto_length, krb5_raw_encrypt_iov, krb5_raw_decrypt_iov,
+      NULL },
 
     { ENCTYPE_DES3_CBC_SHA1,
       "des3-cbc-sha1", "Triple DES cbc mode with HMAC/sha1",
       &krb5_enc_des3, &krb5_hash_sha1,
       krb5_dk_encrypt_length, krb5_dk_encrypt, krb5_dk_decrypt,
-      krb5_dk_string_to_key },
+      krb5_dk_string_to_key,
+      krb5_dk_crypto_length, krb5_dk_encrypt_iov, krb5_dk_decrypt_iov,
+      krb5_dk_decrypt_batch },
     { ENCTYPE_DES3_CBC_SHA1,	/* alias */
       "des3-hmac-sha1", "Triple DES cbc mode with HMAC/sha1",
       &krb5_enc_des3, &krb5_hash_sha1,
       krb5_dk_encrypt_length, krb5_dk_encrypt, krb5_dk_decrypt,
-      krb5_dk_string_to_key },
+      krb5_dk_string_to_key,
+      krb5_dk_crypto_length, krb5_dk_encrypt_iov, krb5_dk_decrypt_iov,
+      krb5_dk_decrypt_batch },
     { ENCTYPE_DES3_CBC_SHA1,	/* alias */
       "des3-cbc-sha1-kd", "Triple DES cbc mode with HMAC/sha1",
       &krb5_enc_des3, &krb5_hash_sha1,
       krb5_dk_encrypt_length, krb5_dk_encrypt, krb5_dk_decrypt,
-      krb5_dk_string_to_key },
+      krb5_dk_string_to_key,
+      krb5_dk_crypto_length, krb5_dk_encrypt_iov, krb5_dk_decrypt_iov,
+      krb5_dk_decrypt_batch },
 
     { ENCTYPE_DES_HMAC_SHA1,
       "des-hmac-sha1", "DES with HMAC/sha1",
       &krb5_enc_des, &krb5_hash_sha1,
       krb5_dk_encrypt_length, krb5_dk_encrypt, krb5_dk_decrypt,
-      krb5_dk_string_to_key },
+      krb5_dk_string_to_key,
+      krb5_dk_crypto_length, krb5_dk_encrypt_iov, krb5_dk_decrypt_iov,
+      krb5_dk_decrypt_batch },
 #ifdef ATHENA_DES3_KLUDGE
     /*
      * If you are using this, you're almost certainly doing the
@@ -102,7 +122,8 @@ const struct krb5_keytypes krb5_enctypes_list[] = {
       "Triple DES with HMAC/sha1 and 32-bit length code",
       &krb5_enc_des3, &krb5_hash_sha1,
       krb5_marc_dk_encrypt_length, krb5_marc_dk_encrypt, krb5_marc_dk_decrypt,
-      krb5_dk_string_to_key },
+      krb5_dk_string_to_key,
+      NULL, NULL, NULL, NULL },
 #endif
 };
 
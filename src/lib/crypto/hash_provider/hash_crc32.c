@@ -44,17 +44,16 @@ static krb5_error_code
 k5_crc32_hash(unsigned int icount, krb5_const krb5_data *input,
 	      krb5_data *output)
 {
-    unsigned long c, cn;
+    unsigned long c;
     int i;
     
     if (output->length != CRC32_CKSUM_LENGTH)
 	return(KRB5_CRYPTO_INTERNAL);
 
+    /* the crc of the concatenation, not of each piece */
     c = 0;
-    for (i=0; i<icount; i++) {
-	mit_crc32(input[i].data, input[i].length, &cn);
-	c ^= cn;
-    }
+    for (i=0; i<icount; i++)
+	mit_crc32_update(input[i].data, input[i].length, &c);
 
     output->data[0] = c&0xff;
     output->data[1] = (c>>8)&0xff;
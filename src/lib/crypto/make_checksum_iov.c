@@ -0,0 +1,112 @@
+/*
+ * lib/crypto/make_checksum_iov.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ * 
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ * krb5_c_make_checksum_iov: checksum the buffers of an iov (all but
+ * the TRAILER) without first copying them together.
+ */
+
+#include "k5-int.h"
+#include "cksumtypes.h"
+#include "etypes.h"
+#include "dk.h"
+#include "aead.h"
+
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_c_make_checksum_iov(context, cksumtype, key, usage, data, num_data,
+			 cksum)
+     krb5_context context;
+     krb5_cksumtype cksumtype;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     krb5_const krb5_crypto_iov *data;
+     size_t num_data;
+     krb5_checksum *cksum;
+{
+    int i;
+    unsigned int icount;
+    krb5_data *input, gathered, out;
+    krb5_error_code ret;
+    size_t cksumlen;
+
+    for (i=0; i<krb5_cksumtypes_length; i++) {
+	if (krb5_cksumtypes_list[i].ctype == cksumtype)
+	    break;
+    }
+
+    if (i == krb5_cksumtypes_length)
+	return(KRB5_BAD_ENCTYPE);
+
+    /* the keyed hash providers only take a single input, so the data
+       has to be copied together for them.  They are all DES-based
+       checksums over small messages, so this is not a loss. */
+
+    if (krb5_cksumtypes_list[i].keyhash) {
+	if ((ret = krb5int_c_iov_gather(data, num_data, 1, &gathered)))
+	    return(ret);
+
+	ret = krb5_c_make_checksum(context, cksumtype, key, usage,
+				   &gathered, cksum);
+
+	memset(gathered.data, 0, gathered.length);
+	free(gathered.data);
+
+	return(ret);
+    }
+
+    (*(krb5_cksumtypes_list[i].hash->hash_size))(&cksumlen);
+
+    cksum->length = cksumlen;
+
+    if ((cksum->contents = (krb5_octet *) malloc(cksum->length)) == NULL)
+	return(ENOMEM);
+
+    if ((ret = krb5int_c_iov_to_data(data, num_data, 1, &icount, &input))) {
+	free(cksum->contents);
+	cksum->contents = NULL;
+	return(ret);
+    }
+
+    out.length = cksum->length;
+    out.data = (char *) cksum->contents;
+
+    if (krb5_cksumtypes_list[i].flags & KRB5_CKSUMFLAG_DERIVE)
+	ret = krb5_dk_make_checksum_multi(krb5_cksumtypes_list[i].hash,
+					  key, usage, icount, input, &out);
+    else
+	ret = (*(krb5_cksumtypes_list[i].hash->hash))(icount, input, &out);
+
+    free(input);
+
+    if (!ret) {
+	cksum->magic = KV5M_CHECKSUM;
+	cksum->checksum_type = cksumtype;
+    } else {
+	memset(cksum->contents, 0, cksum->length);
+	free(cksum->contents);
+	cksum->contents = NULL;
+    }
+
+    return(ret);
+}
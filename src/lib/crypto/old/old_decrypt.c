@@ -26,6 +26,7 @@
 
 #include "k5-int.h"
 #include "old.h"
+#include "aead.h"
 
 #ifndef HAVE_MEMMOVE
 #ifdef HAVE_BCOPY
@@ -148,3 +149,86 @@ cleanup:
     free(cksumdata);
     return(ret);
 }
+
+krb5_error_code
+krb5_old_decrypt_iov(enc, hash, key, usage, ivec, data, num_data)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     krb5_const krb5_data *ivec;
+     krb5_crypto_iov *data;
+     size_t num_data;
+{
+    krb5_error_code ret;
+    size_t blocksize, hashsize;
+    unsigned char *cksumdata, *cn;
+    krb5_crypto_iov *header, *trailer;
+    krb5_data cksum, crcivec, *hashin;
+    unsigned int icount;
+
+    (*(enc->block_size))(&blocksize);
+    (*(hash->hash_size))(&hashsize);
+
+    if ((ret = krb5int_c_iov_prepare(data, num_data, blocksize+hashsize, 0,
+				     blocksize, 0, &header, &trailer)))
+	return(ret);
+
+    if ((cksumdata = (unsigned char *) malloc(hashsize)) == NULL)
+	return(ENOMEM);
+
+    /* save last ciphertext block, since we decrypt in place */
+    if (ivec != NULL && ivec->length == blocksize) {
+	cn = malloc(blocksize);
+	if (cn == NULL) {
+	    ret = ENOMEM;
+	    goto cleanup;
+	}
+	krb5int_c_iov_last_block(data, num_data, blocksize, cn);
+    } else
+	cn = NULL;
+
+    /* XXX this is gross, but I don't have much choice */
+    if ((key->enctype == ENCTYPE_DES_CBC_CRC) && (ivec == 0)) {
+	crcivec.length = key->length;
+	crcivec.data = (char *) key->contents;
+	ivec = &crcivec;
+    }
+
+    if ((ret = ((*(enc->decrypt_iov))(key, ivec, data, num_data))))
+	goto cleanup;
+
+    /* verify the checksum */
+
+    memcpy(cksumdata, header->data.data+blocksize, hashsize);
+    memset(header->data.data+blocksize, 0, hashsize);
+
+    cksum.length = hashsize;
+    cksum.data = header->data.data+blocksize;
+
+    if ((ret = krb5int_c_iov_to_data(data, num_data, 0, &icount, &hashin)))
+	goto cleanup;
+
+    ret = (*(hash->hash))(icount, hashin, &cksum);
+    free(hashin);
+    if (ret)
+	goto cleanup;
+
+    if (memcmp(cksum.data, cksumdata, cksum.length) != 0) {
+	ret = KRB5KRB_AP_ERR_BAD_INTEGRITY;
+	goto cleanup;
+    }
+
+    /* update ivec */
+    if (cn != NULL)
+	memcpy(ivec->data, cn, blocksize);
+
+    ret = 0;
+
+cleanup:
+    if (cn != NULL)
+	free(cn);
+    memset(cksumdata, 0, hashsize);
+    free(cksumdata);
+    return(ret);
+}
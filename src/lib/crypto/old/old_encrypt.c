@@ -26,6 +26,7 @@
 
 #include "k5-int.h"
 #include "old.h"
+#include "aead.h"
 
 void
 krb5_old_encrypt_length(enc, hash, inputlen, length)
@@ -110,3 +111,109 @@ cleanup:
 
     return(ret);
 }
+
+krb5_error_code
+krb5_old_crypto_length(enc, hash, type, size)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_cryptotype type;
+     size_t *size;
+{
+    size_t blocksize, hashsize;
+
+    (*(enc->block_size))(&blocksize);
+    (*(hash->hash_size))(&hashsize);
+
+    switch (type) {
+    case KRB5_CRYPTO_TYPE_EMPTY:
+    case KRB5_CRYPTO_TYPE_DATA:
+    case KRB5_CRYPTO_TYPE_SIGN_ONLY:
+    case KRB5_CRYPTO_TYPE_TRAILER:
+	*size = 0;
+	break;
+    case KRB5_CRYPTO_TYPE_HEADER:
+	/* confounder and checksum */
+	*size = blocksize + hashsize;
+	break;
+    case KRB5_CRYPTO_TYPE_PADDING:
+	*size = blocksize;
+	break;
+    default:
+	return(EINVAL);
+    }
+
+    return(0);
+}
+
+krb5_error_code
+krb5_old_encrypt_iov(enc, hash, key, usage, ivec, data, num_data)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     krb5_const krb5_data *ivec;
+     krb5_crypto_iov *data;
+     size_t num_data;
+{
+    krb5_error_code ret;
+    size_t blocksize, hashsize;
+    krb5_crypto_iov *header, *trailer;
+    krb5_data datain, crcivec, *hashin;
+    unsigned int icount;
+    int real_ivec;
+
+    (*(enc->block_size))(&blocksize);
+    (*(hash->hash_size))(&hashsize);
+
+    if ((ret = krb5int_c_iov_prepare(data, num_data, blocksize+hashsize, 0,
+				     blocksize, 1, &header, &trailer)))
+	return(ret);
+
+    /* fill in the confounder and a zero checksum; the data and
+       padding are already in place */
+
+    memset(header->data.data, 0, header->data.length);
+
+    datain.length = blocksize;
+    datain.data = header->data.data;
+
+    if ((ret = krb5_c_random_make_octets(/* XXX */ 0, &datain)))
+	return(ret);
+
+    /* compute the checksum */
+
+    if ((ret = krb5int_c_iov_to_data(data, num_data, 0, &icount, &hashin)))
+	return(ret);
+
+    datain.length = hashsize;
+    datain.data = header->data.data+blocksize;
+
+    ret = (*(hash->hash))(icount, hashin, &datain);
+    free(hashin);
+    if (ret)
+	goto cleanup;
+
+    /* encrypt it */
+
+    /* XXX this is gross, but I don't have much choice */
+    if ((key->enctype == ENCTYPE_DES_CBC_CRC) && (ivec == 0)) {
+	crcivec.length = key->length;
+	crcivec.data = (char *) key->contents;
+	ivec = &crcivec;
+	real_ivec = 0;
+    } else
+	real_ivec = 1;
+
+    if ((ret = ((*(enc->encrypt_iov))(key, ivec, data, num_data))))
+	goto cleanup;
+
+    /* update ivec */
+    if (real_ivec && ivec != NULL && ivec->length == blocksize)
+	krb5int_c_iov_last_block(data, num_data, blocksize,
+				 (unsigned char *) ivec->data);
+cleanup:
+    if (ret)
+	memset(header->data.data, 0, header->data.length);
+
+    return(ret);
+}
@@ -25,130 +25,455 @@
  */
 
 #include "k5-int.h"
-#include "enc_provider.h"
-
-/* This random number generator is a feedback generator based on a
-   block cipher.  It uses DES by default, since it guaranteed to be
-   present in the system, but can be changed.  As new seed data comes
-   in, the old state is folded with the new seed into new state.  Each
-   time random bytes are requested, the seed is used as a key and
-   cblock, and the encryption is used as the output.  The output is
-   fed back as new seed data, as described above. */
-
-/* this can be replaced with another encryption provider, since
-   everything below uses it abstractly */
-
-static const struct krb5_enc_provider *const enc = &krb5_enc_des;
-
-/* XXX state.  Should it be in krb5_context? */
-
-static int inited = 0;
-static size_t blocksize, keybytes, keylength;
-static int random_count;
-/* keybytes | state-block | encblock | key | new-keybytes | new-state-block */
-static unsigned char *random_state; 
-#define STATE (random_state)
-#define STATEKEY (STATE)
-#define STATEBLOCK (STATEKEY+keybytes)
-#define STATESIZE (keybytes+blocksize)
-#define OUTPUT (STATE)
-#define OUTPUTSIZE (STATESIZE+blocksize)
-#define RANDBLOCK (STATEBLOCK+blocksize)
-#define KEYCONTENTS (RANDBLOCK+blocksize)
-#define NEWSTATE (KEYCONTENTS+keylength)
-#define ALLSTATESIZE (keybytes+blocksize*2+keylength+keybytes+blocksize)
+#include "hash_provider.h"
+#include <errno.h>
 
-KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
-krb5_c_random_seed(krb5_context context, krb5_data *data)
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_ONCE)
+#define PRNG_THREADS
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_SYS_RANDOM_H
+#include <sys/random.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+/* This random number generator is built in the style of the Fortuna
+   generator, with a hash function in place of the block cipher,
+   since a hash is the fastest primitive available here.
+
+   A shared pool key collects seed data: each call to
+   krb5_c_random_seed (and the operating system's random source, when
+   there is one) is hashed into it.  Each thread keeps its own
+   generator, keyed from the pool, which produces a buffer of output
+   at a time by hashing its key with a counter, and then replaces its
+   key, so that the output already given out can't be recovered from
+   the state left behind.  Random bytes are handed out from the buffer
+   and erased as they go.  Threads only take the pool lock to rekey,
+   which happens when they first generate output, when new seed data
+   has come in since, or after a fork.  The first rekey in a new
+   process mixes its pid and fresh operating system entropy into the
+   pool, so that children forked from one parent don't go on to
+   produce the same output. */
+
+/* this can be replaced with another hash provider, since everything
+   below uses it abstractly */
+
+static const struct krb5_hash_provider *const hash = &krb5_hash_sha1;
+
+/* hash outputs of keystream generated per refill */
+#define RANDOM_BLOCKS 16
+
+/* bytes requested from the operating system for the initial seed */
+#define RANDOM_OS_SEED 32
+
+struct prng_thread {
+    unsigned long generation;	/* pool generation last keyed from */
+#ifdef HAVE_UNISTD_H
+    pid_t pid;			/* process the state belongs to */
+#endif
+    size_t count;		/* unused bytes left at the end of buf */
+    unsigned char counter[8];
+    unsigned char *key;		/* hashsize bytes */
+    unsigned char *buf;		/* RANDOM_BLOCKS*hashsize bytes */
+};
+
+static size_t hashsize;
+static int pool_inited = 0;
+static int pool_seeded = 0;
+static volatile unsigned long pool_generation = 0;
+static unsigned long pool_draws = 0;
+static unsigned char *pool_key;
+#ifdef HAVE_UNISTD_H
+static pid_t pool_pid;		/* process the pool was last mixed in */
+#endif
+
+#ifdef PRNG_THREADS
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+static int thread_key_ok = 0;
+#define LOCK_POOL()	pthread_mutex_lock(&pool_lock)
+#define UNLOCK_POOL()	pthread_mutex_unlock(&pool_lock)
+#else
+static struct prng_thread *single_thread = NULL;
+#define LOCK_POOL()
+#define UNLOCK_POOL()
+#endif
+
+static void
+prng_thread_free(void *arg)
 {
-    unsigned char *fold_input;
+    struct prng_thread *t = (struct prng_thread *) arg;
 
-    if (inited == 0) {
-	/* this does a bunch of malloc'ing up front, so that
-	   generating random keys doesn't have to malloc, so it can't
-	   fail.  seeding still malloc's, but that's less common. */
+    if (t == NULL)
+	return;
+    memset(t->key, 0, hashsize+RANDOM_BLOCKS*hashsize);
+    free(t->key);
+    memset(t, 0, sizeof(*t));
+    free(t);
+}
 
-	enc->block_size(&blocksize);
-	enc->keysize(&keybytes, &keylength);
-	if ((random_state = (unsigned char *) malloc(ALLSTATESIZE)) == NULL)
-	    return(ENOMEM);
-	random_count = 0;
-	inited = 1;
+#ifdef PRNG_THREADS
+static void
+prng_make_thread_key(void)
+{
+    if (pthread_key_create(&thread_key, prng_thread_free) == 0)
+	thread_key_ok = 1;
+}
+#endif
 
-	krb5_nfold(data->length*8, data->data, STATESIZE*8, STATE);
+/* hash the pool key together with the new data.  The pool lock must
+   be held. */
 
-	return(0);
+static krb5_error_code
+prng_pool_mix(unsigned int icount, krb5_data *data)
+{
+    krb5_data *input, output;
+    krb5_error_code ret;
+    unsigned int i;
+
+    if ((input = (krb5_data *) malloc(sizeof(krb5_data)*(icount+1))) == NULL)
+	return(ENOMEM);
+
+    input[0].length = hashsize;
+    input[0].data = (char *) pool_key;
+    for (i=0; i<icount; i++)
+	input[i+1] = data[i];
+
+    output.length = hashsize;
+    output.data = (char *) pool_key;
+
+    ret = (*(hash->hash))(icount+1, input, &output);
+    free(input);
+
+    if (ret == 0)
+	pool_generation++;
+
+    return(ret);
+}
+
+/* read some entropy from the operating system, if it has any to
+   offer.  Returns the number of bytes read. */
+
+static size_t
+prng_os_entropy(unsigned char *buf, size_t len)
+{
+    size_t got = 0;
+#ifdef HAVE_GETRANDOM
+    ssize_t n;
+
+    while (got < len) {
+	if ((n = getrandom(buf+got, len-got, 0)) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    break;
+	}
+	got += n;
+    }
+#endif
+#ifdef HAVE_UNISTD_H
+    if (got < len) {
+	int fd;
+	ssize_t n;
+
+	if ((fd = open("/dev/urandom", O_RDONLY)) >= 0) {
+	    while (got < len) {
+		if ((n = read(fd, buf+got, len-got)) <= 0) {
+		    if ((n < 0) && (errno == EINTR))
+			continue;
+		    break;
+		}
+		got += n;
+	    }
+	    close(fd);
+	}
     }
+#endif
+    return(got);
+}
+
+/* set up the pool, seeding it from the operating system.  The pool
+   lock must be held. */
+
+static krb5_error_code
+prng_pool_init(void)
+{
+    unsigned char osbuf[RANDOM_OS_SEED];
+    krb5_data data;
+    krb5_error_code ret;
+
+    if (pool_inited)
+	return(0);
 
-    if ((fold_input =
-	 (unsigned char *) malloc(data->length+STATESIZE)) == NULL)
+    (*(hash->hash_size))(&hashsize);
+    if ((pool_key = (unsigned char *) malloc(hashsize)) == NULL)
 	return(ENOMEM);
+    memset(pool_key, 0, hashsize);
+    pool_inited = 1;
+#ifdef HAVE_UNISTD_H
+    pool_pid = getpid();
+#endif
 
-    memcpy(fold_input, data->data, data->length);
-    memcpy(fold_input+data->length, STATE, STATESIZE);
+    if ((data.length = prng_os_entropy(osbuf, sizeof(osbuf))) > 0) {
+	data.data = (char *) osbuf;
+	ret = prng_pool_mix(1, &data);
+	memset(osbuf, 0, sizeof(osbuf));
+	if (ret)
+	    return(ret);
+	pool_seeded = 1;
+    }
 
-    krb5_nfold((data->length+STATESIZE)*8, fold_input,
-	       STATESIZE*8, STATE);
-    free(fold_input);
     return(0);
 }
 
-KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
-krb5_c_random_make_octets(krb5_context context, krb5_data *data)
+#ifdef HAVE_UNISTD_H
+/* after a fork, the pool is a copy of the parent's, and so of every
+   other child's; make it this process's own by mixing in the pid and
+   new entropy from the operating system.  The pool lock must be
+   held. */
+
+static krb5_error_code
+prng_pool_fork(void)
 {
+    unsigned char pidbuf[sizeof(pid_t)], osbuf[RANDOM_OS_SEED];
+    krb5_data data[2];
     krb5_error_code ret;
-    krb5_data data1, data2;
-    krb5_keyblock key;
-    int bytes;
-
-    if (inited == 0) {
-	/* i need some entropy.  I'd use the current time and pid, but
-	   that could cause portability problems. */
-	abort();
+    pid_t pid;
+    int i;
+
+    if ((pid = getpid()) == pool_pid)
+	return(0);
+
+    for (i=0; i<sizeof(pidbuf); i++)
+	pidbuf[i] = (pid >> (8*i))&0xff;
+
+    data[0].length = sizeof(pidbuf);
+    data[0].data = (char *) pidbuf;
+    data[1].length = prng_os_entropy(osbuf, sizeof(osbuf));
+    data[1].data = (char *) osbuf;
+
+    ret = prng_pool_mix(2, data);
+    memset(osbuf, 0, sizeof(osbuf));
+    if (ret)
+	return(ret);
+
+    pool_pid = pid;
+    return(0);
+}
+#endif
+
+static struct prng_thread *
+prng_thread_get(void)
+{
+    struct prng_thread *t;
+
+#ifdef PRNG_THREADS
+    pthread_once(&thread_key_once, prng_make_thread_key);
+    if (!thread_key_ok)
+	return(NULL);
+    if ((t = (struct prng_thread *) pthread_getspecific(thread_key)) != NULL)
+	return(t);
+#else
+    if ((t = single_thread) != NULL)
+	return(t);
+#endif
+
+    if ((t = (struct prng_thread *) malloc(sizeof(*t))) == NULL)
+	return(NULL);
+    memset(t, 0, sizeof(*t));
+    if ((t->key = (unsigned char *)
+	 malloc(hashsize+RANDOM_BLOCKS*hashsize)) == NULL) {
+	free(t);
+	return(NULL);
     }
+    memset(t->key, 0, hashsize+RANDOM_BLOCKS*hashsize);
+    t->buf = t->key+hashsize;
+    /* force a rekey from the pool before first use */
+    t->generation = pool_generation-1;
 
-    bytes = 0;
+#ifdef PRNG_THREADS
+    if (pthread_setspecific(thread_key, t)) {
+	prng_thread_free(t);
+	return(NULL);
+    }
+#else
+    single_thread = t;
+#endif
 
-    while (bytes < data->length) {
-	if (random_count == 0) {
-	    /* set up random krb5_data, and key to be filled in */
-	    data1.length = keybytes;
-	    data1.data = STATEKEY;
-	    key.length = keylength;
-	    key.contents = KEYCONTENTS;
-
-	    /* fill it in */
-	    if ((ret = ((*(enc->make_key))(&data1, &key))))
-		return(ret);
+    return(t);
+}
 
-	    /* encrypt the block */
-	    data1.length = blocksize;
-	    data1.data = STATEBLOCK;
-	    data2.length = blocksize;
-	    data2.data = RANDBLOCK;
-	    if ((ret = ((*(enc->encrypt))(&key, NULL, &data1, &data2))))
-		return(ret);
+/* key a thread's generator from the pool, discarding any output it
+   had buffered. */
 
-	    /* fold the new output back into the state */
+static krb5_error_code
+prng_thread_rekey(struct prng_thread *t)
+{
+    unsigned char drawbuf[sizeof(pool_draws)];
+    krb5_data input[3], output;
+    krb5_error_code ret;
+    unsigned long draw;
+    int i;
 
-	    krb5_nfold(OUTPUTSIZE*8, OUTPUT, STATESIZE*8, NEWSTATE);
-	    memcpy(STATE, NEWSTATE, STATESIZE);
+    LOCK_POOL();
 
-	    random_count = blocksize;
-	}
+    if (!pool_seeded) {
+	UNLOCK_POOL();
+	return(KRB5_CRYPTO_INTERNAL);
+    }
+
+#ifdef HAVE_UNISTD_H
+    if ((ret = prng_pool_fork())) {
+	UNLOCK_POOL();
+	return(ret);
+    }
+#endif
+
+    /* every draw from the pool is distinct, so threads keyed from the
+       same pool contents still get different generators */
+    draw = pool_draws++;
+    for (i=0; i<sizeof(drawbuf); i++) {
+	drawbuf[i] = draw&0xff;
+	draw >>= 8;
+    }
+
+    input[0].length = hashsize;
+    input[0].data = (char *) t->key;
+    input[1].length = hashsize;
+    input[1].data = (char *) pool_key;
+    input[2].length = sizeof(drawbuf);
+    input[2].data = (char *) drawbuf;
+    output.length = hashsize;
+    output.data = (char *) t->key;
+
+    ret = (*(hash->hash))(3, input, &output);
+
+    t->generation = pool_generation;
+
+    UNLOCK_POOL();
+
+    if (ret)
+	return(ret);
+
+#ifdef HAVE_UNISTD_H
+    t->pid = getpid();
+#endif
+    memset(t->buf, 0, RANDOM_BLOCKS*hashsize);
+    t->count = 0;
+
+    return(0);
+}
+
+static void
+prng_thread_count(struct prng_thread *t)
+{
+    int i;
 
-	if ((data->length - bytes) <= random_count) {
-	    memcpy(data->data + bytes, RANDBLOCK+(blocksize-random_count),
-		   data->length - bytes);
-	    random_count -= (data->length - bytes);
+    for (i=sizeof(t->counter)-1; i>=0; i--)
+	if (++t->counter[i])
 	    break;
+}
+
+/* fill the buffer with H(key | counter) for successive counters, then
+   replace the key in the same way. */
+
+static krb5_error_code
+prng_thread_refill(struct prng_thread *t)
+{
+    krb5_data input[2], output;
+    krb5_error_code ret;
+    int i;
+
+    input[0].length = hashsize;
+    input[0].data = (char *) t->key;
+    input[1].length = sizeof(t->counter);
+    input[1].data = (char *) t->counter;
+    output.length = hashsize;
+
+    for (i=0; i<RANDOM_BLOCKS; i++) {
+	output.data = (char *) t->buf+i*hashsize;
+	if ((ret = (*(hash->hash))(2, input, &output)))
+	    return(ret);
+	prng_thread_count(t);
+    }
+
+    output.data = (char *) t->key;
+    if ((ret = (*(hash->hash))(2, input, &output)))
+	return(ret);
+    prng_thread_count(t);
+
+    t->count = RANDOM_BLOCKS*hashsize;
+
+    return(0);
+}
+
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_c_random_seed(krb5_context context, krb5_data *data)
+{
+    krb5_error_code ret;
+
+    LOCK_POOL();
+
+    if ((ret = prng_pool_init()) == 0) {
+	if ((ret = prng_pool_mix(1, data)) == 0)
+	    pool_seeded = 1;
+    }
+
+    UNLOCK_POOL();
+
+    return(ret);
+}
+
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_c_random_make_octets(krb5_context context, krb5_data *data)
+{
+    krb5_error_code ret;
+    struct prng_thread *t;
+    size_t bytes, n;
+
+    if (!pool_inited) {
+	LOCK_POOL();
+	ret = prng_pool_init();
+	UNLOCK_POOL();
+	if (ret)
+	    return(ret);
+    }
+
+    if ((t = prng_thread_get()) == NULL)
+	return(ENOMEM);
+
+    if ((t->generation != pool_generation)
+#ifdef HAVE_UNISTD_H
+	|| (t->pid != getpid())
+#endif
+	) {
+	if ((ret = prng_thread_rekey(t)))
+	    return(ret);
+    }
+
+    bytes = 0;
+
+    while (bytes < data->length) {
+	if (t->count == 0) {
+	    if ((ret = prng_thread_refill(t)))
+		return(ret);
 	}
 
-	memcpy(data->data + bytes, RANDBLOCK+(blocksize - random_count),
-	       random_count);
+	n = data->length - bytes;
+	if (n > t->count)
+	    n = t->count;
 
-	bytes += random_count;
-	random_count = 0;
+	memcpy(data->data + bytes, t->buf+(RANDOM_BLOCKS*hashsize-t->count),
+	       n);
+	memset(t->buf+(RANDOM_BLOCKS*hashsize-t->count), 0, n);
+
+	bytes += n;
+	t->count -= n;
     }
 
     return(0);
@@ -156,6 +481,27 @@ krb5_c_random_make_octets(krb5_context context, krb5_data *data)
 
 void prng_cleanup (void)
 {
-	free (random_state);
-	inited = 0;
+	struct prng_thread *t;
+
+	LOCK_POOL();
+#ifdef PRNG_THREADS
+	if (thread_key_ok &&
+	    (t = (struct prng_thread *) pthread_getspecific(thread_key))) {
+		pthread_setspecific(thread_key, NULL);
+		prng_thread_free(t);
+	}
+#else
+	t = single_thread;
+	single_thread = NULL;
+	prng_thread_free(t);
+#endif
+	if (pool_inited) {
+		memset(pool_key, 0, hashsize);
+		free(pool_key);
+	}
+	pool_inited = 0;
+	pool_seeded = 0;
+	/* any surviving per-thread state rekeys on next use */
+	pool_generation++;
+	UNLOCK_POOL();
 }
@@ -44,3 +44,22 @@ KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
 		krb5_const krb5_keyblock *key, krb5_keyusage usage,
 		krb5_const krb5_data *ivec, krb5_const krb5_data *input,
 		krb5_data *arg_output));
+
+krb5_error_code krb5_raw_crypto_length
+KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
+		krb5_const struct krb5_hash_provider *hash,
+		krb5_cryptotype type, size_t *size));
+
+krb5_error_code krb5_raw_encrypt_iov
+KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
+		krb5_const struct krb5_hash_provider *hash,
+		krb5_const krb5_keyblock *key, krb5_keyusage usage,
+		krb5_const krb5_data *ivec,
+		krb5_crypto_iov *data, size_t num_data));
+
+krb5_error_code krb5_raw_decrypt_iov
+KRB5_PROTOTYPE((krb5_const struct krb5_enc_provider *enc,
+		krb5_const struct krb5_hash_provider *hash,
+		krb5_const krb5_keyblock *key, krb5_keyusage usage,
+		krb5_const krb5_data *ivec,
+		krb5_crypto_iov *data, size_t num_data));
@@ -26,6 +26,7 @@
 
 #include "k5-int.h"
 #include "raw.h"
+#include "aead.h"
 
 krb5_error_code
 krb5_raw_decrypt(enc, hash, key, usage, ivec, input, output)
@@ -39,3 +40,26 @@ krb5_raw_decrypt(enc, hash, key, usage, ivec, input, output)
 {
     return((*(enc->decrypt))(key, ivec, input, output));
 }
+
+krb5_error_code
+krb5_raw_decrypt_iov(enc, hash, key, usage, ivec, data, num_data)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     krb5_const krb5_data *ivec;
+     krb5_crypto_iov *data;
+     size_t num_data;
+{
+    krb5_error_code ret;
+    size_t blocksize;
+    krb5_crypto_iov *header, *trailer;
+
+    (*(enc->block_size))(&blocksize);
+
+    if ((ret = krb5int_c_iov_prepare(data, num_data, 0, 0, blocksize, 0,
+				     &header, &trailer)))
+	return(ret);
+
+    return((*(enc->decrypt_iov))(key, ivec, data, num_data));
+}
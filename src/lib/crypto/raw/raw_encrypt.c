@@ -26,6 +26,7 @@
 
 #include "k5-int.h"
 #include "raw.h"
+#include "aead.h"
 
 void
 krb5_raw_encrypt_length(enc, hash, inputlen, length)
@@ -53,3 +54,51 @@ krb5_raw_encrypt(enc, hash, key, usage, ivec, input, output)
 {
     return((*(enc->encrypt))(key, ivec, input, output));
 }
+
+krb5_error_code
+krb5_raw_crypto_length(enc, hash, type, size)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_cryptotype type;
+     size_t *size;
+{
+    switch (type) {
+    case KRB5_CRYPTO_TYPE_EMPTY:
+    case KRB5_CRYPTO_TYPE_DATA:
+    case KRB5_CRYPTO_TYPE_SIGN_ONLY:
+    case KRB5_CRYPTO_TYPE_HEADER:
+    case KRB5_CRYPTO_TYPE_TRAILER:
+	*size = 0;
+	break;
+    case KRB5_CRYPTO_TYPE_PADDING:
+	(*(enc->block_size))(size);
+	break;
+    default:
+	return(EINVAL);
+    }
+
+    return(0);
+}
+
+krb5_error_code
+krb5_raw_encrypt_iov(enc, hash, key, usage, ivec, data, num_data)
+     krb5_const struct krb5_enc_provider *enc;
+     krb5_const struct krb5_hash_provider *hash;
+     krb5_const krb5_keyblock *key;
+     krb5_keyusage usage;
+     krb5_const krb5_data *ivec;
+     krb5_crypto_iov *data;
+     size_t num_data;
+{
+    krb5_error_code ret;
+    size_t blocksize;
+    krb5_crypto_iov *header, *trailer;
+
+    (*(enc->block_size))(&blocksize);
+
+    if ((ret = krb5int_c_iov_prepare(data, num_data, 0, 0, blocksize, 1,
+				     &header, &trailer)))
+	return(ret);
+
+    return((*(enc->encrypt_iov))(key, ivec, data, num_data));
+}
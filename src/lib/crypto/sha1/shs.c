@@ -221,7 +221,7 @@ void shsUpdate(shsInfo, buffer, count)
     int count;
 {
     LONG tmp;
-    int dataCount, canfill;
+    int dataCount;
     LONG *lp;
 
     /* Update bitcount */
@@ -234,44 +234,21 @@ void shsUpdate(shsInfo, buffer, count)
     /* Get count of bytes already in data */
     dataCount = (int) (tmp >> 3) & 0x3F;
 
-    /* Handle any leading odd-sized chunks */
+    /* Handle any leading odd-sized chunks.  Top up the partial block
+       a byte at a time; this only happens when the hash input is
+       passed in several pieces, so it need not be fast. */
     if (dataCount) {
-	lp = shsInfo->data + dataCount / 4;
-	canfill = (count >= dataCount);
-	dataCount = SHS_DATASIZE - dataCount;
-
-	if (dataCount % 4) {
-	    /* Fill out a full 32 bit word first if needed -- this
-	       is not very efficient (computed shift amount),
-	       but it shouldn't happen often. */
-	    while (dataCount % 4 && count > 0) {
-		*lp |= (LONG) *buffer++ << ((3 - dataCount++ % 4) * 8);
-		count--;
-	    }
-	    lp++;
-	}
-	while (lp < shsInfo->data + 16) {
-	    *lp = (LONG) *buffer++ << 24;
-	    *lp |= (LONG) *buffer++ << 16;
-	    *lp |= (LONG) *buffer++ << 8;
-	    *lp++ |= (LONG) *buffer++;
-	    if ((count -= 4) < 4 && lp < shsInfo->data + 16) {
+	while (dataCount < SHS_DATASIZE && count > 0) {
+	    lp = shsInfo->data + dataCount / 4;
+	    if (dataCount % 4 == 0)
 		*lp = 0;
-		switch (count % 4) {
-		case 3:
-		    *lp |= (LONG) buffer[2] << 8;
-		case 2:
-		    *lp |= (LONG) buffer[1] << 16;
-		case 1:
-		    *lp |= (LONG) buffer[0] << 24;
-		}
-		break;
-		count = 0;
-	    }
-	}
-	if (canfill) {
-	    SHSTransform(shsInfo->digest, shsInfo->data);
+	    *lp |= (LONG) *buffer++ << ((3 - dataCount % 4) * 8);
+	    dataCount++;
+	    count--;
 	}
+	if (dataCount < SHS_DATASIZE)
+	    return;
+	SHSTransform(shsInfo->digest, shsInfo->data);
     }
 
     /* Process data in SHS_DATASIZE chunks */
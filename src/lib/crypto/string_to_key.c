@@ -26,6 +26,196 @@
 
 #include "k5-int.h"
 #include "etypes.h"
+#include "hash_provider.h"
+#include <time.h>
+
+/* Deriving a key from a password is slow, by design for some
+   enctypes, and the same password and salt are often run through it
+   several times in a row: krb5_get_init_creds_password asks for the
+   key again on each preauth retry and when it retries at the master
+   KDC.  While a cache is started in the context, which
+   krb5_get_init_creds_password does for the length of the call, the
+   context remembers the last few keys derived, for a short while.
+   Nothing else starts one, so servers which check many passwords
+   never keep them.  Entries are found by an HMAC of the password and
+   salt under a random secret made with the cache, so the password is
+   never kept and the digests can't be checked against guesses without
+   the secret; keys are zeroed as they are dropped. */
+
+#define S2K_CACHE_ENTRIES	4
+#define S2K_CACHE_LIFETIME	60	/* seconds */
+
+static const struct krb5_hash_provider *const s2k_hash = &krb5_hash_sha1;
+
+struct s2k_cache_entry {
+    time_t time;			/* zero if the entry is unused */
+    krb5_enctype enctype;
+    unsigned char digest[20];		/* HMAC of password and salt */
+    krb5_keyblock key;
+};
+
+struct s2k_cache {
+    unsigned char secret[20];		/* HMAC key for the digests */
+    struct s2k_cache_entry entries[S2K_CACHE_ENTRIES];
+};
+
+static void
+s2k_cache_drop(entry)
+     struct s2k_cache_entry *entry;
+{
+    if (entry->key.contents) {
+	memset(entry->key.contents, 0, entry->key.length);
+	free(entry->key.contents);
+    }
+    memset(entry, 0, sizeof(*entry));
+}
+
+static krb5_error_code
+s2k_cache_digest(cache, string, salt, digest)
+     struct s2k_cache *cache;
+     krb5_const krb5_data *string;
+     krb5_const krb5_data *salt;
+     unsigned char *digest;
+{
+    unsigned char lenbuf[4];
+    krb5_data input[3], output;
+    krb5_keyblock secret;
+    size_t hashsize;
+
+    (*(s2k_hash->hash_size))(&hashsize);
+    if (hashsize != sizeof(((struct s2k_cache_entry *) 0)->digest))
+	return(KRB5_CRYPTO_INTERNAL);
+
+    /* the password length keeps the boundary with the salt fixed */
+    lenbuf[0] = (string->length >> 24) & 0xff;
+    lenbuf[1] = (string->length >> 16) & 0xff;
+    lenbuf[2] = (string->length >> 8) & 0xff;
+    lenbuf[3] = string->length & 0xff;
+
+    input[0].length = sizeof(lenbuf);
+    input[0].data = (char *) lenbuf;
+    input[1] = *string;
+    input[2].length = salt ? salt->length : 0;
+    input[2].data = salt ? salt->data : NULL;
+    output.length = hashsize;
+    output.data = (char *) digest;
+
+    secret.magic = KV5M_KEYBLOCK;
+    secret.enctype = ENCTYPE_NULL;
+    secret.length = sizeof(cache->secret);
+    secret.contents = cache->secret;
+
+    return(krb5_hmac(s2k_hash, &secret, 3, input, &output));
+}
+
+/* look for a live entry matching enctype and digest, dropping any
+   that have expired on the way */
+
+static struct s2k_cache_entry *
+s2k_cache_lookup(cache, enctype, digest, now)
+     struct s2k_cache *cache;
+     krb5_enctype enctype;
+     unsigned char *digest;
+     time_t now;
+{
+    struct s2k_cache_entry *entry, *found = NULL;
+    int i;
+
+    for (i=0; i<S2K_CACHE_ENTRIES; i++) {
+	entry = &cache->entries[i];
+	if (entry->time == 0)
+	    continue;
+	if ((now < entry->time) || (now - entry->time > S2K_CACHE_LIFETIME)) {
+	    s2k_cache_drop(entry);
+	    continue;
+	}
+	if ((entry->enctype == enctype) &&
+	    (memcmp(entry->digest, digest, sizeof(entry->digest)) == 0))
+	    found = entry;
+    }
+
+    return(found);
+}
+
+/* remember a key, replacing the oldest entry if the cache is full.
+   Failure to remember is not an error. */
+
+static void
+s2k_cache_store(cache, enctype, digest, key, now)
+     struct s2k_cache *cache;
+     krb5_enctype enctype;
+     unsigned char *digest;
+     krb5_keyblock *key;
+     time_t now;
+{
+    struct s2k_cache_entry *entry;
+    int i;
+
+    entry = &cache->entries[0];
+    for (i=1; i<S2K_CACHE_ENTRIES; i++) {
+	if (cache->entries[i].time < entry->time)
+	    entry = &cache->entries[i];
+    }
+    s2k_cache_drop(entry);
+
+    if ((entry->key.contents = (krb5_octet *) malloc(key->length)) == NULL)
+	return;
+    memcpy(entry->key.contents, key->contents, key->length);
+    entry->key.magic = KV5M_KEYBLOCK;
+    entry->key.enctype = key->enctype;
+    entry->key.length = key->length;
+    entry->enctype = enctype;
+    memcpy(entry->digest, digest, sizeof(entry->digest));
+    entry->time = now;
+}
+
+/* start remembering keys derived in context, if it is not already.
+   Returns 0 only if a new cache was started, which the caller should
+   then free. */
+
+krb5_error_code
+krb5int_c_s2k_cache_init(context)
+     krb5_context context;
+{
+    struct s2k_cache *cache;
+    krb5_data secret;
+    krb5_error_code ret;
+
+    if (context->s2k_cache)
+	return(EEXIST);
+
+    if ((cache = (struct s2k_cache *) malloc(sizeof(*cache))) == NULL)
+	return(ENOMEM);
+    memset(cache, 0, sizeof(*cache));
+
+    secret.length = sizeof(cache->secret);
+    secret.data = (char *) cache->secret;
+    if ((ret = krb5_c_random_make_octets(context, &secret))) {
+	free(cache);
+	return(ret);
+    }
+
+    context->s2k_cache = cache;
+    return(0);
+}
+
+void
+krb5int_c_s2k_cache_free(context)
+     krb5_context context;
+{
+    struct s2k_cache *cache;
+    int i;
+
+    if ((context == NULL) || (context->s2k_cache == NULL))
+	return;
+
+    cache = (struct s2k_cache *) context->s2k_cache;
+    for (i=0; i<S2K_CACHE_ENTRIES; i++)
+	s2k_cache_drop(&cache->entries[i]);
+    memset(cache, 0, sizeof(*cache));
+    free(cache);
+    context->s2k_cache = NULL;
+}
 
 KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
 krb5_c_string_to_key(context, enctype, string, salt, key)
@@ -39,6 +229,10 @@ krb5_c_string_to_key(context, enctype, string, salt, key)
     krb5_error_code ret;
     const struct krb5_enc_provider *enc;
     size_t keybytes, keylength;
+    struct s2k_cache *cache = NULL;
+    struct s2k_cache_entry *entry;
+    unsigned char digest[sizeof(entry->digest)];
+    time_t now;
 
     for (i=0; i<krb5_enctypes_length; i++) {
 	if (krb5_enctypes_list[i].etype == enctype)
@@ -59,10 +253,35 @@ krb5_c_string_to_key(context, enctype, string, salt, key)
     key->enctype = enctype;
     key->length = keylength;
 
+    /* the cache is only used if one has been started in the context */
+    if (context)
+	cache = (struct s2k_cache *) context->s2k_cache;
+
+    /* a salt length of -1 marks an AFS cell name rather than a real
+       salt; those are rare enough not to bother remembering */
+    if (salt && (salt->length == -1))
+	cache = NULL;
+
+    if (cache && (s2k_cache_digest(cache, string, salt, digest) == 0)) {
+	now = time((time_t *) NULL);
+	entry = s2k_cache_lookup(cache, enctype, digest, now);
+	if (entry && (entry->key.length == keylength)) {
+	    memcpy(key->contents, entry->key.contents, keylength);
+	    memset(digest, 0, sizeof(digest));
+	    return(0);
+	}
+    } else {
+	cache = NULL;
+    }
+
     if ((ret = ((*(krb5_enctypes_list[i].str2key))(enc, string, salt, key)))) {
 	memset(key->contents, 0, keylength);
 	free(key->contents);
+    } else if (cache) {
+	s2k_cache_store(cache, enctype, digest, key, now);
     }
 
+    memset(digest, 0, sizeof(digest));
+
     return(ret);
 }
@@ -0,0 +1,392 @@
+/*
+ * lib/crypto/t_cryptobench.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ * Throughput benchmark for every enctype and checksum type in the
+ * crypto library tables.
+ *
+ * usage: t_cryptobench [-t msec] [-m maxsize] [name ...]
+ *
+ * For each enctype, encrypt and decrypt are timed over message sizes
+ * from 16 bytes to maxsize (default 1MB), quadrupling each step, and
+ * string_to_key is timed once.  For each checksum type, make_checksum
+ * and verify_checksum are timed over the same sizes.  Each test runs
+ * for at least msec milliseconds (default 100).  If names are given,
+ * only the enctypes and checksum types with those names are run.
+ *
+ * One line is printed per test, with tab-separated fields:
+ *
+ *	operation  type  bytes  iterations  ops/sec  cycles/byte
+ *
+ * Cycles are counted with the processor cycle counter where one is
+ * available, and printed as "-" otherwise.  Lines beginning with '#'
+ * are comments.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "k5-int.h"
+#include "etypes.h"
+#include "cksumtypes.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define HAVE_CYCLE_COUNTER
+static unsigned long long
+cycles()
+{
+    unsigned int lo, hi;
+
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return(((unsigned long long) hi << 32) | lo);
+}
+#endif
+
+#define MINSIZE		16
+#define MAXSIZE		(1024*1024)
+
+#define USAGE		1027
+
+krb5_context context;
+long mintime = 100;
+char **names;
+int nnames;
+
+/* operation being timed, and its arguments */
+struct bench {
+    krb5_keyblock *key;
+    krb5_enctype enctype;
+    krb5_cksumtype cksumtype;
+    krb5_data plain;
+    krb5_data output;
+    krb5_enc_data enc;
+    krb5_checksum cksum;
+    krb5_data password;
+    krb5_data salt;
+};
+
+typedef krb5_error_code (*bench_func) PROTOTYPE((struct bench *));
+
+static void
+fail(what, name, code)
+     char *what;
+     char *name;
+     krb5_error_code code;
+{
+    fprintf(stderr, "t_cryptobench: %s failed for %s: %s\n", what, name,
+	    error_message(code));
+    exit(1);
+}
+
+static int
+wanted(name)
+     char *name;
+{
+    int i;
+
+    if (nnames == 0)
+	return(1);
+    for (i=0; i<nnames; i++)
+	if (strcmp(names[i], name) == 0)
+	    return(1);
+    return(0);
+}
+
+static double
+now()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return(tv.tv_sec + tv.tv_usec/1000000.0);
+}
+
+static krb5_error_code
+do_encrypt(b)
+     struct bench *b;
+{
+    return(krb5_c_encrypt(context, b->key, USAGE, NULL, &b->plain, &b->enc));
+}
+
+static krb5_error_code
+do_decrypt(b)
+     struct bench *b;
+{
+    return(krb5_c_decrypt(context, b->key, USAGE, NULL, &b->enc,
+			  &b->output));
+}
+
+static krb5_error_code
+do_make_checksum(b)
+     struct bench *b;
+{
+    krb5_checksum cksum;
+    krb5_error_code ret;
+
+    if ((ret = krb5_c_make_checksum(context, b->cksumtype, b->key, USAGE,
+				    &b->plain, &cksum)))
+	return(ret);
+    free(cksum.contents);
+    return(0);
+}
+
+static krb5_error_code
+do_verify_checksum(b)
+     struct bench *b;
+{
+    krb5_boolean valid;
+    krb5_error_code ret;
+
+    if ((ret = krb5_c_verify_checksum(context, b->key, USAGE, &b->plain,
+				      &b->cksum, &valid)))
+	return(ret);
+    return(valid ? 0 : KRB5KRB_AP_ERR_BAD_INTEGRITY);
+}
+
+static krb5_error_code
+do_string_to_key(b)
+     struct bench *b;
+{
+    krb5_keyblock key;
+    krb5_error_code ret;
+
+    /* no context, so that every iteration derives the key rather than
+       finding it among the context's recent string-to-key results */
+    if ((ret = krb5_c_string_to_key(NULL, b->enctype, &b->password,
+				    &b->salt, &key)))
+	return(ret);
+    krb5_free_keyblock_contents(context, &key);
+    return(0);
+}
+
+/* run func until at least mintime has gone by, doubling the
+   iteration count each round, and report the last round */
+
+static void
+run(what, name, bytes, func, b)
+     char *what;
+     char *name;
+     size_t bytes;
+     bench_func func;
+     struct bench *b;
+{
+    long iter, i;
+    double start, elapsed;
+    krb5_error_code ret;
+#ifdef HAVE_CYCLE_COUNTER
+    unsigned long long c0, c1;
+#endif
+
+    for (iter = 1; ; iter *= 2) {
+	start = now();
+#ifdef HAVE_CYCLE_COUNTER
+	c0 = cycles();
+#endif
+	for (i=0; i<iter; i++) {
+	    if ((ret = (*func)(b)))
+		fail(what, name, ret);
+	}
+#ifdef HAVE_CYCLE_COUNTER
+	c1 = cycles();
+#endif
+	elapsed = now() - start;
+	if (elapsed*1000 >= mintime)
+	    break;
+    }
+
+    printf("%s\t%s\t%lu\t%ld\t%.1f\t", what, name, (unsigned long) bytes,
+	   iter, iter/elapsed);
+#ifdef HAVE_CYCLE_COUNTER
+    printf("%.2f\n", (double) (c1-c0)/((double) iter*(bytes ? bytes : 1)));
+#else
+    printf("-\n");
+#endif
+    fflush(stdout);
+}
+
+static void
+bench_enctype(ktp, buf, maxsize)
+     const struct krb5_keytypes *ktp;
+     char *buf;
+     size_t maxsize;
+{
+    struct bench b;
+    krb5_keyblock key;
+    krb5_error_code ret;
+    size_t size, enclen;
+
+    memset(&b, 0, sizeof(b));
+    b.enctype = ktp->etype;
+
+    if ((ret = krb5_c_make_random_key(context, ktp->etype, &key)))
+	fail("make_random_key", ktp->in_string, ret);
+    b.key = &key;
+
+    for (size = MINSIZE; size <= maxsize; size *= 4) {
+	b.plain.length = size;
+	b.plain.data = buf;
+
+	if ((ret = krb5_c_encrypt_length(context, ktp->etype, size, &enclen)))
+	    fail("encrypt_length", ktp->in_string, ret);
+	b.enc.ciphertext.length = enclen;
+	if ((b.enc.ciphertext.data = malloc(enclen)) == NULL)
+	    fail("malloc", ktp->in_string, ENOMEM);
+	b.output.length = enclen;
+	if ((b.output.data = malloc(enclen)) == NULL)
+	    fail("malloc", ktp->in_string, ENOMEM);
+
+	run("encrypt", ktp->in_string, size, do_encrypt, &b);
+	run("decrypt", ktp->in_string, size, do_decrypt, &b);
+
+	free(b.enc.ciphertext.data);
+	free(b.output.data);
+	b.output.length = 0;
+    }
+
+    b.password.data = "password";
+    b.password.length = strlen(b.password.data);
+    b.salt.data = "ATHENA.MIT.EDUraeburn";
+    b.salt.length = strlen(b.salt.data);
+    run("string_to_key", ktp->in_string,
+	b.password.length + b.salt.length, do_string_to_key, &b);
+
+    krb5_free_keyblock_contents(context, &key);
+}
+
+static void
+bench_cksumtype(ctp, buf, maxsize)
+     const struct krb5_cksumtypes *ctp;
+     char *buf;
+     size_t maxsize;
+{
+    struct bench b;
+    krb5_keyblock key;
+    krb5_enctype enctype;
+    krb5_error_code ret;
+    size_t size;
+
+    memset(&b, 0, sizeof(b));
+    b.cksumtype = ctp->ctype;
+
+    /* derived-key checksums can be keyed with any enctype; use the
+       one they are normally found with */
+    enctype = ctp->keyed_etype;
+    if ((enctype == 0) && (ctp->flags & KRB5_CKSUMFLAG_DERIVE))
+	enctype = ENCTYPE_DES3_CBC_SHA1;
+
+    if (enctype) {
+	if ((ret = krb5_c_make_random_key(context, enctype, &key)))
+	    fail("make_random_key", ctp->in_string, ret);
+	b.key = &key;
+    }
+
+    for (size = MINSIZE; size <= maxsize; size *= 4) {
+	b.plain.length = size;
+	b.plain.data = buf;
+
+	if ((ret = krb5_c_make_checksum(context, b.cksumtype, b.key, USAGE,
+					&b.plain, &b.cksum)))
+	    fail("make_checksum", ctp->in_string, ret);
+
+	run("make_checksum", ctp->in_string, size, do_make_checksum, &b);
+	run("verify_checksum", ctp->in_string, size, do_verify_checksum, &b);
+
+	free(b.cksum.contents);
+    }
+
+    if (b.key)
+	krb5_free_keyblock_contents(context, &key);
+}
+
+int
+main(argc, argv)
+     int argc;
+     char **argv;
+{
+    krb5_error_code ret;
+    krb5_data seed;
+    size_t maxsize = MAXSIZE, i;
+    char *buf;
+    int c, j, k;
+    extern int optind;
+    extern char *optarg;
+
+    while ((c = getopt(argc, argv, "t:m:")) != -1) {
+	switch (c) {
+	case 't':
+	    mintime = atol(optarg);
+	    break;
+	case 'm':
+	    maxsize = atol(optarg);
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-t msec] [-m maxsize] [name ...]\n",
+		    argv[0]);
+	    exit(1);
+	}
+    }
+    names = argv+optind;
+    nnames = argc-optind;
+
+    if ((ret = krb5_init_context(&context)))
+	fail("krb5_init_context", "library", ret);
+
+    seed.data = "t_cryptobench";
+    seed.length = strlen(seed.data);
+    if ((ret = krb5_c_random_seed(context, &seed)))
+	fail("krb5_c_random_seed", "library", ret);
+
+    if ((buf = malloc(maxsize)) == NULL)
+	fail("malloc", "buffer", ENOMEM);
+    for (i=0; i<maxsize; i++)
+	buf[i] = i & 0xff;
+
+    printf("# operation\ttype\tbytes\titerations\tops/sec\tcycles/byte\n");
+
+    /* aliases share their etype with an earlier entry; skip them */
+    for (j=0; j<krb5_enctypes_length; j++) {
+	for (k=0; k<j; k++)
+	    if (krb5_enctypes_list[k].etype == krb5_enctypes_list[j].etype)
+		break;
+	if ((k < j) || !wanted(krb5_enctypes_list[j].in_string))
+	    continue;
+	bench_enctype(&krb5_enctypes_list[j], buf, maxsize);
+    }
+
+    for (j=0; j<krb5_cksumtypes_length; j++) {
+	for (k=0; k<j; k++)
+	    if (krb5_cksumtypes_list[k].ctype == krb5_cksumtypes_list[j].ctype)
+		break;
+	if ((k < j) || !wanted(krb5_cksumtypes_list[j].in_string))
+	    continue;
+	bench_cksumtype(&krb5_cksumtypes_list[j], buf, maxsize);
+    }
+
+    free(buf);
+    krb5_free_context(context);
+
+    return(0);
+}
@@ -0,0 +1,147 @@
+/*
+ * lib/crypto/t_decrypt_batch.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ * 
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ * Program to test krb5_c_decrypt_batch against krb5_c_encrypt, with
+ * the jobs mixing enctypes, keys and usages, and some of them
+ * corrupted.
+ *
+ * exit returns	 0 ==> success
+ * 		 1 ==> error
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "k5-int.h"
+
+krb5_enctype enctypes[] = {
+    ENCTYPE_DES_CBC_CRC,
+    ENCTYPE_DES_CBC_MD5,
+    ENCTYPE_DES3_CBC_SHA1,
+    ENCTYPE_DES_HMAC_SHA1,
+};
+
+#define NENCTYPES	(sizeof(enctypes)/sizeof(enctypes[0]))
+#define NKEYS		2	/* per enctype */
+#define NJOBS		64
+
+static void
+check(what, code)
+     char *what;
+     krb5_error_code code;
+{
+    if (code) {
+	printf("%s failed: %s\n", what, error_message(code));
+	exit(1);
+    }
+}
+
+int
+main(argc, argv)
+     int argc;
+     char *argv[];
+{
+    krb5_context context = NULL;
+    krb5_keyblock keys[NENCTYPES][NKEYS], *key;
+    krb5_crypto_job jobs[NJOBS];
+    krb5_enc_data enc[NJOBS];
+    krb5_data seed, plain, out[NJOBS];
+    krb5_keyusage usage;
+    krb5_error_code expect;
+    char msg[NJOBS];
+    size_t enclen;
+    int i, j;
+
+    seed.data = "t_decrypt_batch";
+    seed.length = strlen(seed.data);
+    check("krb5_c_random_seed", krb5_c_random_seed(context, &seed));
+
+    for (i = 0; i < NENCTYPES; i++)
+	for (j = 0; j < NKEYS; j++)
+	    check("krb5_c_make_random_key",
+		  krb5_c_make_random_key(context, enctypes[i], &keys[i][j]));
+
+    for (i = 0; i < NJOBS; i++)
+	msg[i] = 'a' + i % 26;
+
+    for (i = 0; i < NJOBS; i++) {
+	/* mostly the same few keys and usages, as a server would see */
+	key = &keys[i % NENCTYPES][(i / NENCTYPES) % NKEYS];
+	usage = (i % 3) ? 2 : 7;
+
+	plain.data = msg;
+	plain.length = i;
+	check("krb5_c_encrypt_length",
+	      krb5_c_encrypt_length(context, key->enctype, plain.length,
+				    &enclen));
+	enc[i].ciphertext.length = enclen;
+	if ((enc[i].ciphertext.data = malloc(enclen)) == NULL)
+	    check("malloc", ENOMEM);
+	check("krb5_c_encrypt",
+	      krb5_c_encrypt(context, key, usage, 0, &plain, &enc[i]));
+
+	/* every fifth message is corrupted */
+	if (i % 5 == 4)
+	    enc[i].ciphertext.data[enclen - 1] ^= 0x10;
+
+	out[i].length = enclen;
+	if ((out[i].data = malloc(enclen)) == NULL)
+	    check("malloc", ENOMEM);
+
+	jobs[i].key = key;
+	jobs[i].usage = usage;
+	jobs[i].ivec = NULL;
+	jobs[i].input = &enc[i];
+	jobs[i].output = &out[i];
+	jobs[i].result = -1;
+    }
+
+    check("krb5_c_decrypt_batch",
+	  krb5_c_decrypt_batch(context, jobs, NJOBS));
+
+    for (i = 0; i < NJOBS; i++) {
+	expect = (i % 5 == 4) ? KRB5KRB_AP_ERR_BAD_INTEGRITY : 0;
+	if (jobs[i].result != expect) {
+	    printf("job %d (enctype %d): got %d, expected %d\n", i,
+		   jobs[i].key->enctype, jobs[i].result, expect);
+	    exit(1);
+	}
+	if ((expect == 0) &&
+	    ((out[i].length < i) || memcmp(out[i].data, msg, i))) {
+	    printf("job %d (enctype %d): wrong plaintext\n", i,
+		   jobs[i].key->enctype);
+	    exit(1);
+	}
+	free(out[i].data);
+	free(enc[i].ciphertext.data);
+    }
+
+    for (i = 0; i < NENCTYPES; i++)
+	for (j = 0; j < NKEYS; j++)
+	    krb5_free_keyblock_contents(context, &keys[i][j]);
+
+    printf("verify: batch decryption is correct\n");
+    exit(0);
+}
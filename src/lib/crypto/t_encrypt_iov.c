@@ -0,0 +1,224 @@
+/*
+ * lib/crypto/t_encrypt_iov.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ * 
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ * Program to test krb5_c_encrypt_iov and krb5_c_decrypt_iov against
+ * the contiguous krb5_c_encrypt and krb5_c_decrypt.  For each enctype
+ * and each message length up to 40 bytes, a message split over three
+ * DATA buffers is encrypted in place and decrypted as one ciphertext,
+ * a contiguous ciphertext is decrypted in place through the iov
+ * interface, and a message with a damaged header must fail to
+ * decrypt where the enctype has a checksum.
+ *
+ * exit returns	 0 ==> success
+ * 		 1 ==> error
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "k5-int.h"
+
+krb5_enctype enctypes[] = {
+    ENCTYPE_DES_CBC_CRC,
+    ENCTYPE_DES_CBC_MD4,
+    ENCTYPE_DES_CBC_MD5,
+    ENCTYPE_DES_CBC_RAW,
+    ENCTYPE_DES3_CBC_RAW,
+    ENCTYPE_DES3_CBC_SHA1,
+    ENCTYPE_DES_HMAC_SHA1,
+};
+
+/* the message is split over three DATA buffers at these points */
+#define SPLIT1(len)	((len)/3)
+#define SPLIT2(len)	((len) - (len)/4)
+
+static void
+check(what, enctype, len, code)
+     char *what;
+     krb5_enctype enctype;
+     int len;
+     krb5_error_code code;
+{
+    if (code) {
+	printf("%s failed for enctype %d, length %d: %s\n", what,
+	       enctype, len, error_message(code));
+	exit(1);
+    }
+}
+
+static void
+fill_iov(iov, header, hlen, msg, len, padding, plen, trailer, tlen)
+     krb5_crypto_iov *iov;
+     char *header, *msg, *padding, *trailer;
+     int hlen, len, plen, tlen;
+{
+    iov[0].flags = KRB5_CRYPTO_TYPE_HEADER;
+    iov[0].data.data = header;
+    iov[0].data.length = hlen;
+    iov[1].flags = KRB5_CRYPTO_TYPE_DATA;
+    iov[1].data.data = msg;
+    iov[1].data.length = SPLIT1(len);
+    iov[2].flags = KRB5_CRYPTO_TYPE_DATA;
+    iov[2].data.data = msg + SPLIT1(len);
+    iov[2].data.length = SPLIT2(len) - SPLIT1(len);
+    iov[3].flags = KRB5_CRYPTO_TYPE_DATA;
+    iov[3].data.data = msg + SPLIT2(len);
+    iov[3].data.length = len - SPLIT2(len);
+    iov[4].flags = KRB5_CRYPTO_TYPE_PADDING;
+    iov[4].data.data = padding;
+    iov[4].data.length = plen;
+    iov[5].flags = KRB5_CRYPTO_TYPE_TRAILER;
+    iov[5].data.data = trailer;
+    iov[5].data.length = tlen;
+}
+
+int
+main(argc, argv)
+     int argc;
+     char *argv[];
+{
+    krb5_context context = NULL;
+    krb5_keyblock key;
+    krb5_data seed, plain, out;
+    krb5_enc_data enc;
+    krb5_crypto_iov iov[6];
+    char msg[64], work[64], header[64], padding[64], trailer[64];
+    char *p;
+    size_t hlen, plen, tlen, enclen;
+    int i, len;
+
+    seed.data = "t_encrypt_iov";
+    seed.length = strlen(seed.data);
+    check("krb5_c_random_seed", 0, 0, krb5_c_random_seed(context, &seed));
+
+    for (i = 0; i < sizeof(msg); i++)
+	msg[i] = 'a' + i % 26;
+
+    for (i = 0; i < sizeof(enctypes)/sizeof(enctypes[0]); i++) {
+	check("krb5_c_make_random_key", enctypes[i], 0,
+	      krb5_c_make_random_key(context, enctypes[i], &key));
+	check("krb5_c_crypto_length", enctypes[i], 0,
+	      krb5_c_crypto_length(context, enctypes[i],
+				   KRB5_CRYPTO_TYPE_HEADER, &hlen));
+	check("krb5_c_crypto_length", enctypes[i], 0,
+	      krb5_c_crypto_length(context, enctypes[i],
+				   KRB5_CRYPTO_TYPE_TRAILER, &tlen));
+
+	for (len = 0; len <= 40; len++) {
+	    check("krb5_c_padding_length", enctypes[i], len,
+		  krb5_c_padding_length(context, enctypes[i], len, &plen));
+
+	    /* scattered encrypt, contiguous decrypt */
+
+	    memcpy(work, msg, len);
+	    fill_iov(iov, header, sizeof(header), work, len,
+		     padding, sizeof(padding), trailer, sizeof(trailer));
+	    check("krb5_c_encrypt_iov", enctypes[i], len,
+		  krb5_c_encrypt_iov(context, &key, 0, 0, iov, 6));
+
+	    if (iov[0].data.length != hlen || iov[4].data.length != plen ||
+		iov[5].data.length != tlen) {
+		printf("bad buffer lengths for enctype %d, length %d\n",
+		       enctypes[i], len);
+		exit(1);
+	    }
+
+	    enc.enctype = ENCTYPE_UNKNOWN;
+	    enc.ciphertext.length = hlen + len + plen + tlen;
+	    if ((enc.ciphertext.data = malloc(enc.ciphertext.length)) == NULL)
+		check("malloc", enctypes[i], len, ENOMEM);
+	    p = enc.ciphertext.data;
+	    memcpy(p, header, hlen);
+	    memcpy(p += hlen, work, len);
+	    memcpy(p += len, padding, plen);
+	    memcpy(p += plen, trailer, tlen);
+
+	    out.length = enc.ciphertext.length;
+	    if ((out.data = malloc(out.length)) == NULL)
+		check("malloc", enctypes[i], len, ENOMEM);
+	    check("krb5_c_decrypt", enctypes[i], len,
+		  krb5_c_decrypt(context, &key, 0, 0, &enc, &out));
+	    if (out.length < len || memcmp(out.data, msg, len)) {
+		printf("iov encrypt mismatch for enctype %d, length %d\n",
+		       enctypes[i], len);
+		exit(1);
+	    }
+	    free(out.data);
+	    free(enc.ciphertext.data);
+
+	    /* contiguous encrypt, scattered decrypt; feed in the padded
+	       message so that the raw enctypes can take it as well */
+
+	    memcpy(work, msg, len);
+	    memset(work + len, 0, plen);
+	    plain.data = work;
+	    plain.length = len + plen;
+
+	    check("krb5_c_encrypt_length", enctypes[i], len,
+		  krb5_c_encrypt_length(context, enctypes[i], plain.length,
+					&enclen));
+	    enc.ciphertext.length = enclen;
+	    if ((enc.ciphertext.data = malloc(enclen)) == NULL)
+		check("malloc", enctypes[i], len, ENOMEM);
+	    check("krb5_c_encrypt", enctypes[i], len,
+		  krb5_c_encrypt(context, &key, 0, 0, &plain, &enc));
+
+	    p = enc.ciphertext.data;
+	    memcpy(header, p, hlen);
+	    memcpy(work, p += hlen, len + plen);
+	    memcpy(trailer, p += len + plen, tlen);
+	    fill_iov(iov, header, hlen, work, len + plen,
+		     padding, 0, trailer, tlen);
+	    check("krb5_c_decrypt_iov", enctypes[i], len,
+		  krb5_c_decrypt_iov(context, &key, 0, 0, iov, 6));
+	    if (memcmp(work, msg, len)) {
+		printf("iov decrypt mismatch for enctype %d, length %d\n",
+		       enctypes[i], len);
+		exit(1);
+	    }
+
+	    /* and a tampered message must not verify */
+
+	    if (tlen || hlen > 8) {
+		memcpy(work, enc.ciphertext.data + hlen, len + plen);
+		memcpy(header, enc.ciphertext.data, hlen);
+		header[0] ^= 1;
+		if (krb5_c_decrypt_iov(context, &key, 0, 0, iov, 6) == 0) {
+		    printf("tampered message verified for enctype %d, "
+			   "length %d\n", enctypes[i], len);
+		    exit(1);
+		}
+	    }
+	    free(enc.ciphertext.data);
+	}
+
+	krb5_free_keyblock_contents(context, &key);
+	printf("enctype %d: ok\n", enctypes[i]);
+    }
+
+    printf("verify: iov encryption is correct\n");
+
+    exit(0);
+}
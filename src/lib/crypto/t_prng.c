@@ -0,0 +1,147 @@
+/*
+ * lib/crypto/t_prng.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ * Program to check that children forked from one process get
+ * different output from krb5_c_random_make_octets, both from each
+ * other and from the parent, even though they all start with a copy
+ * of its generator.
+ *
+ * exit returns	 0 ==> success
+ * 		 1 ==> error
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "k5-int.h"
+
+#define NCHILDREN	2
+#define OUTLEN		32
+
+static void
+check(what, code)
+     char *what;
+     krb5_error_code code;
+{
+    if (code) {
+	printf("%s failed: %s\n", what, error_message(code));
+	exit(1);
+    }
+}
+
+/* fork a child which writes OUTLEN random bytes down a pipe, and read
+   them into buf */
+
+static void
+child_octets(buf)
+     char *buf;
+{
+    krb5_data out;
+    int fds[2], status;
+    size_t got;
+    ssize_t n;
+    pid_t pid;
+
+    if (pipe(fds) < 0) {
+	perror("pipe");
+	exit(1);
+    }
+
+    if ((pid = fork()) < 0) {
+	perror("fork");
+	exit(1);
+    }
+
+    if (pid == 0) {
+	close(fds[0]);
+	out.data = buf;
+	out.length = OUTLEN;
+	if (krb5_c_random_make_octets(NULL, &out) ||
+	    write(fds[1], buf, OUTLEN) != OUTLEN)
+	    _exit(1);
+	_exit(0);
+    }
+
+    close(fds[1]);
+    for (got = 0; got < OUTLEN; got += n) {
+	if ((n = read(fds[0], buf+got, OUTLEN-got)) <= 0) {
+	    printf("short read from child\n");
+	    exit(1);
+	}
+    }
+    close(fds[0]);
+
+    if (waitpid(pid, &status, 0) != pid ||
+	!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+	printf("child failed\n");
+	exit(1);
+    }
+}
+
+int
+main(argc, argv)
+     int argc;
+     char *argv[];
+{
+    char parent[OUTLEN], children[NCHILDREN][OUTLEN];
+    krb5_data seed, out;
+    int i, j;
+
+    seed.data = "t_prng";
+    seed.length = strlen(seed.data);
+    check("krb5_c_random_seed", krb5_c_random_seed(NULL, &seed));
+
+    /* make the parent's generator, so the children inherit it keyed
+       and with buffered output */
+    out.data = parent;
+    out.length = sizeof(parent);
+    check("krb5_c_random_make_octets",
+	  krb5_c_random_make_octets(NULL, &out));
+
+    for (i = 0; i < NCHILDREN; i++)
+	child_octets(children[i]);
+
+    check("krb5_c_random_make_octets",
+	  krb5_c_random_make_octets(NULL, &out));
+
+    for (i = 0; i < NCHILDREN; i++) {
+	if (memcmp(children[i], parent, OUTLEN) == 0) {
+	    printf("child %d repeated the parent's output\n", i);
+	    exit(1);
+	}
+	for (j = 0; j < i; j++) {
+	    if (memcmp(children[i], children[j], OUTLEN) == 0) {
+		printf("children %d and %d produced the same output\n", j, i);
+		exit(1);
+	    }
+	}
+    }
+
+    printf("verify: forked children produce different output\n");
+    exit(0);
+}
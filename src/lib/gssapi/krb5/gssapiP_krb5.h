@@ -263,6 +263,18 @@ krb5_error_code kg_decrypt PROTOTYPE((krb5_context context,
 				      krb5_pointer out,
 				      int length));
 
+krb5_error_code kg_encrypt_iov PROTOTYPE((krb5_context context,
+					  krb5_keyblock *key, int usage,
+					  krb5_pointer iv,
+					  krb5_crypto_iov *data,
+					  size_t num_data));
+
+krb5_error_code kg_decrypt_iov PROTOTYPE((krb5_context context,
+					  krb5_keyblock *key, int usage,
+					  krb5_pointer iv,
+					  krb5_crypto_iov *data,
+					  size_t num_data));
+
 OM_uint32 kg_seal PROTOTYPE((krb5_context context,
 		  OM_uint32 *minor_status,
 		  gss_ctx_id_t context_handle,
@@ -85,8 +85,7 @@ make_seal_token_v1(context, enc, seq, seqnum, direction, text, token,
 {
     krb5_error_code code;
     size_t sumlen;
-    char *data_ptr;
-    krb5_data plaind;
+    krb5_crypto_iov iov[2];
     krb5_checksum md5cksum;
     krb5_checksum cksum;
     int conflen=0, tmsglen, tlen;
@@ -189,96 +188,73 @@ make_seal_token_v1(context, enc, seq, seqnum, direction, text, token,
 	return(code);
     md5cksum.length = sumlen;
 
+    /* 8 = head of token body as specified by mech spec */
+    iov[0].flags = KRB5_CRYPTO_TYPE_DATA;
+    iov[0].data.length = 8;
+    iov[0].data.data = (char *) ptr-2;
+    iov[1].flags = KRB5_CRYPTO_TYPE_DATA;
+
     if (toktype == KG_TOK_SEAL_MSG) {
-	unsigned char *plain;
+	unsigned char *body;
 	unsigned char pad;
 
-	if (!bigend || encrypt) {
-	    if ((plain = (unsigned char *) xmalloc(tmsglen)) == NULL) {
-		xfree(t);
-		return(ENOMEM);
-	    }
+	/* the message is assembled and encrypted in place in the token,
+	   rather than in a temporary buffer which is then copied */
+
+	body = ptr+14+cksum_size;
 
-	    if ((code = kg_make_confounder(context, enc, plain))) {
-		xfree(plain);
+	if (!bigend || encrypt) {
+	    if ((code = kg_make_confounder(context, enc, body))) {
 		xfree(t);
 		return(code);
 	    }
 
-	    memcpy(plain+conflen, text->value, text->length);
+	    memcpy(body+conflen, text->value, text->length);
 
 	    /* XXX 8 is DES cblock size */
 	    pad = 8-(text->length%8);
 
-	    memset(plain+conflen+text->length, pad, pad);
+	    memset(body+conflen+text->length, pad, pad);
 	} else {
-	    /* plain is never used in the bigend && !encrypt case */
-	    plain = NULL;
+	    memcpy(body, text->value, text->length);
 	}
 
-	if (encrypt) {
-	    if ((code = kg_encrypt(context, enc, KG_USAGE_SEAL, NULL,
-				   (krb5_pointer) plain,
-				   (krb5_pointer) (ptr+cksum_size+14),
-				   tmsglen))) {
-		if (plain)
-		    xfree(plain);
-		xfree(t);
-		return(code);
-	    }
-	} else {
-	    if (bigend)
-		memcpy(ptr+14+cksum_size, text->value, text->length);
-	    else
-		memcpy(ptr+14+cksum_size, plain, tmsglen);
-	}
+	/* compute the checksum, over the plaintext; the big-endian
+	   token covers only the message, not the confounder and pad */
 
-	/* compute the checksum */
-
-	/* 8 = head of token body as specified by mech spec */
-	if (! (data_ptr =
-	       (char *) xmalloc(8 + (bigend ? text->length : tmsglen)))) {
-	    if (plain)
-		xfree(plain);
-	    xfree(t);
-	    return(ENOMEM);
+	if (bigend) {
+	    iov[1].data.length = text->length;
+	    iov[1].data.data = (char *) text->value;
+	} else {
+	    iov[1].data.length = tmsglen;
+	    iov[1].data.data = (char *) body;
 	}
-	(void) memcpy(data_ptr, ptr-2, 8);
-	if (bigend)
-	    (void) memcpy(data_ptr+8, text->value, text->length);
-	else
-	    (void) memcpy(data_ptr+8, plain, tmsglen);
-	plaind.length = 8 + (bigend ? text->length : tmsglen);
-	plaind.data = data_ptr;
-	code = krb5_c_make_checksum(context, md5cksum.checksum_type, seq,
-				    KG_USAGE_SIGN, &plaind, &md5cksum);
-	xfree(data_ptr);
-
-	if (code) {
-	    if (plain)
-		xfree(plain);
+	if ((code = krb5_c_make_checksum_iov(context, md5cksum.checksum_type,
+					     seq, KG_USAGE_SIGN, iov, 2,
+					     &md5cksum))) {
 	    xfree(t);
 	    return(code);
 	}
 
-	if (plain)
-	    xfree(plain);
+	if (encrypt) {
+	    iov[1].data.length = tmsglen;
+	    iov[1].data.data = (char *) body;
+	    if ((code = kg_encrypt_iov(context, enc, KG_USAGE_SEAL, NULL,
+				       &iov[1], 1))) {
+		xfree(md5cksum.contents);
+		xfree(t);
+		return(code);
+	    }
+	}
     } else {
 	/* Sign only.  */
 	/* compute the checksum */
 
-	if (! (data_ptr = (char *) xmalloc(8 + text->length))) {
-	    xfree(t);
-	    return(ENOMEM);
-	}
-	(void) memcpy(data_ptr, ptr-2, 8);
-	(void) memcpy(data_ptr+8, text->value, text->length);
-	plaind.length = 8 + text->length;
-	plaind.data = data_ptr;
-	code = krb5_c_make_checksum(context, md5cksum.checksum_type, seq,
-				    KG_USAGE_SIGN, &plaind, &md5cksum);
-	xfree(data_ptr);
-	if (code) {
+	iov[1].data.length = text->length;
+	iov[1].data.data = (char *) text->value;
+	if ((code = krb5_c_make_checksum_iov(context, md5cksum.checksum_type,
+					     seq, KG_USAGE_SIGN, iov, 2,
+					     &md5cksum))) {
 	    xfree(t);
 	    return(code);
 	}
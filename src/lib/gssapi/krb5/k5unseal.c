@@ -77,8 +77,7 @@ kg_unseal_v1(context, minor_status, ctx, ptr, bodysize, message_buffer,
     gss_buffer_desc token;
     krb5_checksum cksum;
     krb5_checksum md5cksum;
-    krb5_data plaind;
-    char *data_ptr;
+    krb5_crypto_iov iov[3];
     krb5_timestamp now;
     unsigned char *plain;
     int cksum_len = 0;
@@ -157,13 +156,21 @@ kg_unseal_v1(context, minor_status, ctx, ptr, bodysize, message_buffer,
 
     if (toktype == KG_TOK_SEAL_MSG) {
 	if (sealalg != 0xffff) {
+	    /* decrypt in place in a copy of the ciphertext; the message
+	       is moved down over the confounder once it has been
+	       verified, so the copy doubles as the output buffer */
+
 	    if ((plain = (unsigned char *) xmalloc(tmsglen)) == NULL) {
 		*minor_status = ENOMEM;
 		return(GSS_S_FAILURE);
 	    }
+	    memcpy(plain, ptr+14+cksum_len, tmsglen);
 
-	    if ((code = kg_decrypt(context, ctx->enc, KG_USAGE_SEAL, NULL,
-				   ptr+14+cksum_len, plain, tmsglen))) {
+	    iov[0].flags = KRB5_CRYPTO_TYPE_DATA;
+	    iov[0].data.length = tmsglen;
+	    iov[0].data.data = (char *) plain;
+	    if ((code = kg_decrypt_iov(context, ctx->enc, KG_USAGE_SEAL, NULL,
+				       iov, 1))) {
 		xfree(plain);
 		*minor_status = code;
 		return(GSS_S_FAILURE);
@@ -181,15 +188,7 @@ kg_unseal_v1(context, minor_status, ctx, ptr, bodysize, message_buffer,
 	    token.length = tmsglen - conflen - plain[tmsglen-1];
 	}
 
-	if (token.length) {
-	    if ((token.value = (void *) xmalloc(token.length)) == NULL) {
-		if (sealalg != 0xffff)
-		    xfree(plain);
-		*minor_status = ENOMEM;
-		return(GSS_S_FAILURE);
-	    }
-	    memcpy(token.value, plain+conflen, token.length);
-	}
+	token.value = plain+conflen;
     } else if (toktype == KG_TOK_SIGN_MSG) {
 	token = *message_buffer;
 	plain = token.value;
@@ -223,40 +222,38 @@ kg_unseal_v1(context, minor_status, ctx, ptr, bodysize, message_buffer,
 	return(code);
     md5cksum.length = sumlen;
 
+    /* 8 = bytes of token body to be checksummed according to spec */
+
+    iov[0].flags = KRB5_CRYPTO_TYPE_DATA;
+    iov[0].data.length = 8;
+    iov[0].data.data = (char *) ptr-2;
+
+    iov[1].flags = KRB5_CRYPTO_TYPE_DATA;
+    iov[1].data.length = sizeof(ctx->seed);
+    iov[1].data.data = (char *) ctx->seed;
+
+    iov[2].flags = KRB5_CRYPTO_TYPE_DATA;
+    if (ctx->big_endian) {
+	iov[2].data.length = token.length;
+	iov[2].data.data = (char *) token.value;
+    } else {
+	iov[2].data.length = plainlen;
+	iov[2].data.data = (char *) plain;
+    }
+
     switch (signalg) {
     case SGN_ALG_DES_MAC_MD5:
     case SGN_ALG_3:
 	/* compute the checksum of the message */
 
-	/* 8 = bytes of token body to be checksummed according to spec */
+	iov[1].flags = KRB5_CRYPTO_TYPE_EMPTY;
+	code = krb5_c_make_checksum_iov(context, md5cksum.checksum_type,
+					ctx->seq, KG_USAGE_SIGN,
+					iov, 3, &md5cksum);
 
-	if (! (data_ptr = (void *)
-	       xmalloc(8 + (ctx->big_endian ? token.length : plainlen)))) {
+	if (code) {
 	    if (sealalg != 0xffff)
 		xfree(plain);
-	    if (toktype == KG_TOK_SEAL_MSG)
-		xfree(token.value);
-	    *minor_status = ENOMEM;
-	    return(GSS_S_FAILURE);
-	}
-
-	(void) memcpy(data_ptr, ptr-2, 8);
-
-	if (ctx->big_endian)
-	    (void) memcpy(data_ptr+8, token.value, token.length);
-	else
-	    (void) memcpy(data_ptr+8, plain, plainlen);
-
-	plaind.length = 8 + (ctx->big_endian ? token.length : plainlen);
-	plaind.data = data_ptr;
-	code = krb5_c_make_checksum(context, md5cksum.checksum_type,
-				    ctx->seq, KG_USAGE_SIGN,
-				    &plaind, &md5cksum);
-	xfree(data_ptr);
-
-	if (code) {
-	    if (toktype == KG_TOK_SEAL_MSG)
-		xfree(token.value);
 	    *minor_status = code;
 	    return(GSS_S_FAILURE);
 	}
@@ -266,8 +263,8 @@ kg_unseal_v1(context, minor_status, ctx, ptr, bodysize, message_buffer,
 				ctx->seq->contents : NULL),
 			       md5cksum.contents, md5cksum.contents, 16))) {
 	    xfree(md5cksum.contents);
-	    if (toktype == KG_TOK_SEAL_MSG)
-		xfree(token.value);
+	    if (sealalg != 0xffff)
+		xfree(plain);
 	    *minor_status = code;
 	    return GSS_S_FAILURE;
 	}
@@ -284,91 +281,44 @@ kg_unseal_v1(context, minor_status, ctx, ptr, bodysize, message_buffer,
     case SGN_ALG_MD2_5:
 	if (!ctx->seed_init &&
 	    (code = kg_make_seed(context, ctx->subkey, ctx->seed))) {
-	    xfree(md5cksum.contents);
 	    if (sealalg != 0xffff)
 		xfree(plain);
-	    if (toktype == KG_TOK_SEAL_MSG)
-		xfree(token.value);
 	    *minor_status = code;
 	    return GSS_S_FAILURE;
 	}
 
-	if (! (data_ptr = (void *)
-	       xmalloc(sizeof(ctx->seed) + 8 +
-		       (ctx->big_endian ? token.length : plainlen)))) {
-	    xfree(md5cksum.contents);
-	    if (sealalg == 0)
-		xfree(plain);
-	    if (toktype == KG_TOK_SEAL_MSG)
-		xfree(token.value);
-	    *minor_status = ENOMEM;
-	    return(GSS_S_FAILURE);
-	}
-	(void) memcpy(data_ptr, ptr-2, 8);
-	(void) memcpy(data_ptr+8, ctx->seed, sizeof(ctx->seed));
-	if (ctx->big_endian)
-	    (void) memcpy(data_ptr+8+sizeof(ctx->seed),
-			  token.value, token.length);
-	else
-	    (void) memcpy(data_ptr+8+sizeof(ctx->seed),
-			  plain, plainlen);
-	plaind.length = 8 + sizeof(ctx->seed) +
-	    (ctx->big_endian ? token.length : plainlen);
-	plaind.data = data_ptr;
-	xfree(md5cksum.contents);
-	code = krb5_c_make_checksum(context, md5cksum.checksum_type,
-				    ctx->seq, KG_USAGE_SIGN,
-				    &plaind, &md5cksum);
-	xfree(data_ptr);
+	code = krb5_c_make_checksum_iov(context, md5cksum.checksum_type,
+					ctx->seq, KG_USAGE_SIGN,
+					iov, 3, &md5cksum);
 
 	if (code) {
-	    if (sealalg == 0)
+	    if (sealalg != 0xffff)
 		xfree(plain);
-	    if (toktype == KG_TOK_SEAL_MSG)
-		xfree(token.value);
 	    *minor_status = code;
 	    return(GSS_S_FAILURE);
 	}
 
 	code = memcmp(md5cksum.contents, ptr+14, 8);
+	xfree(md5cksum.contents);
 	/* Falls through to defective-token??  */
 
     default:
+	if (sealalg != 0xffff)
+	    xfree(plain);
 	*minor_status = 0;
 	return(GSS_S_DEFECTIVE_TOKEN);
 
     case SGN_ALG_HMAC_SHA1_DES3_KD:
 	/* compute the checksum of the message */
 
-	/* 8 = bytes of token body to be checksummed according to spec */
+	iov[1].flags = KRB5_CRYPTO_TYPE_EMPTY;
+	code = krb5_c_make_checksum_iov(context, md5cksum.checksum_type,
+					ctx->seq, KG_USAGE_SIGN,
+					iov, 3, &md5cksum);
 
-	if (! (data_ptr = (void *)
-	       xmalloc(8 + (ctx->big_endian ? token.length : plainlen)))) {
+	if (code) {
 	    if (sealalg != 0xffff)
 		xfree(plain);
-	    if (toktype == KG_TOK_SEAL_MSG)
-		xfree(token.value);
-	    *minor_status = ENOMEM;
-	    return(GSS_S_FAILURE);
-	}
-
-	(void) memcpy(data_ptr, ptr-2, 8);
-
-	if (ctx->big_endian)
-	    (void) memcpy(data_ptr+8, token.value, token.length);
-	else
-	    (void) memcpy(data_ptr+8, plain, plainlen);
-
-	plaind.length = 8 + (ctx->big_endian ? token.length : plainlen);
-	plaind.data = data_ptr;
-	code = krb5_c_make_checksum(context, md5cksum.checksum_type,
-				    ctx->seq, KG_USAGE_SIGN,
-				    &plaind, &md5cksum);
-	xfree(data_ptr);
-
-	if (code) {
-	    if (toktype == KG_TOK_SEAL_MSG)
-		xfree(token.value);
 	    *minor_status = code;
 	    return(GSS_S_FAILURE);
 	}
@@ -378,18 +328,32 @@ kg_unseal_v1(context, minor_status, ctx, ptr, bodysize, message_buffer,
     }
 
     xfree(md5cksum.contents);
-    if (sealalg != 0xffff)
-	xfree(plain);
 
     /* compare the computed checksum against the transmitted checksum */
 
     if (code) {
-	if (toktype == KG_TOK_SEAL_MSG)
-	    xfree(token.value);
+	if (sealalg != 0xffff)
+	    xfree(plain);
 	*minor_status = 0;
 	return(GSS_S_BAD_SIG);
     }
 
+    /* hand back the message in a buffer of its own */
+
+    if (toktype == KG_TOK_SEAL_MSG) {
+	if (sealalg != 0xffff) {
+	    memmove(plain, token.value, token.length);
+	    token.value = plain;
+	} else if (token.length) {
+	    if ((token.value = (void *) xmalloc(token.length)) == NULL) {
+		*minor_status = ENOMEM;
+		return(GSS_S_FAILURE);
+	    }
+	    memcpy(token.value, plain+conflen, token.length);
+	} else {
+	    token.value = NULL;
+	}
+    }
 
     /* it got through unscathed.  Make sure the context is unexpired */
 
@@ -0,0 +1,153 @@
+/*
+ * lib/gssapi/krb5/t_seal.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ * Program to check that messages sealed with kg_seal are unsealed by
+ * kg_unseal, with and without confidentiality, for DES contexts using
+ * both the standard and the old big-endian token checksum.
+ *
+ * exit returns	 0 ==> success
+ * 		 1 ==> error
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gssapiP_krb5.h"
+
+static void
+check(what, code)
+     char *what;
+     krb5_error_code code;
+{
+    if (code) {
+	printf("%s failed: %s\n", what, error_message(code));
+	exit(1);
+    }
+}
+
+/* make one end of an established DES context on subkey */
+
+static krb5_gss_ctx_id_rec *
+make_ctx(context, subkey, initiate, bigend)
+     krb5_context context;
+     krb5_keyblock *subkey;
+     int initiate;
+     int bigend;
+{
+    krb5_gss_ctx_id_rec *ctx;
+    int i;
+
+    if ((ctx = (krb5_gss_ctx_id_rec *) malloc(sizeof(*ctx))) == NULL)
+	check("malloc", ENOMEM);
+    memset((char *) ctx, 0, sizeof(*ctx));
+    ctx->initiate = initiate;
+    ctx->gss_flags = GSS_C_CONF_FLAG | GSS_C_INTEG_FLAG;
+    ctx->signalg = SGN_ALG_DES_MAC_MD5;
+    ctx->cksum_size = 8;
+    ctx->sealalg = SEAL_ALG_DES;
+    ctx->endtime = 0x7fffffff;
+    ctx->established = 1;
+    ctx->big_endian = bigend;
+    ctx->mech_used = (gss_OID_desc *) gss_mech_krb5;
+
+    check("krb5_copy_keyblock", krb5_copy_keyblock(context, subkey,
+						   &ctx->subkey));
+    check("krb5_copy_keyblock", krb5_copy_keyblock(context, subkey,
+						   &ctx->enc));
+    for (i = 0; i < ctx->enc->length; i++)
+	ctx->enc->contents[i] ^= 0xf0;
+    check("krb5_copy_keyblock", krb5_copy_keyblock(context, subkey,
+						   &ctx->seq));
+    check("g_order_init", g_order_init(&ctx->seqstate, 0, 0, 0));
+
+    if (! kg_save_ctx_id((gss_ctx_id_t) ctx)) {
+	printf("kg_save_ctx_id failed\n");
+	exit(1);
+    }
+    return ctx;
+}
+
+int
+main(argc, argv)
+     int argc;
+     char *argv[];
+{
+    krb5_context context;
+    krb5_keyblock subkey;
+    krb5_gss_ctx_id_rec *ictx, *actx;
+    gss_buffer_desc in, token, out;
+    OM_uint32 major, minor;
+    char msg[32];
+    int bigend, conf, state, qop, len;
+
+    check("krb5_init_context", krb5_init_context(&context));
+    for (len = 0; len < sizeof(msg); len++)
+	msg[len] = 'a' + len % 26;
+
+    for (bigend = 0; bigend <= 1; bigend++) {
+	check("krb5_c_make_random_key",
+	      krb5_c_make_random_key(context, ENCTYPE_DES_CBC_CRC, &subkey));
+	subkey.enctype = ENCTYPE_DES_CBC_RAW;
+	ictx = make_ctx(context, &subkey, 1, bigend);
+	actx = make_ctx(context, &subkey, 0, bigend);
+
+	for (conf = 0; conf <= 1; conf++) {
+	    for (len = 0; len <= 17; len++) {
+		in.value = msg;
+		in.length = len;
+		major = kg_seal(context, &minor, (gss_ctx_id_t) ictx, conf,
+				0, &in, &state, &token, KG_TOK_SEAL_MSG);
+		if (GSS_ERROR(major)) {
+		    printf("kg_seal failed: bigend %d, conf %d, length %d\n",
+			   bigend, conf, len);
+		    exit(1);
+		}
+		major = kg_unseal(context, &minor, (gss_ctx_id_t) actx,
+				  &token, &out, &state, &qop,
+				  KG_TOK_SEAL_MSG);
+		if (GSS_ERROR(major)) {
+		    printf("kg_unseal failed (major %lx): bigend %d, "
+			   "conf %d, length %d\n", (unsigned long) major,
+			   bigend, conf, len);
+		    exit(1);
+		}
+		if (out.length != len || memcmp(out.value, msg, len) ||
+		    state != conf) {
+		    printf("unsealed message differs: bigend %d, conf %d, "
+			   "length %d\n", bigend, conf, len);
+		    exit(1);
+		}
+		xfree(token.value);
+		xfree(out.value);
+	    }
+	}
+	krb5_free_keyblock_contents(context, &subkey);
+	printf("bigend %d: ok\n", bigend);
+    }
+
+    krb5_free_context(context);
+    printf("verify: sealed messages unseal\n");
+    exit(0);
+}
@@ -186,3 +186,68 @@ kg_decrypt(context, key, usage, iv, in, out, length)
        krb5_free_data_contents(context, pivd);
    return code;
 }
+
+/* These work in place on the message buffers, so the caller need not
+   assemble the confounder, message and padding in a separate buffer
+   first. */
+
+static krb5_error_code
+kg_crypt_iov(context, key, usage, iv, data, num_data, encrypt)
+     krb5_context context;
+     krb5_keyblock *key;
+     int usage;
+     krb5_pointer iv;
+     krb5_crypto_iov *data;
+     size_t num_data;
+     int encrypt;
+{
+   krb5_error_code code;
+   size_t blocksize;
+   krb5_data ivd, *pivd;
+
+   if (iv) {
+       if ((code = krb5_c_block_size(context, key->enctype, &blocksize)))
+	   return(code);
+
+       ivd.length = blocksize;
+       ivd.data = malloc(ivd.length);
+       if (ivd.data == NULL)
+	   return ENOMEM;
+       memcpy(ivd.data, iv, ivd.length);
+       pivd = &ivd;
+   } else {
+       pivd = NULL;
+   }
+
+   if (encrypt)
+       code = krb5_c_encrypt_iov(context, key, usage, pivd, data, num_data);
+   else
+       code = krb5_c_decrypt_iov(context, key, usage, pivd, data, num_data);
+   if (pivd != NULL)
+       krb5_free_data_contents(context, pivd);
+   return code;
+}
+
+krb5_error_code
+kg_encrypt_iov(context, key, usage, iv, data, num_data)
+     krb5_context context;
+     krb5_keyblock *key;
+     int usage;
+     krb5_pointer iv;
+     krb5_crypto_iov *data;
+     size_t num_data;
+{
+   return(kg_crypt_iov(context, key, usage, iv, data, num_data, 1));
+}
+
+krb5_error_code
+kg_decrypt_iov(context, key, usage, iv, data, num_data)
+     krb5_context context;
+     krb5_keyblock *key;
+     int usage;
+     krb5_pointer iv;
+     krb5_crypto_iov *data;
+     size_t num_data;
+{
+   return(kg_crypt_iov(context, key, usage, iv, data, num_data, 0));
+}
@@ -810,6 +810,17 @@ krb5_read_realm_params(kcontext, realm, kdcprofile, kdcenv, rparamp)
     if (!krb5_aprof_get_string(aprofile, hierarchy, TRUE, &svalue))
 	rparams->realm_stash_file = svalue;
 	    
+    /* Get the database cache size, page size and hash fill factor */
+    hierarchy[2] = "database_cache_size";
+    if (!krb5_aprof_get_int32(aprofile, hierarchy, TRUE, &ivalue))
+	rparams->realm_db_cachesize = ivalue;
+    hierarchy[2] = "database_page_size";
+    if (!krb5_aprof_get_int32(aprofile, hierarchy, TRUE, &ivalue))
+	rparams->realm_db_pagesize = ivalue;
+    hierarchy[2] = "database_fill_factor";
+    if (!krb5_aprof_get_int32(aprofile, hierarchy, TRUE, &ivalue))
+	rparams->realm_db_ffactor = ivalue;
+	    
     /* Get the value for maximum ticket lifetime. */
     hierarchy[2] = "max_life";
     if (!krb5_aprof_get_deltat(aprofile, hierarchy, TRUE, &dtvalue)) {
@@ -48,6 +48,7 @@ krb5_error_code     kdb_get_entry(kadm5_server_handle_t handle,
 				  osa_princ_ent_rec *adb);
 krb5_error_code     kdb_free_entry(kadm5_server_handle_t handle,
 				   krb5_db_entry *kdb, osa_princ_ent_rec *adb);
+void		    kdb_log_reset(kadm5_server_handle_t handle);
 krb5_error_code     kdb_put_entry(kadm5_server_handle_t handle,
 				  krb5_db_entry *kdb, osa_princ_ent_rec *adb);
 krb5_error_code     kdb_delete_entry(kadm5_server_handle_t handle,
@@ -299,6 +299,37 @@ kdb_free_entry(kadm5_server_handle_t handle,
     return(0);
 }
 
+/*
+ * The update log of the database, from which slaves are brought up to
+ * date incrementally.  The database library logs principal changes
+ * itself; changes it does not see, such as to policies, reset the log,
+ * which makes the next propagation to each slave a full one.
+ */
+static char *
+kdb_log_name(kadm5_server_handle_t handle)
+{
+    char *logname;
+
+    logname = malloc(strlen(handle->params.dbname) +
+		     strlen(KRB5_DB_LOG_EXT) + 1);
+    if (logname) {
+	strcpy(logname, handle->params.dbname);
+	strcat(logname, KRB5_DB_LOG_EXT);
+    }
+    return logname;
+}
+
+void
+kdb_log_reset(kadm5_server_handle_t handle)
+{
+    char *logname;
+
+    if ((logname = kdb_log_name(handle)) == NULL)
+	return;
+    (void) krb5_db_log_reset(handle->context, logname);
+    free(logname);
+}
+
 /*
  * Function: kdb_put_entry
  *
@@ -315,7 +346,8 @@ kdb_free_entry(kadm5_server_handle_t handle,
  *
  * The last modifier field of the kdb is set to the caller at now.
  * adb is encoded with xdr_osa_princ_ent_ret and stored in kbd as
- * KRB5_TL_KADM_DATA.  kdb is then written to the database.
+ * KRB5_TL_KADM_DATA.  kdb is then written to the database, which
+ * records the change in its update log.
  */
 krb5_error_code
 kdb_put_entry(kadm5_server_handle_t handle,
@@ -139,9 +139,11 @@ kadm5_create_policy_internal(void *server_handle,
 	pent.policy_refcnt = 0;
     else
 	pent.policy_refcnt = entry->policy_refcnt;
-    if ((ret = osa_adb_create_policy(handle->policy_db, &pent)) == OSA_ADB_OK)
+    if ((ret = osa_adb_create_policy(handle->policy_db, &pent)) == OSA_ADB_OK) {
+	/* Policies are not in the update log; slaves must resync. */
+	kdb_log_reset(handle);
 	return KADM5_OK;
-    else
+    } else
 	return ret;
 }
 	  
@@ -165,9 +167,10 @@ kadm5_delete_policy(void *server_handle, kadm5_policy_t name)
 	return KADM5_POLICY_REF;
     }
     osa_free_policy_ent(entry);
-    if ((ret = osa_adb_destroy_policy(handle->policy_db, name)) == OSA_ADB_OK)
+    if ((ret = osa_adb_destroy_policy(handle->policy_db, name)) == OSA_ADB_OK) {
+	kdb_log_reset(handle);
 	return KADM5_OK;
-    else
+    } else
 	return ret;
 }
 
@@ -175,12 +178,16 @@ kadm5_ret_t
 kadm5_modify_policy(void *server_handle,
 			 kadm5_policy_ent_t entry, long mask)
 {
+    kadm5_ret_t ret;
+
     CHECK_HANDLE(server_handle);
 
     if (mask & KADM5_REF_COUNT)
 	return KADM5_BAD_MASK;
-    else
-	return kadm5_modify_policy_internal(server_handle, entry, mask);
+    ret = kadm5_modify_policy_internal(server_handle, entry, mask);
+    if (ret == KADM5_OK)
+	kdb_log_reset((kadm5_server_handle_t) server_handle);
+    return ret;
 }
 
 kadm5_ret_t
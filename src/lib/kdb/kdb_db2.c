@@ -77,6 +77,12 @@ static krb5_error_code krb5_db2_db_end_update
 	PROTOTYPE((krb5_context));
 static krb5_error_code krb5_db2_db_set_hashfirst
 	PROTOTYPE((krb5_context, int));
+static krb5_error_code k5db2_flush_pending
+	PROTOTYPE((krb5_context));
+static void k5db2_free_pending
+	PROTOTYPE((krb5_db2_context *));
+static void k5db2_log_reset
+	PROTOTYPE((krb5_context, char *));
 
 static char default_db_name[] = DEFAULT_KDB_FILE;
 
@@ -126,6 +132,35 @@ static char default_db_name[] = DEFAULT_KDB_FILE;
 
 #define free_dbsuffix(name) free(name)
 
+/*
+ * Bulk loading:
+ *
+ * While a database is being loaded from scratch (kdb5_util load), puts
+ * are encoded and buffered instead of being written one at a time.
+ * Each batch is sorted by key and then written under a single lock with
+ * a bigger mpool cache, so that the btree is filled in key order and
+ * its pages stay in core, and the lock file is touched once per batch
+ * rather than once per record.  Records with the same key are written
+ * in the order they were put, so the last one wins as before.
+ */
+#define KDB2_BULK_CACHESIZE	(4 * 1024 * 1024) /* mpool cache for loads */
+#define KDB2_BULK_BATCH		(16 * 1024 * 1024) /* bytes sorted at once */
+
+#define KDB2_COPY_BUFSIZ	(64 * 1024)	/* for snapshot copies */
+
+struct k5db2_pending_rec {
+    krb5_data	key;
+    krb5_data	contents;
+    int		seq;
+};
+
+struct _krb5_db2_pending {
+    struct k5db2_pending_rec *recs;
+    int		nrecs;
+    int		nalloc;
+    size_t	nbytes;
+};
+
 /*
  * Routines to deal with context.
  */
@@ -145,8 +180,11 @@ k5db2_clear_context(dbctx)
      */
     if (dbctx->db_lf_name)
 	free(dbctx->db_lf_name);
+    if (dbctx->db_log_name)
+	free(dbctx->db_log_name);
     if (dbctx->db_name && (dbctx->db_name != default_db_name))
 	free(dbctx->db_name);
+    k5db2_free_pending(dbctx);
     /*
      * Clear the structure and reset the defaults.
      */
@@ -208,20 +246,23 @@ k5db2_dbopen(dbc, fname, flags, mode)
     HASHINFO hashi;
 
     bti.flags = 0;
-    bti.cachesize = 0;
-    bti.psize = 4096;
+    bti.cachesize = dbc->db_cachesize;
+    bti.psize = dbc->db_psize ? dbc->db_psize : 4096;
     bti.lorder = 0;
     bti.minkeypage = 0;
     bti.compare = NULL;
     bti.prefix = NULL;
 
-    hashi.bsize = 4096;
-    hashi.cachesize = 0;
-    hashi.ffactor = 40;
+    hashi.bsize = dbc->db_psize ? dbc->db_psize : 4096;
+    hashi.cachesize = dbc->db_cachesize;
+    hashi.ffactor = dbc->db_ffactor ? dbc->db_ffactor : 40;
     hashi.hash = NULL;
     hashi.lorder = 0;
     hashi.nelem = 1;
 
+    if (dbc->db_bulk && dbc->db_cachesize < KDB2_BULK_CACHESIZE)
+	bti.cachesize = hashi.cachesize = KDB2_BULK_CACHESIZE;
+
     db = dbopen(fname, flags, mode,
 		dbc->hashfirst ? DB_HASH : DB_BTREE,
 		dbc->hashfirst ? (void *) &hashi : (void *) &bti);
@@ -242,6 +283,28 @@ k5db2_dbopen(dbc, fname, flags, mode)
     }
 }
 
+/*
+ * Close the database handle, adding its cache statistics to the
+ * totals for the context.
+ */
+static void
+k5db2_close_db(dbc)
+    krb5_db2_context *dbc;
+{
+    DB_MPOOL_STAT st;
+
+    if (dbc->db == NULL)
+	return;
+    memset((char *) &st, 0, sizeof(st));
+    if (dbmpoolstat(dbc->db, &st) == 0) {
+	dbc->db_stats.hits += st.hits;
+	dbc->db_stats.misses += st.misses;
+	dbc->db_stats.evictions += st.evictions;
+    }
+    (*dbc->db->close)(dbc->db);
+    dbc->db = NULL;
+}
+
 static krb5_error_code
 krb5_db2_db_set_hashfirst(context, hashfirst)
     krb5_context context;
@@ -281,6 +344,11 @@ krb5_db2_db_init(context)
     if (!(filename = gen_dbsuffix(db_ctx->db_name, KDB2_LOCK_EXT)))
 	return ENOMEM;
     db_ctx->db_lf_name = filename; /* so it gets freed by clear_context */
+    if (!(db_ctx->db_log_name = gen_dbsuffix(db_ctx->db_name,
+					     KRB5_DB_LOG_EXT))) {
+	retval = ENOMEM;
+	goto err_out;
+    }
 
     /*
      * should be opened read/write so that write locking can work with
@@ -319,10 +387,11 @@ krb5_db2_db_fini(context)
     db_ctx = (krb5_db2_context *) context->db_context;
 
     if (k5db2_inited(context)) {
-	if (close(db_ctx->db_lf_file))
+	retval = k5db2_flush_pending(context);
+	if (!db_ctx->db_locks_held)
+	    k5db2_close_db(db_ctx);
+	if (close(db_ctx->db_lf_file) && !retval)
 	    retval = errno;
-	else
-	    retval = 0;
     }
     if (db_ctx) {
 	k5db2_clear_context(db_ctx);
@@ -543,6 +612,19 @@ krb5_db2_db_lock(context, mode)
     if ((retval = krb5_db2_db_get_age(context, NULL, &mod_time)))
 	goto lock_error;
 
+    if (db_ctx->db && !db_ctx->db_locks_held) {
+	/*
+	 * The handle was kept open after the last shared lock; it may
+	 * be used again, with its cache, if nothing has been changed.
+	 */
+	if (mode == KRB5_LOCKMODE_SHARED && mod_time == db_ctx->db_lf_time) {
+	    db_ctx->db_lock_mode = mode;
+	    db_ctx->db_locks_held++;
+	    return 0;
+	}
+	k5db2_close_db(db_ctx);
+    }
+
     db = k5db2_dbopen(db_ctx, db_ctx->db_name,
 		mode == KRB5_LOCKMODE_SHARED ? O_RDONLY : O_RDWR,
 		0600);
@@ -571,8 +653,7 @@ krb5_db2_db_unlock(context)
     krb5_context context;
 {
     krb5_db2_context *db_ctx;
-    DB *db;
-    krb5_error_code retval;
+    krb5_error_code retval, flushret = 0;
 
     if (!k5db2_inited(context))
 	return KRB5_KDB_DBNOTINITED;
@@ -580,15 +661,239 @@ krb5_db2_db_unlock(context)
     db_ctx = (krb5_db2_context *) context->db_context;
     if (!db_ctx->db_locks_held)		/* lock already unlocked */
 	return KRB5_KDB_NOTLOCKED;
-    db = db_ctx->db;
+    /* Write out buffered puts before giving up the last lock. */
+    if (db_ctx->db_locks_held == 1)
+	flushret = k5db2_flush_pending(context);
     if (--(db_ctx->db_locks_held) == 0) {
-	(*db->close)(db);
-	db_ctx->db = NULL;
+	/*
+	 * With a cache size set, keep a read-only handle open so that
+	 * its cache lasts from one lookup to the next.
+	 */
+	if (db_ctx->db_lock_mode != KRB5_LOCKMODE_SHARED ||
+	    !db_ctx->db_cachesize)
+	    k5db2_close_db(db_ctx);
 
     	retval = krb5_lock_file(context, db_ctx->db_lf_file,
 				KRB5_LOCKMODE_UNLOCK);
 	db_ctx->db_lock_mode = 0;
-	return(retval);
+	return(flushret ? flushret : retval);
+    }
+    return 0;
+}
+
+static void
+k5db2_free_pending(dbctx)
+    krb5_db2_context *dbctx;
+{
+    struct _krb5_db2_pending *pend;
+    int i;
+
+    if ((pend = dbctx->db_pending) == NULL)
+	return;
+    for (i = 0; i < pend->nrecs; i++) {
+	krb5_xfree(pend->recs[i].key.data);
+	krb5_xfree(pend->recs[i].contents.data);
+    }
+    if (pend->recs)
+	free(pend->recs);
+    free(pend);
+    dbctx->db_pending = NULL;
+}
+
+/* Order buffered records as the btree does, oldest first within a key. */
+static int
+k5db2_pending_cmp(a, b)
+    const void *a;
+    const void *b;
+{
+    const struct k5db2_pending_rec *ra = a, *rb = b;
+    size_t len;
+    int cmp;
+
+    len = ra->key.length < rb->key.length ? ra->key.length : rb->key.length;
+    if ((cmp = memcmp(ra->key.data, rb->key.data, len)))
+	return cmp;
+    if (ra->key.length != rb->key.length)
+	return ra->key.length < rb->key.length ? -1 : 1;
+    return ra->seq - rb->seq;
+}
+
+/*
+ * Sort the buffered puts by key and write them to the database under
+ * one exclusive lock.  The buffer is emptied whether or not the writes
+ * succeed.
+ */
+static krb5_error_code
+k5db2_flush_pending(context)
+    krb5_context context;
+{
+    krb5_db2_context *db_ctx;
+    struct _krb5_db2_pending *pend;
+    krb5_error_code retval;
+    DB *db;
+    DBT key, contents;
+    int i;
+
+    db_ctx = (krb5_db2_context *) context->db_context;
+    if ((pend = db_ctx->db_pending) == NULL || pend->nrecs == 0)
+	return 0;
+    /* Keep the unlock below from flushing again. */
+    db_ctx->db_pending = NULL;
+
+    if ((retval = krb5_db2_db_lock(context, KRB5_LOCKMODE_EXCLUSIVE)))
+	goto cleanup;
+
+    qsort(pend->recs, pend->nrecs, sizeof(struct k5db2_pending_rec),
+	  k5db2_pending_cmp);
+    db = db_ctx->db;
+    for (i = 0; i < pend->nrecs; i++) {
+	key.data = pend->recs[i].key.data;
+	key.size = pend->recs[i].key.length;
+	contents.data = pend->recs[i].contents.data;
+	contents.size = pend->recs[i].contents.length;
+	if ((*db->put)(db, &key, &contents, 0)) {
+	    retval = errno;
+	    break;
+	}
+    }
+
+    (void) krb5_db2_db_end_update(context);
+    (void) krb5_db2_db_unlock(context);
+
+cleanup:
+    db_ctx->db_pending = pend;
+    k5db2_free_pending(db_ctx);
+    return retval;
+}
+
+/*
+ * Buffer an encoded record for k5db2_flush_pending, which takes over
+ * key and contents whether or not this succeeds.
+ */
+static krb5_error_code
+k5db2_add_pending(context, key, contents)
+    krb5_context context;
+    krb5_data *key;
+    krb5_data *contents;
+{
+    krb5_db2_context *db_ctx;
+    struct _krb5_db2_pending *pend;
+    struct k5db2_pending_rec *recs;
+    int nalloc;
+
+    db_ctx = (krb5_db2_context *) context->db_context;
+    if ((pend = db_ctx->db_pending) == NULL) {
+	pend = (struct _krb5_db2_pending *) malloc(sizeof(*pend));
+	if (pend == NULL)
+	    goto nomem;
+	memset((char *) pend, 0, sizeof(*pend));
+	db_ctx->db_pending = pend;
+    }
+    if (pend->nrecs == pend->nalloc) {
+	nalloc = pend->nalloc ? 2 * pend->nalloc : 1024;
+	recs = (struct k5db2_pending_rec *)
+	    realloc(pend->recs, nalloc * sizeof(struct k5db2_pending_rec));
+	if (recs == NULL)
+	    goto nomem;
+	pend->recs = recs;
+	pend->nalloc = nalloc;
+    }
+    pend->recs[pend->nrecs].key = *key;
+    pend->recs[pend->nrecs].contents = *contents;
+    pend->recs[pend->nrecs].seq = pend->nrecs;
+    pend->nrecs++;
+    pend->nbytes += key->length + contents->length;
+
+    if (pend->nbytes >= KDB2_BULK_BATCH)
+	return k5db2_flush_pending(context);
+    return 0;
+
+nomem:
+    krb5_free_data_contents(context, key);
+    krb5_free_data_contents(context, contents);
+    return ENOMEM;
+}
+
+/*
+ * Turn buffering of puts for a bulk load on or off.  The larger mpool
+ * cache takes effect the next time the database is opened, so this
+ * should be called before the database is locked.  Turning it off
+ * writes out anything still buffered.
+ */
+krb5_error_code
+krb5_db2_db_set_bulk_load(context, bulk)
+    krb5_context context;
+    krb5_boolean bulk;
+{
+    krb5_db2_context *db_ctx;
+    krb5_error_code retval = 0;
+
+    if (!k5db2_inited(context))
+	return KRB5_KDB_DBNOTINITED;
+
+    db_ctx = (krb5_db2_context *) context->db_context;
+    if (!bulk)
+	retval = k5db2_flush_pending(context);
+    db_ctx->db_bulk = bulk;
+    return retval;
+}
+
+/*
+ * Set the mpool cache size in bytes, and the page size and hash fill
+ * factor used when a database is created; zero leaves the default.
+ * They take effect the next time the database is opened.  A cache
+ * size also keeps the database open between shared locks, as long as
+ * it is not changed, so that the cache is not thrown away after each
+ * lookup.
+ */
+krb5_error_code
+krb5_db2_db_set_cache_params(context, cachesize, pagesize, ffactor)
+    krb5_context context;
+    krb5_int32 cachesize;
+    krb5_int32 pagesize;
+    krb5_int32 ffactor;
+{
+    krb5_db2_context *db_ctx;
+    krb5_error_code retval;
+
+    if (cachesize < 0 || ffactor < 0 ||
+	(pagesize && (pagesize < 512 || pagesize > 65536 ||
+		      (pagesize & (pagesize - 1)))))
+	return EINVAL;
+
+    if ((retval = k5db2_init_context(context)))
+	return retval;
+    db_ctx = (krb5_db2_context *) context->db_context;
+    db_ctx->db_cachesize = cachesize;
+    db_ctx->db_psize = pagesize;
+    db_ctx->db_ffactor = ffactor;
+    return 0;
+}
+
+/*
+ * Return the mpool cache statistics for every handle this context has
+ * opened on the database, together with the size of the cache of the
+ * one open now, if any.
+ */
+krb5_error_code
+krb5_db2_db_get_cache_stats(context, stats)
+    krb5_context context;
+    krb5_db_cache_stats *stats;
+{
+    krb5_db2_context *db_ctx;
+    DB_MPOOL_STAT st;
+
+    if (!k5db2_inited(context))
+	return KRB5_KDB_DBNOTINITED;
+
+    db_ctx = (krb5_db2_context *) context->db_context;
+    *stats = db_ctx->db_stats;
+    if (db_ctx->db && dbmpoolstat(db_ctx->db, &st) == 0) {
+	stats->hits += st.hits;
+	stats->misses += st.misses;
+	stats->evictions += st.evictions;
+	stats->cached = st.curcache;
+	stats->maxcache = st.maxcache;
     }
     return 0;
 }
@@ -852,6 +1157,12 @@ krb5_db2_db_rename(context, from, to)
 	retval = errno;
 	goto errfromok;
     }
+    /* The update log of the old database does not describe the new. */
+    if ((db_ctx->db_log_name = gen_dbsuffix(to, KRB5_DB_LOG_EXT)) == NULL) {
+	retval = ENOMEM;
+	goto errfromok;
+    }
+    k5db2_log_reset(context, db_ctx->db_log_name);
     retval = krb5_db2_db_end_update(context);
 errfromok:
     free_dbsuffix(fromok);
@@ -899,6 +1210,8 @@ krb5_db2_db_get_principal(context, searchfor, entries, nentries, more)
 	return KRB5_KDB_DBNOTINITED;
 
     db_ctx = (krb5_db2_context *) context->db_context;
+    if ((retval = k5db2_flush_pending(context)))
+	return retval;
     for (try = 0; try < KRB5_DB2_MAX_RETRY; try++) {
 	if ((retval = krb5_db2_db_lock(context, KRB5_LOCKMODE_SHARED))) {
 	    if (db_ctx->db_nb_locks) 
@@ -958,6 +1271,43 @@ krb5_db2_db_free_principal(context, entries, nentries)
     return;
 }
 
+/*
+ * Start a new generation of the update log logname, or failing that
+ * remove it, so that the next propagation to each slave is a full one.
+ */
+static void
+k5db2_log_reset(context, logname)
+    krb5_context context;
+    char *logname;
+{
+    if (krb5_db_log_reset(context, logname))
+	(void) unlink(logname);
+}
+
+/*
+ * Record a change in the update log, while the database is still
+ * locked for writing so that the two change together.  If the change
+ * cannot be logged the log is reset.
+ */
+static void
+k5db2_log_change(context, entry, princ)
+    krb5_context context;
+    krb5_db_entry *entry;
+    krb5_const_principal princ;
+{
+    krb5_db2_context *db_ctx = (krb5_db2_context *) context->db_context;
+    krb5_error_code retval;
+
+    if (db_ctx->db_log_name == NULL)
+	return;
+    if (entry)
+	retval = krb5_db_log_put(context, db_ctx->db_log_name, entry);
+    else
+	retval = krb5_db_log_delete(context, db_ctx->db_log_name, princ);
+    if (retval)
+	k5db2_log_reset(context, db_ctx->db_log_name);
+}
+
 /*
   Stores the *"nentries" entry structures pointed to by "entries" in the
   database.
@@ -987,6 +1337,27 @@ krb5_db2_db_put_principal(context, entries, nentries)
 	return KRB5_KDB_DBNOTINITED;
 
     db_ctx = (krb5_db2_context *) context->db_context;
+    /* A bulk load fills a new database, whose log is reset when it is
+       put in place, so its entries are not logged. */
+    if (db_ctx->db_bulk) {
+	retval = 0;
+	for (i = 0; i < n; i++) {
+	    retval = krb5_encode_princ_contents(context, &contdata, entries);
+	    if (retval)
+		break;
+	    retval = krb5_encode_princ_dbkey(context, &keydata, entries->princ);
+	    if (retval) {
+		krb5_free_data_contents(context, &contdata);
+		break;
+	    }
+	    if ((retval = k5db2_add_pending(context, &keydata, &contdata)))
+		break;
+	    entries++;
+	}
+	*nentries = i;
+	return(retval);
+    }
+
     if ((retval = krb5_db2_db_lock(context, KRB5_LOCKMODE_EXCLUSIVE)))
 	return retval;
 
@@ -1017,6 +1388,7 @@ krb5_db2_db_put_principal(context, entries, nentries)
 	krb5_free_data_contents(context, &contdata);
 	if (retval)
 	    break;
+	k5db2_log_change(context, entries, NULL);
 	entries++;			/* bump to next struct */
     }
 
@@ -1049,6 +1421,8 @@ krb5_db2_db_delete_principal(context, searchfor, nentries)
 	return KRB5_KDB_DBNOTINITED;
 
     db_ctx = (krb5_db2_context *) context->db_context;
+    if ((retval = k5db2_flush_pending(context)))
+	return retval;
     if ((retval = krb5_db2_db_lock(context, KRB5_LOCKMODE_EXCLUSIVE)))
 	return(retval);
 
@@ -1105,6 +1479,8 @@ krb5_db2_db_delete_principal(context, searchfor, nentries)
 	goto cleankey;
     dbret = (*db->del)(db, &key, 0);
     retval = dbret ? errno : 0;
+    if (retval == 0)
+	k5db2_log_change(context, NULL, searchfor);
 cleankey:
     krb5_free_data_contents(context, &keydata);
 
@@ -1132,6 +1508,8 @@ krb5_db2_db_iterate (context, func, func_arg)
 	return KRB5_KDB_DBNOTINITED;
 
     db_ctx = (krb5_db2_context *) context->db_context;
+    if ((retval = k5db2_flush_pending(context)))
+	return retval;
     retval = krb5_db2_db_lock(context, KRB5_LOCKMODE_SHARED);
     if (retval)
 	return retval;
@@ -1162,6 +1540,128 @@ krb5_db2_db_iterate (context, func, func_arg)
     return retval;
 }
 
+/*
+ * Copy the file from to a new file to, for a snapshot of the database.
+ */
+static krb5_error_code
+k5db2_copy_file(from, to)
+    char *from;
+    char *to;
+{
+    char *buf;
+    int in, out, n;
+    krb5_error_code retval = 0;
+
+    if ((buf = malloc(KDB2_COPY_BUFSIZ)) == NULL)
+	return ENOMEM;
+    if ((in = open(from, O_RDONLY, 0)) < 0) {
+	retval = errno;
+	free(buf);
+	return retval;
+    }
+    if ((out = open(to, O_WRONLY | O_CREAT | O_EXCL, 0600)) < 0) {
+	retval = errno;
+	close(in);
+	free(buf);
+	return retval;
+    }
+    while ((n = read(in, buf, KDB2_COPY_BUFSIZ)) > 0) {
+	if (write(out, buf, n) != n) {
+	    retval = errno ? errno : ENOSPC;
+	    break;
+	}
+    }
+    if (n < 0)
+	retval = errno;
+    if (close(out) < 0 && !retval)
+	retval = errno;
+    close(in);
+    free(buf);
+    if (retval)
+	(void) unlink(to);
+    return retval;
+}
+
+/*
+ * Like krb5_db2_db_iterate, but the database is only locked while a
+ * copy of its file is taken; the entries are then read from the copy,
+ * so that a slow func does not hold up changes to the database.
+ */
+krb5_error_code
+krb5_db2_db_iterate_snapshot(context, func, func_arg)
+    krb5_context context;
+    krb5_error_code (*func) PROTOTYPE((krb5_pointer, krb5_db_entry *));
+    krb5_pointer func_arg;
+{
+    krb5_db2_context *db_ctx;
+    DB *db;
+    DBT key, contents;
+    krb5_data contdata;
+    krb5_db_entry entries;
+    krb5_error_code retval;
+    char *snapname;
+    int dbret;
+
+    if (!k5db2_inited(context))
+	return KRB5_KDB_DBNOTINITED;
+
+    db_ctx = (krb5_db2_context *) context->db_context;
+    if ((retval = k5db2_flush_pending(context)))
+	return retval;
+
+    snapname = malloc(strlen(db_ctx->db_name) + 30);
+    if (snapname == NULL)
+	return ENOMEM;
+    sprintf(snapname, "%s~snap%ld", db_ctx->db_name, (long) getpid());
+
+    /* Any snapshot by this name was left by an earlier process with
+       our process ID which died before removing it. */
+    (void) unlink(snapname);
+
+    if ((retval = krb5_db2_db_lock(context, KRB5_LOCKMODE_SHARED))) {
+	free(snapname);
+	return retval;
+    }
+    retval = k5db2_copy_file(db_ctx->db_name, snapname);
+    (void) krb5_db2_db_unlock(context);
+    if (retval) {
+	free(snapname);
+	return retval;
+    }
+
+    db = k5db2_dbopen(db_ctx, snapname, O_RDONLY, 0600);
+    if (db == NULL)
+	retval = errno;
+    (void) unlink(snapname);
+    free(snapname);
+    if (db == NULL)
+	return retval;
+
+    dbret = (*db->seq)(db, &key, &contents, R_FIRST);
+    while (dbret == 0) {
+	contdata.data = contents.data;
+	contdata.length = contents.size;
+	retval = krb5_decode_princ_contents(context, &contdata, &entries);
+	if (retval)
+	    break;
+	retval = (*func)(func_arg, &entries);
+	krb5_dbe_free_contents(context, &entries);
+	if (retval)
+	    break;
+	dbret = (*db->seq)(db, &key, &contents, R_NEXT);
+    }
+    switch (dbret) {
+    case 1:
+    case 0:
+	break;
+    case -1:
+    default:
+	retval = errno;
+    }
+    (*db->close)(db);
+    return retval;
+}
+
 krb5_boolean
 krb5_db2_db_set_lockmode(context, mode)
     krb5_context context;
@@ -42,9 +42,13 @@
 #define krb5_db2_db_put_principal	krb5_db_put_principal
 #define krb5_db2_db_delete_principal	krb5_db_delete_principal
 #define krb5_db2_db_iterate		krb5_db_iterate
+#define krb5_db2_db_iterate_snapshot	krb5_db_iterate_snapshot
 #define krb5_db2_db_lock		krb5_db_lock
 #define krb5_db2_db_unlock		krb5_db_unlock
 #define krb5_db2_db_set_lockmode	krb5_db_set_lockmode
+#define krb5_db2_db_set_bulk_load	krb5_db_set_bulk_load
+#define krb5_db2_db_set_cache_params	krb5_db_set_cache_params
+#define krb5_db2_db_get_cache_stats	krb5_db_get_cache_stats
 #define krb5_db2_db_close_database	krb5_db_close_database
 #define krb5_db2_db_open_database	krb5_db_open_database
 #define krb5_db2_db_set_mkey		krb5_db_set_mkey
@@ -56,12 +60,19 @@ typedef struct _krb5_db2_context {
     DB *		db;		/* DB handle			*/
     krb5_boolean	hashfirst;	/* Try hash database type first	*/
     char *              db_lf_name;     /* Name of lock file            */
+    char *              db_log_name;    /* Name of update log           */
     int                 db_lf_file;     /* File descriptor of lock file */
     time_t              db_lf_time;     /* Time last updated            */
     int                 db_locks_held;  /* Number of times locked       */
     int                 db_lock_mode;   /* Last lock mode, e.g. greatest*/
     krb5_boolean        db_nb_locks;    /* [Non]Blocking lock modes     */
     krb5_keyblock      *db_master_key;  /* Master key of database       */
+    krb5_boolean        db_bulk;        /* Buffer puts for a bulk load  */
+    struct _krb5_db2_pending *db_pending; /* Puts not yet written     */
+    krb5_int32          db_cachesize;   /* mpool cache size, or 0       */
+    krb5_int32          db_psize;       /* Page size for new databases  */
+    krb5_int32          db_ffactor;     /* Fill factor for new hash dbs */
+    krb5_db_cache_stats db_stats;       /* Stats of closed handles      */
 } krb5_db2_context;
 
 #define KRB5_DB2_MAX_RETRY 5
@@ -109,6 +120,11 @@ krb5_error_code krb5_db2_db_iterate
 		   krb5_error_code (*) KRB5_PROTOTYPE((krb5_pointer,
 					          krb5_db_entry *)),
 	           krb5_pointer ));
+krb5_error_code krb5_db2_db_iterate_snapshot
+    	KRB5_PROTOTYPE((krb5_context,
+		   krb5_error_code (*) KRB5_PROTOTYPE((krb5_pointer,
+					          krb5_db_entry *)),
+	           krb5_pointer ));
 krb5_error_code krb5_db2_db_set_nonblocking 
 	KRB5_PROTOTYPE((krb5_context,
 		   krb5_boolean,
@@ -116,6 +132,17 @@ krb5_error_code krb5_db2_db_set_nonblocking
 krb5_boolean krb5_db2_db_set_lockmode
 	KRB5_PROTOTYPE((krb5_context,
 		   krb5_boolean ));
+krb5_error_code krb5_db2_db_set_bulk_load
+	KRB5_PROTOTYPE((krb5_context,
+		   krb5_boolean ));
+krb5_error_code krb5_db2_db_set_cache_params
+	KRB5_PROTOTYPE((krb5_context,
+		   krb5_int32,
+		   krb5_int32,
+		   krb5_int32 ));
+krb5_error_code krb5_db2_db_get_cache_stats
+	KRB5_PROTOTYPE((krb5_context,
+		   krb5_db_cache_stats * ));
 krb5_error_code krb5_db2_db_open_database 
 	KRB5_PROTOTYPE((krb5_context));
 krb5_error_code krb5_db2_db_close_database 
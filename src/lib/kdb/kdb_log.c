@@ -0,0 +1,530 @@
+/*
+ * lib/kdb/kdb_log.c
+ *
+ * Copyright 2001 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ *
+ * The update log of a database, used for incremental propagation.
+ *
+ * The log is a text file next to the database.  Its first line is
+ *
+ *	KRB5_DB_LOG_HEADER <generation> <first serial> <last serial>
+ *
+ * with fixed-width numbers so that it can be rewritten in place, and
+ * each following line is one change:
+ *
+ *	<serial> put <hex of the encoded entry>
+ *	<serial> delete <hex of the principal's database key>
+ *
+ * separated by tabs.  Serials are consecutive.  The header is updated
+ * before the record is appended, so a record lost in a crash shows up
+ * as a gap rather than as a serial used twice.  The generation changes
+ * whenever the log is reset, i.e. whenever the database changed in a
+ * way the log does not describe, so that a position (generation,
+ * serial) names one database state.
+ *
+ * A set of changes to send to a slave has the same format, so it can
+ * be loaded with "kdb5_util load -update".
+ *
+ * The database library appends to the log as each principal is put or
+ * deleted, with the database locked.  Nothing is logged for a database
+ * with no log; krb5_db_log_reset() starts one, as kdb5_util create and
+ * load do and as renaming a database over another does.
+ */
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "k5-int.h"
+#include <stdio.h>
+#include <errno.h>
+
+/* Once this many records are kept, the older half is thrown away. */
+#define KDB_LOG_MAX		2000
+
+#define KDB_LOG_PUT		"put"
+#define KDB_LOG_DELETE		"delete"
+
+typedef struct _kdb_log_header {
+    krb5_ui_4	generation;
+    krb5_ui_4	first;
+    krb5_ui_4	last;
+} kdb_log_header;
+
+static const char hexdigits[] = "0123456789abcdef";
+
+/*
+ * Read a line of any length into *bufp, which is grown as needed.
+ * Returns 0 at end of file.
+ */
+static int
+log_getline(fp, bufp, sizep)
+    FILE *fp;
+    char **bufp;
+    size_t *sizep;
+{
+    size_t len = 0;
+    char *nbuf;
+
+    for (;;) {
+	if (*sizep - len < 2) {
+	    nbuf = realloc(*bufp, *sizep ? 2 * *sizep : 1024);
+	    if (nbuf == NULL)
+		return 0;
+	    *bufp = nbuf;
+	    *sizep = *sizep ? 2 * *sizep : 1024;
+	}
+	if (fgets(*bufp + len, *sizep - len, fp) == NULL)
+	    return len != 0;
+	len += strlen(*bufp + len);
+	if (len && (*bufp)[len - 1] == '\n')
+	    return 1;
+    }
+}
+
+static krb5_error_code
+log_read_header(fp, hdr)
+    FILE *fp;
+    kdb_log_header *hdr;
+{
+    char buf[128];
+    unsigned long gen, first, last;
+    size_t hlen = strlen(KRB5_DB_LOG_HEADER);
+
+    if (fgets(buf, sizeof(buf), fp) == NULL)
+	return ferror(fp) ? errno : KRB5_KDB_DB_CORRUPT;
+    if (strncmp(buf, KRB5_DB_LOG_HEADER, hlen) ||
+	sscanf(buf + hlen, "%lu\t%lu\t%lu", &gen, &first, &last) != 3 ||
+	last + 1 < first)
+	return KRB5_KDB_DB_CORRUPT;
+    hdr->generation = gen;
+    hdr->first = first;
+    hdr->last = last;
+    return 0;
+}
+
+static krb5_error_code
+log_write_header(fp, hdr)
+    FILE *fp;
+    kdb_log_header *hdr;
+{
+    if (fseek(fp, 0L, SEEK_SET) ||
+	fprintf(fp, "%s%10lu\t%10lu\t%10lu\n", KRB5_DB_LOG_HEADER,
+		(unsigned long) hdr->generation, (unsigned long) hdr->first,
+		(unsigned long) hdr->last) < 0 ||
+	fflush(fp))
+	return errno;
+    return 0;
+}
+
+/* Start a new, empty generation of the log. */
+static krb5_error_code
+log_new(fp, hdr)
+    FILE *fp;
+    kdb_log_header *hdr;
+{
+    krb5_ui_4 now = (krb5_ui_4) time((time_t *) NULL);
+
+    hdr->generation = (now > hdr->generation) ? now : hdr->generation + 1;
+    hdr->first = 1;
+    hdr->last = 0;
+    if (fflush(fp) || ftruncate(fileno(fp), 0))
+	return errno;
+    return log_write_header(fp, hdr);
+}
+
+/* The serial number at the start of a record line. */
+static krb5_ui_4
+log_serial(line)
+    char *line;
+{
+    return (krb5_ui_4) strtoul(line, NULL, 10);
+}
+
+/*
+ * Throw away all but the newest KDB_LOG_MAX / 2 records.  The log is
+ * rewritten in place since others lock the file itself.
+ */
+static krb5_error_code
+log_trim(fp, hdr)
+    FILE *fp;
+    kdb_log_header *hdr;
+{
+    krb5_error_code retval = 0;
+    krb5_ui_4 first = hdr->last - KDB_LOG_MAX / 2 + 1;
+    char *line = NULL, *keep = NULL, *nkeep;
+    size_t size = 0, klen = 0, len;
+
+    while (log_getline(fp, &line, &size)) {
+	if (log_serial(line) < first)
+	    continue;
+	len = strlen(line);
+	if ((nkeep = realloc(keep, klen + len + 1)) == NULL) {
+	    retval = ENOMEM;
+	    goto cleanup;
+	}
+	keep = nkeep;
+	memcpy(keep + klen, line, len + 1);
+	klen += len;
+    }
+
+    hdr->first = first;
+    if (fflush(fp) || ftruncate(fileno(fp), 0) ||
+	(retval = log_write_header(fp, hdr)))
+	goto cleanup;
+    if ((klen && fwrite(keep, klen, 1, fp) != 1) || fflush(fp))
+	retval = errno;
+
+cleanup:
+    if (line)
+	free(line);
+    if (keep)
+	free(keep);
+    return retval;
+}
+
+/*
+ * Open logname and lock it in mode, returning a stdio stream on it.
+ * If create is set the log is created when it does not exist.
+ */
+static krb5_error_code
+log_open(context, logname, mode, create, fpp)
+    krb5_context context;
+    char *logname;
+    int mode;
+    int create;
+    FILE **fpp;
+{
+    krb5_error_code retval;
+    int fd;
+
+    if (mode == KRB5_LOCKMODE_SHARED)
+	fd = open(logname, O_RDONLY, 0);
+    else
+	fd = THREEPARAMOPEN(logname, O_RDWR | (create ? O_CREAT : 0), 0600);
+    if (fd < 0)
+	return errno;
+    if ((retval = krb5_lock_file(context, fd, mode))) {
+	close(fd);
+	return retval;
+    }
+    if ((*fpp = fdopen(fd, mode == KRB5_LOCKMODE_SHARED ? "r" : "r+"))
+	== NULL) {
+	retval = errno;
+	(void) krb5_lock_file(context, fd, KRB5_LOCKMODE_UNLOCK);
+	close(fd);
+	return retval;
+    }
+    return 0;
+}
+
+static void
+log_close(context, fp)
+    krb5_context context;
+    FILE *fp;
+{
+    (void) fflush(fp);
+    (void) krb5_lock_file(context, fileno(fp), KRB5_LOCKMODE_UNLOCK);
+    (void) fclose(fp);
+}
+
+static krb5_error_code
+log_append(context, logname, op, data)
+    krb5_context context;
+    char *logname;
+    char *op;
+    krb5_data *data;
+{
+    krb5_error_code retval;
+    kdb_log_header hdr;
+    FILE *fp;
+    char *cp, *ep;
+
+    /* Changes are only logged once the log has been started. */
+    retval = log_open(context, logname, KRB5_LOCKMODE_EXCLUSIVE, 0, &fp);
+    if (retval)
+	return (retval == ENOENT) ? 0 : retval;
+
+    /* A damaged log starts over; slaves will resync in full. */
+    memset((char *) &hdr, 0, sizeof(hdr));
+    if (log_read_header(fp, &hdr) && (retval = log_new(fp, &hdr)))
+	goto cleanup;
+    if (hdr.last - hdr.first + 1 >= KDB_LOG_MAX &&
+	(retval = log_trim(fp, &hdr)))
+	goto cleanup;
+
+    hdr.last++;
+    if ((retval = log_write_header(fp, &hdr)) ||
+	fseek(fp, 0L, SEEK_END) < 0) {
+	retval = retval ? retval : errno;
+	goto cleanup;
+    }
+    fprintf(fp, "%lu\t%s\t", (unsigned long) hdr.last, op);
+    for (cp = data->data, ep = cp + data->length; cp < ep; cp++) {
+	putc(hexdigits[(*cp >> 4) & 0xf], fp);
+	putc(hexdigits[*cp & 0xf], fp);
+    }
+    putc('\n', fp);
+    if (fflush(fp))
+	retval = errno;
+
+cleanup:
+    log_close(context, fp);
+    return retval;
+}
+
+/*
+ * Record in logname that entry was stored in the database.
+ */
+krb5_error_code
+krb5_db_log_put(context, logname, entry)
+    krb5_context context;
+    char *logname;
+    krb5_db_entry *entry;
+{
+    krb5_error_code retval;
+    krb5_data contents;
+
+    if ((retval = krb5_encode_princ_contents(context, &contents, entry)))
+	return retval;
+    retval = log_append(context, logname, KDB_LOG_PUT, &contents);
+    krb5_free_data_contents(context, &contents);
+    return retval;
+}
+
+/*
+ * Record in logname that principal was deleted from the database.
+ */
+krb5_error_code
+krb5_db_log_delete(context, logname, principal)
+    krb5_context context;
+    char *logname;
+    krb5_const_principal principal;
+{
+    krb5_error_code retval;
+    krb5_data key;
+
+    if ((retval = krb5_encode_princ_dbkey(context, &key, principal)))
+	return retval;
+    retval = log_append(context, logname, KDB_LOG_DELETE, &key);
+    krb5_free_data_contents(context, &key);
+    return retval;
+}
+
+/*
+ * Start a new, empty generation of logname, creating it if need be,
+ * because the database has been changed in a way that the log does
+ * not record.
+ */
+krb5_error_code
+krb5_db_log_reset(context, logname)
+    krb5_context context;
+    char *logname;
+{
+    krb5_error_code retval;
+    kdb_log_header hdr;
+    FILE *fp;
+
+    retval = log_open(context, logname, KRB5_LOCKMODE_EXCLUSIVE, 1, &fp);
+    if (retval)
+	return retval;
+    memset((char *) &hdr, 0, sizeof(hdr));
+    (void) log_read_header(fp, &hdr);
+    retval = log_new(fp, &hdr);
+    log_close(context, fp);
+    return retval;
+}
+
+/*
+ * Return the generation of logname and the range of serials it holds.
+ * The database is at (*generation, *last).
+ */
+krb5_error_code
+krb5_db_log_position(context, logname, generation, first, last)
+    krb5_context context;
+    char *logname;
+    krb5_ui_4 *generation;
+    krb5_ui_4 *first;
+    krb5_ui_4 *last;
+{
+    krb5_error_code retval;
+    kdb_log_header hdr;
+    FILE *fp;
+
+    retval = log_open(context, logname, KRB5_LOCKMODE_SHARED, 0, &fp);
+    if (retval)
+	return retval;
+    if (!(retval = log_read_header(fp, &hdr))) {
+	*generation = hdr.generation;
+	*first = hdr.first;
+	*last = hdr.last;
+    }
+    log_close(context, fp);
+    return retval;
+}
+
+/*
+ * Write to outfd the changes which bring a database at (generation,
+ * serial) up to date with logname, and set *newserial to the serial
+ * it will then be at.  KRB5_KDB_LOG_GAP is returned if the log does
+ * not hold all of those changes, in which case the database has to be
+ * sent in full.
+ */
+krb5_error_code
+krb5_db_log_copy(context, logname, generation, serial, outfd, newserial)
+    krb5_context context;
+    char *logname;
+    krb5_ui_4 generation;
+    krb5_ui_4 serial;
+    int outfd;
+    krb5_ui_4 *newserial;
+{
+    krb5_error_code retval;
+    kdb_log_header hdr, outhdr;
+    FILE *fp, *out = NULL;
+    char *line = NULL;
+    size_t size = 0;
+    krb5_ui_4 next;
+
+    retval = log_open(context, logname, KRB5_LOCKMODE_SHARED, 0, &fp);
+    if (retval)
+	return retval;
+    if ((retval = log_read_header(fp, &hdr)))
+	goto cleanup;
+    if (hdr.generation != generation || serial + 1 < hdr.first ||
+	serial > hdr.last) {
+	retval = KRB5_KDB_LOG_GAP;
+	goto cleanup;
+    }
+
+    if ((out = fdopen(dup(outfd), "w")) == NULL) {
+	retval = errno;
+	goto cleanup;
+    }
+    outhdr.generation = hdr.generation;
+    outhdr.first = serial + 1;
+    outhdr.last = hdr.last;
+    if ((retval = log_write_header(out, &outhdr)))
+	goto cleanup;
+
+    next = hdr.first;
+    while (next <= hdr.last && log_getline(fp, &line, &size)) {
+	if (log_serial(line) != next)
+	    break;
+	if (next > serial && fputs(line, out) == EOF) {
+	    retval = errno;
+	    goto cleanup;
+	}
+	next++;
+    }
+    if (next <= hdr.last) {
+	retval = KRB5_KDB_LOG_GAP;
+	goto cleanup;
+    }
+    if (fflush(out))
+	retval = errno;
+    else
+	*newserial = hdr.last;
+
+cleanup:
+    if (out)
+	fclose(out);
+    if (line)
+	free(line);
+    log_close(context, fp);
+    return retval;
+}
+
+static int
+log_unhex(c)
+    int c;
+{
+    if (c >= '0' && c <= '9')
+	return c - '0';
+    if (c >= 'a' && c <= 'f')
+	return c - 'a' + 10;
+    return -1;
+}
+
+/*
+ * Apply one record line of an update log to the current database.
+ * Putting an entry and deleting a principal which is already gone are
+ * both harmless, so changes can be applied more than once.
+ */
+krb5_error_code
+krb5_db_log_apply(context, line)
+    krb5_context context;
+    char *line;
+{
+    krb5_error_code retval;
+    krb5_db_entry entry;
+    krb5_principal princ;
+    krb5_data data;
+    char *op, *hex, *ep;
+    int i, hi, lo, n;
+
+    if ((op = strchr(line, '\t')) == NULL ||
+	(hex = strchr(++op, '\t')) == NULL)
+	return KRB5_KDB_DB_CORRUPT;
+    hex++;
+    for (ep = hex; *ep && *ep != '\n'; ep++)
+	;
+    if ((ep - hex) % 2)
+	return KRB5_KDB_DB_CORRUPT;
+
+    data.length = (ep - hex) / 2;
+    if ((data.data = malloc(data.length + 1)) == NULL)
+	return ENOMEM;
+    for (i = 0; i < data.length; i++) {
+	hi = log_unhex(hex[2 * i]);
+	lo = log_unhex(hex[2 * i + 1]);
+	if (hi < 0 || lo < 0) {
+	    retval = KRB5_KDB_DB_CORRUPT;
+	    goto cleanup;
+	}
+	data.data[i] = (hi << 4) | lo;
+    }
+    data.data[data.length] = '\0';
+
+    n = 1;
+    if (!strncmp(op, KDB_LOG_PUT "\t", sizeof(KDB_LOG_PUT))) {
+	memset((char *) &entry, 0, sizeof(entry));
+	if ((retval = krb5_decode_princ_contents(context, &data, &entry)))
+	    goto cleanup;
+	retval = krb5_db_put_principal(context, &entry, &n);
+	krb5_dbe_free_contents(context, &entry);
+    } else if (!strncmp(op, KDB_LOG_DELETE "\t", sizeof(KDB_LOG_DELETE))) {
+	if ((retval = krb5_parse_name(context, data.data, &princ)))
+	    goto cleanup;
+	retval = krb5_db_delete_principal(context, princ, &n);
+	if (retval == KRB5_KDB_NOENTRY)
+	    retval = 0;
+	krb5_free_principal(context, princ);
+    } else
+	retval = KRB5_KDB_DB_CORRUPT;
+
+cleanup:
+    free(data.data);
+    return retval;
+}
@@ -189,19 +189,23 @@ asn1_error_code asn1_decode_generaltime(buf, val)
      time_t * val;
 {
   setup();
-  char *s;
+  char s[15];
+  asn1_octet o;
   struct tm ts;
   time_t t;
+  int i;
 
   tag(ASN1_GENERALTIME);
 
   if(length != 15) return ASN1_BAD_LENGTH;
-  retval = asn1buf_remove_charstring(buf,15,&s);
+  for(i=0; i<15; i++){
+    retval = asn1buf_remove_octet(buf,&o);
+    if(retval) return retval;
+    s[i] = (char)o;
+  }
   /* Time encoding: YYYYMMDDhhmmssZ */
-  if(s[14] != 'Z') {
-      free(s);
+  if(s[14] != 'Z')
       return ASN1_BAD_FORMAT;
-  }
 #define c2i(c) ((c)-'0')
   ts.tm_year = 1000*c2i(s[0]) + 100*c2i(s[1]) + 10*c2i(s[2]) + c2i(s[3])
     - 1900;
@@ -212,7 +216,6 @@ asn1_error_code asn1_decode_generaltime(buf, val)
   ts.tm_sec = 10*c2i(s[12]) + c2i(s[13]);
   ts.tm_isdst = -1;
   t = gmt_mktime(&ts);
-  free(s);
 
   if(t == -1) return ASN1_BAD_TIMEFORMAT;
 
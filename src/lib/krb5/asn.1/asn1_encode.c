@@ -197,29 +197,40 @@ asn1_error_code asn1_encode_generaltime(buf, val, retlen)
 {
   asn1_error_code retval;
   struct tm *gtime;
-  char s[16];
+  char s[6*11+2];	/* six ints of any value, 'Z' and the nul */
   int length, sum=0;
   time_t gmt_time = val;
 
-#ifdef macintosh
-  unix_time_to_msl_time (&gmt_time);
-#endif
-  gtime = gmtime(&gmt_time);
-
   /*
-   * Time encoding: YYYYMMDDhhmmssZ
-   *
-   * Sanity check this just to be paranoid, as gmtime can return NULL,
-   * and some bogus implementations might overrun on the sprintf.
+   * The encoding is always 15 octets long, so there is no need to
+   * format it when only measuring.
    */
-  if (gtime == NULL ||
-      gtime->tm_year > 8099 || gtime->tm_mon > 11 ||
-      gtime->tm_mday > 31 || gtime->tm_hour > 23 ||
-      gtime->tm_min > 59 || gtime->tm_sec > 59)
-    return ASN1_BAD_GMTIME;
-  sprintf(s, "%04d%02d%02d%02d%02d%02dZ",
-	  1900+gtime->tm_year, gtime->tm_mon+1, gtime->tm_mday,
-	  gtime->tm_hour, gtime->tm_min, gtime->tm_sec);
+  if (!asn1buf_measuring(buf)) {
+#ifdef macintosh
+    unix_time_to_msl_time (&gmt_time);
+#endif
+    gtime = gmtime(&gmt_time);
+
+    /*
+     * Time encoding: YYYYMMDDhhmmssZ
+     *
+     * Sanity check this just to be paranoid, as gmtime can return NULL,
+     * and some bogus implementations might overrun on the sprintf.
+     * Every field is checked at both ends, so that each is formatted
+     * in exactly its width and the result is 15 octets.
+     */
+    if (gtime == NULL ||
+	gtime->tm_year < -1900 || gtime->tm_year > 8099 ||
+	gtime->tm_mon < 0 || gtime->tm_mon > 11 ||
+	gtime->tm_mday < 1 || gtime->tm_mday > 31 ||
+	gtime->tm_hour < 0 || gtime->tm_hour > 23 ||
+	gtime->tm_min < 0 || gtime->tm_min > 59 ||
+	gtime->tm_sec < 0 || gtime->tm_sec > 59)
+      return ASN1_BAD_GMTIME;
+    sprintf(s, "%04d%02d%02d%02d%02d%02dZ",
+	    1900+gtime->tm_year, gtime->tm_mon+1, gtime->tm_mday,
+	    gtime->tm_hour, gtime->tm_min, gtime->tm_sec);
+  }
 
   retval = asn1buf_insert_charstring(buf,15,s);
   if(retval) return retval;
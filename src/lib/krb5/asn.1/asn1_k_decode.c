@@ -28,6 +28,7 @@
 #include "asn1_decode.h"
 #include "asn1_get.h"
 #include "asn1_misc.h"
+#include "asn1_tables.h"
 
 #define setup()\
 asn1_error_code retval;\
@@ -51,7 +52,7 @@ if(class != UNIVERSAL || tagnum || indef)			\
   return ASN1_MISSING_EOC
 
 #define alloc_field(var,type)\
-var = (type*)calloc(1,sizeof(type));\
+var = (type*)asn1buf_alloc(buf,sizeof(type));\
 if((var) == NULL) return ENOMEM
 
 
@@ -252,18 +253,16 @@ asn1_error_code asn1_decode_principal_name(buf, val)
     { sequence_of_no_tagvars(&subbuf);
       while(asn1buf_remains(&seqbuf,seqofindef) > 0){
 	size++;
-	if ((*val)->data == NULL)
-	  (*val)->data = (krb5_data*)malloc(size*sizeof(krb5_data));
-	else
-	  (*val)->data = (krb5_data*)realloc((*val)->data,
-					     size*sizeof(krb5_data));
+	(*val)->data = (krb5_data*)asn1buf_realloc(buf, (*val)->data,
+						   (size-1)*sizeof(krb5_data),
+						   size*sizeof(krb5_data));
 	if((*val)->data == NULL) return ENOMEM;
 	retval = asn1_decode_generalstring(&seqbuf,
 					   &((*val)->data[size-1].length),
 					   &((*val)->data[size-1].data));
 	if(retval) return retval;
+	(*val)->length = size;
       }
-      (*val)->length = size;
       end_sequence_of_no_tagvars(&subbuf);
     }
     if (indef) {
@@ -280,43 +279,21 @@ asn1_error_code asn1_decode_checksum(buf, val)
      asn1buf * buf;
      krb5_checksum * val;
 {
-  setup();
-  { begin_structure();
-    get_field(val->checksum_type,0,asn1_decode_cksumtype);
-    get_lenfield(val->length,val->contents,1,asn1_decode_octetstring);
-    end_structure();
-    val->magic = KV5M_CHECKSUM;
-  }
-  cleanup();
+  return asn1_tab_decode(buf,&asn1_type_Checksum,val);
 }
 
 asn1_error_code asn1_decode_encryption_key(buf, val)
      asn1buf * buf;
      krb5_keyblock * val;
 {
-  setup();
-  { begin_structure();
-    get_field(val->enctype,0,asn1_decode_enctype);
-    get_lenfield(val->length,val->contents,1,asn1_decode_octetstring);
-    end_structure();
-    val->magic = KV5M_KEYBLOCK;
-  }
-  cleanup();
+  return asn1_tab_decode(buf,&asn1_type_EncryptionKey,val);
 }
 
 asn1_error_code asn1_decode_encrypted_data(buf, val)
      asn1buf * buf;
      krb5_enc_data * val;
 {
-  setup();
-  { begin_structure();
-    get_field(val->enctype,0,asn1_decode_enctype);
-    opt_field(val->kvno,1,asn1_decode_kvno,0);
-    get_lenfield(val->ciphertext.length,val->ciphertext.data,2,asn1_decode_charstring);
-    end_structure();
-    val->magic = KV5M_ENC_DATA;
-  }
-  cleanup();
+  return asn1_tab_decode(buf,&asn1_type_EncryptedData,val);
 }
 
 asn1_error_code asn1_decode_krb5_flags(buf, val)
@@ -374,20 +351,6 @@ asn1_error_code asn1_decode_kdc_options(buf, val)
      krb5_flags * val;
 { return asn1_decode_krb5_flags(buf,val); }
 
-asn1_error_code asn1_decode_transited_encoding(buf, val)
-     asn1buf * buf;
-     krb5_transited * val;
-{
-  setup();
-  { begin_structure();
-    get_field(val->tr_type,0,asn1_decode_octet);
-    get_lenfield(val->tr_contents.length,val->tr_contents.data,1,asn1_decode_charstring);
-    end_structure();
-    val->magic = KV5M_TRANSITED;
-  }
-  cleanup();
-}
-
 asn1_error_code asn1_decode_enc_kdc_rep_part(buf, val)
      asn1buf * buf;
      krb5_enc_kdc_rep_part * val;
@@ -419,25 +382,7 @@ asn1_error_code asn1_decode_ticket(buf, val)
      asn1buf * buf;
      krb5_ticket * val;
 {
-  setup();
-  int applen;
-  apptag(1);
-  { begin_structure();
-    { krb5_kvno vno;
-      get_field(vno,0,asn1_decode_kvno);
-      if(vno != KVNO) return KRB5KDC_ERR_BAD_PVNO; }
-    alloc_field(val->server,krb5_principal_data);
-    get_field(val->server,1,asn1_decode_realm);
-    get_field(val->server,2,asn1_decode_principal_name);
-    get_field(val->enc_part,3,asn1_decode_encrypted_data);
-    end_structure();
-    val->magic = KV5M_TICKET;
-  }
-  if(!applen) {
-    retval = asn1_get_tag(buf,&class,&construction,&tagnum,NULL);
-    if (retval) return retval;
-  }
-  cleanup();
+  return asn1_tab_decode(buf,&asn1_type_Ticket,val);
 }
 
 asn1_error_code asn1_decode_kdc_req(buf, val)
@@ -470,8 +415,11 @@ asn1_error_code asn1_decode_kdc_req_body(buf, val)
     alloc_field(val->server,krb5_principal_data);
     get_field(val->server,2,asn1_decode_realm);
     if(val->client != NULL){
-      retval = asn1_krb5_realm_copy(val->client,val->server);
-      if(retval) return retval; }
+      if(buf->arena != NULL)	/* borrowed: both point into the packet */
+	val->client->realm = val->server->realm;
+      else{
+	retval = asn1_krb5_realm_copy(val->client,val->server);
+	if(retval) return retval; }}
     opt_field(val->server,3,asn1_decode_principal_name,NULL);
     opt_field(val->from,4,asn1_decode_kerberos_time,0);
     get_field(val->till,5,asn1_decode_kerberos_time);
@@ -495,42 +443,6 @@ asn1_error_code asn1_decode_kdc_req_body(buf, val)
   cleanup();
 }
 
-asn1_error_code asn1_decode_krb_safe_body(buf, val)
-     asn1buf * buf;
-     krb5_safe * val;
-{
-  setup();
-  { begin_structure();
-    get_lenfield(val->user_data.length,val->user_data.data,0,asn1_decode_charstring);
-    opt_field(val->timestamp,1,asn1_decode_kerberos_time,0);
-    opt_field(val->usec,2,asn1_decode_int32,0);
-    opt_field(val->seq_number,3,asn1_decode_int32,0);
-    alloc_field(val->s_address,krb5_address);
-    get_field(*(val->s_address),4,asn1_decode_host_address);
-    if(tagnum == 5){
-      alloc_field(val->r_address,krb5_address);
-      get_field(*(val->r_address),5,asn1_decode_host_address);
-    } else val->r_address = NULL;
-    end_structure();
-    val->magic = KV5M_SAFE;
-  }
-  cleanup();
-}
-
-asn1_error_code asn1_decode_host_address(buf, val)
-     asn1buf * buf;
-     krb5_address * val;
-{
-  setup();
-  { begin_structure();
-    get_field(val->addrtype,0,asn1_decode_addrtype);
-    get_lenfield(val->length,val->contents,1,asn1_decode_octetstring);
-    end_structure();
-    val->magic = KV5M_ADDRESS;
-  }
-  cleanup();
-}
-
 asn1_error_code asn1_decode_kdc_rep(buf, val)
      asn1buf * buf;
      krb5_kdc_rep * val;
@@ -562,11 +474,9 @@ if(retval) return retval
      
 #define array_append(array,size,element,type)\
 size++;\
-if (*(array) == NULL)\
-     *(array) = (type**)malloc((size+1)*sizeof(type*));\
-else\
-  *(array) = (type**)realloc(*(array),\
-			     (size+1)*sizeof(type*));\
+*(array) = (type**)asn1buf_realloc(buf,*(array),\
+				   (*(array) ? size*sizeof(type*) : 0),\
+				   (size+1)*sizeof(type*));\
 if(*(array) == NULL) return ENOMEM;\
 (*(array))[(size)-1] = elt
      
@@ -581,123 +491,39 @@ if(*(array) == NULL) return ENOMEM;\
       array_append(val,size,elt,type);\
     }\
     if (*val == NULL)\
-	*val = (type **)malloc(sizeof(type*));\
+	*val = (type **)asn1buf_alloc(buf,sizeof(type*));\
     (*val)[size] = NULL;\
     end_sequence_of(buf);\
   }\
   cleanup()
 
 
-asn1_error_code asn1_decode_authorization_data(buf, val)
-     asn1buf * buf;
-     krb5_authdata *** val;
-{
-  decode_array_body(krb5_authdata,asn1_decode_authdata_elt);
-}
-
-asn1_error_code asn1_decode_authdata_elt(buf, val)
-     asn1buf * buf;
-     krb5_authdata * val;
-{
-  setup();
-  { begin_structure();
-    get_field(val->ad_type,0,asn1_decode_authdatatype);
-    get_lenfield(val->length,val->contents,1,asn1_decode_octetstring);
-    end_structure();
-    val->magic = KV5M_AUTHDATA;
-  }
-  cleanup();
-}
-
 asn1_error_code asn1_decode_host_addresses(buf, val)
      asn1buf * buf;
      krb5_address *** val;
 {
-  decode_array_body(krb5_address,asn1_decode_host_address);
+  return asn1_tab_decode(buf,&asn1_type_HostAddresses,val);
 }
 
 asn1_error_code asn1_decode_sequence_of_ticket(buf, val)
      asn1buf * buf;
      krb5_ticket *** val;
 {
-  decode_array_body(krb5_ticket,asn1_decode_ticket);
-}
-
-asn1_error_code asn1_decode_sequence_of_krb_cred_info(buf, val)
-     asn1buf * buf;
-     krb5_cred_info *** val;
-{
-  decode_array_body(krb5_cred_info,asn1_decode_krb_cred_info);
-}
-
-asn1_error_code asn1_decode_krb_cred_info(buf, val)
-     asn1buf * buf;
-     krb5_cred_info * val;
-{
-  setup();
-  { begin_structure();
-    alloc_field(val->session,krb5_keyblock);
-    get_field(*(val->session),0,asn1_decode_encryption_key);
-    if(tagnum == 1){
-      alloc_field(val->client,krb5_principal_data);
-      opt_field(val->client,1,asn1_decode_realm,NULL);
-      opt_field(val->client,2,asn1_decode_principal_name,NULL); }
-    opt_field(val->flags,3,asn1_decode_ticket_flags,0);
-    opt_field(val->times.authtime,4,asn1_decode_kerberos_time,0);
-    opt_field(val->times.starttime,5,asn1_decode_kerberos_time,0);
-    opt_field(val->times.endtime,6,asn1_decode_kerberos_time,0);
-    opt_field(val->times.renew_till,7,asn1_decode_kerberos_time,0);
-    if(tagnum == 8){
-      alloc_field(val->server,krb5_principal_data);
-      opt_field(val->server,8,asn1_decode_realm,NULL);
-      opt_field(val->server,9,asn1_decode_principal_name,NULL); }
-    opt_field(val->caddrs,10,asn1_decode_host_addresses,NULL);
-    end_structure();
-    val->magic = KV5M_CRED_INFO;
-  }
-  cleanup();
+  return asn1_tab_decode(buf,&asn1_type_seqof_Ticket,val);
 }
 
 asn1_error_code asn1_decode_sequence_of_pa_data(buf, val)
      asn1buf * buf;
      krb5_pa_data *** val;
 {
-  decode_array_body(krb5_pa_data,asn1_decode_pa_data);
-}
-
-asn1_error_code asn1_decode_pa_data(buf, val)
-     asn1buf * buf;
-     krb5_pa_data * val;
-{
-  setup();
-  { begin_structure();
-    get_field(val->pa_type,1,asn1_decode_int32);
-    get_lenfield(val->length,val->contents,2,asn1_decode_octetstring);
-    end_structure();
-    val->magic = KV5M_PA_DATA;
-  }
-  cleanup();
+  return asn1_tab_decode(buf,&asn1_type_seqof_PA_DATA,val);
 }
 
 asn1_error_code asn1_decode_last_req(buf, val)
      asn1buf * buf;
      krb5_last_req_entry *** val;
 {
-  decode_array_body(krb5_last_req_entry,asn1_decode_last_req_entry);
-}
-
-asn1_error_code asn1_decode_last_req_entry(buf, val)
-     asn1buf * buf;
-     krb5_last_req_entry * val;
-{
-  setup();
-  { begin_structure();
-    get_field(val->lr_type,0,asn1_decode_octet);
-    get_field(val->value,1,asn1_decode_kerberos_time);
-    end_structure();
-    val->magic = KV5M_LAST_REQ_ENTRY;
-  }
-  cleanup();
+  return asn1_tab_decode(buf,&asn1_type_LastReq,val);
 }
 
 asn1_error_code asn1_decode_sequence_of_enctype(buf, num, val)
@@ -709,10 +535,9 @@ asn1_error_code asn1_decode_sequence_of_enctype(buf, num, val)
   { sequence_of(buf);
     while(asn1buf_remains(&seqbuf,seqofindef) > 0){
       size++;
-      if (*val == NULL)
-        *val = (krb5_enctype*)malloc(size*sizeof(krb5_enctype));
-      else
-        *val = (krb5_enctype*)realloc(*val,size*sizeof(krb5_enctype));
+      *val = (krb5_enctype*)asn1buf_realloc(buf, *val,
+					    (size-1)*sizeof(krb5_enctype),
+					    size*sizeof(krb5_enctype));
       if(*val == NULL) return ENOMEM;
       retval = asn1_decode_enctype(&seqbuf,&((*val)[size-1]));
       if(retval) return retval;
@@ -723,32 +548,6 @@ asn1_error_code asn1_decode_sequence_of_enctype(buf, num, val)
   cleanup();
 }
 
-asn1_error_code asn1_decode_etype_info_entry(buf, val)
-     asn1buf * buf;
-     krb5_etype_info_entry * val;
-{
-  setup();
-  { begin_structure();
-    get_field(val->etype,0,asn1_decode_enctype);
-    if (tagnum == 1) {
-	    get_lenfield(val->length,val->salt,1,asn1_decode_octetstring);
-    } else {
-	    val->length = -1;
-	    val->salt = 0;
-    }
-    end_structure();
-    val->magic = KV5M_ETYPE_INFO_ENTRY;
-  }
-  cleanup();
-}
-
-asn1_error_code asn1_decode_etype_info(buf, val)
-     asn1buf * buf;
-     krb5_etype_info_entry *** val;
-{
-  decode_array_body(krb5_etype_info_entry,asn1_decode_etype_info_entry);
-}
-
 asn1_error_code asn1_decode_passwdsequence(buf, val)
      asn1buf * buf;
      passwd_phrase_element * val;
@@ -888,3 +687,120 @@ asn1_error_code asn1_decode_predicted_sam_response(buf, val)
   }
   cleanup();
 }
+
+/* peeking at KDC requests */
+
+#define skip_field(tagexpect)\
+if(tagnum > (tagexpect)) return ASN1_MISSING_FIELD;\
+if(tagnum < (tagexpect)) return ASN1_MISPLACED_FIELD;\
+if(class != CONTEXT_SPECIFIC || construction != CONSTRUCTED)\
+  return ASN1_BAD_ID;\
+retval = asn1buf_skip_value(&subbuf,taglen,indef);\
+if(retval) return retval;\
+next_tag()
+
+#define opt_skip_field(tagexpect)\
+if(tagnum == (tagexpect)){ skip_field(tagexpect); }
+
+static asn1_error_code peek_generalstring(buf, val)
+     asn1buf * buf;
+     krb5_data * val;
+{
+  setup();
+  retval = asn1_get_tag(buf,&class,&construction,&tagnum,&length);
+  if(retval) return retval;
+  if(tagnum != ASN1_GENERALSTRING || class != UNIVERSAL ||
+     construction != PRIMITIVE) return ASN1_BAD_ID;
+  retval = asn1buf_remove_pointer(buf,length,&val->data);
+  if(retval) return retval;
+  val->length = length;
+  cleanup();
+}
+
+static asn1_error_code peek_principal_name(buf, val)
+     asn1buf * buf;
+     krb5_kdc_req_peek * val;
+{
+  krb5_data comp;
+
+  setup();
+  { begin_structure();
+    get_field(val->sname_type,0,asn1_decode_int32);
+
+    { sequence_of_no_tagvars(&subbuf);
+      while(asn1buf_remains(&seqbuf,seqofindef) > 0){
+	retval = peek_generalstring(&seqbuf,&comp);
+	if(retval) return retval;
+	if(size < KRB5_PEEK_MAX_SNAME)
+	  val->sname[size] = comp;
+	size++;
+      }
+      val->sname_length = size;
+      end_sequence_of_no_tagvars(&subbuf);
+    }
+    if (indef) {
+	get_eoc();
+    }
+    next_tag();
+    end_structure();
+  }
+  cleanup();
+}
+
+static asn1_error_code peek_sequence_of_enctype(buf, val)
+     asn1buf * buf;
+     krb5_kdc_req_peek * val;
+{
+  asn1_error_code retval;
+  krb5_enctype etype;
+
+  { sequence_of(buf);
+    while(asn1buf_remains(&seqbuf,seqofindef) > 0){
+      retval = asn1_decode_enctype(&seqbuf,&etype);
+      if(retval) return retval;
+      if(size < KRB5_PEEK_MAX_ETYPES)
+	val->ktype[size] = etype;
+      size++;
+    }
+    val->nktypes = size;
+    end_sequence_of(buf);
+  }
+  cleanup();
+}
+
+/* The fields after the enctypes are not looked at, so the end of the
+   body is never checked. */
+static asn1_error_code peek_kdc_req_body(buf, val)
+     asn1buf * buf;
+     krb5_kdc_req_peek * val;
+{
+  setup();
+  { begin_structure();
+    skip_field(0);
+    opt_skip_field(1);
+    get_field(val->realm,2,peek_generalstring);
+    if(tagnum == 3){ get_field(*val,3,peek_principal_name); }
+    opt_skip_field(4);
+    skip_field(5);
+    opt_skip_field(6);
+    get_field(val->nonce,7,asn1_decode_int32);
+    get_field(*val,8,peek_sequence_of_enctype);
+  }
+  cleanup();
+}
+
+asn1_error_code asn1_peek_kdc_req(buf, val)
+     asn1buf * buf;
+     krb5_kdc_req_peek * val;
+{
+  setup();
+  { begin_structure();
+    { krb5_kvno kvno;
+      get_field(kvno,1,asn1_decode_kvno);
+      if(kvno != KVNO) return KRB5KDC_ERR_BAD_PVNO; }
+    get_field(val->msg_type,2,asn1_decode_msgtype);
+    opt_skip_field(3);
+    get_field(*val,4,peek_kdc_req_body);
+  }
+  cleanup();
+}
@@ -31,6 +31,10 @@
 #include "krbasn1.h"
 #include "asn1buf.h"
 
+/* The structures described in krb5_types.map are decoded by
+   asn1_tab_decode (see asn1_tab.h); the routines here for them only
+   pass their tables to it, for the decoders which remain by hand. */
+
 /* asn1_error_code asn1_decode_scalar_type(asn1buf *buf, krb5_scalar *val); */
 /* requires  *buf is allocated, *buf's current position points to the
               beginning of an encoding (<id> <len> <contents>),
@@ -107,8 +111,6 @@ asn1_error_code asn1_decode_encrypted_data
 	PROTOTYPE((asn1buf *buf, krb5_enc_data *val));
 asn1_error_code asn1_decode_ticket_flags
 	PROTOTYPE((asn1buf *buf, krb5_flags *val));
-asn1_error_code asn1_decode_transited_encoding
-	PROTOTYPE((asn1buf *buf, krb5_transited *val));
 asn1_error_code asn1_decode_enc_kdc_rep_part
 	PROTOTYPE((asn1buf *buf, krb5_enc_kdc_rep_part *val));
 asn1_error_code asn1_decode_krb5_flags
@@ -123,24 +125,10 @@ asn1_error_code asn1_decode_kdc_req
 	PROTOTYPE((asn1buf *buf, krb5_kdc_req *val));
 asn1_error_code asn1_decode_kdc_req_body
 	PROTOTYPE((asn1buf *buf, krb5_kdc_req *val));
-asn1_error_code asn1_decode_krb_safe_body
-	PROTOTYPE((asn1buf *buf, krb5_safe *val));
-asn1_error_code asn1_decode_host_address
-	PROTOTYPE((asn1buf *buf, krb5_address *val));
 asn1_error_code asn1_decode_kdc_rep
 	PROTOTYPE((asn1buf *buf, krb5_kdc_rep *val));
-asn1_error_code asn1_decode_last_req_entry
-	PROTOTYPE((asn1buf *buf, krb5_last_req_entry *val));
-asn1_error_code asn1_decode_authdata_elt
-	PROTOTYPE((asn1buf *buf, krb5_authdata *val));
-asn1_error_code asn1_decode_krb_cred_info
-	PROTOTYPE((asn1buf *buf, krb5_cred_info *val));
-asn1_error_code asn1_decode_pa_data
-	PROTOTYPE((asn1buf *buf, krb5_pa_data *val));
 asn1_error_code asn1_decode_passwdsequence
 	PROTOTYPE((asn1buf *buf, passwd_phrase_element *val));
-asn1_error_code asn1_decode_etype_info_entry
-	PROTOTYPE((asn1buf *buf, krb5_etype_info_entry *val));
 asn1_error_code asn1_decode_sam_challenge
 	PROTOTYPE((asn1buf *buf, krb5_sam_challenge *val));
 asn1_error_code asn1_decode_enc_sam_key
@@ -153,14 +141,10 @@ asn1_error_code asn1_decode_predicted_sam_response
 	PROTOTYPE((asn1buf *buf, krb5_predicted_sam_response *val));
 
 /* arrays */
-asn1_error_code asn1_decode_authorization_data
-	PROTOTYPE((asn1buf *buf, krb5_authdata ***val));
 asn1_error_code asn1_decode_host_addresses
 	PROTOTYPE((asn1buf *buf, krb5_address ***val));
 asn1_error_code asn1_decode_sequence_of_ticket
 	PROTOTYPE((asn1buf *buf, krb5_ticket ***val));
-asn1_error_code asn1_decode_sequence_of_krb_cred_info
-	PROTOTYPE((asn1buf *buf, krb5_cred_info ***val));
 asn1_error_code asn1_decode_sequence_of_pa_data
 	PROTOTYPE((asn1buf *buf, krb5_pa_data ***val));
 asn1_error_code asn1_decode_last_req
@@ -172,8 +156,9 @@ asn1_error_code asn1_decode_sequence_of_enctype
 asn1_error_code asn1_decode_sequence_of_passwdsequence
 	PROTOTYPE((asn1buf *buf, passwd_phrase_element ***val));
 
-asn1_error_code asn1_decode_etype_info
-	PROTOTYPE((asn1buf *buf, krb5_etype_info_entry ***val));
+/* peeking */
+asn1_error_code asn1_peek_kdc_req
+	PROTOTYPE((asn1buf *buf, krb5_kdc_req_peek *val));
 
 
 #endif
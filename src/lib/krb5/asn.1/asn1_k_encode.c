@@ -27,6 +27,7 @@
 #include "asn1_k_encode.h"
 #include "asn1_make.h"
 #include "asn1_encode.h"
+#include "asn1_tables.h"
 
 /**** asn1 macros ****/
 #if 0
@@ -79,43 +80,31 @@
 /* asn1_addfield -- add a field, or component, to the encoding */
 #define asn1_addfield(value,tag,encoder)\
 { retval = encoder(buf,value,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length;\
   retval = asn1_make_etag(buf,CONTEXT_SPECIFIC,tag,length,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length; }
 
 /* asn1_addlenfield -- add a field whose length must be separately specified */
 #define asn1_addlenfield(len,value,tag,encoder)\
 { retval = encoder(buf,len,value,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length;\
   retval = asn1_make_etag(buf,CONTEXT_SPECIFIC,tag,length,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length; }
 
 /* form a sequence (by adding a sequence header to the current encoding) */
 #define asn1_makeseq()\
   retval = asn1_make_sequence(buf,sum,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length
 
 /* add an APPLICATION class tag to the current encoding */
 #define asn1_apptag(num)\
   retval = asn1_make_etag(buf,APPLICATION,num,sum,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length
 
 /* produce the final output and clean up the workspace */
@@ -186,41 +175,12 @@ asn1_error_code asn1_encode_kerberos_time(buf, val, retlen)
   return asn1_encode_generaltime(buf,val,retlen);
 }
 
-asn1_error_code asn1_encode_host_address(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_address * val;
-     int * retlen;
-{
-  asn1_setup();
-
-  if (val == NULL || val->contents == NULL) return ASN1_MISSING_FIELD;
-
-  asn1_addlenfield(val->length,val->contents,1,asn1_encode_octetstring);
-  asn1_addfield(val->addrtype,0,asn1_encode_integer);
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
 asn1_error_code asn1_encode_host_addresses(buf, val, retlen)
      asn1buf * buf;
      const krb5_address ** val;
      int * retlen;
 {
-  asn1_setup();
-  int i;
-
-  if(val == NULL || val[0] == NULL) return ASN1_MISSING_FIELD;
-
-  for(i=0; val[i] != NULL; i++); /* go to end of array */
-  for(i--; i>=0; i--){
-    retval = asn1_encode_host_address(buf,val[i],&length);
-    if(retval) return retval;
-    sum += length;
-  }
-  asn1_makeseq();
-
-  asn1_cleanup();
+  return asn1_tab_encode(buf,&asn1_type_HostAddresses,val,retlen);
 }
 
 asn1_error_code asn1_encode_encrypted_data(buf, val, retlen)
@@ -228,20 +188,7 @@ asn1_error_code asn1_encode_encrypted_data(buf, val, retlen)
      const krb5_enc_data * val;
      int * retlen;
 {
-  asn1_setup();
-
-  if(val == NULL ||
-     (val->ciphertext.length && val->ciphertext.data == NULL))
-	  return ASN1_MISSING_FIELD;
-
-  asn1_addlenfield(val->ciphertext.length,val->ciphertext.data,2,asn1_encode_charstring);
-  if(val->kvno)
-    asn1_addfield(val->kvno,1,asn1_encode_integer);
-  asn1_addfield(val->enctype,0,asn1_encode_integer);
-
-  asn1_makeseq();
-
-  asn1_cleanup();
+  return asn1_tab_encode(buf,&asn1_type_EncryptedData,val,retlen);
 }
 
 asn1_error_code asn1_encode_krb5_flags(buf, val, retlen)
@@ -295,48 +242,6 @@ asn1_error_code asn1_encode_kdc_options(buf, val, retlen)
   return asn1_encode_krb5_flags(buf,val,retlen);
 }
 
-asn1_error_code asn1_encode_authorization_data(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_authdata ** val;
-     int * retlen;
-{
-  asn1_setup();
-  int i;
-  
-  if(val == NULL || val[0] == NULL) return ASN1_MISSING_FIELD;
-  
-  for(i=0; val[i] != NULL; i++); /* get to the end of the array */
-  for(i--; i>=0; i--){
-    retval = asn1_encode_krb5_authdata_elt(buf,val[i],&length);
-    if(retval) return retval;
-    sum += length;
-  }
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
-asn1_error_code asn1_encode_krb5_authdata_elt(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_authdata * val;
-     int * retlen;
-{
-  asn1_setup();
-
-  if (val == NULL ||
-     (val->length && val->contents == NULL))
-	  return ASN1_MISSING_FIELD;
-
-  /* ad-data[1]		OCTET STRING */
-  asn1_addlenfield(val->length,val->contents,1,asn1_encode_octetstring);
-  /* ad-type[0]		INTEGER */
-  asn1_addfield(val->ad_type,0,asn1_encode_integer);
-  /* SEQUENCE */
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
 asn1_error_code asn1_encode_kdc_rep(msg_type, buf, val, retlen)
      int msg_type;
      asn1buf * buf;
@@ -491,17 +396,7 @@ asn1_error_code asn1_encode_encryption_key(buf, val, retlen)
      const krb5_keyblock * val;
      int * retlen;
 {
-  asn1_setup();
-
-  if (val == NULL ||
-      (val->length && val->contents == NULL))
-	  return ASN1_MISSING_FIELD;
-
-  asn1_addlenfield(val->length,val->contents,1,asn1_encode_octetstring);
-  asn1_addfield(val->enctype,0,asn1_encode_integer);
-  asn1_makeseq();
-
-  asn1_cleanup();
+  return asn1_tab_encode(buf,&asn1_type_EncryptionKey,val,retlen);
 }
 
 asn1_error_code asn1_encode_checksum(buf, val, retlen)
@@ -509,36 +404,7 @@ asn1_error_code asn1_encode_checksum(buf, val, retlen)
      const krb5_checksum * val;
      int * retlen;
 {
-  asn1_setup();
-
-  if (val == NULL ||
-     (val->length && val->contents == NULL))
-	  return ASN1_MISSING_FIELD;
-
-  asn1_addlenfield(val->length,val->contents,1,asn1_encode_octetstring);
-  asn1_addfield(val->checksum_type,0,asn1_encode_integer);
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
-asn1_error_code asn1_encode_transited_encoding(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_transited * val;
-     int * retlen;
-{
-  asn1_setup();
-
-  if(val == NULL ||
-     (val->tr_contents.length != 0 && val->tr_contents.data == NULL))
-    return ASN1_MISSING_FIELD;
-
-  asn1_addlenfield(val->tr_contents.length,val->tr_contents.data,
-		   1,asn1_encode_charstring);
-  asn1_addfield(val->tr_type,0,asn1_encode_integer);
-  asn1_makeseq();
-
-  asn1_cleanup();
+  return asn1_tab_encode(buf,&asn1_type_Checksum,val,retlen);
 }
 
 asn1_error_code asn1_encode_last_req(buf, val, retlen)
@@ -546,36 +412,7 @@ asn1_error_code asn1_encode_last_req(buf, val, retlen)
      const krb5_last_req_entry ** val;
      int * retlen;
 {
-  asn1_setup();
-  int i;
-
-  if(val == NULL || val[0] == NULL) return ASN1_MISSING_FIELD;
-
-  for(i=0; val[i] != NULL; i++); /* go to end of array */
-  for(i--; i>=0; i--){
-    retval = asn1_encode_last_req_entry(buf,val[i],&length);
-    if(retval) return retval;
-    sum += length;
-  }
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
-asn1_error_code asn1_encode_last_req_entry(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_last_req_entry * val;
-     int * retlen;
-{
-  asn1_setup();
-
-  if(val == NULL) return ASN1_MISSING_FIELD;
-
-  asn1_addfield(val->value,1,asn1_encode_kerberos_time);
-  asn1_addfield(val->lr_type,0,asn1_encode_integer);
-  asn1_makeseq();
-
-  asn1_cleanup();
+  return asn1_tab_encode(buf,&asn1_type_LastReq,val,retlen);
 }
 
 asn1_error_code asn1_encode_sequence_of_pa_data(buf, val, retlen)
@@ -583,37 +420,7 @@ asn1_error_code asn1_encode_sequence_of_pa_data(buf, val, retlen)
      const krb5_pa_data ** val;
      int * retlen;
 {
-  asn1_setup();
-  int i;
-
-  if (val == NULL) return ASN1_MISSING_FIELD;
-
-  for(i=0; val[i] != NULL; i++);
-  for(i--; i>=0; i--){
-    retval = asn1_encode_pa_data(buf,val[i],&length);
-    if(retval) return retval;
-    sum += length;
-  }
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
-asn1_error_code asn1_encode_pa_data(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_pa_data * val;
-     int * retlen;
-{
-  asn1_setup();
-
-  if(val == NULL || (val->length != 0 && val->contents == NULL))
-     return ASN1_MISSING_FIELD;
-
-  asn1_addlenfield(val->length,val->contents,2,asn1_encode_octetstring);
-  asn1_addfield(val->pa_type,1,asn1_encode_integer);
-  asn1_makeseq();
-
-  asn1_cleanup();
+  return asn1_tab_encode(buf,&asn1_type_seqof_PA_DATA,val,retlen);
 }
 
 asn1_error_code asn1_encode_sequence_of_ticket(buf, val, retlen)
@@ -621,20 +428,7 @@ asn1_error_code asn1_encode_sequence_of_ticket(buf, val, retlen)
      const krb5_ticket ** val;
      int * retlen;
 {
-  asn1_setup();
-  int i;
-
-  if(val == NULL || val[0] == NULL) return ASN1_MISSING_FIELD;
-
-  for(i=0; val[i] != NULL; i++);
-  for(i--; i>=0; i--){
-    retval = asn1_encode_ticket(buf,val[i],&length);
-    if(retval) return retval;
-    sum += length;
-  }
-  asn1_makeseq();
-
-  asn1_cleanup();
+  return asn1_tab_encode(buf,&asn1_type_seqof_Ticket,val,retlen);
 }
 
 asn1_error_code asn1_encode_ticket(buf, val, retlen)
@@ -642,18 +436,7 @@ asn1_error_code asn1_encode_ticket(buf, val, retlen)
      const krb5_ticket * val;
      int * retlen;
 {
-  asn1_setup();
-
-  if(val == NULL) return ASN1_MISSING_FIELD;
-
-  asn1_addfield(&(val->enc_part),3,asn1_encode_encrypted_data);
-  asn1_addfield(val->server,2,asn1_encode_principal_name);
-  asn1_addfield(val->server,1,asn1_encode_realm);
-  asn1_addfield(KVNO,0,asn1_encode_integer);
-  asn1_makeseq();
-  asn1_apptag(1);
-
-  asn1_cleanup();
+  return asn1_tab_encode(buf,&asn1_type_Ticket,val,retlen);
 }
 
 asn1_error_code asn1_encode_sequence_of_enctype(buf, len, val, retlen)
@@ -699,129 +482,6 @@ asn1_error_code asn1_encode_kdc_req(msg_type, buf, val, retlen)
   asn1_cleanup();
 }
 
-asn1_error_code asn1_encode_krb_safe_body(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_safe * val;
-     int * retlen;
-{
-  asn1_setup();
-
-  if(val == NULL) return ASN1_MISSING_FIELD;
-
-  if(val->r_address != NULL)
-    asn1_addfield(val->r_address,5,asn1_encode_host_address);
-  asn1_addfield(val->s_address,4,asn1_encode_host_address);
-  if(val->seq_number)
-    asn1_addfield(val->seq_number,3,asn1_encode_integer);
-  if(val->timestamp){
-    asn1_addfield(val->usec,2,asn1_encode_integer);
-    asn1_addfield(val->timestamp,1,asn1_encode_kerberos_time);
-  }
-  if (val->user_data.length && val->user_data.data == NULL)
-	  return ASN1_MISSING_FIELD;
-  asn1_addlenfield(val->user_data.length,val->user_data.data,0,asn1_encode_charstring)
-;
-
-  asn1_makeseq();
-  asn1_cleanup();
-}
-
-asn1_error_code asn1_encode_sequence_of_krb_cred_info(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_cred_info ** val;
-     int * retlen;
-{
-  asn1_setup();
-  int i;
-
-  if(val == NULL) return ASN1_MISSING_FIELD;
-
-  for(i=0; val[i] != NULL; i++);
-  for(i--; i>=0; i--){
-    retval = asn1_encode_krb_cred_info(buf,val[i],&length);
-    if(retval) return retval;
-    sum += length;
-  }
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
-asn1_error_code asn1_encode_krb_cred_info(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_cred_info * val;
-     int * retlen;
-{
-  asn1_setup();
-
-  if(val == NULL) return ASN1_MISSING_FIELD;
-
-  if(val->caddrs != NULL && val->caddrs[0] != NULL)
-    asn1_addfield((const krb5_address**)val->caddrs,10,asn1_encode_host_addresses);
-  if(val->server != NULL){
-    asn1_addfield(val->server,9,asn1_encode_principal_name);
-    asn1_addfield(val->server,8,asn1_encode_realm);
-  }
-  if(val->times.renew_till)
-    asn1_addfield(val->times.renew_till,7,asn1_encode_kerberos_time);
-  if(val->times.endtime)
-    asn1_addfield(val->times.endtime,6,asn1_encode_kerberos_time);
-  if(val->times.starttime)
-    asn1_addfield(val->times.starttime,5,asn1_encode_kerberos_time);
-  if(val->times.authtime)
-    asn1_addfield(val->times.authtime,4,asn1_encode_kerberos_time);
-  if(val->flags)
-    asn1_addfield(val->flags,3,asn1_encode_ticket_flags);
-  if(val->client != NULL){
-    asn1_addfield(val->client,2,asn1_encode_principal_name);
-    asn1_addfield(val->client,1,asn1_encode_realm);
-  }
-  asn1_addfield(val->session,0,asn1_encode_encryption_key);
-
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
-asn1_error_code asn1_encode_etype_info_entry(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_etype_info_entry * val;
-     int * retlen;
-{
-  asn1_setup();
-
-  if(val == NULL || (val->length > 0 && val->salt == NULL))
-     return ASN1_MISSING_FIELD;
-
-  if (val->length >= 0)
-	  asn1_addlenfield((int) val->length,val->salt,1,
-			   asn1_encode_octetstring);
-  asn1_addfield(val->etype,0,asn1_encode_integer);
-  asn1_makeseq();
-
-  asn1_cleanup();
-}
-
-asn1_error_code asn1_encode_etype_info(buf, val, retlen)
-     asn1buf * buf;
-     const krb5_etype_info_entry ** val;
-     int * retlen;
-{
-    asn1_setup();
-    int i;
-  
-    if (val == NULL) return ASN1_MISSING_FIELD;
-  
-    for(i=0; val[i] != NULL; i++); /* get to the end of the array */
-    for(i--; i>=0; i--){
-	retval = asn1_encode_etype_info_entry(buf,val[i],&length);
-	if(retval) return retval;
-	sum += length;
-    }
-    asn1_makeseq();
-    asn1_cleanup();
-}
-
 asn1_error_code asn1_encode_sequence_of_passwdsequence(buf, val, retlen)
      asn1buf * buf;
      const passwd_phrase_element ** val;
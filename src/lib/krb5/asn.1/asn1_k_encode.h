@@ -37,6 +37,10 @@
      Encoding routines for various ASN.1 "substructures" as defined in
      the krb5 protocol.
 
+     The structures described in krb5_types.map are encoded by
+     asn1_tab_encode (see asn1_tab.h); the routines here for them only
+     pass their tables to it, for the encoders which remain by hand.
+
    Operations
 
     asn1_encode_krb5_flags
@@ -48,28 +52,19 @@
     asn1_encode_realm
     asn1_encode_principal_name
     asn1_encode_encrypted_data
-    asn1_encode_authorization_data
-    asn1_encode_krb5_authdata_elt
     asn1_encode_kdc_rep
     asn1_encode_ticket
     asn1_encode_encryption_key
     asn1_encode_checksum
-    asn1_encode_host_address
-    asn1_encode_transited_encoding
     asn1_encode_enc_kdc_rep_part
     asn1_encode_kdc_req
     asn1_encode_kdc_req_body
-    asn1_encode_krb_safe_body
-    asn1_encode_krb_cred_info
-    asn1_encode_last_req_entry
-    asn1_encode_pa_data
 
     asn1_encode_host_addresses
     asn1_encode_last_req
     asn1_encode_sequence_of_pa_data
     asn1_encode_sequence_of_ticket
     asn1_encode_sequence_of_enctype
-    asn1_encode_sequence_of_krb_cred_info
 */
 
 /*
@@ -134,12 +129,6 @@ asn1_error_code asn1_encode_ticket_flags
 asn1_error_code asn1_encode_kdc_options
 	PROTOTYPE((asn1buf *buf, const krb5_flags val, int *retlen));
 
-asn1_error_code asn1_encode_authorization_data
-	PROTOTYPE((asn1buf *buf, const krb5_authdata **val, int *retlen));
-
-asn1_error_code asn1_encode_krb5_authdata_elt
-	PROTOTYPE((asn1buf *buf, const krb5_authdata *val, int *retlen));
-
 asn1_error_code asn1_encode_kdc_rep
 	PROTOTYPE((int msg_type, asn1buf *buf, const krb5_kdc_rep *val,
 		   int *retlen));
@@ -160,15 +149,9 @@ asn1_error_code asn1_encode_kerberos_time
 asn1_error_code asn1_encode_checksum
 	PROTOTYPE((asn1buf *buf, const krb5_checksum *val, int *retlen));
 
-asn1_error_code asn1_encode_host_address
-	PROTOTYPE((asn1buf *buf, const krb5_address *val, int *retlen));
-
 asn1_error_code asn1_encode_host_addresses
 	PROTOTYPE((asn1buf *buf, const krb5_address **val, int *retlen));
 
-asn1_error_code asn1_encode_transited_encoding
-	PROTOTYPE((asn1buf *buf, const krb5_transited *val, int *retlen));
-
 asn1_error_code asn1_encode_last_req
 	PROTOTYPE((asn1buf *buf, const krb5_last_req_entry **val,
 		   int *retlen));
@@ -193,34 +176,10 @@ asn1_error_code asn1_encode_kdc_req
 asn1_error_code asn1_encode_kdc_req_body
 	PROTOTYPE((asn1buf *buf, const krb5_kdc_req *val, int *retlen));
 
-asn1_error_code asn1_encode_krb_safe_body
-	PROTOTYPE((asn1buf *buf, const krb5_safe *val, int *retlen));
-
-asn1_error_code asn1_encode_sequence_of_krb_cred_info
-	PROTOTYPE((asn1buf *buf, const krb5_cred_info **val, int *retlen));
-
-asn1_error_code asn1_encode_krb_cred_info
-	PROTOTYPE((asn1buf *buf, const krb5_cred_info *val, int *retlen));
-
-asn1_error_code asn1_encode_last_req_entry
-	PROTOTYPE((asn1buf *buf, const krb5_last_req_entry *val,
-		   int *retlen));
-
-asn1_error_code asn1_encode_pa_data
-	PROTOTYPE((asn1buf *buf, const krb5_pa_data *val, int *retlen));
-
 asn1_error_code asn1_encode_alt_method
 	PROTOTYPE((asn1buf *buf, const krb5_alt_method *val,
 		   int *retlen));
 
-asn1_error_code asn1_encode_etype_info_entry
-	PROTOTYPE((asn1buf *buf, const krb5_etype_info_entry *val,
-		   int *retlen));
-
-asn1_error_code asn1_encode_etype_info
-	PROTOTYPE((asn1buf *buf, const krb5_etype_info_entry **val,
-		   int *retlen));
-
 asn1_error_code asn1_encode_passwdsequence
 	PROTOTYPE((asn1buf *buf, const passwd_phrase_element *val, int *retlen));
 
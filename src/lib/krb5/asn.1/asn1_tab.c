@@ -0,0 +1,493 @@
+/*
+ * src/lib/krb5/asn.1/asn1_tab.c
+ *
+ * Copyright 1994 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ */
+
+/* The interpreter for the type tables in asn1_tables.c.  It encodes
+   and decodes exactly as the hand-written routines in asn1_k_encode.c
+   and asn1_k_decode.c do: fields in reverse order into the back of the
+   buffer, and forward out of a decoding buffer with the same tag
+   checks, the same tolerance of indefinite lengths and the same
+   error codes. */
+
+#include "asn1_tab.h"
+#include "asn1_k_encode.h"
+#include "asn1_k_decode.h"
+#include "asn1_encode.h"
+#include "asn1_decode.h"
+#include "asn1_make.h"
+#include "asn1_get.h"
+
+#define member(val,f)	((char*)(val) + (f)->offset)
+#define aux(val,f)	((char*)(val) + (f)->aux)
+
+#define int32_at(p)	(*(krb5_int32*)(p))
+#define int_at(p)	(*(int*)(p))
+#define ptr_at(p)	(*(void**)(p))
+
+/**************** encoding ****************/
+
+/* Is field f of val to be encoded? */
+static int field_present(f, val)
+     const asn1_field * f;
+     const void * val;
+{
+  const char *p = member(val,f);
+
+  if(f->flags & ASN1_TAB_IF)
+    return int32_at(aux(val,f)) != 0;
+  if(f->flags & ASN1_TAB_NEGLEN)
+    return int_at(aux(val,f)) >= 0;
+  if(!(f->flags & ASN1_TAB_OPTIONAL))
+    return 1;
+
+  switch(f->kind){
+  case ASN1_TAB_INT32:
+  case ASN1_TAB_TIME:
+  case ASN1_TAB_FLAGS:
+    return int32_at(p) != 0;
+  case ASN1_TAB_UINT:
+    return *(krb5_kvno*)p != 0;
+  case ASN1_TAB_UI4:
+    return *(krb5_ui_4*)p != 0;
+  case ASN1_TAB_OCTET:
+    return *(krb5_octet*)p != 0;
+  case ASN1_TAB_OCTETS:
+  case ASN1_TAB_GENSTRING:
+    return ptr_at(p) != NULL && int_at(aux(val,f)) > 0;
+  case ASN1_TAB_ARRAY:
+    return ptr_at(p) != NULL && ((void**)ptr_at(p))[0] != NULL;
+  default:			/* REALM, NAME, POINTER */
+    return ptr_at(p) != NULL;
+  }
+}
+
+static asn1_error_code encode_field(buf, f, val, retlen)
+     asn1buf * buf;
+     const asn1_field * f;
+     const void * val;
+     int * retlen;
+{
+  const char *p = member(val,f);
+  int len;
+
+  switch(f->kind){
+  case ASN1_TAB_INT32:
+    return asn1_encode_integer(buf,(long)int32_at(p),retlen);
+  case ASN1_TAB_UINT:
+    return asn1_encode_integer(buf,(long)*(krb5_kvno*)p,retlen);
+  case ASN1_TAB_UI4:
+    return asn1_encode_unsigned_integer(buf,(unsigned long)*(krb5_ui_4*)p,
+					retlen);
+  case ASN1_TAB_OCTET:
+    return asn1_encode_integer(buf,(long)*(krb5_octet*)p,retlen);
+  case ASN1_TAB_TIME:
+    return asn1_encode_kerberos_time(buf,int32_at(p),retlen);
+  case ASN1_TAB_FLAGS:
+    return asn1_encode_krb5_flags(buf,int32_at(p),retlen);
+  case ASN1_TAB_OCTETS:
+  case ASN1_TAB_GENSTRING:
+    len = int_at(aux(val,f));
+    if(len != 0 && ptr_at(p) == NULL) return ASN1_MISSING_FIELD;
+    if(f->kind == ASN1_TAB_OCTETS)
+      return asn1_encode_octetstring(buf,len,(const asn1_octet*)ptr_at(p),
+				     retlen);
+    return asn1_encode_generalstring(buf,len,(const char*)ptr_at(p),retlen);
+  case ASN1_TAB_REALM:
+    return asn1_encode_realm(buf,(krb5_principal)ptr_at(p),retlen);
+  case ASN1_TAB_NAME:
+    return asn1_encode_principal_name(buf,(krb5_principal)ptr_at(p),retlen);
+  case ASN1_TAB_PVNO:
+  case ASN1_TAB_MSGTYPE:
+    return asn1_encode_integer(buf,(long)f->aux,retlen);
+  case ASN1_TAB_STRUCT:
+    return asn1_tab_encode(buf,f->type,p,retlen);
+  case ASN1_TAB_POINTER:
+  case ASN1_TAB_ARRAY:
+    return asn1_tab_encode(buf,f->type,ptr_at(p),retlen);
+  }
+  return ASN1_BAD_ID;
+}
+
+asn1_error_code asn1_tab_encode(buf, type, val, retlen)
+     asn1buf * buf;
+     const asn1_type * type;
+     const void * val;
+     int * retlen;
+{
+  asn1_error_code retval;
+  const asn1_field *f;
+  void * const *array;
+  int length, sum=0, i;
+
+  if(val == NULL) return ASN1_MISSING_FIELD;
+
+  if(type->flags & ASN1_TAB_SEQOF){
+    array = (void * const *)val;
+    for(i=0; array[i] != NULL; i++);
+    if(i == 0 && (type->flags & ASN1_TAB_NONEMPTY))
+      return ASN1_MISSING_FIELD;
+    for(i--; i>=0; i--){
+      retval = asn1_tab_encode(buf,type->elem,array[i],&length);
+      if(retval) return retval;
+      sum += length;
+    }
+  }else{
+    for(f = type->fields + type->nfields - 1; f >= type->fields; f--){
+      if(!field_present(f,val))
+	continue;
+      retval = encode_field(buf,f,val,&length);
+      if(retval) return retval;
+      sum += length;
+      retval = asn1_make_etag(buf,CONTEXT_SPECIFIC,f->tag,length,&length);
+      if(retval) return retval;
+      sum += length;
+    }
+  }
+
+  retval = asn1_make_sequence(buf,sum,&length);
+  if(retval) return retval;
+  sum += length;
+
+  if(type->apptag >= 0){
+    retval = asn1_make_etag(buf,APPLICATION,type->apptag,sum,&length);
+    if(retval) return retval;
+    sum += length;
+  }
+
+  *retlen = sum;
+  return 0;
+}
+
+/**************** decoding ****************/
+
+static asn1_error_code decode_type
+	PROTOTYPE((asn1buf *buf, const asn1_type *type, void *val, int top));
+
+static asn1_error_code decode_array(buf, type, val)
+     asn1buf * buf;
+     const asn1_type * type;
+     void *** val;
+{
+  asn1_error_code retval;
+  asn1_class class;
+  asn1_construction construction;
+  asn1_tagnum tagnum;
+  asn1buf seqbuf;
+  int length, taglen, indef, seqofindef;
+  int size = 0, room = 0;
+  void **array, *elt;
+
+  *val = NULL;
+  retval = asn1_get_sequence(buf,&length,&seqofindef);
+  if(retval) return retval;
+  retval = asn1buf_imbed(&seqbuf,buf,length,seqofindef);
+  if(retval) return retval;
+
+  while(asn1buf_remains(&seqbuf,seqofindef) > 0){
+    /* keep the array NULL-terminated, so that a partial result can be
+       freed */
+    if(size + 1 >= room){
+      array = (void**)asn1buf_realloc(buf,*val,room*sizeof(void*),
+				      (room ? 2*room : 4)*sizeof(void*));
+      if(array == NULL) return ENOMEM;
+      *val = array;
+      room = room ? 2*room : 4;
+    }
+    elt = asn1buf_alloc(buf,type->elem->size);
+    if(elt == NULL) return ENOMEM;
+    (*val)[size++] = elt;
+    (*val)[size] = NULL;
+    retval = decode_type(&seqbuf,type->elem,elt,0);
+    if(retval) return retval;
+  }
+  if(*val == NULL){
+    *val = (void**)asn1buf_alloc(buf,sizeof(void*));
+    if(*val == NULL) return ENOMEM;
+  }
+
+  retval = asn1_get_tag_indef(&seqbuf,&class,&construction,
+			      &tagnum,&taglen,&indef);
+  if(retval) return retval;
+  return asn1buf_sync(buf,&seqbuf,class,tagnum,length,indef,seqofindef);
+}
+
+static asn1_error_code decode_field(buf, f, val)
+     asn1buf * buf;
+     const asn1_field * f;
+     void * val;
+{
+  asn1_error_code retval;
+  char *p = member(val,f);
+  long n;
+  unsigned long un;
+
+  switch(f->kind){
+  case ASN1_TAB_INT32:
+    retval = asn1_decode_integer(buf,&n);
+    if(retval) return retval;
+    int32_at(p) = (krb5_int32)n;
+    return 0;
+  case ASN1_TAB_UINT:
+    retval = asn1_decode_integer(buf,&n);
+    if(retval) return retval;
+    *(krb5_kvno*)p = (krb5_kvno)n;
+    return 0;
+  case ASN1_TAB_UI4:
+    retval = asn1_decode_unsigned_integer(buf,&un);
+    if(retval) return retval;
+    *(krb5_ui_4*)p = (krb5_ui_4)un;
+    return 0;
+  case ASN1_TAB_OCTET:
+    retval = asn1_decode_integer(buf,&n);
+    if(retval) return retval;
+    *(krb5_octet*)p = (krb5_octet)n;
+    return 0;
+  case ASN1_TAB_TIME:
+    return asn1_decode_kerberos_time(buf,(krb5_timestamp*)p);
+  case ASN1_TAB_FLAGS:
+    return asn1_decode_krb5_flags(buf,(krb5_flags*)p);
+  case ASN1_TAB_OCTETS:
+    return asn1_decode_charstring(buf,(int*)aux(val,f),(char**)p);
+  case ASN1_TAB_GENSTRING:
+    return asn1_decode_generalstring(buf,(int*)aux(val,f),(char**)p);
+  case ASN1_TAB_REALM:
+  case ASN1_TAB_NAME:
+    if(ptr_at(p) == NULL){
+      ptr_at(p) = asn1buf_alloc(buf,sizeof(krb5_principal_data));
+      if(ptr_at(p) == NULL) return ENOMEM;
+    }
+    if(f->kind == ASN1_TAB_REALM)
+      return asn1_decode_realm(buf,(krb5_principal*)p);
+    return asn1_decode_principal_name(buf,(krb5_principal*)p);
+  case ASN1_TAB_PVNO:
+    retval = asn1_decode_integer(buf,&n);
+    if(retval) return retval;
+    if(n != f->aux) return KRB5KDC_ERR_BAD_PVNO;
+    return 0;
+  case ASN1_TAB_MSGTYPE:
+    retval = asn1_decode_unsigned_integer(buf,&un);
+    if(retval) return retval;
+#ifdef KRB5_MSGTYPE_STRICT
+    if(un != (unsigned long)f->aux) return KRB5_BADMSGTYPE;
+#endif
+    return 0;
+  case ASN1_TAB_STRUCT:
+    return decode_type(buf,f->type,p,0);
+  case ASN1_TAB_POINTER:
+    ptr_at(p) = asn1buf_alloc(buf,f->type->size);
+    if(ptr_at(p) == NULL) return ENOMEM;
+    return decode_type(buf,f->type,ptr_at(p),0);
+  case ASN1_TAB_ARRAY:
+    return decode_array(buf,f->type,(void***)p);
+  }
+  return ASN1_BAD_ID;
+}
+
+/* Set an absent OPTIONAL field to the value it decodes as. */
+static void absent_field(f, val)
+     const asn1_field * f;
+     void * val;
+{
+  char *p = member(val,f);
+
+  if(f->flags & ASN1_TAB_DEFAULT)
+    int32_at(p) = int32_at(aux(val,f));
+  else if(f->flags & ASN1_TAB_NEGLEN){
+    int_at(aux(val,f)) = -1;
+    ptr_at(p) = NULL;
+  }
+  /* everything else is already zero, and a PrincipalName shares its
+     pointer with the Realm before it */
+}
+
+static asn1_error_code decode_type(buf, type, val, top)
+     asn1buf * buf;
+     const asn1_type * type;
+     void * val;
+     int top;
+{
+  asn1_error_code retval;
+  asn1_class class;
+  asn1_construction construction;
+  asn1_tagnum tagnum;
+  asn1buf subbuf;
+  int length, taglen, applen = 1, indef, seqindef;
+  const asn1_field *f;
+
+  if(type->apptag >= 0){
+    retval = asn1_get_tag(buf,&class,&construction,&tagnum,&applen);
+    if(retval) return retval;
+    if(class != APPLICATION || construction != CONSTRUCTED)
+      return ASN1_BAD_ID;
+    if(tagnum != type->apptag)
+      return top ? KRB5_BADMSGTYPE : ASN1_BAD_ID;
+  }
+
+  if(type->flags & ASN1_TAB_SEQOF)
+    return decode_array(buf,type,(void***)val);
+
+  retval = asn1_get_sequence(buf,&length,&seqindef);
+  if(retval) return retval;
+  retval = asn1buf_imbed(&subbuf,buf,length,seqindef);
+  if(retval) return retval;
+  class = CONTEXT_SPECIFIC;
+  construction = CONSTRUCTED;
+  retval = asn1_get_tag_indef(&subbuf,&class,&construction,
+			      &tagnum,&taglen,&indef);
+  if(retval) return retval;
+
+  for(f = type->fields; f < type->fields + type->nfields; f++){
+    if((class != CONTEXT_SPECIFIC || construction != CONSTRUCTED)
+       && (tagnum || taglen || class != UNIVERSAL))
+      return ASN1_BAD_ID;
+    if(tagnum != f->tag || class != CONTEXT_SPECIFIC){
+      if(!(f->flags & ASN1_TAB_OPTIONAL))
+	return tagnum < f->tag ? ASN1_MISPLACED_FIELD : ASN1_MISSING_FIELD;
+      absent_field(f,val);
+      continue;
+    }
+    retval = decode_field(&subbuf,f,val);
+    if(retval) return retval;
+    if(!taglen && indef){
+      retval = asn1_get_tag_indef(&subbuf,&class,&construction,
+				  &tagnum,&taglen,&indef);
+      if(retval) return retval;
+      if(class != UNIVERSAL || tagnum || indef)
+	return ASN1_MISSING_EOC;
+    }
+    retval = asn1_get_tag_indef(&subbuf,&class,&construction,
+				&tagnum,&taglen,&indef);
+    if(retval) return retval;
+  }
+
+  retval = asn1buf_sync(buf,&subbuf,class,tagnum,length,indef,seqindef);
+  if(retval) return retval;
+  if(type->magic)
+    *(krb5_magic*)val = type->magic;
+
+  if(!applen){
+    retval = asn1_get_tag(buf,&class,&construction,&tagnum,NULL);
+    if(retval) return retval;
+  }
+  return 0;
+}
+
+asn1_error_code asn1_tab_decode(buf, type, val)
+     asn1buf * buf;
+     const asn1_type * type;
+     void * val;
+{
+  return decode_type(buf,type,val,0);
+}
+
+/**************** freeing ****************/
+
+static void free_field(f, val)
+     const asn1_field * f;
+     void * val;
+{
+  char *p = member(val,f);
+
+  switch(f->kind){
+  case ASN1_TAB_OCTETS:
+  case ASN1_TAB_GENSTRING:
+    if(ptr_at(p) != NULL) free(ptr_at(p));
+    ptr_at(p) = NULL;
+    break;
+  case ASN1_TAB_REALM:
+  case ASN1_TAB_NAME:
+    /* the first of the pair frees the principal */
+    if(ptr_at(p) != NULL) krb5_free_principal(NULL,(krb5_principal)ptr_at(p));
+    ptr_at(p) = NULL;
+    break;
+  case ASN1_TAB_STRUCT:
+    asn1_tab_free(f->type,p);
+    break;
+  case ASN1_TAB_POINTER:
+    if(ptr_at(p) != NULL){
+      asn1_tab_free(f->type,ptr_at(p));
+      free(ptr_at(p));
+    }
+    ptr_at(p) = NULL;
+    break;
+  case ASN1_TAB_ARRAY:
+    asn1_tab_free(f->type,p);
+    break;
+  }
+}
+
+void asn1_tab_free(type, val)
+     const asn1_type * type;
+     void * val;
+{
+  const asn1_field *f;
+  void **array;
+  int i;
+
+  if(type->flags & ASN1_TAB_SEQOF){
+    array = *(void***)val;
+    if(array == NULL) return;
+    for(i=0; array[i] != NULL; i++){
+      asn1_tab_free(type->elem,array[i]);
+      free(array[i]);
+    }
+    free(array);
+    *(void***)val = NULL;
+    return;
+  }
+  for(f = type->fields; f < type->fields + type->nfields; f++)
+    free_field(f,val);
+}
+
+krb5_error_code asn1_tab_decode_pdu(code, type, rep)
+     const krb5_data * code;
+     const asn1_type * type;
+     void * rep;
+{
+  asn1_error_code retval;
+  asn1buf buf;
+  void *val;
+
+  retval = asn1buf_wrap_data(&buf,code);
+  if(retval) return retval;
+
+  if(type->flags & ASN1_TAB_SEQOF){
+    retval = decode_type(&buf,type,rep,1);
+    if(retval) asn1_tab_free(type,rep);
+    return retval;
+  }
+
+  *(void**)rep = NULL;
+  val = calloc(1,type->size);
+  if(val == NULL) return ENOMEM;
+  retval = decode_type(&buf,type,val,1);
+  if(retval){
+    asn1_tab_free(type,val);
+    free(val);
+    return retval;
+  }
+  *(void**)rep = val;
+  return 0;
+}
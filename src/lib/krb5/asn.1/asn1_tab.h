@@ -0,0 +1,150 @@
+/*
+ * src/lib/krb5/asn.1/asn1_tab.h
+ *
+ * Copyright 1994 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ */
+
+#ifndef __ASN1_TAB_H__
+#define __ASN1_TAB_H__
+
+#include "k5-int.h"
+#include <stdio.h>
+#include "asn1buf.h"
+
+/*
+   Overview
+
+     Table-driven encoding and decoding of Kerberos structures.
+
+     Each ASN.1 type is described by an asn1_type: its application tag,
+     the C structure it is stored in, and one asn1_field for each of
+     its components, in tag order.  The tables themselves are generated
+     at build time by mktables.awk, from the ASN.1 module KRB5-asn.py
+     and the C bindings in krb5_types.map, into asn1_tables.c and
+     asn1_tables.h.
+
+     One interpreter then encodes, decodes and frees every tabled type.
+     Run over a buffer from asn1buf_measure, asn1_tab_encode computes
+     the length of an encoding without producing it.
+
+   Operations
+
+    asn1_tab_encode
+    asn1_tab_decode
+    asn1_tab_free
+    asn1_tab_decode_pdu
+*/
+
+/* field kinds */
+#define ASN1_TAB_INT32		1	/* INTEGER, krb5_int32 */
+#define ASN1_TAB_UINT		2	/* INTEGER, krb5_kvno */
+#define ASN1_TAB_UI4		3	/* INTEGER, krb5_ui_4, unsigned */
+#define ASN1_TAB_OCTET		4	/* INTEGER, krb5_octet */
+#define ASN1_TAB_TIME		5	/* KerberosTime, krb5_timestamp */
+#define ASN1_TAB_FLAGS		6	/* BIT STRING, krb5_flags */
+#define ASN1_TAB_OCTETS		7	/* OCTET STRING, length at aux */
+#define ASN1_TAB_GENSTRING	8	/* GeneralString, length at aux */
+#define ASN1_TAB_REALM		9	/* Realm, of a krb5_principal */
+#define ASN1_TAB_NAME		10	/* PrincipalName, of a krb5_principal */
+#define ASN1_TAB_PVNO		11	/* INTEGER, always aux */
+#define ASN1_TAB_MSGTYPE	12	/* INTEGER, always aux */
+#define ASN1_TAB_STRUCT		13	/* type, stored in place */
+#define ASN1_TAB_POINTER	14	/* type, stored through a pointer */
+#define ASN1_TAB_ARRAY		15	/* SEQUENCE OF type, NULL-terminated
+					   array of pointers */
+
+/* field flags */
+#define ASN1_TAB_OPTIONAL	0x01	/* absent when zero, NULL or empty */
+#define ASN1_TAB_DEFAULT	0x02	/* when absent, decodes as the
+					   krb5_timestamp at aux */
+#define ASN1_TAB_NEGLEN		0x04	/* absent when its length is negative,
+					   and decodes with length -1 */
+#define ASN1_TAB_IF		0x08	/* present when the krb5_int32 at
+					   aux is nonzero */
+
+/* type flags */
+#define ASN1_TAB_SEQOF		0x01	/* SEQUENCE OF elem */
+#define ASN1_TAB_NONEMPTY	0x02	/* and must have an element */
+
+typedef struct asn1_type_rep asn1_type;
+
+typedef struct asn1_field_rep {
+  unsigned char kind;
+  unsigned char flags;
+  unsigned char tag;		/* context-specific tag number */
+  unsigned int offset;		/* of the member in the structure */
+  int aux;			/* see the kinds and flags */
+  const asn1_type *type;	/* for STRUCT, POINTER and ARRAY */
+} asn1_field;
+
+struct asn1_type_rep {
+  const char *name;		/* the ASN.1 name, for debugging */
+  int apptag;			/* APPLICATION tag number, or -1 */
+  int flags;
+  krb5_magic magic;		/* stored in the structure, or 0 */
+  unsigned int size;		/* of the structure */
+  int nfields;
+  const asn1_field *fields;
+  const asn1_type *elem;	/* for SEQUENCE OF */
+};
+
+asn1_error_code asn1_tab_encode
+	PROTOTYPE((asn1buf *buf, const asn1_type *type, const void *val,
+		   int *retlen));
+/* requires  *buf is allocated
+   effects   Inserts the encoding of val, a structure of the given type
+              (the array itself, for a SEQUENCE OF type) into *buf and
+	      returns the length of this encoding in *retlen.
+	     Returns ASN1_MISSING_FIELD if val is NULL or a required
+	      field is empty in it.
+	     Returns ENOMEM if memory runs out. */
+
+asn1_error_code asn1_tab_decode
+	PROTOTYPE((asn1buf *buf, const asn1_type *type, void *val));
+/* requires  *buf is allocated, val points to a structure of the given
+              type (a pointer to an array, for a SEQUENCE OF type)
+   modifies  *buf, *val
+   effects   Decodes the encoding in *buf into *val, allocating storage
+              for what it points to with asn1buf_alloc.
+	     On error, what has been decoded so far is left in *val, and
+	      can be released with asn1_tab_free.
+	     Returns ASN1_BAD_ID if the encoding is not of the type.
+	     Returns ENOMEM if memory runs out. */
+
+void asn1_tab_free
+	PROTOTYPE((const asn1_type *type, void *val));
+/* requires  val is as for asn1_tab_decode, and was not decoded into
+              an arena
+   effects   Frees the storage *val points to, but not val itself. */
+
+krb5_error_code asn1_tab_decode_pdu
+	PROTOTYPE((const krb5_data *code, const asn1_type *type, void *rep));
+/* requires  rep points to a pointer to a structure of the given type
+              (to a pointer to an array, for a SEQUENCE OF type)
+   modifies  *rep
+   effects   Decodes code into a newly allocated structure and returns
+              it in *rep.
+	     Returns KRB5_BADMSGTYPE if code has the wrong application tag.
+	     On error, everything allocated is freed. */
+
+#endif
@@ -5,19 +5,12 @@
 
     Encoding mode
 
-    The encoding buffer is filled from bottom (lowest address) to top
-    (highest address).  This makes it easier to expand the buffer,
-    since realloc preserves the existing portion of the buffer.
-
-    Note: Since ASN.1 encoding must be done in reverse, this means
-    that you can't simply memcpy out the buffer data, since it will be
-    backwards.  You need to reverse-iterate through it, instead.
-
-    ***This decision may have been a mistake.  In practice, the
-    implementation will probably be tuned such that reallocation is
-    rarely necessary.  Also, the realloc probably has recopy the
-    buffer itself, so we don't really gain that much by avoiding an
-    explicit copy of the buffer.  --Keep this in mind for future reference.
+    The encoding buffer is filled from top (highest address) to bottom
+    (lowest address), since ASN.1 encoding must be done in reverse.
+    The array is never grown; callers first encode into a buffer with
+    no array, which only counts octets, and then into an array of the
+    exact length counted, so that the finished encoding is in order
+    and starts at the bottom of the array.
 
 
     Decoding mode
@@ -28,25 +21,16 @@
 
 /* Abstraction Function
 
-   Programs should use just pointers to asn1buf's (e.g. asn1buf *mybuf).
-   These pointers must always point to a valid, allocated asn1buf
-   structure or be NULL.
-
-   The contents of the asn1buf represent an octet string.  This string
-   begins at base and continues to the octet immediately preceding next.
-   If next == base or mybuf == NULL, then the asn1buf represents an empty
-   octet string. */
+   The contents of an encoding asn1buf represent an octet string.  This
+   string begins at next and continues to bound, and is length octets
+   long.  If base is NULL, only length is kept. */
 
 /* Representation Invariant
 
-   Pointers to asn1buf's must always point to a valid, allocated
-   asn1buf structure or be NULL.
-
-   base points to a valid, allocated octet array or is NULL
-   next >= base
-   next <= bound+2  (i.e. next should be able to step just past the bound,
-                     but no further.  (The bound should move out in response
-		     to being crossed by next.)) */
+   base points to a valid octet array or is NULL
+   If base is not NULL:
+     base <= next <= bound+1
+     length == bound+1 - next */
 
 #define ASN1BUF_OMIT_INLINE_FUNCS
 #include "asn1buf.h"
@@ -57,15 +41,28 @@
 #define asn1_is_eoc(class, num, indef)	\
 ((class) == UNIVERSAL && !(num) && !(indef))
 
-asn1_error_code asn1buf_create(buf)
-     asn1buf ** buf;
+void asn1buf_measure(buf)
+     asn1buf * buf;
 {
-  *buf = (asn1buf*)malloc(sizeof(asn1buf));
-  if (*buf == NULL) return ENOMEM;
-  (*buf)->base = NULL;
-  (*buf)->bound = NULL;
-  (*buf)->next = NULL;
-  return 0;
+  buf->base = buf->bound = buf->next = NULL;
+  buf->length = 0;
+}
+
+void asn1buf_wrap_output(buf, code)
+     asn1buf * buf;
+     krb5_data * code;
+{
+  buf->base = code->data;
+  buf->bound = code->data + code->length - 1;
+  buf->next = code->data + code->length;
+  buf->length = 0;
+}
+
+#undef asn1buf_measuring
+int asn1buf_measuring(buf)
+     const asn1buf * buf;
+{
+  return buf->base == NULL;
 }
 
 asn1_error_code asn1buf_wrap_data(buf, code)
@@ -75,6 +72,7 @@ asn1_error_code asn1buf_wrap_data(buf, code)
   if(code == NULL || code->data == NULL) return ASN1_MISSING_FIELD;
   buf->next = buf->base = code->data;
   buf->bound = code->data + code->length - 1;
+  buf->arena = NULL;
   return 0;
 }
 
@@ -85,10 +83,11 @@ asn1_error_code asn1buf_imbed(subbuf, buf, length, indef)
      const int indef;
 {
   subbuf->base = subbuf->next = buf->next;
+  subbuf->arena = buf->arena;
   if (!indef) {
-      subbuf->bound = subbuf->base + length - 1;
-      if (subbuf->bound > buf->bound)
+      if (length < 0 || length > buf->bound - buf->next + 1)
 	  return ASN1_OVERRUN;
+      subbuf->bound = subbuf->base + length - 1;
   } else /* constructed indefinite */
       subbuf->bound = buf->bound;
   return 0;
@@ -134,7 +133,7 @@ asn1_error_code asn1buf_skiptail(buf, length, indef)
 
   nestlevel = 1 + indef;
   if (!indef) {
-    if (length <= buf->bound - buf->next + 1)
+    if (length >= 0 && length <= buf->bound - buf->next + 1)
       buf->next += length;
     else
       return ASN1_OVERRUN;
@@ -143,8 +142,10 @@ asn1_error_code asn1buf_skiptail(buf, length, indef)
     retval = asn1_get_tag_indef(buf, &class, &construction, &tagnum,
 				&taglen, &tagindef);
     if (retval) return retval;
+    if (tagnum == ASN1_TAGNUM_CEILING)
+      return ASN1_MISSING_EOC;	/* ran out before the end-of-contents */
     if (!tagindef) {
-      if (taglen <= buf->bound - buf->next + 1)
+      if (taglen >= 0 && taglen <= buf->bound - buf->next + 1)
 	buf->next += taglen;
       else
 	return ASN1_OVERRUN;
@@ -157,13 +158,40 @@ asn1_error_code asn1buf_skiptail(buf, length, indef)
   return 0;
 }
 
-asn1_error_code asn1buf_destroy(buf)
-     asn1buf ** buf;
+asn1_error_code asn1buf_skip_value(buf, length, indef)
+     asn1buf *buf;
+     const int length;
+     const int indef;
 {
-  if (*buf != NULL) {
-    if ((*buf)->base != NULL) free((*buf)->base);
-    free(*buf);
-    *buf = NULL;
+  asn1_error_code retval;
+  asn1_class class;
+  asn1_construction construction;
+  asn1_tagnum tagnum;
+  int taglen;
+  int nestlevel;
+  int tagindef;
+
+  if (!indef) {
+    if (length < 0 || length > buf->bound - buf->next + 1)
+      return ASN1_OVERRUN;
+    buf->next += length;
+    return 0;
+  }
+  nestlevel = 1;
+  while (nestlevel > 0) {
+    retval = asn1_get_tag_indef(buf, &class, &construction, &tagnum,
+				&taglen, &tagindef);
+    if (retval) return retval;
+    if (tagnum == ASN1_TAGNUM_CEILING)
+      return ASN1_MISSING_EOC;
+    if (tagindef)
+      nestlevel++;
+    else if (asn1_is_eoc(class, tagnum, tagindef))
+      nestlevel--;
+    else if (taglen >= 0 && taglen <= buf->bound - buf->next + 1)
+      buf->next += taglen;
+    else
+      return ASN1_OVERRUN;
   }
   return 0;
 }
@@ -175,12 +203,11 @@ asn1_error_code asn1buf_insert_octet(buf, o)
      asn1buf * buf;
      const int o;
 {
-  asn1_error_code retval;
-
-  retval = asn1buf_ensure_space(buf,1);
-  if(retval) return retval;
-  *(buf->next) = (char)o;
-  (buf->next)++;
+  if(buf->base != NULL){
+    if(buf->next <= buf->base) return ASN1_OVERFLOW;
+    *(--(buf->next)) = (char)o;
+  }
+  (buf->length)++;
   return 0;
 }
 
@@ -189,13 +216,12 @@ asn1_error_code asn1buf_insert_octetstring(buf, len, s)
      const int len;
      const krb5_octet * s;
 {
-  asn1_error_code retval;
-  int length;
-
-  retval = asn1buf_ensure_space(buf,len);
-  if(retval) return retval;
-  for(length=1; length<=len; length++,(buf->next)++)
-    *(buf->next) = (char)(s[len-length]);
+  if(buf->base != NULL){
+    if(buf->next - buf->base < len) return ASN1_OVERFLOW;
+    buf->next -= len;
+    memcpy(buf->next, s, len);
+  }
+  buf->length += len;
   return 0;
 }
 
@@ -204,16 +230,135 @@ asn1_error_code asn1buf_insert_charstring(buf, len, s)
      const int len;
      const char * s;
 {
-  asn1_error_code retval;
-  int length;
+  if(buf->base != NULL){
+    if(buf->next - buf->base < len) return ASN1_OVERFLOW;
+    buf->next -= len;
+    memcpy(buf->next, s, len);
+  }
+  buf->length += len;
+  return 0;
+}
+
+/* Arenas
+
+   An arena is a chain of blocks, each starting with a struct
+   asn1_arena_rep.  The first block's header describes the free space
+   in the newest block, and holds the chain of later blocks; the first
+   storage handed out follows it directly, which is how asn1_arena_free
+   finds it.  Storage is never returned to an arena, except that the
+   most recent allocation can be grown in place. */
+
+struct asn1_arena_rep {
+  asn1_arena *more;		/* later blocks, newest first */
+  char *next, *bound;		/* free space in the newest block */
+  char *last;			/* most recent allocation */
+};
+
+typedef union {
+  struct asn1_arena_rep arena;
+  double d;
+  long l;
+  void *p;
+} asn1_arena_header;
+
+#define ARENA_ALIGN(n) \
+  (((n) + sizeof(double) - 1) & ~(unsigned int)(sizeof(double) - 1))
+#define ARENA_MINBLOCK 1024
+
+static asn1_arena *asn1_arena_block(size)
+     unsigned int size;
+{
+  asn1_arena *a;
+
+  a = (asn1_arena*)malloc(sizeof(asn1_arena_header) + size);
+  if (a == NULL) return NULL;
+  a->more = NULL;
+  a->next = (char*)a + sizeof(asn1_arena_header);
+  a->bound = a->next + size;
+  a->last = NULL;
+  return a;
+}
 
-  retval = asn1buf_ensure_space(buf,len);
-  if(retval) return retval;
-  for(length=1; length<=len; length++,(buf->next)++)
-    *(buf->next) = (char)(s[len-length]);
+static void *asn1_arena_alloc(a, size)
+     asn1_arena * a;
+     unsigned int size;
+{
+  asn1_arena *block;
+  char *p;
+
+  size = ARENA_ALIGN(size);
+  if (a->bound - a->next < size) {
+    block = asn1_arena_block(size > ARENA_MINBLOCK ? size : ARENA_MINBLOCK);
+    if (block == NULL) return NULL;
+    block->more = a->more;
+    a->more = block;
+    a->next = block->next;
+    a->bound = block->bound;
+  }
+  p = a->next;
+  a->next += size;
+  a->last = p;
+  memset(p, 0, size);
+  return p;
+}
+
+asn1_error_code asn1buf_borrow(buf, size)
+     asn1buf * buf;
+     const unsigned int size;
+{
+  buf->arena = asn1_arena_block(ARENA_ALIGN(size > ARENA_MINBLOCK ?
+					    size : ARENA_MINBLOCK));
+  if (buf->arena == NULL) return ENOMEM;
   return 0;
 }
 
+void *asn1buf_alloc(buf, size)
+     asn1buf * buf;
+     const unsigned int size;
+{
+  if (buf->arena == NULL)
+    return calloc(1, size);
+  return asn1_arena_alloc(buf->arena, size);
+}
+
+void *asn1buf_realloc(buf, ptr, oldsize, size)
+     asn1buf * buf;
+     void * ptr;
+     const unsigned int oldsize;
+     const unsigned int size;
+{
+  asn1_arena *a = buf->arena;
+  void *p;
+
+  if (a == NULL)
+    return ptr == NULL ? malloc(size) : realloc(ptr, size);
+
+  /* grow the most recent allocation where it is, if there's room */
+  if (ptr != NULL && (char*)ptr == a->last &&
+      a->bound - a->last >= ARENA_ALIGN(size)) {
+    a->next = a->last + ARENA_ALIGN(size);
+    return ptr;
+  }
+  p = asn1_arena_alloc(a, size);
+  if (p != NULL && ptr != NULL)
+    memcpy(p, ptr, oldsize < size ? oldsize : size);
+  return p;
+}
+
+void asn1_arena_free(first)
+     void * first;
+{
+  asn1_arena *head, *a, *next;
+
+  if (first == NULL) return;
+  head = (asn1_arena*)((char*)first - sizeof(asn1_arena_header));
+  for (a = head->more; a != NULL; a = next) {
+    next = a->more;
+    free(a);
+  }
+  free(head);
+}
+
 #undef asn1buf_remove_octet
 asn1_error_code asn1buf_remove_octet(buf, o)
      asn1buf * buf;
@@ -231,11 +376,16 @@ asn1_error_code asn1buf_remove_octetstring(buf, len, s)
 {
   int i;
 
-  if(buf->next + len - 1 > buf->bound) return ASN1_OVERRUN;
+  if (len < 0 || len > buf->bound - buf->next + 1) return ASN1_OVERRUN;
   if (len == 0) {
       *s = 0;
       return 0;
   }
+  if (buf->arena != NULL) {
+      *s = (asn1_octet*)buf->next;
+      buf->next += len;
+      return 0;
+  }
   *s = (asn1_octet*)malloc(len*sizeof(asn1_octet));
   if (*s == NULL)
       return ENOMEM;
@@ -252,11 +402,16 @@ asn1_error_code asn1buf_remove_charstring(buf, len, s)
 {
   int i;
 
-  if (buf->next + len - 1 > buf->bound) return ASN1_OVERRUN;
+  if (len < 0 || len > buf->bound - buf->next + 1) return ASN1_OVERRUN;
   if (len == 0) {
       *s = 0;
       return 0;
   }
+  if (buf->arena != NULL) {
+      *s = buf->next;
+      buf->next += len;
+      return 0;
+  }
   *s = (char*)malloc(len*sizeof(char));
   if (*s == NULL) return ENOMEM;
   for(i=0; i<len; i++)
@@ -265,6 +420,17 @@ asn1_error_code asn1buf_remove_charstring(buf, len, s)
   return 0;
 }
 
+asn1_error_code asn1buf_remove_pointer(buf, len, s)
+     asn1buf * buf;
+     const int len;
+     char ** s;
+{
+  if (len < 0 || len > buf->bound - buf->next + 1) return ASN1_OVERRUN;
+  *s = buf->next;
+  buf->next += len;
+  return 0;
+}
+
 int asn1buf_remains(buf, indef)
     asn1buf *buf;
     int indef;
@@ -281,30 +447,6 @@ int asn1buf_remains(buf, indef)
   else return remain;
 }
 
-asn1_error_code asn12krb5_buf(buf, code)
-     const asn1buf * buf;
-     krb5_data ** code;
-{
-  int i;
-  *code = (krb5_data*)calloc(1,sizeof(krb5_data));
-  if(*code == NULL) return ENOMEM;
-  (*code)->magic = KV5M_DATA;
-  (*code)->data = NULL;
-  (*code)->length = 0;
-  (*code)->length = asn1buf_len(buf);
-  (*code)->data = (char*)malloc((((*code)->length)+1)*sizeof(char));
-  if ((*code)->data == NULL) {
-    free(*code);
-    return ENOMEM;
-  }
-  for(i=0; i < (*code)->length; i++)
-    ((*code)->data)[i] = (buf->base)[((*code)->length)-i-1];
-  ((*code)->data)[(*code)->length] = '\0';
-  return 0;
-}
-
-
-
 /* These parse and unparse procedures should be moved out. They're
    useful only for debugging and superfluous in the production version. */
 
@@ -328,8 +470,8 @@ asn1_error_code asn1buf_unparse(buf, s)
     *s = calloc(length+1, sizeof(char));
     if(*s == NULL) return ENOMEM;
     (*s)[length] = '\0';
-    for(i=0; i<length; i++) ;
-/*      OLDDECLARG( (*s)[i] = , (buf->base)[length-i-1]) */
+    for(i=0; i<length; i++)
+      (*s)[i] = (buf->next)[i];
   }
   return 0;
 }
@@ -358,10 +500,10 @@ asn1_error_code asn1buf_hex_unparse(buf, s)
 
     *s = malloc(3*length);
     if(*s == NULL) return ENOMEM;
-    for(i = length-1; i >= 0; i--){
-      (*s)[3*(length-i-1)] = hexchar(((buf->base)[i]&0xF0)>>4);
-      (*s)[3*(length-i-1)+1] = hexchar((buf->base)[i]&0x0F);
-      (*s)[3*(length-i-1)+2] = ' ';
+    for(i=0; i<length; i++){
+      (*s)[3*i] = hexchar(((buf->next)[i]&0xF0)>>4);
+      (*s)[3*i+1] = hexchar((buf->next)[i]&0x0F);
+      (*s)[3*i+2] = ' ';
     }
     (*s)[3*length-1] = '\0';
   }
@@ -371,62 +513,9 @@ asn1_error_code asn1buf_hex_unparse(buf, s)
 /****************************************************************/
 /* Private Procedures */
 
-#undef asn1buf_size
-int asn1buf_size(buf)
-     const asn1buf * buf;
-{
-  if(buf == NULL || buf->base == NULL) return 0;
-  return buf->bound - buf->base + 1;
-}
-
-#undef asn1buf_free
-int asn1buf_free(buf)
-     const asn1buf * buf;
-{
-  if(buf == NULL || buf->base == NULL) return 0;
-  else return buf->bound - buf->next + 1;
-}
-
-#undef asn1buf_ensure_space
-asn1_error_code asn1buf_ensure_space(buf, amount)
-     asn1buf * buf;
-     const int amount;
-{
-  int avail = asn1buf_free(buf);
-  if(avail < amount){
-    asn1_error_code retval = asn1buf_expand(buf, amount-avail);
-    if(retval) return retval;
-  }
-  return 0;
-}
-
-asn1_error_code asn1buf_expand(buf, inc)
-     asn1buf * buf;
-     int inc;
-{
-#define STANDARD_INCREMENT 200
-  int next_offset = buf->next - buf->base;
-  int bound_offset;
-  if(buf->base == NULL) bound_offset = -1;
-  else bound_offset = buf->bound - buf->base;
-
-  if (inc < STANDARD_INCREMENT)
-    inc = STANDARD_INCREMENT;
-
-  if (buf->base == NULL)
-    buf->base = malloc((asn1buf_size(buf)+inc) * sizeof(asn1_octet));
-  else
-    buf->base = realloc(buf->base,
-			(asn1buf_size(buf)+inc) * sizeof(asn1_octet));
-  if(buf->base == NULL) return ENOMEM;
-  buf->bound = (buf->base) + bound_offset + inc;
-  buf->next = (buf->base) + next_offset;
-  return 0;
-}
-
 #undef asn1buf_len
 int asn1buf_len(buf)
      const asn1buf * buf;
 {
-  return buf->next - buf->base;
+  return buf->length;
 }
@@ -5,58 +5,22 @@
 #include "k5-int.h"
 #include "krbasn1.h"
 
+typedef struct asn1_arena_rep asn1_arena;
+
 typedef struct code_buffer_rep {
   char *base, *bound, *next;
+  int length;
+  asn1_arena *arena;
 } asn1buf;
 
 
 /**************** Private Procedures ****************/
 
-int asn1buf_size
-	PROTOTYPE((const asn1buf *buf));
-/* requires  *buf has been created and not destroyed
-   effects   Returns the total size 
-	PROTOTYPE((in octets) of buf's octet buffer. */
-#define asn1buf_size(buf) \
-  (((buf) == NULL || (buf)->base == NULL) \
-   ? 0 \
-   : ((buf)->bound - (buf)->base + 1))
-
-int asn1buf_free
-	PROTOTYPE((const asn1buf *buf));
-/* requires  *buf is allocated
-   effects   Returns the number of unused, allocated octets in *buf. */
-#define asn1buf_free(buf) \
-  (((buf) == NULL || (buf)->base == NULL) \
-   ? 0 \
-   : ((buf)->bound - (buf)->next + 1))
-
-
-asn1_error_code asn1buf_ensure_space
-	PROTOTYPE((asn1buf *buf, const int amount));
-/* requires  *buf is allocated
-   modifies  *buf
-   effects  If buf has less than amount octets of free space, then it is
-            expanded to have at least amount octets of free space.
-            Returns ENOMEM memory is exhausted. */
-#define asn1buf_ensure_space(buf,amount) \
-  ((asn1buf_free(buf) < (amount)) \
-   ? (asn1buf_expand((buf), (amount)-asn1buf_free(buf))) \
-   : 0)
-
-
-asn1_error_code asn1buf_expand
-	PROTOTYPE((asn1buf *buf, int inc));
-/* requires  *buf is allocated
-   modifies  *buf
-   effects   Expands *buf by allocating space for inc more octets.
-             Returns ENOMEM if memory is exhausted. */
-
 int asn1buf_len
 	PROTOTYPE((const asn1buf *buf));
-/* requires  *buf is allocated
+/* requires  *buf is an encoding buffer
    effects   Returns the length of the encoding in *buf. */
-#define asn1buf_len(buf)	((buf)->next - (buf)->base)
+#define asn1buf_len(buf)	((buf)->length)
 
 /****** End of private procedures *****/
 	
@@ -65,42 +29,69 @@ int asn1buf_len
     
     The coding buffer is an array of char (to match a krb5_data structure)
      with 3 reference pointers:
-     1) base - The bottom of the octet array.  Used for memory management
-               operations on the array (e.g. alloc, realloc, free).
-     2) next - Points to the next available octet position in the array.
-               During encoding, this is the next free position, and it
-                 advances as octets are added to the array.
+     1) base - The bottom of the octet array.
+     2) next - During encoding, this is the first octet of the encoding
+                 so far.  The encoding is built from the top of the
+                 array downward, since ASN.1 encoding must be done in
+                 reverse, so next moves down as octets are added.
 	       During decoding, this is the next unread position, and it
                  advances as octets are read from the array.
      3) bound - Points to the top of the array. Used for bounds-checking.
-    
-    All pointers to encoding buffers should be initalized to NULL.
+
+    A decoding buffer may have an arena.  Decoders then take storage for
+    the structures they build from the arena, and strings point into
+    the buffer being decoded rather than being copied.  Everything
+    decoded is released at once with asn1_arena_free.
+
+    An encoding buffer also keeps the length of the encoding so far.
+    An encoding buffer with no array only counts the octets added to it;
+    encoders are run once over such a buffer to find the exact length of
+    an encoding, and then again over an array of exactly that length,
+    which leaves the encoding in order at the bottom of the array.
     
   Operations
 
-    asn1buf_create
+    asn1buf_measure
+    asn1buf_wrap_output
+    (asn1buf_measuring)
     asn1buf_wrap_data
-    asn1buf_destroy
+    asn1buf_borrow
+    asn1buf_alloc
+    asn1buf_realloc
+    asn1_arena_free
     asn1buf_insert_octet
     asn1buf_insert_charstring
     asn1buf_remove_octet
     asn1buf_remove_charstring
+    asn1buf_remove_pointer
+    asn1buf_skip_value
     asn1buf_unparse
     asn1buf_hex_unparse
-    asn12krb5_buf
     asn1buf_remains
 
-    (asn1buf_size)
-    (asn1buf_free)
-    (asn1buf_ensure_space)
-    (asn1buf_expand)
     (asn1buf_len)
 */
 
-asn1_error_code asn1buf_create
-	PROTOTYPE((asn1buf **buf));
-/* effects   Creates a new encoding buffer pointed to by *buf.
-             Returns ENOMEM if the buffer can't be created. */
+void asn1buf_measure
+	PROTOTYPE((asn1buf *buf));
+/* modifies  *buf
+   effects   Turns *buf into an encoding buffer which stores nothing,
+              and only counts the octets inserted into it. */
+
+void asn1buf_wrap_output
+	PROTOTYPE((asn1buf *buf, krb5_data *code));
+/* requires  code->data points to at least code->length octets
+   modifies  *buf
+   effects   Turns *buf into an encoding buffer whose array is the first
+              code->length octets of code->data.  An encoding of exactly
+	      code->length octets fills it from the start. */
+
+int asn1buf_measuring
+	PROTOTYPE((const asn1buf *buf));
+/* requires  *buf is an encoding buffer
+   effects   Returns non-zero if *buf only counts octets, in which case
+              encoders need not compute the octets they insert. */
+#define asn1buf_measuring(buf)	((buf)->base == NULL)
 
 asn1_error_code asn1buf_wrap_data
 	PROTOTYPE((asn1buf *buf, const krb5_data *code));
@@ -110,6 +101,40 @@ asn1_error_code asn1buf_wrap_data
 	      is the top of *code.
 	     Returns ASN1_MISSING_FIELD if code is empty. */
 
+asn1_error_code asn1buf_borrow
+	PROTOTYPE((asn1buf *buf, const unsigned int size));
+/* requires  *buf is a decoding buffer made by asn1buf_wrap_data
+   modifies  *buf
+   effects   Gives *buf a new arena, with room for about size octets
+              before it needs more memory.  Strings decoded from *buf
+	      (and its sub-buffers) will point into its octets, and
+	      asn1buf_alloc and asn1buf_realloc will take storage from
+	      the arena.  The first storage taken from the arena
+	      identifies it to asn1_arena_free.
+	     Returns ENOMEM if the arena can't be created. */
+
+void *asn1buf_alloc
+	PROTOTYPE((asn1buf *buf, const unsigned int size));
+/* requires  *buf is a decoding buffer
+   effects   Returns size zeroed octets of storage, from *buf's arena if
+              it has one and from calloc otherwise, or NULL if memory
+	      is exhausted. */
+
+void *asn1buf_realloc
+	PROTOTYPE((asn1buf *buf, void *ptr, const unsigned int oldsize,
+		   const unsigned int size));
+/* requires  ptr is NULL or was returned by asn1buf_alloc or
+              asn1buf_realloc on *buf (or a buffer sharing its arena)
+	      with length oldsize
+   effects   Returns storage of length size holding the first oldsize
+              octets of ptr, as realloc does, or NULL if memory is
+	      exhausted.  ptr may not be used afterward. */
+
+void asn1_arena_free
+	PROTOTYPE((void *first));
+/* requires  first is the first storage taken from an arena
+   effects   Frees everything taken from the arena, and the arena. */
+
 asn1_error_code asn1buf_imbed
 	PROTOTYPE((asn1buf *subbuf, const asn1buf *buf, const int length,
 		   const int indef));
@@ -136,45 +161,50 @@ asn1_error_code asn1buf_skiptail
              constructed indefinite sequence.
    effects   skips trailing fields. */
 
-asn1_error_code asn1buf_destroy
-	PROTOTYPE((asn1buf **buf));
-/* effects   Deallocates **buf, sets *buf to NULL. */
+asn1_error_code asn1buf_skip_value
+	PROTOTYPE((asn1buf *buf, const int length, const int indef));
+/* requires  The identifier and length octets of a value have just been
+             read from *buf; length and indef are as they returned.
+   effects   Skips the contents of the value, including its
+              end-of-contents octets if it is of indefinite length.
+	     Returns ASN1_OVERRUN or ASN1_MISSING_EOC if *buf ends
+	      first. */
 
 asn1_error_code asn1buf_insert_octet
 	PROTOTYPE((asn1buf *buf, const int o));
-/* requires  *buf is allocated
-   effects   Inserts o into the buffer *buf, expanding the buffer if
-             necessary.  Returns ENOMEM memory is exhausted. */
+/* requires  *buf is an encoding buffer
+   modifies  *buf
+   effects   Inserts o in front of the encoding in *buf.
+             Returns ASN1_OVERFLOW if *buf's array is full. */
 #if ((__GNUC__ >= 2) && !defined(ASN1BUF_OMIT_INLINE_FUNCS))
 extern __inline__ asn1_error_code asn1buf_insert_octet(buf, o)
      asn1buf * buf;
      const int o;
 {
-  asn1_error_code retval;
-
-  retval = asn1buf_ensure_space(buf,1);
-  if(retval) return retval;
-  *(buf->next) = (char)o;
-  (buf->next)++;
+  if(buf->base != NULL){
+    if(buf->next <= buf->base) return ASN1_OVERFLOW;
+    *(--(buf->next)) = (char)o;
+  }
+  (buf->length)++;
   return 0;
 }
 #endif
 
 asn1_error_code asn1buf_insert_octetstring
 	PROTOTYPE((asn1buf *buf, const int len, const asn1_octet *s));
-/* requires  *buf is allocated
+/* requires  *buf is an encoding buffer
    modifies  *buf
    effects   Inserts the contents of s (an octet array of length len)
-              into the buffer *buf, expanding the buffer if necessary.
-	     Returns ENOMEM if memory is exhausted. */
+              in front of the encoding in *buf.
+	     Returns ASN1_OVERFLOW if *buf's array is too small. */
 
 asn1_error_code asn1buf_insert_charstring
 	PROTOTYPE((asn1buf *buf, const int len, const char *s));
-/* requires  *buf is allocated
+/* requires  *buf is an encoding buffer
    modifies  *buf
    effects   Inserts the contents of s (a character array of length len)
-              into the buffer *buf, expanding the buffer if necessary.
-	     Returns ENOMEM if memory is exhausted. */
+              in front of the encoding in *buf.
+	     Returns ASN1_OVERFLOW if *buf's array is too small. */
 
 asn1_error_code asn1buf_remove_octet
 	PROTOTYPE((asn1buf *buf, asn1_octet *o));
@@ -190,7 +220,8 @@ asn1_error_code asn1buf_remove_octet
 asn1_error_code asn1buf_remove_octetstring
 	PROTOTYPE((asn1buf *buf, const int len, asn1_octet **s));
 /* requires  *buf is allocated
-   effects   Removes the next len octets of *buf and returns them in **s.
+   effects   Removes the next len octets of *buf and returns them in **s,
+              or a pointer to them in *buf if *buf has an arena.
 	     Returns ASN1_OVERRUN if there are fewer than len unread octets
 	      left in *buf.
 	     Returns ENOMEM if *s could not be allocated. */
@@ -199,11 +230,20 @@ asn1_error_code asn1buf_remove_charstring
 	PROTOTYPE((asn1buf *buf, const int len,
 					  char **s));
 /* requires  *buf is allocated
-   effects   Removes the next len octets of *buf and returns them in **s.
+   effects   Removes the next len octets of *buf and returns them in **s,
+              or a pointer to them in *buf if *buf has an arena.
 	     Returns ASN1_OVERRUN if there are fewer than len unread octets
 	      left in *buf.
 	     Returns ENOMEM if *s could not be allocated. */
 
+asn1_error_code asn1buf_remove_pointer
+	PROTOTYPE((asn1buf *buf, const int len, char **s));
+/* requires  *buf is allocated
+   effects   Removes the next len octets of *buf and returns a pointer
+              to them in *buf in *s, whether or not *buf has an arena.
+	     Returns ASN1_OVERRUN if there are fewer than len unread octets
+	      left in *buf. */
+
 asn1_error_code asn1buf_unparse
 	PROTOTYPE((const asn1buf *buf, char **s));
 /* modifies  *s
@@ -217,12 +257,6 @@ asn1_error_code asn1buf_hex_unparse
              where each octet in *buf is represented by a 2-digit
 	     hexadecimal number in *s. */
 
-asn1_error_code asn12krb5_buf
-	PROTOTYPE((const asn1buf *buf, krb5_data **code));
-/* modifies  *code
-   effects   Instantiates **code with the krb5_data representation of **buf. */
-
-
 int asn1buf_remains
 	PROTOTYPE((asn1buf *buf, int indef));
 /* requires  *buf is a buffer containing an asn.1 structure or array
@@ -30,6 +30,7 @@
 #include "krbasn1.h"
 #include "asn1buf.h"
 #include "asn1_make.h"
+#include "asn1_tables.h"
 
 /**************** Macros (these save a lot of typing) ****************/
 
@@ -37,8 +38,9 @@
 #if 0
    How to write a krb5 encoder function using these macros:
 
-   asn1_error_code encode_krb5_structure(const krb5_type *rep,
-                                         krb5_data **code)
+   static asn1_error_code encode_structure(asn1buf *buf,
+                                           const krb5_type *rep,
+                                           int *retlen)
    {
      krb5_setup();
 
@@ -72,241 +74,146 @@
 
      krb5_cleanup();
    }
+
+   krb5_encoders(structure, const krb5_type *)
 #endif
 
 /* setup() -- create and initialize bookkeeping variables
      retval: stores error codes returned from subroutines
-     buf: the coding buffer
      length: length of the most-recently produced encoding
      sum: cumulative length of the entire encoding */
 #define krb5_setup()\
   asn1_error_code retval;\
-  asn1buf *buf=NULL;\
   int length, sum=0;\
 \
-  if(rep == NULL) return ASN1_MISSING_FIELD;\
-\
-  retval = asn1buf_create(&buf);\
-  if(retval) return retval
+  if(rep == NULL) return ASN1_MISSING_FIELD
   
 /* krb5_addfield -- add a field, or component, to the encoding */
 #define krb5_addfield(value,tag,encoder)\
 { retval = encoder(buf,value,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length;\
   retval = asn1_make_etag(buf,CONTEXT_SPECIFIC,tag,length,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length; }
 
 /* krb5_addlenfield -- add a field whose length must be separately specified */
 #define krb5_addlenfield(len,value,tag,encoder)\
 { retval = encoder(buf,len,value,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length;\
   retval = asn1_make_etag(buf,CONTEXT_SPECIFIC,tag,length,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length; }
 
 /* form a sequence (by adding a sequence header to the current encoding) */
 #define krb5_makeseq()\
   retval = asn1_make_sequence(buf,sum,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length
 
 /* add an APPLICATION class tag to the current encoding */
 #define krb5_apptag(num)\
   retval = asn1_make_etag(buf,APPLICATION,num,sum,&length);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
+  if(retval) return retval;\
   sum += length
 
-/* produce the final output and clean up the workspace */
+/* return the length of the finished encoding */
 #define krb5_cleanup()\
-  retval = asn12krb5_buf(buf,code);\
-  if(retval){\
-    asn1buf_destroy(&buf);\
-    return retval; }\
-  retval = asn1buf_destroy(&buf);\
+  *retlen = sum;\
+  return 0
+
+/* krb5_encoders -- define the public encoders for a structure whose
+   encoding is produced by encode_name(buf,rep,retlen).
+
+   encode_krb5_name(rep, code) returns the encoding in a newly
+   allocated krb5_data.  encode_krb5_name_into(rep, code) writes it
+   into the caller's buffer code->data, of code->length octets, and
+   sets code->length to the length of the encoding; if the buffer is
+   too small (or code->data is NULL), it sets code->length to the
+   length needed and returns ASN1_OVERFLOW.
+
+   Both run the encoder once over a buffer which only counts octets,
+   and then again over storage of exactly the counted length, so the
+   encoding is written in place, in order, with no reallocation. */
+#define krb5_encoders(name,type)\
+krb5_error_code encode_krb5_##name(rep, code)\
+     type rep;\
+     krb5_data ** code;\
+{\
+  asn1_error_code retval;\
+  asn1buf buf;\
+  krb5_data *out;\
+  int length;\
+\
+  asn1buf_measure(&buf);\
+  retval = encode_##name(&buf,rep,&length);\
+  if(retval) return retval;\
+  out = (krb5_data*)malloc(sizeof(krb5_data));\
+  if(out == NULL) return ENOMEM;\
+  out->magic = KV5M_DATA;\
+  out->length = length;\
+  out->data = (char*)malloc(length+1);\
+  if(out->data == NULL){\
+    free(out);\
+    return ENOMEM; }\
+  asn1buf_wrap_output(&buf,out);\
+  retval = encode_##name(&buf,rep,&length);\
   if(retval){\
+    free(out->data);\
+    free(out);\
     return retval; }\
+  out->data[out->length] = '\0';\
+  *code = out;\
+  return 0;\
+}\
 \
-  return 0
-
-krb5_error_code encode_krb5_authenticator(rep, code)
-     const krb5_authenticator * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* authorization-data[8]	AuthorizationData OPTIONAL */
-  if(rep->authorization_data != NULL &&
-     rep->authorization_data[0] != NULL){
-    retval = asn1_encode_authorization_data(buf, (const krb5_authdata **)
-					    rep->authorization_data,
-					    &length);
-    if(retval){
-      asn1buf_destroy(&buf);
-      return retval; }
-    sum += length;
-    retval = asn1_make_etag(buf,CONTEXT_SPECIFIC,8,length,&length);
-    if(retval){
-      asn1buf_destroy(&buf);
-      return retval; }
-    sum += length;
-  }
-
-  /* seq-number[7]		INTEGER OPTIONAL */
-  if(rep->seq_number != 0)
-    krb5_addfield(rep->seq_number,7,asn1_encode_integer);
-
-  /* subkey[6]			EncryptionKey OPTIONAL */
-  if(rep->subkey != NULL)
-    krb5_addfield(rep->subkey,6,asn1_encode_encryption_key);
-
-  /* ctime[5]			KerberosTime */
-  krb5_addfield(rep->ctime,5,asn1_encode_kerberos_time);
-
-  /* cusec[4]			INTEGER */
-  krb5_addfield(rep->cusec,4,asn1_encode_integer);
-
-  /* cksum[3]			Checksum OPTIONAL */
-  if(rep->checksum != NULL)
-    krb5_addfield(rep->checksum,3,asn1_encode_checksum);
-
-  /* cname[2]			PrincipalName */
-  krb5_addfield(rep->client,2,asn1_encode_principal_name);
-
-  /* crealm[1]			Realm */
-  krb5_addfield(rep->client,1,asn1_encode_realm);
-
-  /* authenticator-vno[0]	INTEGER */
-  krb5_addfield(KVNO,0,asn1_encode_integer);
-
-  /* Authenticator ::= [APPLICATION 2] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(2);
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_ticket(rep, code)
-     const krb5_ticket * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* enc-part[3]	EncryptedData */
-  krb5_addfield(&(rep->enc_part),3,asn1_encode_encrypted_data);
-
-  /* sname [2]		PrincipalName */
-  krb5_addfield(rep->server,2,asn1_encode_principal_name);
-
-  /* realm [1]		Realm */
-  krb5_addfield(rep->server,1,asn1_encode_realm);
-
-  /* tkt-vno [0]	INTEGER */
-  krb5_addfield(KVNO,0,asn1_encode_integer);
-
-  /* Ticket ::= [APPLICATION 1] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(1);
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_encryption_key(rep, code)
-     const krb5_keyblock * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* keyvalue[1]	OCTET STRING */
-  krb5_addlenfield(rep->length,rep->contents,1,asn1_encode_octetstring);
-
-  /* enctype[0]		INTEGER */
-  krb5_addfield(rep->enctype,0,asn1_encode_integer);
-
-  /* EncryptionKey ::= SEQUENCE */
-  krb5_makeseq();
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_enc_tkt_part(rep, code)
-     const krb5_enc_tkt_part * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* authorization-data[10]	AuthorizationData OPTIONAL */
-  if(rep->authorization_data != NULL &&
-     rep->authorization_data[0] != NULL)
-    krb5_addfield((const krb5_authdata**)rep->authorization_data,
-		  10,asn1_encode_authorization_data);
-
-  /* caddr[9]			HostAddresses OPTIONAL */
-  if(rep->caddrs != NULL && rep->caddrs[0] != NULL)
-    krb5_addfield((const krb5_address**)rep->caddrs,9,asn1_encode_host_addresses);
-
-  /* renew-till[8]		KerberosTime OPTIONAL */
-  if(rep->times.renew_till)
-    krb5_addfield(rep->times.renew_till,8,asn1_encode_kerberos_time);
-
-  /* endtime[7]			KerberosTime */
-  krb5_addfield(rep->times.endtime,7,asn1_encode_kerberos_time);
-
-  /* starttime[6]		KerberosTime OPTIONAL */
-  if(rep->times.starttime)
-    krb5_addfield(rep->times.starttime,6,asn1_encode_kerberos_time);
-
-  /* authtime[5]		KerberosTime */
-  krb5_addfield(rep->times.authtime,5,asn1_encode_kerberos_time);
-
-  /* transited[4]		TransitedEncoding */
-  krb5_addfield(&(rep->transited),4,asn1_encode_transited_encoding);
-
-  /* cname[3]			PrincipalName */
-  krb5_addfield(rep->client,3,asn1_encode_principal_name);
+krb5_error_code encode_krb5_##name##_into(rep, code)\
+     type rep;\
+     krb5_data * code;\
+{\
+  asn1_error_code retval;\
+  asn1buf buf;\
+  int length;\
+\
+  asn1buf_measure(&buf);\
+  retval = encode_##name(&buf,rep,&length);\
+  if(retval) return retval;\
+  if(code->data == NULL || length > code->length){\
+    code->length = length;\
+    return ASN1_OVERFLOW; }\
+  code->length = length;\
+  asn1buf_wrap_output(&buf,code);\
+  return encode_##name(&buf,rep,&length);\
+}
+
+/* tab_encoders -- define encode_name for a structure described by an
+   asn1_type in asn1_tables.c, and then its public encoders. */
+#define tab_encoders(name,type,table)\
+static asn1_error_code encode_##name(buf, rep, retlen)\
+     asn1buf * buf;\
+     type rep;\
+     int * retlen;\
+{\
+  return asn1_tab_encode(buf,&(table),rep,retlen);\
+}\
+\
+krb5_encoders(name,type)
 
-  /* crealm[2]			Realm */
-  krb5_addfield(rep->client,2,asn1_encode_realm);
+tab_encoders(authenticator,const krb5_authenticator *,asn1_type_Authenticator)
 
-  /* key[1]			EncryptionKey */
-  krb5_addfield(rep->session,1,asn1_encode_encryption_key);
+tab_encoders(ticket,const krb5_ticket *,asn1_type_Ticket)
 
-  /* flags[0]			TicketFlags */
-  krb5_addfield(rep->flags,0,asn1_encode_ticket_flags);
+tab_encoders(encryption_key,const krb5_keyblock *,asn1_type_EncryptionKey)
 
-  /* EncTicketPart ::= [APPLICATION 3] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(3);
+tab_encoders(enc_tkt_part,const krb5_enc_tkt_part *,asn1_type_EncTicketPart)
 
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_enc_kdc_rep_part(rep, code)
+static asn1_error_code encode_enc_kdc_rep_part(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_enc_kdc_rep_part * rep;
-     krb5_data ** code;
+     int * retlen;
 {
-  asn1_error_code retval;
-  asn1buf *buf=NULL;
-  int length, sum=0;
-
-  if(rep == NULL) return ASN1_MISSING_FIELD;
-
-  retval = asn1buf_create(&buf);
-  if(retval) return retval;
+  krb5_setup();
 
   retval = asn1_encode_enc_kdc_rep_part(buf,rep,&length);
   if(retval) return retval;
@@ -322,10 +229,13 @@ krb5_error_code encode_krb5_enc_kdc_rep_part(rep, code)
   krb5_cleanup();
 }
 
+krb5_encoders(enc_kdc_rep_part,const krb5_enc_kdc_rep_part *)
+
 /* yes, the translation is identical to that used for KDC__REP */ 
-krb5_error_code encode_krb5_as_rep(rep, code)
+static asn1_error_code encode_as_rep(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_kdc_rep * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
 
@@ -339,10 +249,13 @@ krb5_error_code encode_krb5_as_rep(rep, code)
   krb5_cleanup();
 }
 
+krb5_encoders(as_rep,const krb5_kdc_rep *)
+
 /* yes, the translation is identical to that used for KDC__REP */ 
-krb5_error_code encode_krb5_tgs_rep( rep, code)
+static asn1_error_code encode_tgs_rep(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_kdc_rep * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
 
@@ -356,87 +269,18 @@ krb5_error_code encode_krb5_tgs_rep( rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_ap_req(rep, code)
-     const krb5_ap_req * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* authenticator[4]	EncryptedData */
-  krb5_addfield(&(rep->authenticator),4,asn1_encode_encrypted_data);
-
-  /* ticket[3]		Ticket */
-  krb5_addfield(rep->ticket,3,asn1_encode_ticket);
-
-  /* ap-options[2]	APOptions */
-  krb5_addfield(rep->ap_options,2,asn1_encode_ap_options);
-
-  /* msg-type[1]	INTEGER */
-  krb5_addfield(ASN1_KRB_AP_REQ,1,asn1_encode_integer);
-
-  /* pvno[0]		INTEGER */
-  krb5_addfield(KVNO,0,asn1_encode_integer);
-
-  /* AP-REQ ::=	[APPLICATION 14] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(14);
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_ap_rep(rep, code)
-     const krb5_ap_rep * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* enc-part[2]	EncryptedData */
-  krb5_addfield(&(rep->enc_part),2,asn1_encode_encrypted_data);
-  
-  /* msg-type[1]	INTEGER */
-  krb5_addfield(ASN1_KRB_AP_REP,1,asn1_encode_integer);
-  
-  /* pvno[0]		INTEGER */
-  krb5_addfield(KVNO,0,asn1_encode_integer);
-  
-  /* AP-REP ::=	[APPLICATION 15] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(15);
-  
-  krb5_cleanup();
-}
-
-
-krb5_error_code encode_krb5_ap_rep_enc_part(rep, code)
-     const krb5_ap_rep_enc_part * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* seq-number[3]	INTEGER OPTIONAL */
-  if(rep->seq_number)
-    krb5_addfield(rep->seq_number,3,asn1_encode_integer);
-
-  /* subkey[2]		EncryptionKey OPTIONAL */
-  if(rep->subkey != NULL)
-    krb5_addfield(rep->subkey,2,asn1_encode_encryption_key);
-
-  /* cusec[1]		INTEGER */
-  krb5_addfield(rep->cusec,1,asn1_encode_integer);
+krb5_encoders(tgs_rep,const krb5_kdc_rep *)
 
-  /* ctime[0]		KerberosTime */
-  krb5_addfield(rep->ctime,0,asn1_encode_kerberos_time);
+tab_encoders(ap_req,const krb5_ap_req *,asn1_type_AP_REQ)
 
-  /* EncAPRepPart ::= [APPLICATION 27] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(27);
+tab_encoders(ap_rep,const krb5_ap_rep *,asn1_type_AP_REP)
 
-  krb5_cleanup();
-}
+tab_encoders(ap_rep_enc_part,const krb5_ap_rep_enc_part *,asn1_type_EncAPRepPart)
 
-krb5_error_code encode_krb5_as_req(rep, code)
+static asn1_error_code encode_as_req(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_kdc_req * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
 
@@ -450,9 +294,12 @@ krb5_error_code encode_krb5_as_req(rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_tgs_req(rep, code)
+krb5_encoders(as_req,const krb5_kdc_req *)
+
+static asn1_error_code encode_tgs_req(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_kdc_req * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
 
@@ -466,9 +313,12 @@ krb5_error_code encode_krb5_tgs_req(rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_kdc_req_body(rep, code)
+krb5_encoders(tgs_req,const krb5_kdc_req *)
+
+static asn1_error_code encode_kdc_req_body(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_kdc_req * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
 
@@ -479,290 +329,35 @@ krb5_error_code encode_krb5_kdc_req_body(rep, code)
   krb5_cleanup();
 }
 
+krb5_encoders(kdc_req_body,const krb5_kdc_req *)
 
-krb5_error_code encode_krb5_safe(rep, code)
-     const krb5_safe * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
+tab_encoders(safe,const krb5_safe *,asn1_type_KRB_SAFE)
 
-  /* cksum[3]		Checksum */
-  krb5_addfield(rep->checksum,3,asn1_encode_checksum);
+tab_encoders(priv,const krb5_priv *,asn1_type_KRB_PRIV)
 
-  /* safe-body[2]	KRB-SAFE-BODY */
-  krb5_addfield(rep,2,asn1_encode_krb_safe_body);
+tab_encoders(enc_priv_part,const krb5_priv_enc_part *,asn1_type_EncKrbPrivPart)
 
-  /* msg-type[1]	INTEGER */
-  krb5_addfield(ASN1_KRB_SAFE,1,asn1_encode_integer);
+tab_encoders(cred,const krb5_cred *,asn1_type_KRB_CRED)
 
-  /* pvno[0]		INTEGER */
-  krb5_addfield(KVNO,0,asn1_encode_integer);
+tab_encoders(enc_cred_part,const krb5_cred_enc_part *,asn1_type_EncKrbCredPart)
 
-  /* KRB-SAFE ::= [APPLICATION 20] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(20);
+tab_encoders(error,const krb5_error *,asn1_type_KRB_ERROR)
 
-  krb5_cleanup();
-}
+tab_encoders(authdata,const krb5_authdata **,asn1_type_AuthorizationData)
 
-krb5_error_code encode_krb5_priv(rep, code)
-     const krb5_priv * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
+tab_encoders(alt_method,const krb5_alt_method *,asn1_type_METHOD_DATA)
 
-  /* enc-part[3]	EncryptedData */
-  krb5_addfield(&(rep->enc_part),3,asn1_encode_encrypted_data);
+tab_encoders(etype_info,const krb5_etype_info_entry **,asn1_type_ETYPE_INFO)
 
-  /* msg-type[1]	INTEGER */
-  krb5_addfield(ASN1_KRB_PRIV,1,asn1_encode_integer);
+tab_encoders(enc_data,const krb5_enc_data *,asn1_type_EncryptedData)
 
-  /* pvno[0]		INTEGER */
-  krb5_addfield(KVNO,0,asn1_encode_integer);
-
-  /* KRB-PRIV ::= [APPLICATION 21] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(21);
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_enc_priv_part(rep, code)
-     const krb5_priv_enc_part * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* r-address[5]	HostAddress OPTIONAL -- recip's addr */
-  if(rep->r_address)
-    krb5_addfield(rep->r_address,5,asn1_encode_host_address);
-
-  /* s-address[4]	HostAddress -- sender's addr */
-  krb5_addfield(rep->s_address,4,asn1_encode_host_address);
-
-  /* seq-number[3]	INTEGER OPTIONAL */
-  if(rep->seq_number)
-    krb5_addfield(rep->seq_number,3,asn1_encode_integer);
-
-  /* usec[2]		INTEGER OPTIONAL */
-  if(rep->timestamp){
-    krb5_addfield(rep->usec,2,asn1_encode_integer);
-    /* timestamp[1]	KerberosTime OPTIONAL */
-    krb5_addfield(rep->timestamp,1,asn1_encode_kerberos_time);
-  }
-
-  /* user-data[0]	OCTET STRING */
-  krb5_addlenfield(rep->user_data.length,rep->user_data.data,0,asn1_encode_charstring);
-
-  /* EncKrbPrivPart ::= [APPLICATION 28] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(28);
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_cred(rep, code)
-     const krb5_cred * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* enc-part[3]	EncryptedData */
-  krb5_addfield(&(rep->enc_part),3,asn1_encode_encrypted_data);
-
-  /* tickets[2]		SEQUENCE OF Ticket */
-  krb5_addfield((const krb5_ticket**)rep->tickets,2,asn1_encode_sequence_of_ticket);
-
-  /* msg-type[1]	INTEGER, -- KRB_CRED */
-  krb5_addfield(ASN1_KRB_CRED,1,asn1_encode_integer);
-
-  /* pvno[0]		INTEGER */
-  krb5_addfield(KVNO,0,asn1_encode_integer);
-
-  /* KRB-CRED ::= [APPLICATION 22] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(22);
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_enc_cred_part(rep, code)
-     const krb5_cred_enc_part * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* r-address[5]	HostAddress OPTIONAL */
-  if(rep->r_address != NULL)
-    krb5_addfield(rep->r_address,5,asn1_encode_host_address);
-
-  /* s-address[4]	HostAddress OPTIONAL */
-  if(rep->s_address != NULL)
-    krb5_addfield(rep->s_address,4,asn1_encode_host_address);
-
-  /* usec[3]		INTEGER OPTIONAL */
-  if(rep->timestamp){
-    krb5_addfield(rep->usec,3,asn1_encode_integer);
-    /* timestamp[2]	KerberosTime OPTIONAL */
-    krb5_addfield(rep->timestamp,2,asn1_encode_kerberos_time);
-  }
-
-  /* nonce[1]		INTEGER OPTIONAL */
-  if(rep->nonce)
-    krb5_addfield(rep->nonce,1,asn1_encode_integer);
-
-  /* ticket-info[0]	SEQUENCE OF KrbCredInfo */
-  krb5_addfield((const krb5_cred_info**)rep->ticket_info,
-		0,asn1_encode_sequence_of_krb_cred_info);
-
-  /* EncKrbCredPart ::= [APPLICATION 29] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(29);
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_error(rep, code)
-     const krb5_error * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* e-data[12]		OCTET STRING OPTIONAL */
-  if(rep->e_data.data != NULL && rep->e_data.length > 0)
-    krb5_addlenfield(rep->e_data.length,rep->e_data.data,12,asn1_encode_charstring);
-
-  /* e-text[11]		GeneralString OPTIONAL */
-  if(rep->text.data != NULL && rep->text.length > 0)
-    krb5_addlenfield(rep->text.length,rep->text.data,11,asn1_encode_generalstring);
-
-  /* sname[10]		PrincipalName -- Correct name */
-  krb5_addfield(rep->server,10,asn1_encode_principal_name);
-
-  /* realm[9]		Realm -- Correct realm */
-  krb5_addfield(rep->server,9,asn1_encode_realm);
-
-  /* cname[8]		PrincipalName OPTIONAL */
-  if(rep->client != NULL){
-    krb5_addfield(rep->client,8,asn1_encode_principal_name);
-    /* crealm[7]		Realm OPTIONAL */
-    krb5_addfield(rep->client,7,asn1_encode_realm);
-  }
-
-  /* error-code[6]	INTEGER */
-  krb5_addfield(rep->error,6,asn1_encode_ui_4);
-
-  /* susec[5]		INTEGER */
-  krb5_addfield(rep->susec,5,asn1_encode_integer);
-
-  /* stime[4]		KerberosTime */
-  krb5_addfield(rep->stime,4,asn1_encode_kerberos_time);
-
-  /* cusec[3]		INTEGER OPTIONAL */
-  if(rep->cusec)
-    krb5_addfield(rep->cusec,3,asn1_encode_integer);
-
-  /* ctime[2]		KerberosTime OPTIONAL */
-  if(rep->ctime)
-    krb5_addfield(rep->ctime,2,asn1_encode_kerberos_time);
-
-  /* msg-type[1]	INTEGER */
-  krb5_addfield(ASN1_KRB_ERROR,1,asn1_encode_integer);
-
-  /* pvno[0]		INTEGER */
-  krb5_addfield(KVNO,0,asn1_encode_integer);
-
-  /* KRB-ERROR ::= [APPLICATION 30] SEQUENCE */
-  krb5_makeseq();
-  krb5_apptag(30);
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_authdata(rep, code)
-     const krb5_authdata ** rep;
-     krb5_data ** code;
-{
-  asn1_error_code retval;
-  asn1buf *buf=NULL;
-  int length;
-  
-  if(rep == NULL) return ASN1_MISSING_FIELD;
-
-  retval = asn1buf_create(&buf);
-  if(retval) return retval;
-
-  retval = asn1_encode_authorization_data(buf,(const krb5_authdata**)rep,
-					  &length);
-  if(retval) return retval;
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_alt_method(rep, code)
-     const krb5_alt_method * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* method-data[1]		OctetString OPTIONAL */
-  if(rep->data != NULL && rep->length > 0)
-    krb5_addlenfield((int) rep->length,rep->data,1,asn1_encode_octetstring);
-
-  /* method-type[0]		Integer */
-  krb5_addfield(rep->method,0,asn1_encode_integer);
-
-  krb5_makeseq();
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_etype_info( rep, code)
-     const krb5_etype_info_entry ** rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-  retval = asn1_encode_etype_info(buf,rep,&length);
-  if(retval) return retval;
-  sum += length;
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_enc_data(rep, code)
-     const krb5_enc_data * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  retval = asn1_encode_encrypted_data(buf,rep,&length);
-  if(retval) return retval;
-  sum += length;
-
-  krb5_cleanup();
-}
-
-krb5_error_code encode_krb5_pa_enc_ts(rep, code)
-     const krb5_pa_enc_ts * rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  /* pausec[1]                    INTEGER OPTIONAL */
-  if (rep->pausec)
-	  krb5_addfield(rep->pausec,1,asn1_encode_integer);
-
-  /* patimestamp[0]               KerberosTime, -- client's time */
-  krb5_addfield(rep->patimestamp,0,asn1_encode_kerberos_time);
-
-  krb5_makeseq();
-
-  krb5_cleanup();
-}
+tab_encoders(pa_enc_ts,const krb5_pa_enc_ts *,asn1_type_PA_ENC_TS_ENC)
 
 /* Sandia Additions */
-krb5_error_code encode_krb5_pwd_sequence( rep, code)
+static asn1_error_code encode_pwd_sequence(buf, rep, retlen)
+     asn1buf * buf;
      const passwd_phrase_element * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
   retval = asn1_encode_passwdsequence(buf,rep,&length);
@@ -771,9 +366,12 @@ krb5_error_code encode_krb5_pwd_sequence( rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_pwd_data(rep, code)
+krb5_encoders(pwd_sequence,const passwd_phrase_element *)
+
+static asn1_error_code encode_pwd_data(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_pwd_data * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
   krb5_addfield((const passwd_phrase_element**)rep->element,1,asn1_encode_sequence_of_passwdsequence);
@@ -782,23 +380,15 @@ krb5_error_code encode_krb5_pwd_data(rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_padata_sequence(rep, code)
-     const krb5_pa_data ** rep;
-     krb5_data ** code;
-{
-  krb5_setup();
-
-  retval = asn1_encode_sequence_of_pa_data(buf,rep,&length);
-  if(retval) return retval;
-  sum += length;
+krb5_encoders(pwd_data,const krb5_pwd_data *)
 
-  krb5_cleanup();
-}
+tab_encoders(padata_sequence,const krb5_pa_data **,asn1_type_seqof_PA_DATA)
 
 /* sam preauth additions */
-krb5_error_code encode_krb5_sam_challenge(rep, code)
+static asn1_error_code encode_sam_challenge(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_sam_challenge * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
   retval = asn1_encode_sam_challenge(buf,rep,&length);
@@ -807,9 +397,12 @@ krb5_error_code encode_krb5_sam_challenge(rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_sam_key(rep, code)
+krb5_encoders(sam_challenge,const krb5_sam_challenge *)
+
+static asn1_error_code encode_sam_key(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_sam_key * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
   retval = asn1_encode_sam_key(buf,rep,&length);
@@ -818,9 +411,12 @@ krb5_error_code encode_krb5_sam_key(rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_enc_sam_response_enc(rep, code)
+krb5_encoders(sam_key,const krb5_sam_key *)
+
+static asn1_error_code encode_enc_sam_response_enc(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_enc_sam_response_enc * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
   retval = asn1_encode_enc_sam_response_enc(buf,rep,&length);
@@ -829,9 +425,12 @@ krb5_error_code encode_krb5_enc_sam_response_enc(rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_sam_response(rep, code)
+krb5_encoders(enc_sam_response_enc,const krb5_enc_sam_response_enc *)
+
+static asn1_error_code encode_sam_response(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_sam_response * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
   retval = asn1_encode_sam_response(buf,rep,&length);
@@ -840,9 +439,12 @@ krb5_error_code encode_krb5_sam_response(rep, code)
   krb5_cleanup();
 }
 
-krb5_error_code encode_krb5_predicted_sam_response(rep, code)
+krb5_encoders(sam_response,const krb5_sam_response *)
+
+static asn1_error_code encode_predicted_sam_response(buf, rep, retlen)
+     asn1buf * buf;
      const krb5_predicted_sam_response * rep;
-     krb5_data ** code;
+     int * retlen;
 {
   krb5_setup();
   retval = asn1_encode_predicted_sam_response(buf,rep,&length);
@@ -850,3 +452,5 @@ krb5_error_code encode_krb5_predicted_sam_response(rep, code)
   sum += length;
   krb5_cleanup();
 }
+
+krb5_encoders(predicted_sam_response,const krb5_predicted_sam_response *)
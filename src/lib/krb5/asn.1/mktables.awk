@@ -0,0 +1,370 @@
+# lib/krb5/asn.1/mktables.awk
+#
+# Make the ASN.1 type tables used by asn1_tab.c.
+#
+# usage: awk -f mktables.awk [outfile=name] KRB5-asn.py krb5_types.map
+#
+# Reads the ASN.1 module and the C bindings for some of its types (see
+# krb5_types.map for their syntax), and writes a table for each bound
+# type to outfile.c, and declarations of the tables to outfile.h.
+# outfile defaults to asn1_tables.
+#
+# Only as much ASN.1 is understood as the module uses: type
+# assignments, with an optional [APPLICATION n] tag, of SEQUENCE and
+# SEQUENCE OF types, BIT STRING types and other named types.  The
+# fields of a SEQUENCE must all have context-specific tags.
+
+BEGIN {
+    outfile = "asn1_tables"
+    module = ""
+    nbound = 0
+}
+
+# the module is the first file
+FNR == NR {
+    sub(/--.*/, "")
+    module = module " " $0
+    next
+}
+
+# the bindings are the second
+{ sub(/#.*/, "") }
+
+/^[ \t]*$/ { next }
+
+/^\t/ {
+    if (cur == "")
+	die("field binding outside a type: " $0)
+    n = ++mnf[cur]
+    mfield[cur, n] = $1
+    mmember[cur, n] = $2
+    mmods[cur, n] = ""
+    for (i = 3; i <= NF; i++)
+	mmods[cur, n] = mmods[cur, n] " " $i
+    next
+}
+
+$2 == "=" {
+    malias[$1] = $3
+    cur = ""
+    next
+}
+
+{
+    if ($1 == "SEQUENCE" && $2 == "OF") {
+	cur = "SEQUENCE OF " $3
+	first = 4
+	mctype[cur] = "-"
+	mmagic[cur] = "-"
+    } else {
+	cur = $1
+	first = 4
+	mctype[cur] = $2
+	mmagic[cur] = $3
+    }
+    if (cur in bound)
+	die(cur " is bound twice")
+    bound[cur] = 1
+    border[++nbound] = cur
+    mnf[cur] = 0
+    mflags[cur] = ""
+    for (i = first; i <= NF; i++)
+	mflags[cur] = mflags[cur] " " $i
+}
+
+END {
+    if (failed)
+	exit 1
+    tokenize(module)
+    parse_module()
+
+    hdr = "/* " outfile ".h: generated by mktables.awk from KRB5-asn.py and\n"
+    hdr = hdr "   krb5_types.map.  Do not edit. */\n\n"
+    hdr = hdr "#ifndef __ASN1_TABLES_H__\n#define __ASN1_TABLES_H__\n\n"
+    hdr = hdr "#include \"asn1_tab.h\"\n\n"
+    src = "/* " outfile ".c: generated by mktables.awk from KRB5-asn.py and\n"
+    src = src "   krb5_types.map.  Do not edit. */\n\n"
+    src = src "#include <stddef.h>\n#include \"" outfile ".h\"\n"
+
+    for (b = 1; b <= nbound; b++) {
+	name = border[b]
+	hdr = hdr "extern const asn1_type " cname(name) ";\n"
+	if (name ~ /^SEQUENCE OF /)
+	    src = src seqof_table(name, substr(name, 13))
+	else if (!(name in tkind))
+	    die(name " is not in the module")
+	else if (tkind[name] == "seqof")
+	    src = src seqof_table(name, telem[name])
+	else if (tkind[name] == "seq")
+	    src = src seq_table(name)
+	else
+	    die(name " is not a SEQUENCE or SEQUENCE OF type")
+    }
+    hdr = hdr "\n#endif\n"
+
+    printf "%s", hdr > (outfile ".h")
+    printf "%s", src > (outfile ".c")
+}
+
+function die(msg) {
+    print "mktables: " msg | "cat 1>&2"
+    failed = 1
+    exit 1
+}
+
+function tokenize(s) {
+    gsub(/\{/, " { ", s)
+    gsub(/\}/, " } ", s)
+    gsub(/\[/, " [ ", s)
+    gsub(/\]/, " ] ", s)
+    gsub(/\(/, " ( ", s)
+    gsub(/\)/, " ) ", s)
+    gsub(/,/, " , ", s)
+    ntok = split(s, tok)
+}
+
+function parse_module(i) {
+    for (i = 1; i < ntok; i++) {
+	if (tok[i+1] != "::=" || tok[i+2] == "BEGIN")
+	    continue
+	i = parse_def(tok[i], i + 2)
+    }
+}
+
+# parse the definition of name starting at token i, and return the
+# index of its last token
+function parse_def(name, i) {
+    tapp[name] = -1
+    if (tok[i] == "[") {
+	if (tok[i+1] != "APPLICATION" || tok[i+3] != "]")
+	    die("bad tag for " name)
+	tapp[name] = tok[i+2]
+	i += 4
+    }
+    if (tok[i] == "SEQUENCE" && tok[i+1] == "{") {
+	tkind[name] = "seq"
+	return parse_fields(name, i + 2)
+    }
+    if (tok[i] == "SEQUENCE" && tok[i+1] == "OF") {
+	tkind[name] = "seqof"
+	if (tok[i+2] == "SEQUENCE" && tok[i+3] == "{") {
+	    telem[name] = name ".element"
+	    tapp[telem[name]] = -1
+	    tkind[telem[name]] = "seq"
+	    return parse_fields(telem[name], i + 4)
+	}
+	telem[name] = tok[i+2]
+	return i + 2
+    }
+    if (tok[i] == "BIT" && tok[i+1] == "STRING") {
+	tkind[name] = "bits"
+	i += 2
+	if (tok[i] == "{")
+	    while (tok[i] != "}")
+		i++
+	return i
+    }
+    tkind[name] = "alias"
+    talias[name] = tok[i]
+    return i
+}
+
+# parse the fields of name, the first of which is at token i, and
+# return the index of the closing brace
+function parse_fields(name, i, n, type) {
+    n = 0
+    while (tok[i] != "}") {
+	if (i > ntok)
+	    die("unterminated SEQUENCE " name)
+	n++
+	tfname[name, n] = tok[i]
+	if (tok[i+1] != "[" || tok[i+3] != "]")
+	    die("field " tok[i] " of " name " has no tag")
+	tftag[name, n] = tok[i+2]
+	i += 4
+	type = tok[i++]
+	if (type == "OCTET" || type == "BIT")
+	    type = type " " tok[i++]
+	else if (type == "SEQUENCE" && tok[i] == "OF") {
+	    type = "SEQUENCE OF " tok[i+1]
+	    i += 2
+	}
+	tftype[name, n] = type
+	tfopt[name, n] = 0
+	if (tok[i] == "OPTIONAL") {
+	    tfopt[name, n] = 1
+	    i++
+	}
+	if (tok[i] == ",")
+	    i++
+	else if (tok[i] != "}")
+	    die("can't parse field " tfname[name, n] " of " name)
+    }
+    tnf[name] = n
+    return i
+}
+
+function cname(name) {
+    sub(/^SEQUENCE OF /, "seqof_", name)
+    gsub(/[-.]/, "_", name)
+    return "asn1_type_" name
+}
+
+# what a type comes to, after following aliases
+function base(type) {
+    while (tkind[type] == "alias")
+	type = talias[type]
+    return type
+}
+
+function has_mod(mods, mod) {
+    return index(mods " ", " " mod " ") > 0
+}
+
+function mod_arg(mods, mod, n, w, i) {
+    n = split(mods, w)
+    for (i = 1; i <= n; i++)
+	if (index(w[i], mod "=") == 1)
+	    return substr(w[i], length(mod) + 2)
+    return ""
+}
+
+function member(ctype, m) {
+    return "offsetof(" ctype "," m ")"
+}
+
+# the table entry for field j of name
+function field_entry(name, j, ctype, m, mods, type, kind, flags, offset, aux,
+		     ref, w, arg) {
+    if (mfield[name, j] != tfname[name, j])
+	die(name " binds " mfield[name, j] " where the module has " \
+	    tfname[name, j])
+    m = mmember[name, j]
+    mods = mmods[name, j]
+    type = tftype[name, j]
+    flags = tfopt[name, j] ? "ASN1_TAB_OPTIONAL" : ""
+    offset = "0"
+    aux = "0"
+    ref = "NULL"
+
+    if (m ~ /^=/) {
+	if (type != "INTEGER")
+	    die(name "." tfname[name, j] " is not an INTEGER")
+	kind = has_mod(mods, "msgtype") ? "MSGTYPE" : "PVNO"
+	aux = substr(m, 2)
+    } else if (type == "INTEGER") {
+	kind = "INT32"
+	if (has_mod(mods, "octet"))
+	    kind = "OCTET"
+	else if (has_mod(mods, "kvno"))
+	    kind = "UINT"
+	else if (has_mod(mods, "unsigned"))
+	    kind = "UI4"
+	offset = member(ctype, m)
+    } else if (type == "Realm" || type == "PrincipalName") {
+	kind = (type == "Realm") ? "REALM" : "NAME"
+	offset = member(ctype, m)
+    } else if (type == "OCTET STRING" || type == "GeneralString") {
+	kind = (type == "GeneralString") ? "GENSTRING" : "OCTETS"
+	if (split(m, w, ",") == 2) {
+	    offset = member(ctype, w[2])
+	    aux = member(ctype, w[1])
+	} else {
+	    offset = member(ctype, m ".data")
+	    aux = member(ctype, m ".length")
+	}
+    } else if (base(type) == "GeneralizedTime") {
+	kind = "TIME"
+	offset = member(ctype, m)
+    } else if (tkind[base(type)] == "bits") {
+	kind = "FLAGS"
+	offset = member(ctype, m)
+    } else {
+	if (!(type in bound))
+	    die(name "." tfname[name, j] " is a " type ", which is not bound")
+	ref = "&" cname(type)
+	if (type ~ /^SEQUENCE OF / || tkind[type] == "seqof") {
+	    kind = "ARRAY"
+	    offset = member(ctype, m)
+	} else if (m == "-") {
+	    kind = "STRUCT"
+	} else if (m ~ /^\*/) {
+	    kind = "POINTER"
+	    offset = member(ctype, substr(m, 2))
+	} else {
+	    kind = "STRUCT"
+	    offset = member(ctype, m)
+	}
+    }
+
+    if ((arg = mod_arg(mods, "default")) != "") {
+	flags = flags "|ASN1_TAB_DEFAULT"
+	aux = member(ctype, arg)
+    }
+    if ((arg = mod_arg(mods, "if")) != "") {
+	flags = flags "|ASN1_TAB_IF"
+	aux = member(ctype, arg)
+    }
+    if (has_mod(mods, "neglen"))
+	flags = flags "|ASN1_TAB_NEGLEN"
+    if (flags ~ /DEFAULT|IF|NEGLEN/ && !tfopt[name, j])
+	die(name "." tfname[name, j] " is not OPTIONAL")
+    sub(/^\|/, "", flags)
+    if (flags == "")
+	flags = "0"
+
+    return "  { ASN1_TAB_" kind ", " flags ", " tftag[name, j] ",\n" \
+	"    " offset ", " aux ", " ref " },\n"
+}
+
+function seq_table(name, ctype, magic, s, j, id) {
+    ctype = mctype[name]
+    magic = (mmagic[name] == "-") ? "0" : mmagic[name]
+    if (ctype == "-")
+	die(name " has no C type")
+    if (mnf[name] != tnf[name])
+	die(name " binds " mnf[name] " fields where the module has " \
+	    tnf[name])
+    id = substr(cname(name), 11)
+    s = "\n/* " name " ::= "
+    if (tapp[name] >= 0)
+	s = s "[APPLICATION " tapp[name] "] "
+    s = s "SEQUENCE */\nstatic const asn1_field " id "_fields[] = {\n"
+    for (j = 1; j <= tnf[name]; j++)
+	s = s field_entry(name, j, ctype)
+    s = s "};\n\nconst asn1_type " cname(name) " = {\n"
+    s = s "  \"" name "\", " tapp[name] ", 0, " magic ", sizeof(" ctype "),\n"
+    s = s "  " tnf[name] ", " id "_fields, NULL\n};\n"
+    return s
+}
+
+# an element bound as another type must have the same fields
+function same_fields(a, b, j) {
+    if (tnf[a] != tnf[b])
+	return 0
+    for (j = 1; j <= tnf[a]; j++)
+	if (tfname[a, j] != tfname[b, j] || tftag[a, j] != tftag[b, j] ||
+	    tftype[a, j] != tftype[b, j] || tfopt[a, j] != tfopt[b, j])
+	    return 0
+    return 1
+}
+
+function seqof_table(name, elem, flags, s) {
+    if (elem in malias) {
+	if (!same_fields(elem, malias[elem]))
+	    die(elem " and " malias[elem] " have different fields")
+	elem = malias[elem]
+    }
+    if (!(elem in bound) || elem ~ /^SEQUENCE OF / || tkind[elem] == "seqof")
+	die("the element of " name " is not a bound SEQUENCE")
+    flags = "ASN1_TAB_SEQOF"
+    if (has_mod(mflags[name], "nonempty"))
+	flags = flags "|ASN1_TAB_NONEMPTY"
+    s = "\n/* " name
+    if (name !~ /^SEQUENCE OF /)
+	s = s " ::= SEQUENCE OF " elem
+    s = s " */\nconst asn1_type " cname(name) " = {\n"
+    s = s "  \"" name "\", -1, " flags ", 0, 0,\n"
+    s = s "  0, NULL, &" cname(elem) "\n};\n"
+    return s
+}
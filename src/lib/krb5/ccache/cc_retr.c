@@ -128,6 +128,41 @@ data_match(data1, data2)
 	return memcmp(data1->data, data2->data, data1->length) ? FALSE : TRUE;
 }
 
+static krb5_boolean
+creds_match(context, whichfields, mcreds, creds)
+   krb5_context context;
+   krb5_flags whichfields;
+   const krb5_creds *mcreds, *creds;
+{
+    return (((set(KRB5_TC_MATCH_SRV_NAMEONLY) &&
+		   srvname_match(context, mcreds, creds)) ||
+	       standard_fields_match(context, mcreds, creds))
+	      &&
+	      (! set(KRB5_TC_MATCH_IS_SKEY) ||
+	       mcreds->is_skey == creds->is_skey)
+	      &&
+	      (! set(KRB5_TC_MATCH_FLAGS_EXACT) ||
+	       mcreds->ticket_flags == creds->ticket_flags)
+	      &&
+	      (! set(KRB5_TC_MATCH_FLAGS) ||
+	       flags_match(mcreds->ticket_flags, creds->ticket_flags))
+	      &&
+	      (! set(KRB5_TC_MATCH_TIMES_EXACT) ||
+	       times_match_exact(&mcreds->times, &creds->times))
+	      &&
+	      (! set(KRB5_TC_MATCH_TIMES) ||
+	       times_match(&mcreds->times, &creds->times))
+	      &&
+	      ( ! set(KRB5_TC_MATCH_AUTHDATA) ||
+	       authdata_match(mcreds->authdata, creds->authdata))
+	      &&
+	      (! set(KRB5_TC_MATCH_2ND_TKT) ||
+	       data_match (&mcreds->second_ticket, &creds->second_ticket))
+	      &&
+	     ((! set(KRB5_TC_MATCH_KTYPE))||
+		(mcreds->keyblock.enctype == creds->keyblock.enctype)));
+}
+
 static int
 pref (krb5_enctype my_ktype, int nktypes, krb5_enctype *ktypes)
 {
@@ -194,33 +229,7 @@ krb5_cc_retrieve_cred_seq (context, id, whichfields,
 	  return kret;
 
      while ((kret = krb5_cc_next_cred(context, id, &cursor, &fetchcreds)) == KRB5_OK) {
-	 if (((set(KRB5_TC_MATCH_SRV_NAMEONLY) &&
-		   srvname_match(context, mcreds, &fetchcreds)) ||
-	       standard_fields_match(context, mcreds, &fetchcreds))
-	      &&
-	      (! set(KRB5_TC_MATCH_IS_SKEY) ||
-	       mcreds->is_skey == fetchcreds.is_skey)
-	      &&
-	      (! set(KRB5_TC_MATCH_FLAGS_EXACT) ||
-	       mcreds->ticket_flags == fetchcreds.ticket_flags)
-	      &&
-	      (! set(KRB5_TC_MATCH_FLAGS) ||
-	       flags_match(mcreds->ticket_flags, fetchcreds.ticket_flags))
-	      &&
-	      (! set(KRB5_TC_MATCH_TIMES_EXACT) ||
-	       times_match_exact(&mcreds->times, &fetchcreds.times))
-	      &&
-	      (! set(KRB5_TC_MATCH_TIMES) ||
-	       times_match(&mcreds->times, &fetchcreds.times))
-	      &&
-	      ( ! set(KRB5_TC_MATCH_AUTHDATA) ||
-	       authdata_match(mcreds->authdata, fetchcreds.authdata))
-	      &&
-	      (! set(KRB5_TC_MATCH_2ND_TKT) ||
-	       data_match (&mcreds->second_ticket, &fetchcreds.second_ticket))
-	      &&
-	     ((! set(KRB5_TC_MATCH_KTYPE))||
-		(mcreds->keyblock.enctype == fetchcreds.keyblock.enctype)))
+	 if (creds_match(context, whichfields, mcreds, &fetchcreds))
 	  {
 	      if (ktypes) {
 		  fetched.pref = pref (fetchcreds.keyblock.enctype,
@@ -284,3 +293,110 @@ krb5_cc_retrieve_cred_default (context, id, flags, mcreds, creds)
 					  0, 0);
     }
 }
+
+/*
+ * Effects:
+ * Searches the credentials cache once for all of mcreds[0..n-1], as
+ * krb5_cc_retrieve_cred_default would for each one with the fields
+ * whichfields[i].  An entry whose retvals[i] is nonzero is skipped.
+ * For the others, retvals[i] is set to the result of the search, and
+ * creds[i] to the credentials found if that is 0; they should be
+ * freed by the caller with krb5_free_cred_contents().
+ *
+ * Errors:
+ * system errors
+ * permission errors
+ * KRB5_CC_NOMEM
+ */
+krb5_error_code
+krb5int_cc_retrieve_creds (context, id, n, whichfields, mcreds, creds,
+			   retvals)
+   krb5_context context;
+   krb5_ccache id;
+   int n;
+   krb5_flags *whichfields;
+   krb5_creds *mcreds;
+   krb5_creds *creds;
+   krb5_error_code *retvals;
+{
+     krb5_cc_cursor cursor;
+     krb5_error_code kret;
+     krb5_creds seqcreds, *ncreds;
+     krb5_enctype *ktypes = NULL;
+     int nktypes = 0, *best, i, p;
+
+     if ((best = (int *) malloc(n * sizeof(int))) == NULL)
+	  return KRB5_CC_NOMEM;
+
+     for (i = 0; i < n; i++) {
+	  if (retvals[i]) {
+	       best[i] = -2;		/* skipped */
+	       continue;
+	  }
+	  best[i] = -1;			/* nothing found yet */
+	  retvals[i] = KRB5_CC_NOTFOUND;
+	  if ((whichfields[i] & KRB5_TC_SUPPORTED_KTYPES) && !ktypes) {
+	       kret = krb5_get_tgs_ktypes (context, mcreds[i].server, &ktypes);
+	       if (kret) {
+		    free(best);
+		    return kret;
+	       }
+	       while (ktypes[nktypes])
+		    nktypes++;
+	  }
+     }
+
+     kret = krb5_cc_start_seq_get(context, id, &cursor);
+     if (kret != KRB5_OK)
+	  goto cleanup;
+
+     while ((kret = krb5_cc_next_cred(context, id, &cursor, &seqcreds)) == KRB5_OK) {
+	  for (i = 0; i < n; i++) {
+	       if (best[i] == -2 ||
+		   !creds_match(context, whichfields[i], &mcreds[i],
+				&seqcreds))
+		    continue;
+
+	       /* the first match will do, unless enctypes are compared */
+	       p = 0;
+	       if (whichfields[i] & KRB5_TC_SUPPORTED_KTYPES) {
+		    p = pref (seqcreds.keyblock.enctype, nktypes, ktypes);
+		    if (p < 0) {
+			 if (best[i] == -1)
+			      retvals[i] = KRB5_CC_NOT_KTYPE;
+			 continue;
+		    }
+	       }
+	       if (best[i] >= 0 && p >= best[i])
+		    continue;
+
+	       if ((kret = krb5_copy_creds(context, &seqcreds, &ncreds))) {
+		    krb5_free_cred_contents(context, &seqcreds);
+		    krb5_cc_end_seq_get(context, id, &cursor);
+		    goto cleanup;
+	       }
+	       if (best[i] >= 0)
+		    krb5_free_cred_contents(context, &creds[i]);
+	       creds[i] = *ncreds;
+	       krb5_xfree(ncreds);
+	       best[i] = p;
+	       retvals[i] = 0;
+	  }
+	  krb5_free_cred_contents(context, &seqcreds);
+     }
+
+     krb5_cc_end_seq_get(context, id, &cursor);
+     if (kret == KRB5_CC_END)
+	  kret = KRB5_OK;
+
+cleanup:
+     if (kret) {
+	  for (i = 0; i < n; i++)
+	       if (best[i] >= 0)
+		    krb5_free_cred_contents(context, &creds[i]);
+     }
+     free(best);
+     if (ktypes)
+	  free(ktypes);
+     return kret;
+}
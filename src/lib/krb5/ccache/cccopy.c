@@ -1,4 +1,7 @@
 #include "k5-int.h"
+#ifdef HAVE_SYS_TYPES_H
+#include "fcc.h"		/* From file subdir */
+#endif
 
 KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
 krb5_cc_copy_creds(context, incc, outcc)
@@ -54,3 +57,26 @@ cleanup:
 
     return(code);
 }
+
+/*
+ * Store the NULL-terminated array creds in ccache.  A file cache
+ * takes them all in one write; other types get one at a time.
+ */
+krb5_error_code
+krb5int_cc_store_creds(context, ccache, creds)
+   krb5_context context;
+   krb5_ccache ccache;
+   krb5_creds **creds;
+{
+    krb5_error_code code;
+
+#ifdef HAVE_SYS_TYPES_H
+    if (ccache->ops->store == krb5_fcc_store)
+	return krb5_fcc_store_creds(context, ccache, creds);
+#endif
+
+    for (; *creds; creds++)
+	if ((code = krb5_cc_store_cred(context, ccache, *creds)))
+	    return(code);
+    return(0);
+}
@@ -118,6 +118,8 @@ KRB5_DLLIMP krb5_error_code KRB5_CALLCONV krb5_fcc_start_seq_get
 /* fcc_store.c */
 KRB5_DLLIMP krb5_error_code KRB5_CALLCONV krb5_fcc_store 
         KRB5_PROTOTYPE((krb5_context, krb5_ccache id , krb5_creds *creds ));
+krb5_error_code krb5_fcc_store_creds
+        KRB5_PROTOTYPE((krb5_context, krb5_ccache id , krb5_creds **creds ));
 
 /* fcc_skip.c */
 krb5_error_code krb5_fcc_skip_header
@@ -170,5 +172,7 @@ krb5_error_code krb5_fcc_close_file
         KRB5_PROTOTYPE((krb5_context, krb5_ccache));
 krb5_error_code krb5_fcc_open_file 
         KRB5_PROTOTYPE((krb5_context, krb5_ccache, int));
+krb5_error_code krb5_fcc_replace_file 
+        KRB5_PROTOTYPE((krb5_context, krb5_ccache));
 
 #endif /* KRB5_FCC_PROTO__ */
@@ -91,6 +91,10 @@ typedef struct _krb5_fcc_data {
      krb5_flags flags;
      int mode;				/* needed for locking code */
      int version;	      		/* version number of the file */
+     char *wbuf;			/* if set, krb5_fcc_write appends */
+     int wlen, wsize;			/* to this buffer; see fcc_store.c */
+     int lockfd;			/* while fd is a new copy of the */
+     char *tmpname;			/* file; see fcc_maybe.c */
 } krb5_fcc_data;
 
 /* An off_t can be arbitrarily complex */
@@ -107,7 +111,9 @@ typedef struct _krb5_fcc_cursor {
 #define MAYBE_CLOSE(CONTEXT, ID, RET) \
 {									\
     if (OPENCLOSE (ID)) {						\
-	krb5_error_code maybe_close_ret = krb5_fcc_close_file (CONTEXT,ID);	\
+	krb5_error_code maybe_close_ret;				\
+	if (!(RET)) RET = krb5_fcc_replace_file (CONTEXT,ID);		\
+	maybe_close_ret = krb5_fcc_close_file (CONTEXT,ID);		\
 	if (!(RET)) RET = maybe_close_ret; } }
 
 #define MAYBE_CLOSE_IGNORE(CONTEXT, ID) \
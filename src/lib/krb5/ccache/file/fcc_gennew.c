@@ -88,6 +88,9 @@ krb5_fcc_generate_new (context, id)
       * The file is initially closed at the end of this call...
       */
      ((krb5_fcc_data *) lid->data)->fd = -1;
+     ((krb5_fcc_data *) lid->data)->wbuf = NULL;
+     ((krb5_fcc_data *) lid->data)->lockfd = -1;
+     ((krb5_fcc_data *) lid->data)->tmpname = NULL;
 
      ((krb5_fcc_data *) lid->data)->filename = (char *)
 	  malloc(strlen(scratch) + 1);
@@ -45,6 +45,22 @@
  #error find some way to use net-byte-order file version numbers.
 #endif
 
+/*
+ * With ccache_replace set in [libdefaults], a cache file is never
+ * changed once it is in place.  A writer locks the file against other
+ * writers, and writes its new contents to a copy named after the file
+ * and its process ID; krb5_fcc_replace_file then renames the copy over
+ * the file.  Readers take no lock at all, since the file they open
+ * cannot change under them, and so never wait for a writer.  Every
+ * program sharing a cache must use the same setting, or a writer
+ * appending in place could lose its credentials to a replacement.
+ */
+
+/*
+ * Effects:
+ * Closes the file opened by krb5_fcc_open_file, discarding the new
+ * copy of the file if krb5_fcc_replace_file has not put it in place.
+ */
 krb5_error_code
 krb5_fcc_close_file (context, id)
    krb5_context context;
@@ -60,12 +76,149 @@ krb5_fcc_close_file (context, id)
      retval = krb5_unlock_file(context, data->fd);
      ret = close (data->fd);
      data->fd = -1;
+     if (data->tmpname) {
+	 (void) unlink(data->tmpname);
+	 krb5_xfree(data->tmpname);
+	 data->tmpname = NULL;
+     }
+     if (data->lockfd != -1) {
+	 (void) krb5_unlock_file(context, data->lockfd);
+	 (void) close(data->lockfd);
+	 data->lockfd = -1;
+     }
      if (retval)
 	 return retval;
      else
      return (ret == -1) ? krb5_fcc_interpret (context, errno) : 0;
 }
 
+/*
+ * Effects:
+ * If the file was opened for writing in replace mode, renames the new
+ * copy of it over the cache file.
+ */
+krb5_error_code
+krb5_fcc_replace_file (context, id)
+   krb5_context context;
+   krb5_ccache id;
+{
+     krb5_fcc_data *data = (krb5_fcc_data *)id->data;
+
+     if (data->tmpname == NULL)
+	 return 0;
+     if (rename(data->tmpname, data->filename) == -1)
+	 return krb5_fcc_interpret (context, errno);
+     krb5_xfree(data->tmpname);
+     data->tmpname = NULL;
+     return 0;
+}
+
+/* Nonzero if fd is open on the file called name. */
+static int
+krb5_fcc_same_file (name, fd)
+    char *name;
+    int fd;
+{
+     struct stat fbuf, sbuf;
+
+     return (fstat(fd, &fbuf) == 0 && stat(name, &sbuf) == 0 &&
+	     fbuf.st_dev == sbuf.st_dev && fbuf.st_ino == sbuf.st_ino);
+}
+
+/*
+ * Effects:
+ * Locks the cache file against other writers, and opens a new copy of
+ * it for writing at *fdp, erased if mode is FCC_OPEN_AND_ERASE.
+ */
+static krb5_error_code
+krb5_fcc_open_copy (context, id, mode, fdp)
+    krb5_context context;
+    krb5_ccache id;
+    int mode;
+    int *fdp;
+{
+     krb5_fcc_data *data = (krb5_fcc_data *)id->data;
+     struct stat sbuf;
+     char buf[BUFSIZ];
+     int lockfd, fd, cnt;
+     krb5_error_code retval;
+
+     /* The file may be replaced while we wait for the lock; if so, the
+	lock is on the old file, and we start again with the new one. */
+     for (;;) {
+	 lockfd = THREEPARAMOPEN(data->filename,
+				 ((mode == FCC_OPEN_AND_ERASE) ? O_CREAT : 0) |
+				 O_RDWR | O_BINARY, 0600);
+	 if (lockfd == -1)
+	     return krb5_fcc_interpret (context, errno);
+	 if ((retval = krb5_lock_file(context, lockfd,
+				      KRB5_LOCKMODE_EXCLUSIVE))) {
+	     (void) close(lockfd);
+	     return retval;
+	 }
+	 if (krb5_fcc_same_file(data->filename, lockfd))
+	     break;
+	 (void) krb5_unlock_file(context, lockfd);
+	 (void) close(lockfd);
+     }
+
+     if (fstat(lockfd, &sbuf) == -1) {
+	 retval = krb5_fcc_interpret (context, errno);
+	 goto fail;
+     }
+
+     data->tmpname = malloc(strlen(data->filename) + 20);
+     if (data->tmpname == NULL) {
+	 retval = KRB5_CC_NOMEM;
+	 goto fail;
+     }
+     sprintf(data->tmpname, "%s.%ld", data->filename, (long) getpid());
+
+     /* Any copy by this name was left by a writer which died, since we
+	hold the lock. */
+     (void) unlink(data->tmpname);
+     fd = THREEPARAMOPEN (data->tmpname, O_CREAT|O_EXCL|O_RDWR|O_BINARY,
+			  0600);
+     if (fd == -1) {
+	 retval = krb5_fcc_interpret (context, errno);
+	 krb5_xfree(data->tmpname);
+	 data->tmpname = NULL;
+	 goto fail;
+     }
+
+     /* The copy replaces the cache, so give it the cache's owner and
+	mode. */
+     (void) fchown(fd, sbuf.st_uid, sbuf.st_gid);
+#ifdef HAVE_FCHMOD
+     (void) fchmod(fd, sbuf.st_mode & 07777);
+#endif
+
+     if (mode != FCC_OPEN_AND_ERASE) {
+	 while ((cnt = read(lockfd, buf, sizeof(buf))) > 0)
+	     if (write(fd, buf, cnt) != cnt) {
+		 cnt = -1;
+		 break;
+	     }
+	 if (cnt < 0 || lseek(fd, 0, SEEK_SET) == -1) {
+	     retval = krb5_fcc_interpret (context, errno);
+	     (void) close(fd);
+	     (void) unlink(data->tmpname);
+	     krb5_xfree(data->tmpname);
+	     data->tmpname = NULL;
+	     goto fail;
+	 }
+     }
+
+     data->lockfd = lockfd;
+     *fdp = fd;
+     return 0;
+
+fail:
+     (void) krb5_unlock_file(context, lockfd);
+     (void) close(lockfd);
+     return retval;
+}
+
 krb5_error_code
 krb5_fcc_open_file (context, id, mode)
     krb5_context context;
@@ -78,8 +231,8 @@ krb5_fcc_open_file (context, id, mode)
      krb5_ui_2 fcc_flen;
      krb5_ui_2 fcc_tag;
      krb5_ui_2 fcc_taglen;
-     int fd;
-     int open_flag, lock_flag;
+     int fd = -1;
+     int open_flag, lock_flag, replace;
      krb5_error_code retval = 0;
 
      if (data->fd != -1) {
@@ -89,9 +242,11 @@ krb5_fcc_open_file (context, id, mode)
 	  data->fd = -1;
      }
      data->mode = mode;
+     replace = context->library_options & KRB5_LIBOPT_CCACHE_REPLACE;
      switch(mode) {
      case FCC_OPEN_AND_ERASE:
-	 unlink(data->filename);
+	 if (!replace)
+	     unlink(data->filename);
 	 open_flag = O_CREAT|O_EXCL|O_TRUNC|O_RDWR;
 	 break;
      case FCC_OPEN_RDWR:
@@ -103,18 +258,36 @@ krb5_fcc_open_file (context, id, mode)
 	 break;
      }
 
-     fd = THREEPARAMOPEN (data->filename, open_flag | O_BINARY, 0600);
-     if (fd == -1)
-	  return krb5_fcc_interpret (context, errno);
-
      if (data->mode == FCC_OPEN_RDONLY)
 	lock_flag = KRB5_LOCKMODE_SHARED;
      else 
 	lock_flag = KRB5_LOCKMODE_EXCLUSIVE;
 
-     if ((retval = krb5_lock_file(context, fd, lock_flag))) {
-	 (void) close(fd);
-	 return retval;
+     if (replace && mode != FCC_OPEN_RDONLY) {
+	 if ((retval = krb5_fcc_open_copy(context, id, mode, &fd)))
+	     return retval;
+     } else {
+	 for (;;) {
+	     fd = THREEPARAMOPEN (data->filename, open_flag | O_BINARY, 0600);
+	     if (fd == -1)
+		 return krb5_fcc_interpret (context, errno);
+
+	     /* In replace mode a reader needs no lock. */
+	     if (replace)
+		 break;
+	     if ((retval = krb5_lock_file(context, fd, lock_flag))) {
+		 (void) close(fd);
+		 return retval;
+	     }
+
+	     /* krb5_renew_ccache may have renamed a new file over this
+		one while we waited for the lock; if so, write that one. */
+	     if (mode != FCC_OPEN_RDWR ||
+		 krb5_fcc_same_file(data->filename, fd))
+		 break;
+	     (void) krb5_unlock_file(context, fd);
+	     (void) close(fd);
+	 }
      }
 	 
      if (mode == FCC_OPEN_AND_ERASE) {
@@ -238,9 +411,8 @@ krb5_fcc_open_file (context, id, mode)
 
 done:
      if (retval) {
-	 data->fd = -1;
-	 (void) krb5_unlock_file(context, fd);
-	 (void) close(fd);
+	 data->fd = fd;
+	 (void) krb5_fcc_close_file(context, id);
      }
      return retval;
 }
@@ -84,6 +84,9 @@ krb5_fcc_resolve (context, id, residual)
      /* default to open/close on every trn */
      ((krb5_fcc_data *) lid->data)->flags = KRB5_TC_OPENCLOSE;
      ((krb5_fcc_data *) lid->data)->fd = -1;
+     ((krb5_fcc_data *) lid->data)->wbuf = NULL;
+     ((krb5_fcc_data *) lid->data)->lockfd = -1;
+     ((krb5_fcc_data *) lid->data)->tmpname = NULL;
      
      /* Set up the filename */
      strcpy(((krb5_fcc_data *) lid->data)->filename, residual);
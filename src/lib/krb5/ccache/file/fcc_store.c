@@ -33,6 +33,35 @@
 
 #define CHECK(ret) if (ret != KRB5_OK) return ret;
 
+static krb5_error_code
+krb5_fcc_store_one(context, id, creds)
+   krb5_context context;
+   krb5_ccache id;
+   krb5_creds *creds;
+{
+     krb5_error_code ret;
+
+     ret = krb5_fcc_store_principal(context, id, creds->client);
+     CHECK(ret);
+     ret = krb5_fcc_store_principal(context, id, creds->server);
+     CHECK(ret);
+     ret = krb5_fcc_store_keyblock(context, id, &creds->keyblock);
+     CHECK(ret);
+     ret = krb5_fcc_store_times(context, id, &creds->times);
+     CHECK(ret);
+     ret = krb5_fcc_store_octet(context, id, creds->is_skey);
+     CHECK(ret);
+     ret = krb5_fcc_store_int32(context, id, creds->ticket_flags);
+     CHECK(ret);
+     ret = krb5_fcc_store_addrs(context, id, creds->addresses);
+     CHECK(ret);
+     ret = krb5_fcc_store_authdata(context, id, creds->authdata);
+     CHECK(ret);
+     ret = krb5_fcc_store_data(context, id, &creds->ticket);
+     CHECK(ret);
+     return krb5_fcc_store_data(context, id, &creds->second_ticket);
+}
+
 /*
  * Modifies:
  * the file cache
@@ -50,7 +79,6 @@ krb5_fcc_store(context, id, creds)
    krb5_ccache id;
    krb5_creds *creds;
 {
-#define TCHECK(ret) if (ret != KRB5_OK) goto lose;
      krb5_error_code ret;
 
      MAYBE_OPEN(context, id, FCC_OPEN_RDWR);
@@ -62,30 +90,68 @@ krb5_fcc_store(context, id, creds)
 	  return krb5_fcc_interpret(context, errno);
      }
 
-     ret = krb5_fcc_store_principal(context, id, creds->client);
-     TCHECK(ret);
-     ret = krb5_fcc_store_principal(context, id, creds->server);
-     TCHECK(ret);
-     ret = krb5_fcc_store_keyblock(context, id, &creds->keyblock);
-     TCHECK(ret);
-     ret = krb5_fcc_store_times(context, id, &creds->times);
-     TCHECK(ret);
-     ret = krb5_fcc_store_octet(context, id, creds->is_skey);
-     TCHECK(ret);
-     ret = krb5_fcc_store_int32(context, id, creds->ticket_flags);
-     TCHECK(ret);
-     ret = krb5_fcc_store_addrs(context, id, creds->addresses);
-     TCHECK(ret);
-     ret = krb5_fcc_store_authdata(context, id, creds->authdata);
-     TCHECK(ret);
-     ret = krb5_fcc_store_data(context, id, &creds->ticket);
-     TCHECK(ret);
-     ret = krb5_fcc_store_data(context, id, &creds->second_ticket);
-     TCHECK(ret);
+     ret = krb5_fcc_store_one(context, id, creds);
+
+     MAYBE_CLOSE(context, id, ret);
+     krb5_change_cache ();
+     return ret;
+}
+
+/*
+ * Modifies:
+ * the file cache
+ *
+ * Effects:
+ * stores each of the NULL-terminated array creds in the file cred
+ * cache, opening and locking it once and appending them all with a
+ * single write.  If any of them cannot be encoded, none is stored.
+ *
+ * Errors:
+ * system errors
+ * storage failure errors
+ * KRB5_CC_NOMEM
+ */
+krb5_error_code
+krb5_fcc_store_creds(context, id, creds)
+   krb5_context context;
+   krb5_ccache id;
+   krb5_creds **creds;
+{
+     krb5_fcc_data *data = (krb5_fcc_data *) id->data;
+     krb5_error_code ret;
+     char *buf;
+     int len;
+
+     MAYBE_OPEN(context, id, FCC_OPEN_RDWR);
+
+     ret = lseek(data->fd, 0, SEEK_END);
+     if (ret < 0) {
+	  MAYBE_CLOSE_IGNORE(context, id);
+	  return krb5_fcc_interpret(context, errno);
+     }
+
+     data->wsize = 1024;
+     data->wlen = 0;
+     if ((data->wbuf = malloc(data->wsize)) == NULL) {
+	  MAYBE_CLOSE_IGNORE(context, id);
+	  return KRB5_CC_NOMEM;
+     }
+
+     ret = KRB5_OK;
+     for (; *creds && !ret; creds++)
+	  ret = krb5_fcc_store_one(context, id, *creds);
+
+     buf = data->wbuf;
+     len = data->wlen;
+     data->wbuf = NULL;
+     if (!ret && len)
+	  ret = krb5_fcc_write(context, id, buf, len);
+     /* the buffer holds session keys; clear it whether or not the
+	write succeeded */
+     memset(buf, 0, len);
+     free(buf);
 
-lose:
      MAYBE_CLOSE(context, id, ret);
      krb5_change_cache ();
      return ret;
-#undef TCHECK
 }
@@ -39,10 +39,12 @@
  * id is open
  *
  * Effects:
- * Writes len bytes from buf into the file cred cache id.
+ * Writes len bytes from buf into the file cred cache id, or appends
+ * them to the write buffer if one has been set up.
  *
  * Errors:
  * system errors
+ * KRB5_CC_NOMEM
  */
 krb5_error_code
 krb5_fcc_write(context, id, buf, len)
@@ -51,8 +53,29 @@ krb5_fcc_write(context, id, buf, len)
    krb5_pointer buf;
    int len;
 {
+     krb5_fcc_data *data = (krb5_fcc_data *)id->data;
      int ret;
 
+     if (data->wbuf) {
+	  if (data->wlen + len > data->wsize) {
+	       int nsize = 2 * (data->wlen + len);
+	       char *nbuf = malloc(nsize);
+
+	       if (nbuf == NULL)
+		    return KRB5_CC_NOMEM;
+	       /* not realloc, which would leave the old contents
+		  behind in freed memory */
+	       memcpy(nbuf, data->wbuf, data->wlen);
+	       memset(data->wbuf, 0, data->wlen);
+	       free(data->wbuf);
+	       data->wbuf = nbuf;
+	       data->wsize = nsize;
+	  }
+	  memcpy(data->wbuf + data->wlen, (char *) buf, len);
+	  data->wlen += len;
+	  return KRB5_OK;
+     }
+
      ret = write(((krb5_fcc_data *)id->data)->fd, (char *) buf, len);
      if (ret < 0)
 	  return krb5_fcc_interpret(context, errno);
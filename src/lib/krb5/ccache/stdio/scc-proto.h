@@ -81,6 +81,9 @@ krb5_error_code krb5_scc_open_file
 	PROTOTYPE((krb5_context, 
 		   krb5_ccache,
 		   int));
+krb5_error_code krb5_scc_replace_file 
+	PROTOTYPE((krb5_context, 
+		   krb5_ccache));
 
 /* scc_nseq.c */
 krb5_error_code krb5_scc_next_cred 
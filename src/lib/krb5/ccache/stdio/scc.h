@@ -79,6 +79,8 @@ typedef struct _krb5_scc_data {
      krb5_flags flags;
      char stdio_buffer[BUFSIZ];
      int version;
+     FILE *lockfile;		/* while file is a new copy of the */
+     char *tmpname;		/* cache; see scc_maybe.c */
 } krb5_scc_data;
 
 /* An off_t can be arbitrarily complex */
@@ -95,7 +97,9 @@ typedef struct _krb5_scc_cursor {
 #define MAYBE_CLOSE(context, ID, RET) \
 {									\
     if (OPENCLOSE (ID)) {						\
-	krb5_error_code maybe_close_ret = krb5_scc_close_file (context, ID);	\
+	krb5_error_code maybe_close_ret;				\
+	if (!(RET)) RET = krb5_scc_replace_file (context, ID);		\
+	maybe_close_ret = krb5_scc_close_file (context, ID);		\
 	if (!(RET)) RET = maybe_close_ret; } }
 
 /* DO NOT ADD ANYTHING AFTER THIS #endif */
@@ -84,6 +84,8 @@ krb5_scc_generate_new (context, id)
 
      ((krb5_scc_data *) lid->data)->flags = 0;
      ((krb5_scc_data *) lid->data)->file = 0;
+     ((krb5_scc_data *) lid->data)->lockfile = 0;
+     ((krb5_scc_data *) lid->data)->tmpname = NULL;
      
      /* Set up the filename */
      strcpy(((krb5_scc_data *) lid->data)->filename, scratch);
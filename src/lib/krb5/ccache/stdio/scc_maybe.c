@@ -29,6 +29,7 @@
  * This file contains the source code for conditional open/close calls.
  */
 
+#define NEED_LOWLEVEL_IO
 #include "scc.h"
 #include "k5-int.h"
 
@@ -103,12 +104,140 @@ krb5_scc_close_file (context, id)
      retval = krb5_unlock_file(context, fileno(data->file));
      ret = fclose (data->file);
      data->file = 0;
+     if (data->tmpname) {
+	 (void) remove(data->tmpname);
+	 krb5_xfree(data->tmpname);
+	 data->tmpname = NULL;
+     }
+     if (data->lockfile) {
+	 (void) krb5_unlock_file(context, fileno(data->lockfile));
+	 (void) fclose(data->lockfile);
+	 data->lockfile = 0;
+     }
      if (retval)
 	 return retval;
      else
      return ret ? krb5_scc_interpret (context, errno) : 0;
 }
 
+/*
+ * With ccache_replace set in [libdefaults], writers never change a
+ * cache file in place, and readers do not lock it; this is done as for
+ * the file ccache, which see.  A writer holds a lock on the old file
+ * while it writes a new copy, which is renamed into place here.
+ */
+krb5_error_code
+krb5_scc_replace_file (context, id)
+   krb5_context context;
+   krb5_ccache id;
+{
+     krb5_scc_data *data = (krb5_scc_data *) id->data;
+
+     if (data->tmpname == NULL)
+	 return 0;
+     if (fflush(data->file) == EOF ||
+	 rename(data->tmpname, data->filename) == -1)
+	 return krb5_scc_interpret (context, errno);
+     krb5_xfree(data->tmpname);
+     data->tmpname = NULL;
+     return 0;
+}
+
+/* Lock the cache file against other writers, and open a new copy of
+   it, erased if mode is SCC_OPEN_AND_ERASE. */
+static krb5_error_code
+krb5_scc_open_copy (context, id, mode, fp)
+    krb5_context context;
+    krb5_ccache id;
+    int mode;
+    FILE **fp;
+{
+    krb5_scc_data *data = (krb5_scc_data *) id->data;
+    struct stat fbuf, sbuf;
+    char buf[BUFSIZ];
+    FILE *lockf, *f;
+    int fd, cnt;
+    krb5_error_code retval;
+
+    /* If the file is replaced while we wait for the lock, start again
+       with the new one. */
+    for (;;) {
+	lockf = fopen(data->filename,
+		      (mode == SCC_OPEN_AND_ERASE) ? "ab+" : "rb+");
+	if (!lockf)
+	    return krb5_scc_interpret (context, errno);
+	if ((retval = krb5_lock_file(context, fileno(lockf),
+				     KRB5_LOCKMODE_EXCLUSIVE))) {
+	    (void) fclose(lockf);
+	    return retval;
+	}
+	if (fstat(fileno(lockf), &fbuf) == 0 &&
+	    stat(data->filename, &sbuf) == 0 &&
+	    fbuf.st_dev == sbuf.st_dev && fbuf.st_ino == sbuf.st_ino)
+	    break;
+	(void) krb5_unlock_file(context, fileno(lockf));
+	(void) fclose(lockf);
+    }
+
+    data->tmpname = malloc(strlen(data->filename) + 20);
+    if (data->tmpname == NULL) {
+	retval = KRB5_CC_NOMEM;
+	goto fail;
+    }
+    sprintf(data->tmpname, "%s.%ld", data->filename, (long) getpid());
+
+    /* Any copy by this name was left by a writer which died, since we
+       hold the lock.  Create the new one exclusively, so as not to
+       follow a link planted in its place. */
+    (void) unlink(data->tmpname);
+    fd = THREEPARAMOPEN(data->tmpname, O_CREAT|O_EXCL|O_RDWR|O_BINARY,
+			0600);
+    if (fd == -1 || (f = fdopen(fd, "wb+")) == NULL) {
+	retval = krb5_scc_interpret (context, errno);
+	if (fd != -1) {
+	    (void) close(fd);
+	    (void) unlink(data->tmpname);
+	}
+	krb5_xfree(data->tmpname);
+	data->tmpname = NULL;
+	goto fail;
+    }
+
+    /* The copy replaces the cache, so give it the cache's owner and
+       mode. */
+    (void) fchown(fd, fbuf.st_uid, fbuf.st_gid);
+#ifdef HAVE_FCHMOD
+    (void) fchmod(fd, fbuf.st_mode & 07777);
+#endif
+
+    /* Copy the file underneath f's stdio buffering, which the caller
+       has yet to set up. */
+    if (mode != SCC_OPEN_AND_ERASE) {
+	while ((cnt = read(fileno(lockf), buf, sizeof(buf))) > 0)
+	    if (write(fileno(f), buf, cnt) != cnt) {
+		cnt = -1;
+		break;
+	    }
+	if (cnt < 0 || lseek(fileno(f), 0, SEEK_SET) == -1) {
+	    retval = krb5_scc_interpret (context, errno);
+	    (void) fclose(f);
+	    (void) remove(data->tmpname);
+	    krb5_xfree(data->tmpname);
+	    data->tmpname = NULL;
+	    goto fail;
+	}
+    }
+
+    data->lockfile = lockf;
+    *fp = f;
+    return 0;
+
+fail:
+    (void) krb5_unlock_file(context, fileno(lockf));
+    (void) fclose(lockf);
+    return retval;
+}
+
 krb5_error_code
 krb5_scc_open_file (context, id, mode)
     krb5_context context;
@@ -121,8 +250,9 @@ krb5_scc_open_file (context, id, mode)
     krb5_ui_2 scc_tag;
     krb5_ui_2 scc_taglen;
     krb5_ui_2 scc_hlen;
-    FILE *f;
+    FILE *f = NULL;
     char *open_flag;
+    int replace;
     krb5_error_code retval = 0;
     
     if (data->file) {
@@ -131,10 +261,12 @@ krb5_scc_open_file (context, id, mode)
 	(void) fclose (data->file);
 	data->file = 0;
     }
+    replace = context->library_options & KRB5_LIBOPT_CCACHE_REPLACE;
 #ifdef ANSI_STDIO
     switch(mode) {
     case SCC_OPEN_AND_ERASE:
-	unlink(data->filename);
+	if (!replace)
+	    unlink(data->filename);
 	/* XXX should do an exclusive open here, but no way to do */
 	/* this under stdio */
 	open_flag = "wb+";
@@ -150,7 +282,8 @@ krb5_scc_open_file (context, id, mode)
 #else
     switch(mode) {
     case SCC_OPEN_AND_ERASE:
-	unlink(data->filename);
+	if (!replace)
+	    unlink(data->filename);
 	/* XXX should do an exclusive open here, but no way to do */
 	/* this under stdio */
 	open_flag = "w+";
@@ -165,6 +298,10 @@ krb5_scc_open_file (context, id, mode)
     }
 #endif
 
+    if (replace && mode != SCC_OPEN_RDONLY) {
+	if ((retval = krb5_scc_open_copy(context, id, mode, &f)))
+	    return retval;
+    } else {
 #ifdef macintosh
     f = my_fopen (data->filename, open_flag);
 #else
@@ -172,21 +309,25 @@ krb5_scc_open_file (context, id, mode)
 #endif    
     if (!f)
 	return krb5_scc_interpret (context, errno);
+    }
 #ifdef HAVE_SETVBUF
     setvbuf(f, data->stdio_buffer, _IOFBF, sizeof (data->stdio_buffer));
 #else
     setbuf (f, data->stdio_buffer);
 #endif
+    /* In replace mode neither a reader nor the new copy needs a lock. */
     switch (mode) {
     case SCC_OPEN_RDONLY:
-	if ((retval = krb5_lock_file(context,fileno(f),KRB5_LOCKMODE_SHARED))){
+	if (!replace &&
+	    (retval = krb5_lock_file(context,fileno(f),KRB5_LOCKMODE_SHARED))){
 	    (void) fclose(f);
 	    return retval;
 	}
 	break;
     case SCC_OPEN_RDWR:
     case SCC_OPEN_AND_ERASE:
-	if ((retval = krb5_lock_file(context, fileno(f), 
+	if (!replace &&
+	    (retval = krb5_lock_file(context, fileno(f), 
 				     KRB5_LOCKMODE_EXCLUSIVE))) {
 	    (void) fclose(f);
 	    return retval;
@@ -306,9 +447,8 @@ krb5_scc_open_file (context, id, mode)
 done:
     if (retval)
 	if (f) {
-	    data->file = 0;
-	    (void) krb5_unlock_file(context, fileno(f));
-	    (void) fclose(f);
+	    data->file = f;
+	    (void) krb5_scc_close_file(context, id);
 	}
     return retval;
 }
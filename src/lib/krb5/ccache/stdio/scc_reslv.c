@@ -84,6 +84,8 @@ krb5_scc_resolve (context, id, residual)
      /* default to open/close on every trn */
      ((krb5_scc_data *) lid->data)->flags = KRB5_TC_OPENCLOSE;
      ((krb5_scc_data *) lid->data)->file = 0;
+     ((krb5_scc_data *) lid->data)->lockfile = 0;
+     ((krb5_scc_data *) lid->data)->tmpname = NULL;
      
      /* Set up the filename */
      strcpy(((krb5_scc_data *) lid->data)->filename, residual);
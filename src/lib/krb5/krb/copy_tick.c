@@ -28,8 +28,9 @@
  */
 
 #include "k5-int.h"
+#include "int-proto.h"
 
-static krb5_error_code
+krb5_error_code
 krb5_copy_enc_tkt_part(context, partfrom, partto)
     krb5_context context;
     const krb5_enc_tkt_part *partfrom;
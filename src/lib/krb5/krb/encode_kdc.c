@@ -54,7 +54,8 @@ krb5_encode_kdc_rep(context, type, encpart, using_subkey, client_key,
     krb5_kdc_rep * dec_rep;
     krb5_data ** enc_rep;
 {
-    krb5_data *scratch;
+    krb5_data scratch;
+    char scratchbuf[1024];
     krb5_error_code retval;
     krb5_enc_kdc_rep_part tmp_encpart;
     krb5_keyusage usage;
@@ -91,16 +92,25 @@ krb5_encode_kdc_rep(context, type, encpart, using_subkey, client_key,
      */
     tmp_encpart = *encpart;
     tmp_encpart.msg_type = type;
-    retval = encode_krb5_enc_kdc_rep_part(&tmp_encpart, &scratch);
-    if (retval) {
-	return retval;
+    scratch.data = scratchbuf;
+    scratch.length = sizeof(scratchbuf);
+    retval = encode_krb5_enc_kdc_rep_part_into(&tmp_encpart, &scratch);
+    if (retval == ASN1_OVERFLOW) {
+	if ((scratch.data = malloc(scratch.length)) == NULL)
+	    return ENOMEM;
+	retval = encode_krb5_enc_kdc_rep_part_into(&tmp_encpart, &scratch);
     }
     memset(&tmp_encpart, 0, sizeof(tmp_encpart));
 
-#define cleanup_scratch() { (void) memset(scratch->data, 0, scratch->length); \
-krb5_free_data(context, scratch); }
+#define cleanup_scratch() { (void) memset(scratch.data, 0, scratch.length); \
+if (scratch.data != scratchbuf) free(scratch.data); }
+
+    if (retval) {
+	cleanup_scratch();
+	return retval;
+    }
 
-    retval = krb5_encrypt_helper(context, client_key, usage, scratch,
+    retval = krb5_encrypt_helper(context, client_key, usage, &scratch,
 				 &dec_rep->enc_part);
 
 #define cleanup_encpart() { \
@@ -47,24 +47,33 @@ krb5_encrypt_tkt_part(context, srv_key, dec_ticket)
     krb5_const krb5_keyblock *srv_key;
     register krb5_ticket *dec_ticket;
 {
-    krb5_data *scratch;
+    krb5_data scratch;
+    char scratchbuf[1024];
     krb5_error_code retval;
     register krb5_enc_tkt_part *dec_tkt_part = dec_ticket->enc_part2;
 
-    /*  start by encoding the to-be-encrypted part. */
-    if ((retval = encode_krb5_enc_tkt_part(dec_tkt_part, &scratch))) {
-	return retval;
+    /*  start by encoding the to-be-encrypted part, on the stack if it
+	fits. */
+    scratch.data = scratchbuf;
+    scratch.length = sizeof(scratchbuf);
+    retval = encode_krb5_enc_tkt_part_into(dec_tkt_part, &scratch);
+    if (retval == ASN1_OVERFLOW) {
+	if ((scratch.data = malloc(scratch.length)) == NULL)
+	    return ENOMEM;
+	retval = encode_krb5_enc_tkt_part_into(dec_tkt_part, &scratch);
     }
-
-#define cleanup_scratch() { (void) memset(scratch->data, 0, scratch->length); \
-krb5_free_data(context, scratch); }
+    if (retval)
+	goto cleanup_scratch;
 
     /* call the encryption routine */
     retval = krb5_encrypt_helper(context, srv_key,
-				 KRB5_KEYUSAGE_KDC_REP_TICKET, scratch,
+				 KRB5_KEYUSAGE_KDC_REP_TICKET, &scratch,
 				 &dec_ticket->enc_part);
 
-    cleanup_scratch();
+cleanup_scratch:
+    (void) memset(scratch.data, 0, scratch.length);
+    if (scratch.data != scratchbuf)
+	free(scratch.data);
 
     return(retval);
 }
@@ -62,6 +62,147 @@
 
 #define FLAGS2OPTS(flags) (flags & KDC_TKT_COMMON_MASK)
 
+/*
+ * The client's TGTs are read from the ccache once, into an overlay
+ * which also holds the TGTs fetched along the way, rather than
+ * searching the ccache again for every realm on the path.
+ */
+typedef struct _tgt_overlay {
+    krb5_creds    **cached;	/* read from the ccache */
+    int           ncached;
+    krb5_creds    **fetched;	/* from the KDCs; NULL-terminated */
+    int           nfetched;
+    krb5_enctype  *ktypes;	/* in order of preference */
+} tgt_overlay;
+
+/*
+ * A TGS request of a round.  Each round asks, from the TGT at each of
+ * a chain of positions on the realm path, for TGTs for the target
+ * realm and for every realm beyond the farthest one there is already
+ * a TGT for; all of them are sent at once.
+ */
+typedef struct _tgt_hop {
+    int           seg;		/* the segment asking */
+    int           pos;		/* the position asked for */
+    krb5_creds    in_cred;
+} tgt_hop;
+
+typedef struct _tgt_seg {
+    int           pos;		/* position of the TGT the requests use */
+    krb5_creds    *tgt;
+    int           next;		/* position of the farthest overlay TGT, */
+    krb5_creds    *next_tgt;	/* to go on from if no request succeeds */
+} tgt_seg;
+
+#define PATH_REALM(context, path, i) krb5_princ_component(context, path[i], 1)
+
+static krb5_boolean
+data_equal(d1, d2)
+    const krb5_data *d1, *d2;
+{
+  return (d1->length == d2->length &&
+	  !memcmp(d1->data, d2->data, d1->length));
+}
+
+static krb5_error_code
+load_overlay(context, ccache, client, ov)
+    krb5_context context;
+    krb5_ccache ccache;
+    krb5_principal client;
+    tgt_overlay *ov;
+{
+  krb5_error_code retval;
+  krb5_cc_cursor  cur;
+  krb5_creds      creds, *ncreds, **ncached;
+  krb5_data       *comp0;
+
+  if ((retval = krb5_get_tgs_ktypes(context, NULL, &ov->ktypes)))
+      return retval;
+
+  if ((retval = krb5_cc_start_seq_get(context, ccache, &cur)))
+      return retval;
+
+  while (!(retval = krb5_cc_next_cred(context, ccache, &cur, &creds))) {
+    if (krb5_princ_size(context, creds.server) != 2 ||
+	(comp0 = krb5_princ_component(context, creds.server, 0),
+	 comp0->length != KRB5_TGS_NAME_SIZE ||
+	 memcmp(comp0->data, KRB5_TGS_NAME, KRB5_TGS_NAME_SIZE)) ||
+	!krb5_principal_compare(context, client, creds.client)) {
+      krb5_free_cred_contents(context, &creds);
+      continue;
+    }
+    ncached = (krb5_creds **) realloc(ov->cached, (ov->ncached + 1) *
+				      sizeof(krb5_creds *));
+    if (ncached)
+	ov->cached = ncached;
+    if (!ncached ||
+	!(ncreds = (krb5_creds *) malloc(sizeof(krb5_creds)))) {
+      krb5_free_cred_contents(context, &creds);
+      retval = ENOMEM;
+      break;
+    }
+    *ncreds = creds;
+    ov->cached[ov->ncached++] = ncreds;
+  }
+
+  krb5_cc_end_seq_get(context, ccache, &cur);
+  return (retval == KRB5_CC_END) ? 0 : retval;
+}
+
+static krb5_error_code
+add_fetched(ov, creds)
+    tgt_overlay *ov;
+    krb5_creds *creds;
+{
+  krb5_creds **nfetched;
+
+  nfetched = (krb5_creds **) realloc(ov->fetched, (ov->nfetched + 2) *
+				     sizeof(krb5_creds *));
+  if (!nfetched)
+      return ENOMEM;
+  ov->fetched = nfetched;
+  ov->fetched[ov->nfetched++] = creds;
+  ov->fetched[ov->nfetched] = NULL;
+  return 0;
+}
+
+/*
+ * Find the TGT for realm which has the most preferred of the supported
+ * enctypes, as krb5_cc_retrieve_cred() would with
+ * KRB5_TC_MATCH_SRV_NAMEONLY | KRB5_TC_SUPPORTED_KTYPES; fetched TGTs
+ * are preferred to ones from the ccache.
+ */
+static krb5_error_code
+find_tgt(context, ov, realm, tgt)
+    krb5_context context;
+    tgt_overlay *ov;
+    const krb5_data *realm;
+    krb5_creds **tgt;
+{
+  krb5_error_code retval = KRB5_CC_NOTFOUND;
+  krb5_creds      *creds;
+  int             i, pref, best = -1;
+
+  for (i = 0; i < ov->nfetched + ov->ncached; i++) {
+    creds = (i < ov->nfetched) ? ov->fetched[i] :
+	ov->cached[i - ov->nfetched];
+    if (!data_equal(krb5_princ_component(context, creds->server, 1), realm))
+	continue;
+    for (pref = 0; ov->ktypes[pref]; pref++)
+	if (ov->ktypes[pref] == creds->keyblock.enctype)
+	    break;
+    if (!ov->ktypes[pref]) {
+      retval = KRB5_CC_NOT_KTYPE;
+      continue;
+    }
+    if (best < 0 || pref < best) {
+      best = pref;
+      *tgt = creds;
+    }
+  }
+  return (best < 0) ? retval : 0;
+}
+
 static krb5_error_code
 krb5_get_cred_from_kdc_opt(context, ccache, in_cred, out_cred, tgts, kdcopt)
     krb5_context context;
@@ -71,24 +212,21 @@ krb5_get_cred_from_kdc_opt(context, ccache, in_cred, out_cred, tgts, kdcopt)
     krb5_creds  ***tgts;
     int		kdcopt;
 {
-  krb5_creds      **ret_tgts = NULL;
-  int             ntgts = 0;
-
-  krb5_creds      tgt, tgtq, *tgtr = NULL;
   krb5_error_code retval;
-  krb5_principal  int_server = NULL;    /* Intermediate server for request */
-
+  tgt_overlay     ov;
+  krb5_creds      *tgt, *ntgt;
   krb5_principal  *tgs_list = NULL;
-  krb5_principal  *top_server = NULL;
-  krb5_principal  *next_server = NULL;
-  int             nservers = 0;
+  int             nservers, target, pos, i, j, s;
+
+  tgt_seg         *segs = NULL;
+  tgt_hop         *hops = NULL;
+  krb5int_tgs_call *calls = NULL;
+  int             nsegs, nhops = 0, best;
 
   /* in case we never get a TGT, zero the return */
 
   *tgts = NULL;
-     
-  memset((char *)&tgtq, 0, sizeof(tgtq));
-  memset((char *)&tgt, 0, sizeof(tgt));
+  memset((char *)&ov, 0, sizeof(ov));
 
   /*
    * we know that the desired credentials aren't in the cache yet.
@@ -100,305 +238,187 @@ krb5_get_cred_from_kdc_opt(context, ccache, in_cred, out_cred, tgts, kdcopt)
    * once we have that, then we ask that realm if it can give us
    * tgt for the target.  if not, we do the process over with this
    * new tgt.
-   */
-  
-  /*
+   *
    * (the ticket may be issued by some other intermediate
-   *  realm's KDC; so we use KRB5_TC_MATCH_SRV_NAMEONLY)
+   *  realm's KDC; so only the name of a TGT's server is matched)
    */
-  if ((retval = krb5_copy_principal(context, in_cred->client, &tgtq.client)))
+
+  if ((retval = load_overlay(context, ccache, in_cred->client, &ov)))
       goto cleanup;
 
   /* get target tgt from cache */
-  if ((retval = krb5_tgtname(context, krb5_princ_realm(context, in_cred->server),
-			     krb5_princ_realm(context, in_cred->client),
-			     &int_server))) {
-      goto cleanup;
-  }
+  retval = find_tgt(context, &ov, krb5_princ_realm(context, in_cred->server),
+		    &tgt);
+  if (!retval)
+      goto have_tgt;
 
-  if ((retval = krb5_copy_principal(context, int_server, &tgtq.server))) {
+  /*
+   * Note that we want to request a TGT from our local KDC, even
+   * if we already have a TGT for some intermediate realm.  The 
+   * reason is that our local KDC may have a shortcut to the
+   * destination realm, and if it does we want to use the
+   * shortcut because it will provide greater security. - bcn
+   */
+
+  /*
+   * didn't find it in the cache so it is time to get a local
+   * tgt and walk the realms tree.
+   */
+  if ((retval = find_tgt(context, &ov,
+			 krb5_princ_realm(context, in_cred->client), &tgt)))
       goto cleanup;
-  }
 
-  if ((retval = krb5_cc_retrieve_cred(context, ccache,
-				      KRB5_TC_MATCH_SRV_NAMEONLY | KRB5_TC_SUPPORTED_KTYPES,
-				      &tgtq, &tgt))) {
+  /* get a list of realms to consult */
 
-    if (retval != KRB5_CC_NOTFOUND && retval != KRB5_CC_NOT_KTYPE) {
-	goto cleanup;
-    }
+  if ((retval = krb5_walk_realm_tree(context, 
+				     krb5_princ_realm(context,in_cred->client),
+				     krb5_princ_realm(context,in_cred->server),
+				     &tgs_list, 
+				     KRB5_REALM_BRANCH_CHAR))) {
+      goto cleanup;
+  }
 
-    /*
-     * Note that we want to request a TGT from our local KDC, even
-     * if we already have a TGT for some intermediate realm.  The 
-     * reason is that our local KDC may have a shortcut to the
-     * destination realm, and if it does we want to use the
-     * shortcut because it will provide greater security. - bcn
-     */
-  
-    /*
-     * didn't find it in the cache so it is time to get a local
-     * tgt and walk the realms tree.
-     */
-    krb5_free_principal(context, int_server);
-    int_server = NULL;
-    if ((retval = krb5_tgtname(context, 
-			       krb5_princ_realm(context, in_cred->client),
-			       krb5_princ_realm(context, in_cred->client),
-			       &int_server))) {
-	goto cleanup;
-    }
-  
-    krb5_free_cred_contents(context, &tgtq);
-    memset((char *)&tgtq, 0, sizeof(tgtq));
-    if ((retval = krb5_copy_principal(context, in_cred->client, &tgtq.client)))
-	goto cleanup;
-    if ((retval = krb5_copy_principal(context, int_server, &tgtq.server)))
-	goto cleanup;
+  for (nservers = 0; tgs_list[nservers]; nservers++)
+    ;
+  target = nservers - 1;
 
-    if ((retval = krb5_cc_retrieve_cred(context, ccache,
-					KRB5_TC_MATCH_SRV_NAMEONLY | KRB5_TC_SUPPORTED_KTYPES,
-					&tgtq, &tgt))) {
-	goto cleanup;
-    }
-  
-    /* get a list of realms to consult */
-  
-    if ((retval = krb5_walk_realm_tree(context, 
-				       krb5_princ_realm(context,in_cred->client),
-				       krb5_princ_realm(context,in_cred->server),
-				       &tgs_list, 
-				       KRB5_REALM_BRANCH_CHAR))) {
-	goto cleanup;
-    }
-  
-    for (nservers = 0; tgs_list[nservers]; nservers++)
-      ;
-  
-    /* allocate storage for TGT pointers. */
-    
-    if (!(ret_tgts = (krb5_creds **) calloc(nservers+1, sizeof(krb5_creds)))) {
-      retval = ENOMEM;
-      goto cleanup;
-    }
-    *tgts = ret_tgts;
-    
-    /*
-     * step one is to take the current tgt and see if there is a tgt for
-     * krbtgt/realmof(target)@realmof(tgt).  if not, try to get one with
-     * the tgt.
-     *
-     * if we don't get a tgt for the target, then try to find a tgt as
-     * close to the target realm as possible. at each step if there isn't
-     * a tgt in the cache we have to try and get one with our latest tgt.
-     * once we have a tgt for a closer realm, we go back to step one.
-     *
-     * once we have a tgt for the target, we go try and get credentials.
-     */
-  
-    for (top_server = tgs_list;
-         top_server < tgs_list + nservers;
-         top_server = next_server) {
-    
-      /* look in cache for a tgt for the destination */
-    
-      krb5_free_cred_contents(context, &tgtq);
-      memset(&tgtq, 0, sizeof(tgtq));
-      if ((retval = krb5_copy_principal(context, tgt.client, &tgtq.client)))
-	  goto cleanup;
+  segs = (tgt_seg *) malloc(nservers * sizeof(tgt_seg));
+  hops = (tgt_hop *) calloc(nservers * nservers, sizeof(tgt_hop));
+  calls = (krb5int_tgs_call *) malloc(nservers * nservers *
+				      sizeof(krb5int_tgs_call));
+  if (!segs || !hops || !calls) {
+    retval = ENOMEM;
+    goto cleanup;
+  }
 
-      krb5_free_principal(context, int_server);
-      int_server = NULL;
-      if ((retval = krb5_tgtname(context, 
-				 krb5_princ_realm(context, in_cred->server),
-				 krb5_princ_realm(context, *top_server),
-				 &int_server))) {
-	  goto cleanup;
-      }
-    
-      if ((retval = krb5_copy_principal(context, int_server, &tgtq.server)))
+  /*
+   * The path is walked in rounds.  From the TGT at pos, we ask for a
+   * TGT for the target realm, and for all the realms beyond the
+   * farthest one the overlay already has a TGT for, nearest the
+   * target first; if none of those are issued, we go on from that
+   * TGT, so the same requests are made from it at the same time.  The
+   * farthest TGT issued from the first segment which gets one is
+   * where the next round starts from.
+   */
+  for (pos = 0; pos < target; ) {
+    for (nsegs = 0, ntgt = tgt, i = pos; ; i = segs[nsegs++].next) {
+      if (!valid_enctype(ntgt->keyblock.enctype)) {
+	if (nsegs == 0) {
+	  retval = KRB5_PROG_ETYPE_NOSUPP;
 	  goto cleanup;
-
-      if ((retval = krb5_cc_retrieve_cred(context, ccache,
-					  KRB5_TC_MATCH_SRV_NAMEONLY | KRB5_TC_SUPPORTED_KTYPES,
-					  &tgtq, &tgt))) {
-    
-	if (retval != KRB5_CC_NOTFOUND && retval != KRB5_CC_NOT_KTYPE) {
-	    goto cleanup;
-	}
-  
-	/* didn't find it in the cache so try and get one */
-	/* with current tgt.                              */
-    
-	if (!valid_enctype(tgt.keyblock.enctype)) {
-	    retval = KRB5_PROG_ETYPE_NOSUPP;
-	    goto cleanup;
 	}
-    
-	krb5_free_cred_contents(context, &tgtq);
-	memset(&tgtq, 0, sizeof(tgtq));
-#ifdef HAVE_C_STRUCTURE_ASSIGNMENT
-	tgtq.times        = tgt.times;
-#else
-	memcpy(&tgtq.times, &tgt.times, sizeof(krb5_ticket_times));
-#endif
-
-	if ((retval = krb5_copy_principal(context, tgt.client, &tgtq.client)))
-	    goto cleanup;
-	if ((retval = krb5_copy_principal(context, int_server, &tgtq.server)))
-	    goto cleanup;
-	tgtq.is_skey      = FALSE;
-	tgtq.ticket_flags = tgt.ticket_flags;
-	if ((retval = krb5_get_cred_via_tkt(context, &tgt,
-					    FLAGS2OPTS(tgtq.ticket_flags),
-					    tgt.addresses, &tgtq, &tgtr))) {
-	      
-       /*
-	* couldn't get one so now loop backwards through the realms
-	* list and try and get a tgt for a realm as close to the
-	* target as possible. the kdc should give us a tgt for the
-	* closest one it knows about, but not all kdc's do this yet.
-	*/
-  
-	  for (next_server = tgs_list + nservers - 1;
-	       next_server > top_server;
-	       next_server--) {
-	    krb5_free_cred_contents(context, &tgtq);
-	    memset(&tgtq, 0, sizeof(tgtq));
-	    if ((retval = krb5_copy_principal(context, tgt.client,
-					      &tgtq.client)))
-		goto cleanup;
-
-	    krb5_free_principal(context, int_server);
-	    int_server = NULL;
-	    if ((retval = krb5_tgtname(context, 
-				       krb5_princ_realm(context, *next_server),
-				       krb5_princ_realm(context, *top_server),
-				       &int_server))) {
-		goto cleanup;
-	    }
-    
-	    if ((retval = krb5_copy_principal(context, int_server,
-					      &tgtq.server)))
-		goto cleanup;
-
-	    if ((retval = krb5_cc_retrieve_cred(context, ccache,
-						KRB5_TC_MATCH_SRV_NAMEONLY | KRB5_TC_SUPPORTED_KTYPES,
-						&tgtq, &tgt))) {
-	      if (retval != KRB5_CC_NOTFOUND) {
-		  goto cleanup;
-	      }
-  
-	      /* not in the cache so try and get one with our current tgt. */
-  
-	      if (!valid_enctype(tgt.keyblock.enctype)) {
-		  retval = KRB5_PROG_ETYPE_NOSUPP;
-		  goto cleanup;
-	      }
-            
-	      krb5_free_cred_contents(context, &tgtq);
-	      memset(&tgtq, 0, sizeof(tgtq));
-	      tgtq.times        = tgt.times;
-	      if ((retval = krb5_copy_principal(context, tgt.client,
-						&tgtq.client)))
-		  goto cleanup;
-	      if ((retval = krb5_copy_principal(context, int_server,
-						&tgtq.server)))
-		  goto cleanup;
-	      tgtq.is_skey      = FALSE;
-	      tgtq.ticket_flags = tgt.ticket_flags;
-	      if ((retval = krb5_get_cred_via_tkt(context, &tgt,
-						  FLAGS2OPTS(tgtq.ticket_flags),
-						  tgt.addresses,
-						  &tgtq, &tgtr))) {
-		  continue;
-	      }
-	      
-	      /* save tgt in return array */
-	      if ((retval = krb5_copy_creds(context, tgtr,
-					    &ret_tgts[ntgts]))) {
-		  goto cleanup;
-	      }
-	      krb5_free_creds(context, tgtr);
-	      tgtr = NULL;
-	      
-	      tgt = *ret_tgts[ntgts++];
-	    }
-          
-	    /* got one as close as possible, now start all over */
-  
+	break;
+      }
+      segs[nsegs].pos = i;
+      segs[nsegs].tgt = ntgt;
+      for (j = target; j > i; j--)
+	if (!find_tgt(context, &ov, PATH_REALM(context, tgs_list, j), &ntgt))
 	    break;
-	  }
-  
-	  if (next_server == top_server) {
-	      goto cleanup;
-	  }
-	  continue;
-        }
- 
-	/*
-	 * Got a tgt.  If it is for the target realm we can go try for the
-	 * credentials.  If it is not for the target realm, then make sure it
-	 * is in the realms hierarchy and if so, save it and start the loop
-	 * over from there.  Note that we only need to compare the instance
-	 * names since that is the target realm of the tgt.
-	 */
-    
-	for (next_server = top_server; *next_server; next_server++) {
-            krb5_data *realm_1 = krb5_princ_component(context, next_server[0], 1);
-            krb5_data *realm_2 = krb5_princ_component(context, tgtr->server, 1);
-            if (realm_1->length == realm_2->length &&
-                !memcmp(realm_1->data, realm_2->data, realm_1->length)) {
-		break;
-            }
-	}
-
-	if (!next_server) {
-	    retval = KRB5_KDCREP_MODIFIED;
+      segs[nsegs].next = j;
+      segs[nsegs].next_tgt = ntgt;
+
+      for (j = target; j > segs[nsegs].next; j--) {
+	tgt_hop *hop = &hops[nhops];
+
+	calls[nhops++].in_cred = &hop->in_cred;
+	hop->seg = nsegs;
+	hop->pos = j;
+	if ((retval = krb5_copy_principal(context, segs[nsegs].tgt->client,
+					  &hop->in_cred.client)) ||
+	    (retval = krb5_tgtname(context, PATH_REALM(context, tgs_list, j),
+				   PATH_REALM(context, tgs_list, i),
+				   &hop->in_cred.server)))
 	    goto cleanup;
-	}
+	hop->in_cred.times = segs[nsegs].tgt->times;
+	hop->in_cred.is_skey = FALSE;
+	hop->in_cred.ticket_flags = segs[nsegs].tgt->ticket_flags;
+	calls[nhops - 1].tkt = segs[nsegs].tgt;
+	calls[nhops - 1].kdcoptions =
+	    FLAGS2OPTS(segs[nsegs].tgt->ticket_flags);
+      }
 
-	if ((retval = krb5_copy_creds(context, tgtr, &ret_tgts[ntgts]))) {
-	    goto cleanup;
-	}
-	krb5_free_creds(context, tgtr);
-	tgtr = NULL;
-    
-        tgt = *ret_tgts[ntgts++];
+      if (segs[nsegs].next == i || segs[nsegs].next == target) {
+	nsegs++;
+	break;
+      }
+    }
 
-        /* we're done if it is the target */
+    if ((retval = krb5int_get_creds_via_tkts(context, nhops, calls)))
+	goto cleanup;
+
+    /* keep every TGT issued, whether or not the path goes through it */
+    for (i = 0; i < nhops; i++) {
+      if (calls[i].retval)
+	  continue;
+      if ((retval = add_fetched(&ov, calls[i].out_cred))) {
+	for (; i < nhops; i++)
+	  if (!calls[i].retval)
+	      krb5_free_creds(context, calls[i].out_cred);
+	goto cleanup;
+      }
+    }
 
-        if (!*next_server++) break;
+    for (s = 0; s < nsegs; s++) {
+      for (best = -1, i = 0; i < nhops; i++) {
+	if (hops[i].seg == s && !calls[i].retval && hops[i].pos > best) {
+	  best = hops[i].pos;
+	  tgt = calls[i].out_cred;
+	}
+      }
+      if (best >= 0) {
+	pos = best;
+	break;
+      }
+      if (segs[s].next > segs[s].pos) {
+	tgt = segs[s].next_tgt;
+	pos = segs[s].next;
+	continue;
       }
+
+      /* couldn't get one; fail with the error for the target realm */
+      for (i = 0; hops[i].seg != s; i++)
+	;
+      retval = calls[i].retval;
+      goto cleanup;
     }
+
+    for (i = 0; i < nhops; i++)
+	krb5_free_cred_contents(context, &hops[i].in_cred);
+    memset((char *)hops, 0, nhops * sizeof(tgt_hop));
+    nhops = 0;
   }
 
+have_tgt:
   /* got/finally have tgt!  try for the creds */
 
-  if (!valid_enctype(tgt.keyblock.enctype)) {
+  if (!valid_enctype(tgt->keyblock.enctype)) {
     retval = KRB5_PROG_ETYPE_NOSUPP;
     goto cleanup;
   }
 
-  retval = krb5_get_cred_via_tkt(context, &tgt, FLAGS2OPTS(tgt.ticket_flags) |
+  retval = krb5_get_cred_via_tkt(context, tgt, FLAGS2OPTS(tgt->ticket_flags) |
 				 kdcopt | 
   				 	(in_cred->second_ticket.length ? 
 				  	 KDC_OPT_ENC_TKT_IN_SKEY : 0),
-				 tgt.addresses, in_cred, out_cred);
+				 tgt->addresses, in_cred, out_cred);
 
   /* cleanup and return */
 
 cleanup:
 
-  if (tgtr) krb5_free_creds(context, tgtr);
-  if(tgs_list)  krb5_free_realm_tree(context, tgs_list);
-  krb5_free_cred_contents(context, &tgtq); 
-  if (int_server) krb5_free_principal(context, int_server); 
-  if (ntgts == 0) {
-      *tgts = NULL;
-      if (ret_tgts)  free(ret_tgts);
-      krb5_free_cred_contents(context, &tgt);
+  if (hops) {
+    for (i = 0; i < nhops; i++)
+	krb5_free_cred_contents(context, &hops[i].in_cred);
+    free(hops);
   }
+  if (calls) free(calls);
+  if (segs) free(segs);
+  if (tgs_list)  krb5_free_realm_tree(context, tgs_list);
+  for (i = 0; i < ov.ncached; i++)
+      krb5_free_creds(context, ov.cached[i]);
+  if (ov.cached) free(ov.cached);
+  if (ov.ktypes) free(ov.ktypes);
+  *tgts = ov.fetched;
   return(retval);
 }
 
@@ -101,21 +101,13 @@ cleanup:
     return retval;
 }
  
-krb5_error_code
-krb5_get_cred_via_tkt (context, tkt, kdcoptions, address, in_cred, out_cred)
+static krb5_error_code
+check_tgs_args(context, tkt, kdcoptions, in_cred)
     krb5_context 	  context;
     krb5_creds 		* tkt;
     const krb5_flags 	  kdcoptions;
-    krb5_address *const * address;
     krb5_creds 		* in_cred;
-    krb5_creds 	       ** out_cred;
 {
-    krb5_error_code retval;
-    krb5_kdc_rep *dec_rep;
-    krb5_error *err_reply;
-    krb5_response tgsrep;
-    krb5_enctype *enctypes = 0;
-
     /* tkt->client must be equal to in_cred->client */
     if (!krb5_principal_compare(context, tkt->client, in_cred->client))
 	return KRB5_PRINC_NOMATCH;
@@ -147,6 +139,25 @@ krb5_get_cred_via_tkt (context, tkt, kdcoptions, address, in_cred, out_cred)
     }
 */
 
+    return 0;
+}
+
+static krb5_error_code
+mk_tgs_req(context, tkt, kdcoptions, address, in_cred, tgsrep, request)
+    krb5_context 	  context;
+    krb5_creds 		* tkt;
+    const krb5_flags 	  kdcoptions;
+    krb5_address *const * address;
+    krb5_creds 		* in_cred;
+    krb5_response	* tgsrep;
+    krb5_data	       ** request;
+{
+    krb5_error_code retval;
+    krb5_enctype *enctypes = 0;
+
+    if ((retval = check_tgs_args(context, tkt, kdcoptions, in_cred)))
+	return retval;
+
     if (in_cred->keyblock.enctype) {
 	enctypes = (krb5_enctype *) malloc(sizeof(krb5_enctype)*2);
 	if (!enctypes)
@@ -155,39 +166,55 @@ krb5_get_cred_via_tkt (context, tkt, kdcoptions, address, in_cred, out_cred)
 	enctypes[1] = 0;
     }
     
-    retval = krb5_send_tgs(context, kdcoptions, &in_cred->times, enctypes, 
-			   in_cred->server, address, in_cred->authdata,
-			   0,		/* no padata */
-			   (kdcoptions & KDC_OPT_ENC_TKT_IN_SKEY) ? 
-			   &in_cred->second_ticket : NULL,
-			   tkt, &tgsrep);
+    retval = krb5int_mk_tgs_req(context, kdcoptions, &in_cred->times,
+				enctypes, in_cred->server, address,
+				in_cred->authdata,
+				0,		/* no padata */
+				(kdcoptions & KDC_OPT_ENC_TKT_IN_SKEY) ? 
+				&in_cred->second_ticket : NULL,
+				tkt, tgsrep, request);
     if (enctypes)
 	free(enctypes);
-    if (retval)
-	return retval;
+    return retval;
+}
+
+/* check the reply to a TGS request and make credentials from it */
+static krb5_error_code
+rd_tgs_rep(context, tkt, kdcoptions, address, in_cred, tgsrep, out_cred)
+    krb5_context 	  context;
+    krb5_creds 		* tkt;
+    const krb5_flags 	  kdcoptions;
+    krb5_address *const * address;
+    krb5_creds 		* in_cred;
+    krb5_response	* tgsrep;
+    krb5_creds 	       ** out_cred;
+{
+    krb5_error_code retval;
+    krb5_kdc_rep *dec_rep;
+    krb5_error *err_reply;
 
-    switch (tgsrep.message_type) {
+    switch (tgsrep->message_type) {
     case KRB5_TGS_REP:
 	break;
     case KRB5_ERROR:
     default:
-	if (krb5_is_krb_error(&tgsrep.response))
-	    retval = decode_krb5_error(&tgsrep.response, &err_reply);
+	if (krb5_is_krb_error(&tgsrep->response))
+	    retval = decode_krb5_error(&tgsrep->response, &err_reply);
 	else
 	    retval = KRB5KRB_AP_ERR_MSG_TYPE;
 
 	if (retval) 			/* neither proper reply nor error! */
-	    goto error_4;
+	    return retval;
 
 	retval = err_reply->error + ERROR_TABLE_BASE_krb5;
 
 	krb5_free_error(context, err_reply);
-	goto error_4;
+	return retval;
     }
 
-    if ((retval = krb5_decode_kdc_rep(context, &tgsrep.response,
+    if ((retval = krb5_decode_kdc_rep(context, &tgsrep->response,
 				      &tkt->keyblock, &dec_rep)))
-	goto error_4;
+	return retval;
 
     if (dec_rep->msg_type != KRB5_TGS_REP) {
 	retval = KRB5KRB_AP_ERR_MSG_TYPE;
@@ -206,7 +233,7 @@ krb5_get_cred_via_tkt (context, tkt, kdcoptions, address, in_cred, out_cred)
     if (!krb5_principal_compare(context, dec_rep->ticket->server, in_cred->server))
 	retval = KRB5_KDCREP_MODIFIED;
 
-    if (dec_rep->enc_part2->nonce != tgsrep.expected_nonce)
+    if (dec_rep->enc_part2->nonce != tgsrep->expected_nonce)
 	retval = KRB5_KDCREP_MODIFIED;
 
     if ((kdcoptions & KDC_OPT_POSTDATED) &&
@@ -234,7 +261,7 @@ krb5_get_cred_via_tkt (context, tkt, kdcoptions, address, in_cred, out_cred)
 
     if (!in_cred->times.starttime &&
 	!in_clock_skew(dec_rep->enc_part2->times.starttime,
-		       tgsrep.request_time)) {
+		       tgsrep->request_time)) {
 	retval = KRB5_KDCREP_SKEW;
 	goto error_3;
     }
@@ -246,8 +273,132 @@ error_3:;
     memset(dec_rep->enc_part2->session->contents, 0,
 	   dec_rep->enc_part2->session->length);
     krb5_free_kdc_rep(context, dec_rep);
+    return retval;
+}
+
+krb5_error_code
+krb5_get_cred_via_tkt (context, tkt, kdcoptions, address, in_cred, out_cred)
+    krb5_context 	  context;
+    krb5_creds 		* tkt;
+    const krb5_flags 	  kdcoptions;
+    krb5_address *const * address;
+    krb5_creds 		* in_cred;
+    krb5_creds 	       ** out_cred;
+{
+    krb5_error_code retval;
+    krb5_response tgsrep;
+    krb5_data *request;
+
+    if ((retval = mk_tgs_req(context, tkt, kdcoptions, address, in_cred,
+			     &tgsrep, &request)))
+	return retval;
+
+    /* now send request & get response from KDC */
+    retval = krb5_sendto_kdc(context, request,
+			     krb5_princ_realm(context, in_cred->server),
+			     &tgsrep.response, 0);
+    krb5_free_data(context, request);
+    if (retval)
+	return retval;
+    if (krb5_is_tgs_rep(&tgsrep.response))
+	tgsrep.message_type = KRB5_TGS_REP;
+    else /* assume it's an error */
+	tgsrep.message_type = KRB5_ERROR;
 
-error_4:;
+    retval = rd_tgs_rep(context, tkt, kdcoptions, address, in_cred,
+			&tgsrep, out_cred);
     free(tgsrep.response.data);
     return retval;
 }
+
+/*
+ * Makes the TGS requests in calls[0..ncalls-1] all at once, as
+ * krb5_get_cred_via_tkt would one after the other, using each call's
+ * TGT and the addresses in it.  Each call's retval is set, and its
+ * out_cred if that is 0.  Returns an error only if the requests could
+ * not be made at all.
+ */
+krb5_error_code
+krb5int_get_creds_via_tkts (context, ncalls, calls)
+    krb5_context 	  context;
+    int			  ncalls;
+    krb5int_tgs_call	* calls;
+{
+    krb5_error_code retval;
+    krb5int_tgs_call *call;
+    krb5_response *reps;
+    krb5_data **requests, *replies;
+    const krb5_data **messages, **realms;
+    krb5_error_code *retvals;
+    int *which, nsend, i;
+
+    reps = (krb5_response *) calloc(ncalls, sizeof(*reps));
+    requests = (krb5_data **) calloc(ncalls, sizeof(*requests));
+    messages = (const krb5_data **) calloc(ncalls, sizeof(*messages));
+    realms = (const krb5_data **) calloc(ncalls, sizeof(*realms));
+    replies = (krb5_data *) calloc(ncalls, sizeof(*replies));
+    retvals = (krb5_error_code *) calloc(ncalls, sizeof(*retvals));
+    which = (int *) calloc(ncalls, sizeof(*which));
+    if (!reps || !requests || !messages || !realms || !replies || !retvals
+	|| !which) {
+	retval = ENOMEM;
+	goto cleanup;
+    }
+
+    nsend = 0;
+    for (i = 0; i < ncalls; i++) {
+	call = &calls[i];
+	call->out_cred = NULL;
+	if ((call->retval = mk_tgs_req(context, call->tkt, call->kdcoptions,
+				       call->tkt->addresses, call->in_cred,
+				       &reps[i], &requests[i])))
+	    continue;
+	messages[nsend] = requests[i];
+	realms[nsend] = krb5_princ_realm(context, call->in_cred->server);
+	which[nsend++] = i;
+    }
+
+    retval = 0;
+    if (nsend == 0)
+	goto cleanup;
+
+    /* now send the requests & get responses from the KDCs */
+    (void) krb5int_sendto_kdc_multi(context, nsend, messages, realms,
+				    replies, retvals, 0);
+
+    for (i = 0; i < nsend; i++) {
+	call = &calls[which[i]];
+	if ((call->retval = retvals[i]))
+	    continue;
+	reps[which[i]].response = replies[i];
+	if (krb5_is_tgs_rep(&replies[i]))
+	    reps[which[i]].message_type = KRB5_TGS_REP;
+	else /* assume it's an error */
+	    reps[which[i]].message_type = KRB5_ERROR;
+	call->retval = rd_tgs_rep(context, call->tkt, call->kdcoptions,
+				  call->tkt->addresses, call->in_cred,
+				  &reps[which[i]], &call->out_cred);
+	free(replies[i].data);
+    }
+
+cleanup:
+    if (requests) {
+	for (i = 0; i < ncalls; i++)
+	    if (requests[i])
+		krb5_free_data(context, requests[i]);
+	free(requests);
+    }
+    if (reps)
+	free(reps);
+    if (messages)
+	free(messages);
+    if (realms)
+	free(realms);
+    if (replies)
+	free(replies);
+    if (retvals)
+	free(retvals);
+    if (which)
+	free(which);
+    return retval;
+}
@@ -44,6 +44,7 @@
  */
 
 #include "k5-int.h"
+#include "int-proto.h"
 
 static krb5_error_code
 krb5_get_credentials_core(context, options, ccache, in_creds, out_creds,
@@ -102,7 +103,7 @@ krb5_get_credentials(context, options, ccache, in_creds, out_creds)
     krb5_creds *ncreds;
     krb5_creds **tgts;
     krb5_flags fields;
-    int not_ktype;
+    int not_ktype, stored;
 
     retval = krb5_get_credentials_core(context, options, ccache, 
 				       in_creds, out_creds,
@@ -135,16 +136,26 @@ krb5_get_credentials(context, options, ccache, in_creds, out_creds)
 	not_ktype = 0;
 
     retval = krb5_get_cred_from_kdc(context, ccache, ncreds, out_creds, &tgts);
+    stored = 0;
     if (tgts) {
 	register int i = 0;
 	krb5_error_code rv2;
-	while (tgts[i]) {
-	    if ((rv2 = krb5_cc_store_cred(context, ccache, tgts[i]))) {
-		retval = rv2;
-		break;
-	    }
+	krb5_creds **ntgts;
+
+	while (tgts[i])
 	    i++;
+	/* store the new credentials with the TGTs, in one write if we can */
+	if (!retval &&
+	    (ntgts = (krb5_creds **) realloc(tgts, (i + 2) * sizeof(*tgts)))) {
+	    tgts = ntgts;
+	    tgts[i] = *out_creds;
+	    tgts[i + 1] = NULL;
+	    stored = 1;
 	}
+	if ((rv2 = krb5int_cc_store_creds(context, ccache, tgts)))
+	    retval = rv2;
+	if (stored)
+	    tgts[i] = NULL;
 	krb5_free_tgt_creds(context, tgts);
     }
     /*
@@ -162,11 +173,259 @@ krb5_get_credentials(context, options, ccache, in_creds, out_creds)
 	&& not_ktype)
 	retval = KRB5_CC_NOT_KTYPE;
 
-    if (!retval)
+    if (!retval && !stored)
 	retval = krb5_cc_store_cred(context, ccache, *out_creds);
     return retval;
 }
 
+/* helper macro: convert flags to necessary KDC options */
+
+#define FLAGS2OPTS(flags) (flags & KDC_TKT_COMMON_MASK)
+
+/* is creds a TGT for realm? */
+static krb5_boolean
+tgt_for_realm(context, creds, realm)
+    krb5_context context;
+    krb5_creds *creds;
+    krb5_data *realm;
+{
+    krb5_data *comp;
+
+    if (krb5_princ_size(context, creds->server) != 2)
+	return FALSE;
+    comp = krb5_princ_component(context, creds->server, 0);
+    if (comp->length != KRB5_TGS_NAME_SIZE ||
+	memcmp(comp->data, KRB5_TGS_NAME, KRB5_TGS_NAME_SIZE))
+	return FALSE;
+    comp = krb5_princ_component(context, creds->server, 1);
+    return (comp->length == realm->length &&
+	    !memcmp(comp->data, realm->data, realm->length));
+}
+
+/*
+ * Get credentials for each of in_creds[0..ncreds-1] as
+ * krb5_get_credentials would, but searching ccache once for all of
+ * them, making the TGS requests for them at the same time, and
+ * storing all the credentials obtained together.  retvals[i] is set to
+ * the result for in_creds[i], and out_creds[i] to the credentials if
+ * that is 0.  An error is returned only if the ccache could not be
+ * searched at all; it is then the result for every entry.
+ */
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_get_credentials_multi(context, options, ccache, ncreds, in_creds,
+			   out_creds, retvals)
+    krb5_context context;
+    const krb5_flags options;
+    krb5_ccache ccache;
+    int ncreds;
+    krb5_creds FAR * FAR *in_creds;
+    krb5_creds FAR * FAR *out_creds;
+    krb5_error_code FAR *retvals;
+{
+    krb5_error_code retval;
+    krb5_creds *mcreds = NULL, *found = NULL;
+    krb5_flags *fields = NULL;
+    krb5_error_code *rets = NULL;
+    krb5_creds **tkts = NULL, **tgts, **store = NULL, **nstore;
+    krb5int_tgs_call *calls = NULL;
+    int *state = NULL;
+    int i, j, k, ncalls, nstored = 0, ntgts;
+    krb5_data *realm;
+
+#define GC_DONE		0	/* retvals[i] is final */
+#define GC_NEED_TGS	1	/* ask the KDC, with tkts[i] if it is set */
+#define GC_FETCHED	2	/* out_creds[i] is new, and to be stored */
+
+    for (i = 0; i < ncreds; i++) {
+	out_creds[i] = NULL;
+	retvals[i] = ENOMEM;
+    }
+
+    mcreds = (krb5_creds *) calloc(2 * ncreds, sizeof(krb5_creds));
+    found = (krb5_creds *) calloc(2 * ncreds, sizeof(krb5_creds));
+    fields = (krb5_flags *) calloc(2 * ncreds, sizeof(krb5_flags));
+    rets = (krb5_error_code *) calloc(2 * ncreds, sizeof(krb5_error_code));
+    tkts = (krb5_creds **) calloc(ncreds, sizeof(krb5_creds *));
+    calls = (krb5int_tgs_call *) calloc(ncreds, sizeof(krb5int_tgs_call));
+    state = (int *) calloc(ncreds, sizeof(int));
+    store = (krb5_creds **) calloc(ncreds + 1, sizeof(krb5_creds *));
+    if (!mcreds || !found || !fields || !rets || !tkts || !calls ||
+	!state || !store) {
+	retval = ENOMEM;
+	goto cleanup;
+    }
+
+    /*
+     * Search the ccache for each of the credentials, and for the TGT
+     * for its server's realm in case they aren't there.  A nonzero
+     * rets[] entry is not searched for.
+     */
+    for (i = 0; i < ncreds; i++) {
+	rets[i] = krb5_get_credentials_core(context, options, ccache,
+					    in_creds[i], &out_creds[i],
+					    &mcreds[i], &fields[i]);
+	retvals[i] = rets[i];
+	if (rets[i] || (options & KRB5_GC_CACHED) ||
+	    (rets[ncreds + i] =
+	     krb5_tgtname(context,
+			  krb5_princ_realm(context, in_creds[i]->server),
+			  krb5_princ_realm(context, in_creds[i]->client),
+			  &mcreds[ncreds + i].server))) {
+	    rets[ncreds + i] = KRB5_CC_NOTFOUND;
+	    continue;
+	}
+	mcreds[ncreds + i].client = in_creds[i]->client;
+	fields[ncreds + i] = KRB5_TC_MATCH_SRV_NAMEONLY |
+	    KRB5_TC_SUPPORTED_KTYPES;
+    }
+
+    if ((retval = krb5int_cc_retrieve_creds(context, ccache, 2 * ncreds,
+					    fields, mcreds, found, rets))) {
+	for (i = 0; i < ncreds; i++)
+	    retvals[i] = retval;
+	goto cleanup;
+    }
+
+    for (i = 0; i < ncreds; i++) {
+	if (retvals[i])
+	    continue;
+	if (!rets[i]) {
+	    if ((out_creds[i] = (krb5_creds *) malloc(sizeof(krb5_creds)))) {
+		*out_creds[i] = found[i];
+		memset((char *)&found[i], 0, sizeof(krb5_creds));
+	    } else
+		retvals[i] = ENOMEM;
+	    continue;
+	}
+	retvals[i] = rets[i];
+	if ((rets[i] != KRB5_CC_NOTFOUND && rets[i] != KRB5_CC_NOT_KTYPE)
+	    || options & KRB5_GC_CACHED)
+	    continue;
+	state[i] = GC_NEED_TGS;
+	if (!rets[ncreds + i])
+	    tkts[i] = &found[ncreds + i];
+    }
+
+    /*
+     * Where there is no TGT for the server's realm, walk the realm path
+     * to it, unless an earlier walk has brought us a TGT for it.
+     */
+    for (i = 0; i < ncreds; i++) {
+	if (state[i] != GC_NEED_TGS || tkts[i])
+	    continue;
+	realm = krb5_princ_realm(context, in_creds[i]->server);
+	for (j = 0; j < nstored; j++)
+	    if (tgt_for_realm(context, store[j], realm))
+		break;
+	if (j < nstored) {
+	    tkts[i] = store[j];
+	    continue;
+	}
+
+	retvals[i] = krb5_get_cred_from_kdc(context, ccache, in_creds[i],
+					    &out_creds[i], &tgts);
+	/* see krb5_get_credentials */
+	if ((retvals[i] == KRB5_CC_NOTFOUND ||
+	     retvals[i] == KRB5_CC_NOT_KTYPE) && rets[i] == KRB5_CC_NOT_KTYPE)
+	    retvals[i] = KRB5_CC_NOT_KTYPE;
+	state[i] = GC_DONE;
+	if (!retvals[i])
+	    state[i] = GC_FETCHED;
+	else
+	    out_creds[i] = NULL;
+	if (!tgts)
+	    continue;
+
+	for (k = 0; tgts[k]; k++)
+	    ;
+	nstore = (krb5_creds **) realloc(store, (nstored + k + ncreds + 1) *
+					 sizeof(krb5_creds *));
+	if (!nstore) {
+	    krb5_free_tgt_creds(context, tgts);
+	    continue;
+	}
+	store = nstore;
+	for (k = 0; tgts[k]; k++)
+	    store[nstored++] = tgts[k];
+	free(tgts);
+    }
+
+    /* make the rest of the TGS requests all at once */
+    for (ncalls = 0, i = 0; i < ncreds; i++) {
+	if (state[i] != GC_NEED_TGS)
+	    continue;
+	if (!tkts[i]) {
+	    state[i] = GC_DONE;
+	    continue;
+	}
+	if (!valid_enctype(tkts[i]->keyblock.enctype)) {
+	    retvals[i] = KRB5_PROG_ETYPE_NOSUPP;
+	    state[i] = GC_DONE;
+	    continue;
+	}
+	calls[ncalls].tkt = tkts[i];
+	calls[ncalls].kdcoptions = FLAGS2OPTS(tkts[i]->ticket_flags) |
+	    (in_creds[i]->second_ticket.length ? KDC_OPT_ENC_TKT_IN_SKEY : 0);
+	calls[ncalls].in_cred = in_creds[i];
+	ncalls++;
+    }
+
+    if (ncalls) {
+	retval = krb5int_get_creds_via_tkts(context, ncalls, calls);
+	for (k = 0, i = 0; i < ncreds; i++) {
+	    if (state[i] != GC_NEED_TGS)
+		continue;
+	    state[i] = GC_DONE;
+	    if ((retvals[i] = retval ? retval : calls[k].retval) == 0) {
+		out_creds[i] = calls[k].out_cred;
+		state[i] = GC_FETCHED;
+	    }
+	    k++;
+	}
+    }
+
+    /* store everything obtained, in one write if the ccache can */
+    ntgts = nstored;
+    for (i = 0; i < ncreds; i++)
+	if (state[i] == GC_FETCHED)
+	    store[nstored++] = out_creds[i];
+    store[nstored] = NULL;
+    retval = 0;
+    if (nstored && (retval = krb5int_cc_store_creds(context, ccache,
+						    store))) {
+	for (i = 0; i < ncreds; i++) {
+	    if (state[i] != GC_FETCHED)
+		continue;
+	    krb5_free_creds(context, out_creds[i]);
+	    out_creds[i] = NULL;
+	    retvals[i] = retval;
+	}
+	retval = 0;
+    }
+    for (i = 0; i < ntgts; i++)
+	krb5_free_creds(context, store[i]);
+
+cleanup:
+    if (found) {
+	for (i = 0; i < 2 * ncreds; i++)
+	    krb5_free_cred_contents(context, &found[i]);
+	free(found);
+    }
+    if (mcreds) {
+	for (i = ncreds; i < 2 * ncreds; i++)
+	    if (mcreds[i].server)
+		krb5_free_principal(context, mcreds[i].server);
+	free(mcreds);
+    }
+    if (fields) free(fields);
+    if (rets) free(rets);
+    if (tkts) free(tkts);
+    if (calls) free(calls);
+    if (state) free(state);
+    if (store) free(store);
+    return retval;
+}
+
 #define INT_GC_VALIDATE 1
 #define INT_GC_RENEW 2
 
@@ -105,11 +105,16 @@ krb5_get_init_creds_password(context, creds, client, password, prompter, data,
    char banner[1024], pw0array[1024], pw1array[1024];
    krb5_prompt prompt[2];
    krb5_prompt_type prompt_types[sizeof(prompt)/sizeof(prompt[0])];
+   int s2k_cache;
 
    use_master = 0;
    as_reply = NULL;
    memset(&chpw_creds, 0, sizeof(chpw_creds));
 
+   /* remember the keys derived from the password across the retries
+      below, and forget them on return */
+   s2k_cache = (krb5int_c_s2k_cache_init(context) == 0);
+
    pw0.data = pw0array;
 
    if (password) {
@@ -328,6 +333,8 @@ cleanup:
 
    memset(pw0array, 0, sizeof(pw0array));
    memset(pw1array, 0, sizeof(pw1array));
+   if (s2k_cache)
+      krb5int_c_s2k_cache_free(context);
    krb5_free_cred_contents(context, &chpw_creds);
    if (as_reply)
       krb5_free_kdc_rep(context, as_reply);
@@ -62,6 +62,7 @@ extern void krb5_win_ccdll_load(krb5_context context);
 #endif
 
 static krb5_error_code init_common ();
+static krb5_error_code seed_prng ();
 
 KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
 krb5_init_context(context)
@@ -84,11 +85,6 @@ init_common (context, secure)
 {
 	krb5_context ctx = 0;
 	krb5_error_code retval;
-	struct {
-	    krb5_int32 now, now_usec;
-	    long pid;
-	} seed_data;
-	krb5_data seed;
 	int tmp;
 
 	/* Initialize error tables */
@@ -131,13 +127,7 @@ init_common (context, secure)
 	if ((retval = krb5_os_init_context(ctx)))
 		goto cleanup;
 
-	/* initialize the prng (not well, but passable) */
-	if ((retval = krb5_crypto_us_timeofday(&seed_data.now, &seed_data.now_usec)))
-		goto cleanup;
-	seed_data.pid = getpid ();
-	seed.length = sizeof(seed_data);
-	seed.data = (char *) &seed_data;
-	if ((retval = krb5_c_random_seed(ctx, &seed)))
+	if ((retval = seed_prng(ctx)))
 		goto cleanup;
 
 	ctx->default_realm = 0;
@@ -183,6 +173,13 @@ init_common (context, secure)
 			    &tmp);
 	ctx->library_options = tmp ? KRB5_LIBOPT_SYNC_KDCTIME : 0;
 
+	/* Write file caches by renaming a new copy into place, so that
+	   readers need not lock them; see ccache/file/fcc_maybe.c. */
+	profile_get_integer(ctx->profile, "libdefaults",
+			    "ccache_replace", 0, 0, &tmp);
+	if (tmp)
+	    ctx->library_options |= KRB5_LIBOPT_CCACHE_REPLACE;
+
 	/*
 	 * We use a default file credentials cache of 3.  See
 	 * lib/krb5/krb/ccache/file/fcc.h for a description of the
@@ -200,6 +197,12 @@ init_common (context, secure)
 			    0, DEFAULT_CCACHE_TYPE, &tmp);
 	ctx->fcc_default_format = tmp + 0x0500;
 	ctx->scc_default_format = tmp + 0x0500;
+
+	/* Servers may ask to remember this many decrypted service
+	   tickets; see rd_req_dec.c.  The default is not to. */
+	profile_get_integer(ctx->profile, "libdefaults",
+			    "rd_req_ticket_cache", 0, 0, &tmp);
+	ctx->rd_req_cache_size = (tmp > 0) ? tmp : 0;
 	ctx->prompt_types = 0;
 	*context = ctx;
 	return 0;
@@ -209,12 +212,206 @@ cleanup:
 	return retval;
 }
 
+/* initialize the prng (not well, but passable) */
+static krb5_error_code
+seed_prng(ctx)
+	krb5_context ctx;
+{
+	krb5_error_code retval;
+	struct {
+	    krb5_int32 now, now_usec;
+	    long pid;
+	} seed_data;
+	krb5_data seed;
+
+	if ((retval = krb5_crypto_us_timeofday(&seed_data.now, &seed_data.now_usec)))
+		return retval;
+	seed_data.pid = getpid ();
+	seed.length = sizeof(seed_data);
+	seed.data = (char *) &seed_data;
+	return krb5_c_random_seed(ctx, &seed);
+}
+
+static krb5_error_code
+copy_ktypes(count, in, out)
+	int count;
+	krb5_enctype *in;
+	krb5_enctype **out;
+{
+	*out = 0;
+	if (count == 0)
+		return 0;
+	if ((*out = (krb5_enctype *) malloc(sizeof(krb5_enctype) * (count + 1)))
+	    == NULL)
+		return ENOMEM;
+	memcpy(*out, in, sizeof(krb5_enctype) * count);
+	(*out)[count] = 0;
+	return 0;
+}
+
+/*
+ * Make a new context with the settings of in_context, sharing the
+ * configuration files it has already read rather than reading them
+ * again.  A server which forks for each connection can make one
+ * context at startup and clone it in each child.
+ */
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_init_context_from(in_context, context)
+	krb5_context in_context;
+	krb5_context *context;
+{
+	krb5_context ctx = 0;
+	krb5_os_context in_os_ctx, os_ctx;
+	krb5_error_code retval;
+
+	krb5_init_ets(ctx);
+
+	*context = 0;
+
+	ctx = malloc(sizeof(struct _krb5_context));
+	if (!ctx)
+		return ENOMEM;
+	memset(ctx, 0, sizeof(struct _krb5_context));
+	ctx->magic = KV5M_CONTEXT;
+
+	ctx->profile_secure = in_context->profile_secure;
+#ifdef KRB5_DNS_LOOKUP
+	ctx->profile_in_memory = in_context->profile_in_memory;
+#endif /* KRB5_DNS_LOOKUP */
+
+	if ((retval = copy_ktypes(in_context->in_tkt_ktype_count,
+				  in_context->in_tkt_ktypes,
+				  &ctx->in_tkt_ktypes)))
+		goto cleanup;
+	ctx->in_tkt_ktype_count = in_context->in_tkt_ktype_count;
+	if ((retval = copy_ktypes(in_context->tgs_ktype_count,
+				  in_context->tgs_ktypes, &ctx->tgs_ktypes)))
+		goto cleanup;
+	ctx->tgs_ktype_count = in_context->tgs_ktype_count;
+
+	if (in_context->profile &&
+	    (retval = profile_copy(in_context->profile, &ctx->profile)))
+		goto cleanup;
+
+	if ((retval = krb5_os_init_context(ctx)))
+		goto cleanup;
+	in_os_ctx = in_context->os_context;
+	os_ctx = ctx->os_context;
+	if (in_os_ctx) {
+		os_ctx->time_offset = in_os_ctx->time_offset;
+		os_ctx->usec_offset = in_os_ctx->usec_offset;
+		os_ctx->os_flags = in_os_ctx->os_flags;
+	}
+
+	if ((retval = seed_prng(ctx)))
+		goto cleanup;
+
+	if (in_context->default_realm) {
+		ctx->default_realm = malloc(strlen(in_context->default_realm) + 1);
+		if (!ctx->default_realm) {
+			retval = ENOMEM;
+			goto cleanup;
+		}
+		strcpy(ctx->default_realm, in_context->default_realm);
+	}
+	ctx->clockskew = in_context->clockskew;
+	ctx->kdc_req_sumtype = in_context->kdc_req_sumtype;
+	ctx->default_ap_req_sumtype = in_context->default_ap_req_sumtype;
+	ctx->default_safe_sumtype = in_context->default_safe_sumtype;
+	ctx->kdc_default_options = in_context->kdc_default_options;
+	ctx->library_options = in_context->library_options;
+	ctx->fcc_default_format = in_context->fcc_default_format;
+	ctx->scc_default_format = in_context->scc_default_format;
+	ctx->rd_req_cache_size = in_context->rd_req_cache_size;
+	ctx->prompt_types = 0;
+	*context = ctx;
+	return 0;
+
+cleanup:
+	krb5_free_context(ctx);
+	return retval;
+}
+
+/*
+ * Put into data the settings of context and the contents of the
+ * configuration files it has read, for a process which is to be
+ * exec'd to make its context from with krb5_init_context_from_snapshot().
+ */
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_get_context_snapshot(context, data)
+	krb5_context context;
+	krb5_data *data;
+{
+	krb5_error_code retval;
+	krb5_octet *buf;
+	size_t len;
+
+	if ((retval = krb5_ser_context_init(context)) ||
+	    (retval = krb5_externalize_data(context, (krb5_pointer) context,
+					    &buf, &len)))
+		return retval;
+	data->magic = KV5M_DATA;
+	data->data = (char *) buf;
+	data->length = len;
+	return 0;
+}
+
+/*
+ * Make a new context from a snapshot made by krb5_get_context_snapshot(),
+ * possibly in another process.  The configuration files are not read
+ * again unless they have changed since.
+ */
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_init_context_from_snapshot(data, context)
+	const krb5_data *data;
+	krb5_context *context;
+{
+	struct _krb5_context boot;
+	krb5_context ctx = 0;
+	krb5_error_code retval;
+	krb5_octet *bp;
+	size_t remain;
+
+	krb5_init_ets(ctx);
+
+	*context = 0;
+
+	/* A context just to find the serializers with. */
+	memset(&boot, 0, sizeof(boot));
+	boot.magic = KV5M_CONTEXT;
+	if ((retval = krb5_ser_context_init(&boot)))
+		goto done;
+
+	bp = (krb5_octet *) data->data;
+	remain = data->length;
+	if ((retval = krb5_internalize_opaque(&boot, KV5M_CONTEXT,
+					      (krb5_pointer *) &ctx,
+					      &bp, &remain)))
+		goto done;
+
+	if ((retval = krb5_os_init_context(ctx)) ||
+	    (retval = seed_prng(ctx))) {
+		krb5_free_context(ctx);
+		goto done;
+	}
+	*context = ctx;
+
+done:
+	if (boot.ser_ctx)
+		free(boot.ser_ctx);
+	return retval;
+}
+
 KRB5_DLLIMP void KRB5_CALLCONV
 krb5_free_context(ctx)
 	krb5_context	ctx;
 {
      krb5_free_ets(ctx);
      krb5_os_free_context(ctx);
+     krb5int_c_s2k_cache_free(ctx);
+     krb5int_rd_req_cache_free(ctx);
+     krb5int_realm_map_free(ctx);
+     krb5int_aname_cache_free(ctx);
 
      if (ctx->in_tkt_ktypes) {
           free(ctx->in_tkt_ktypes);
@@ -37,5 +37,38 @@ krb5_error_code krb5_tgtname
 	           const krb5_data *,
 	           krb5_principal *));
 
+krb5_error_code krb5_copy_enc_tkt_part
+	PROTOTYPE((krb5_context context,
+		   const krb5_enc_tkt_part *,
+		   krb5_enc_tkt_part **));
+
+krb5_error_code krb5int_mk_tgs_req
+	PROTOTYPE((krb5_context context,
+		   const krb5_flags,
+		   const krb5_ticket_times *,
+		   const krb5_enctype *,
+		   krb5_const_principal,
+		   krb5_address * const *,
+		   krb5_authdata * const *,
+		   krb5_pa_data * const *,
+		   const krb5_data *,
+		   krb5_creds *,
+		   krb5_response *,
+		   krb5_data **));
+
+/* one of the TGS requests made together by krb5int_get_creds_via_tkts */
+typedef struct _krb5int_tgs_call {
+    krb5_creds *tkt;		/* the TGT to make the request with */
+    krb5_flags kdcoptions;
+    krb5_creds *in_cred;	/* the credentials asked for */
+    krb5_creds *out_cred;	/* the credentials issued */
+    krb5_error_code retval;
+} krb5int_tgs_call;
+
+krb5_error_code krb5int_get_creds_via_tkts
+	PROTOTYPE((krb5_context context,
+		   int,
+		   krb5int_tgs_call *));
+
 #endif /* KRB5_INT_FUNC_PROTO__ */
 
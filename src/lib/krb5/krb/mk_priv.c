@@ -47,7 +47,8 @@ krb5_mk_priv_basic(context, userdata, keyblock, replaydata, local_addr,
     krb5_priv 		privmsg;
     krb5_priv_enc_part 	privmsg_enc_part;
     krb5_data 		*scratch1, *scratch2, ivdata;
-    size_t		blocksize, enclen;
+    krb5_crypto_iov	iov[4];
+    size_t		blocksize, hlen, plen, tlen;
 
     privmsg.enc_part.kvno = 0;	/* XXX allow user-set? */
     privmsg.enc_part.enctype = keyblock->enctype; 
@@ -65,18 +66,39 @@ krb5_mk_priv_basic(context, userdata, keyblock, replaydata, local_addr,
     if ((retval = encode_krb5_enc_priv_part(&privmsg_enc_part, &scratch1)))
 	return retval;
 
-    /* put together an eblock for this encryption */
-    if ((retval = krb5_c_encrypt_length(context, keyblock->enctype,
-					scratch1->length, &enclen)))
+    /* lay out header, data, padding and trailer in one buffer, and
+       encrypt the encoded part in place there */
+    iov[0].flags = KRB5_CRYPTO_TYPE_HEADER;
+    iov[1].flags = KRB5_CRYPTO_TYPE_DATA;
+    iov[1].data.length = scratch1->length;
+    iov[2].flags = KRB5_CRYPTO_TYPE_PADDING;
+    iov[3].flags = KRB5_CRYPTO_TYPE_TRAILER;
+
+    if ((retval = krb5_c_crypto_length(context, keyblock->enctype,
+				       KRB5_CRYPTO_TYPE_HEADER, &hlen)) ||
+	(retval = krb5_c_padding_length(context, keyblock->enctype,
+					scratch1->length, &plen)) ||
+	(retval = krb5_c_crypto_length(context, keyblock->enctype,
+				       KRB5_CRYPTO_TYPE_TRAILER, &tlen)))
 	goto clean_scratch;
+    iov[0].data.length = hlen;
+    iov[2].data.length = plen;
+    iov[3].data.length = tlen;
 
-    privmsg.enc_part.ciphertext.length = enclen;
+    privmsg.enc_part.ciphertext.length = iov[0].data.length +
+	iov[1].data.length + iov[2].data.length + iov[3].data.length;
     if (!(privmsg.enc_part.ciphertext.data =
 	  malloc(privmsg.enc_part.ciphertext.length))) {
         retval = ENOMEM;
         goto clean_scratch;
     }
 
+    iov[0].data.data = privmsg.enc_part.ciphertext.data;
+    iov[1].data.data = iov[0].data.data + iov[0].data.length;
+    iov[2].data.data = iov[1].data.data + iov[1].data.length;
+    iov[3].data.data = iov[2].data.data + iov[2].data.length;
+    memcpy(iov[1].data.data, scratch1->data, scratch1->length);
+
     /* call the encryption routine */
     if (i_vector) {
 	if ((retval = krb5_c_block_size(context, keyblock->enctype,
@@ -87,10 +109,9 @@ krb5_mk_priv_basic(context, userdata, keyblock, replaydata, local_addr,
 	ivdata.data = i_vector;
     }
 
-    if ((retval = krb5_c_encrypt(context, keyblock,
-				 KRB5_KEYUSAGE_KRB_PRIV_ENCPART,
-				 i_vector?&ivdata:0,
-				 scratch1, &privmsg.enc_part)))
+    if ((retval = krb5_c_encrypt_iov(context, keyblock,
+				     KRB5_KEYUSAGE_KRB_PRIV_ENCPART,
+				     i_vector?&ivdata:0, iov, 4)))
 	goto clean_encpart;
 
     if ((retval = encode_krb5_priv(&privmsg, &scratch2)))
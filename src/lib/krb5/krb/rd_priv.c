@@ -70,8 +70,9 @@ krb5_rd_priv_basic(context, inbuf, keyblock, local_addr, remote_addr,
     krb5_priv 		* privmsg;
     krb5_data 		  scratch;
     krb5_priv_enc_part  * privmsg_enc_part;
-    size_t		  blocksize;
+    size_t		  blocksize, hlen, tlen;
     krb5_data		  ivdata;
+    krb5_crypto_iov	  iov[3];
 
     if (!krb5_is_krb_priv(inbuf))
 	return KRB5KRB_AP_ERR_MSG_TYPE;
@@ -89,18 +90,45 @@ krb5_rd_priv_basic(context, inbuf, keyblock, local_addr, remote_addr,
 	ivdata.data = i_vector;
     }
 
-    scratch.length = privmsg->enc_part.ciphertext.length;
-    if (!(scratch.data = malloc(scratch.length))) {
-	retval = ENOMEM;
+    if ((privmsg->enc_part.enctype != ENCTYPE_UNKNOWN) &&
+	(privmsg->enc_part.enctype != keyblock->enctype)) {
+	retval = KRB5_BAD_ENCTYPE;
 	goto cleanup_privmsg;
     }
 
-    if ((retval = krb5_c_decrypt(context, keyblock,
-				 KRB5_KEYUSAGE_KRB_PRIV_ENCPART, 
-				 i_vector?&ivdata:0,
-				 &privmsg->enc_part, &scratch)))
+    /* decrypt in place; the decoded message has no further use for
+       the ciphertext */
+    iov[0].flags = KRB5_CRYPTO_TYPE_HEADER;
+    iov[1].flags = KRB5_CRYPTO_TYPE_DATA;
+    iov[2].flags = KRB5_CRYPTO_TYPE_TRAILER;
+
+    if ((retval = krb5_c_crypto_length(context, keyblock->enctype,
+				       KRB5_CRYPTO_TYPE_HEADER, &hlen)) ||
+	(retval = krb5_c_crypto_length(context, keyblock->enctype,
+				       KRB5_CRYPTO_TYPE_TRAILER, &tlen)))
+	goto cleanup_privmsg;
+    iov[0].data.length = hlen;
+    iov[2].data.length = tlen;
+
+    if (privmsg->enc_part.ciphertext.length <
+	iov[0].data.length + iov[2].data.length) {
+	retval = KRB5_BAD_MSIZE;
+	goto cleanup_privmsg;
+    }
+
+    iov[1].data.length = privmsg->enc_part.ciphertext.length -
+	iov[0].data.length - iov[2].data.length;
+    iov[0].data.data = privmsg->enc_part.ciphertext.data;
+    iov[1].data.data = iov[0].data.data + iov[0].data.length;
+    iov[2].data.data = iov[1].data.data + iov[1].data.length;
+
+    if ((retval = krb5_c_decrypt_iov(context, keyblock,
+				     KRB5_KEYUSAGE_KRB_PRIV_ENCPART, 
+				     i_vector?&ivdata:0, iov, 3)))
 	goto cleanup_scratch;
 
+    scratch = iov[1].data;
+
     /*  now decode the decrypted stuff */
     if ((retval = decode_krb5_enc_priv_part(&scratch, &privmsg_enc_part)))
         goto cleanup_scratch;
@@ -147,8 +175,8 @@ cleanup_data:;
     krb5_free_priv_enc_part(context, privmsg_enc_part);
 
 cleanup_scratch:;
-    memset(scratch.data, 0, scratch.length); 
-    krb5_xfree(scratch.data);
+    memset(privmsg->enc_part.ciphertext.data, 0,
+	   privmsg->enc_part.ciphertext.length); 
 
 cleanup_privmsg:;
     krb5_xfree(privmsg->enc_part.ciphertext.data); 
@@ -31,6 +31,7 @@
 
 #include "k5-int.h"
 #include "auth_con.h"
+#include "int-proto.h"
 
 /*
  * essentially the same as krb_rd_req, but uses a decoded AP_REQ as
@@ -65,6 +66,227 @@ static krb5_error_code decrypt_authenticator
 
 #define in_clock_skew(date) (labs((date)-currenttime) < context->clockskew)
 
+/*
+ * Servers which authenticate every request, as NFS- and HTTP-style
+ * services do, see the same service ticket from a client over and
+ * over.  If rd_req_ticket_cache in [libdefaults] is set, the context
+ * remembers up to that many decrypted tickets, so that a ticket seen
+ * before skips the keytab lookup and the decryption with the service
+ * key.  The authenticator is still decrypted and the replay cache
+ * consulted every time.
+ *
+ * The cache is direct-mapped on a SHA-1 hash of the ticket
+ * ciphertext.  A hit must also match the ticket's server, enctype and
+ * kvno, and the keytab it was decrypted with.  Entries are dropped at
+ * the ticket's endtime, and when the keytab file's size, modification
+ * time or inode changes.  Only file keytabs are cached, since there is
+ * no telling when other kinds change.
+ */
+
+#define TKT_CACHE_MAX		4096
+#define TKT_CACHE_DIGEST	20
+
+struct tkt_cache_id {
+    unsigned char digest[TKT_CACHE_DIGEST];
+    char ktname[MAX_KEYTAB_NAME_LEN];
+    time_t kt_mtime;
+    off_t kt_size;
+    ino_t kt_ino;
+};
+
+struct tkt_cache_entry {
+    krb5_enc_tkt_part *enc_part2;	/* NULL if the entry is unused */
+    unsigned char digest[TKT_CACHE_DIGEST];
+    char *ktname;
+    time_t kt_mtime;
+    off_t kt_size;
+    ino_t kt_ino;
+    krb5_principal server;
+    krb5_enctype enctype;
+    krb5_kvno kvno;
+};
+
+struct tkt_cache {
+    int size;
+    struct tkt_cache_entry *entries;
+};
+
+static void
+tkt_cache_drop(context, entry)
+    krb5_context context;
+    struct tkt_cache_entry *entry;
+{
+    if (entry->enc_part2)
+	krb5_free_enc_tkt_part(context, entry->enc_part2);
+    if (entry->server)
+	krb5_free_principal(context, entry->server);
+    if (entry->ktname)
+	free(entry->ktname);
+    memset(entry, 0, sizeof(*entry));
+}
+
+void
+krb5int_rd_req_cache_free(context)
+    krb5_context context;
+{
+    struct tkt_cache *cache;
+    int i;
+
+    if ((context == NULL) || (context->rd_req_cache == NULL))
+	return;
+
+    cache = (struct tkt_cache *) context->rd_req_cache;
+    for (i = 0; i < cache->size; i++)
+	tkt_cache_drop(context, &cache->entries[i]);
+    free(cache->entries);
+    free(cache);
+    context->rd_req_cache = NULL;
+}
+
+static struct tkt_cache *
+tkt_cache_get(context)
+    krb5_context context;
+{
+    struct tkt_cache *cache;
+    int size;
+
+    if (context->rd_req_cache)
+	return (struct tkt_cache *) context->rd_req_cache;
+    if ((size = context->rd_req_cache_size) <= 0)
+	return NULL;
+    if (size > TKT_CACHE_MAX)
+	size = TKT_CACHE_MAX;
+
+    if (!(cache = (struct tkt_cache *) malloc(sizeof(*cache))))
+	return NULL;
+    cache->entries = (struct tkt_cache_entry *)
+	calloc(size, sizeof(struct tkt_cache_entry));
+    if (cache->entries == NULL) {
+	free(cache);
+	return NULL;
+    }
+    cache->size = size;
+    context->rd_req_cache = cache;
+    return cache;
+}
+
+/* Work out what identifies the ticket and the keytab for the cache.
+   Fails if the keytab is not a file. */
+static krb5_error_code
+tkt_cache_id(context, req, keytab, id)
+    krb5_context          context;
+    const krb5_ap_req 	* req;
+    krb5_keytab           keytab;
+    struct tkt_cache_id * id;
+{
+#ifdef HAVE_SYS_STAT_H
+    krb5_error_code 	  retval;
+    krb5_checksum	  cksum;
+    struct stat		  st;
+    char		* path;
+
+    if ((retval = krb5_kt_get_name(context, keytab, id->ktname,
+				   sizeof(id->ktname))))
+	return retval;
+    if (!(path = strchr(id->ktname, ':')))
+	return KRB5_KT_BADNAME;
+    path++;
+    if (strcmp(krb5_kt_get_type(context, keytab), "FILE") &&
+	strcmp(krb5_kt_get_type(context, keytab), "WRFILE") &&
+	strcmp(krb5_kt_get_type(context, keytab), "SRVTAB"))
+	return KRB5_KT_BADNAME;
+    if (stat(path, &st))
+	return errno;
+    id->kt_mtime = st.st_mtime;
+    id->kt_size = st.st_size;
+    id->kt_ino = st.st_ino;
+
+    if ((retval = krb5_c_make_checksum(context, CKSUMTYPE_NIST_SHA, NULL, 0,
+				       &req->ticket->enc_part.ciphertext,
+				       &cksum)))
+	return retval;
+    if (cksum.length != sizeof(id->digest))
+	retval = KRB5_CRYPTO_INTERNAL;
+    else
+	memcpy(id->digest, cksum.contents, sizeof(id->digest));
+    krb5_xfree(cksum.contents);
+    return retval;
+#else
+    return KRB5_KT_BADNAME;
+#endif
+}
+
+static struct tkt_cache_entry *
+tkt_cache_slot(cache, id)
+    struct tkt_cache    * cache;
+    struct tkt_cache_id * id;
+{
+    unsigned long hash;
+
+    hash = ((unsigned long) id->digest[0] << 24) |
+	((unsigned long) id->digest[1] << 16) |
+	((unsigned long) id->digest[2] << 8) | id->digest[3];
+    return &cache->entries[hash % cache->size];
+}
+
+static int
+tkt_cache_match(context, entry, req, id, now)
+    krb5_context            context;
+    struct tkt_cache_entry *entry;
+    const krb5_ap_req 	  * req;
+    struct tkt_cache_id   * id;
+    krb5_timestamp	    now;
+{
+    krb5_ticket		  * ticket = req->ticket;
+
+    if (entry->enc_part2 == NULL)
+	return 0;
+    if (now > entry->enc_part2->times.endtime) {
+	tkt_cache_drop(context, entry);
+	return 0;
+    }
+    return (!memcmp(entry->digest, id->digest, sizeof(id->digest)) &&
+	    entry->enctype == ticket->enc_part.enctype &&
+	    entry->kvno == ticket->enc_part.kvno &&
+	    entry->kt_mtime == id->kt_mtime &&
+	    entry->kt_size == id->kt_size &&
+	    entry->kt_ino == id->kt_ino &&
+	    !strcmp(entry->ktname, id->ktname) &&
+	    krb5_principal_compare(context, entry->server, ticket->server));
+}
+
+/* Remember a decrypted ticket in its slot.  Failure to remember is not
+   an error. */
+static void
+tkt_cache_store(context, entry, req, id, now)
+    krb5_context            context;
+    struct tkt_cache_entry *entry;
+    const krb5_ap_req 	  * req;
+    struct tkt_cache_id   * id;
+    krb5_timestamp	    now;
+{
+    krb5_ticket		  * ticket = req->ticket;
+
+    tkt_cache_drop(context, entry);
+    if (now > ticket->enc_part2->times.endtime)
+	return;
+    if (!(entry->ktname = malloc(strlen(id->ktname) + 1)))
+	return;
+    strcpy(entry->ktname, id->ktname);
+    if (krb5_copy_principal(context, ticket->server, &entry->server) ||
+	krb5_copy_enc_tkt_part(context, ticket->enc_part2,
+			       &entry->enc_part2)) {
+	tkt_cache_drop(context, entry);
+	return;
+    }
+    memcpy(entry->digest, id->digest, sizeof(entry->digest));
+    entry->kt_mtime = id->kt_mtime;
+    entry->kt_size = id->kt_size;
+    entry->kt_ino = id->kt_ino;
+    entry->enctype = ticket->enc_part.enctype;
+    entry->kvno = ticket->enc_part.kvno;
+}
+
 static krb5_error_code
 krb5_rd_req_decrypt_tkt_part(context, req, keytab)
     krb5_context          context;
@@ -75,6 +297,19 @@ krb5_rd_req_decrypt_tkt_part(context, req, keytab)
     krb5_error_code 	  retval;
     krb5_enctype 	  enctype;
     krb5_keytab_entry 	  ktent;
+    struct tkt_cache	* cache;
+    struct tkt_cache_entry *entry = NULL;
+    struct tkt_cache_id	  id;
+    krb5_timestamp	  now;
+
+    if ((cache = tkt_cache_get(context)) &&
+	!tkt_cache_id(context, req, keytab, &id) &&
+	!krb5_timeofday(context, &now)) {
+	entry = tkt_cache_slot(cache, &id);
+	if (tkt_cache_match(context, entry, req, &id, now))
+	    return krb5_copy_enc_tkt_part(context, entry->enc_part2,
+					  &req->ticket->enc_part2);
+    }
 
     enctype = req->ticket->enc_part.enctype;
 
@@ -87,6 +322,8 @@ krb5_rd_req_decrypt_tkt_part(context, req, keytab)
     /* Upon error, Free keytab entry first, then return */
 
     (void) krb5_kt_free_entry(context, &ktent);
+    if (!retval && entry)
+	tkt_cache_store(context, entry, req, &id, now);
     return retval;
 }
 
@@ -0,0 +1,402 @@
+/*
+ * lib/krb5/krb/renew_cc.c
+ *
+ * Copyright 2000 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ *
+ * krb5_renew_ccache()
+ *
+ * Keep the TGT in a credentials cache renewed ahead of its expiry, for
+ * long-running services and krenewd.  The renewed TGT is written to a
+ * new cache together with the cache's other credentials and then
+ * swapped in, so that readers of the cache see either all of the old
+ * credentials or all of the new ones and are never made to wait.
+ */
+
+#include "k5-int.h"
+#include "int-proto.h"
+#include <stdio.h>
+
+/* The time at which percent of the lifetime of creds will have passed. */
+static krb5_timestamp
+renew_due(creds, percent)
+    krb5_creds *creds;
+    int percent;
+{
+    krb5_timestamp start;
+
+    start = creds->times.starttime ? creds->times.starttime :
+	creds->times.authtime;
+    if (creds->times.endtime <= start)
+	return creds->times.endtime;
+    return start + (creds->times.endtime - start) / 100 * percent;
+}
+
+/*
+ * Get the tickets for prefetch[0..nprefetch-1] which ccache does not
+ * already hold, storing them there.  The first error is returned, once
+ * every ticket has been tried.
+ */
+static krb5_error_code
+prefetch_creds(context, ccache, client, prefetch, nprefetch)
+    krb5_context context;
+    krb5_ccache ccache;
+    krb5_principal client;
+    krb5_principal *prefetch;
+    int nprefetch;
+{
+    krb5_error_code retval;
+    krb5_creds *in = NULL, **inp = NULL, **out = NULL;
+    krb5_error_code *rets = NULL;
+    int i;
+
+    if (nprefetch == 0)
+	return 0;
+
+    in = (krb5_creds *) calloc(nprefetch, sizeof(krb5_creds));
+    inp = (krb5_creds **) calloc(nprefetch, sizeof(krb5_creds *));
+    out = (krb5_creds **) calloc(nprefetch, sizeof(krb5_creds *));
+    rets = (krb5_error_code *) calloc(nprefetch, sizeof(krb5_error_code));
+    if (!in || !inp || !out || !rets) {
+	retval = ENOMEM;
+	goto cleanup;
+    }
+
+    for (i = 0; i < nprefetch; i++) {
+	in[i].client = client;
+	in[i].server = prefetch[i];
+	inp[i] = &in[i];
+    }
+
+    retval = krb5_get_credentials_multi(context, 0, ccache, nprefetch,
+					inp, out, rets);
+    for (i = 0; i < nprefetch; i++) {
+	if (!retval)
+	    retval = rets[i];
+	if (out[i])
+	    krb5_free_creds(context, out[i]);
+    }
+
+cleanup:
+    if (in)
+	free(in);
+    if (inp)
+	free(inp);
+    if (out)
+	free(out);
+    if (rets)
+	free(rets);
+    return retval;
+}
+
+/*
+ * Fill newcc with tgt, the other credentials in fetched, and those in
+ * oldcc which are still current and are not for a server fetched
+ * again.  All of oldcc is read before newcc is written, so they may be
+ * the same cache.
+ */
+static krb5_error_code
+fill_ccache(context, oldcc, newcc, tgt, fetched, now)
+    krb5_context context;
+    krb5_ccache oldcc;
+    krb5_ccache newcc;
+    krb5_creds *tgt;
+    krb5_ccache fetched;
+    krb5_timestamp now;
+{
+    krb5_error_code retval;
+    krb5_ccache cc;
+    krb5_cc_cursor cur;
+    krb5_creds creds, **keep, **nkeep;
+    int nkept = 0, nfetched = 1, i, pass;
+
+    if ((keep = (krb5_creds **) malloc(2 * sizeof(krb5_creds *))) == NULL)
+	return ENOMEM;
+    keep[0] = tgt;
+    keep[1] = NULL;
+
+    for (pass = 0; pass < 2; pass++) {
+	cc = pass ? oldcc : fetched;
+	if ((retval = krb5_cc_start_seq_get(context, cc, &cur)))
+	    goto cleanup;
+	while (!(retval = krb5_cc_next_cred(context, cc, &cur, &creds))) {
+	    for (i = 0; i < nfetched; i++)
+		if (krb5_principal_compare(context, keep[i]->server,
+					   creds.server))
+		    break;
+	    if (i < nfetched || creds.times.endtime <= now) {
+		krb5_free_cred_contents(context, &creds);
+		continue;
+	    }
+	    nkeep = (krb5_creds **) realloc(keep, (nkept + 3) *
+					    sizeof(krb5_creds *));
+	    if (nkeep == NULL ||
+		(nkeep[nkept + 1] = (krb5_creds *) malloc(sizeof(krb5_creds)))
+		== NULL) {
+		if (nkeep)
+		    keep = nkeep;
+		krb5_free_cred_contents(context, &creds);
+		retval = ENOMEM;
+		break;
+	    }
+	    keep = nkeep;
+	    *keep[++nkept] = creds;
+	    keep[nkept + 1] = NULL;
+	    if (!pass)
+		nfetched++;
+	}
+	krb5_cc_end_seq_get(context, cc, &cur);
+	if (retval != KRB5_CC_END)
+	    goto cleanup;
+    }
+
+    if ((retval = krb5_cc_initialize(context, newcc, tgt->client)))
+	goto cleanup;
+    retval = krb5int_cc_store_creds(context, newcc, keep);
+
+cleanup:
+    for (i = 1; i <= nkept; i++)
+	krb5_free_creds(context, keep[i]);
+    free(keep);
+    return retval;
+}
+
+/* Nonzero if fd is open on the file called name. */
+static int
+same_file(fd, name)
+    int fd;
+    const char *name;
+{
+    struct stat fbuf, sbuf;
+
+    return (fstat(fd, &fbuf) == 0 && stat(name, &sbuf) == 0 &&
+	    fbuf.st_dev == sbuf.st_dev && fbuf.st_ino == sbuf.st_ino);
+}
+
+/*
+ * Write the new file for the FILE cache ccache, called name, from tgt,
+ * the credentials in fetched and the ones to be kept from ccache, and
+ * rename it over the old file.  The old file is locked from before it
+ * is read until the rename, so a store into it cannot be lost in
+ * between; writers waiting on the lock notice the rename and start
+ * again on the new file.  The new file is given the old one's owner
+ * and mode, so a krenewd running as root leaves users' caches theirs.
+ */
+static krb5_error_code
+swap_file_ccache(context, ccache, name, tgt, fetched, now)
+    krb5_context context;
+    krb5_ccache ccache;
+    const char *name;
+    krb5_creds *tgt;
+    krb5_ccache fetched;
+    krb5_timestamp now;
+{
+    krb5_error_code retval;
+    krb5_ccache newcc = NULL;
+    struct stat sbuf, nbuf;
+    char *newname;
+    int lockfd = -1, fd = -1, held = 0;
+
+    newname = malloc(strlen(name) + 30);
+    if (newname == NULL)
+	return ENOMEM;
+    sprintf(newname, "FILE:%s.renew%ld", name, (long) getpid());
+
+    /* A shared lock keeps out writers but lets readers in.  If the
+       file was replaced while we waited, lock the new one. */
+    for (;;) {
+	if ((lockfd = THREEPARAMOPEN(name, O_RDONLY, 0)) == -1) {
+	    retval = errno;
+	    goto cleanup;
+	}
+	if ((retval = krb5_lock_file(context, lockfd, KRB5_LOCKMODE_SHARED)))
+	    goto cleanup;
+	if (same_file(lockfd, name))
+	    break;
+	(void) krb5_unlock_file(context, lockfd);
+	(void) close(lockfd);
+    }
+
+    /* Closing any descriptor for the file would drop our lock, so keep
+       the cache's own descriptor open until we are done. */
+    if ((retval = krb5_cc_set_flags(context, ccache, 0)))
+	goto cleanup;
+    held = 1;
+
+    if ((retval = krb5_cc_resolve(context, newname, &newcc)) ||
+	(retval = fill_ccache(context, ccache, newcc, tgt, fetched, now)))
+	goto cleanup;
+
+    if ((fd = THREEPARAMOPEN(newname + 5, O_RDWR, 0)) == -1 ||
+	fstat(lockfd, &sbuf) == -1 || fstat(fd, &nbuf) == -1 ||
+	((sbuf.st_uid != nbuf.st_uid || sbuf.st_gid != nbuf.st_gid) &&
+	 fchown(fd, sbuf.st_uid, sbuf.st_gid) == -1) ||
+	fchmod(fd, sbuf.st_mode & 07777) == -1) {
+	retval = errno;
+	goto cleanup;
+    }
+
+    /* A new cache made in its place meanwhile, by removing the old
+       file rather than writing it, wins. */
+    if (!same_file(lockfd, name))
+	goto cleanup;
+
+    /* MUST be atomic! */
+    if (rename(newname + 5, name) == -1) {
+	retval = errno;
+	goto cleanup;
+    }
+    krb5_cc_close(context, newcc);
+    newcc = NULL;
+
+cleanup:
+    if (fd != -1)
+	(void) close(fd);
+    if (newcc)
+	krb5_cc_destroy(context, newcc);
+    if (held)
+	(void) krb5_cc_set_flags(context, ccache, KRB5_TC_OPENCLOSE);
+    if (lockfd != -1) {
+	(void) krb5_unlock_file(context, lockfd);
+	(void) close(lockfd);
+    }
+    free(newname);
+    return retval;
+}
+
+/*
+ * Store tgt in a memory cache and prefetch the listed tickets into it,
+ * then replace the contents of ccache with those credentials and the
+ * ones still worth keeping from ccache.  A FILE cache is written
+ * beside the old file and renamed over it; other caches are
+ * reinitialized in place.  Nothing is read from or written to ccache
+ * until all the tickets have been fetched.
+ */
+static krb5_error_code
+swap_ccache(context, ccache, tgt, prefetch, nprefetch, now)
+    krb5_context context;
+    krb5_ccache ccache;
+    krb5_creds *tgt;
+    krb5_principal *prefetch;
+    int nprefetch;
+    krb5_timestamp now;
+{
+    krb5_error_code retval, fetchret;
+    krb5_ccache fetched = NULL;
+
+    if ((retval = krb5_cc_resolve(context, "MEMORY:renew_cc", &fetched)) ||
+	(retval = krb5_cc_initialize(context, fetched, tgt->client)) ||
+	(retval = krb5_cc_store_cred(context, fetched, tgt)))
+	goto cleanup;
+
+    /* A ticket we cannot get now is no reason to lose the new TGT. */
+    fetchret = prefetch_creds(context, fetched, tgt->client, prefetch,
+			      nprefetch);
+
+    if (strcmp(krb5_cc_get_type(context, ccache), "FILE") == 0)
+	retval = swap_file_ccache(context, ccache,
+				  krb5_cc_get_name(context, ccache),
+				  tgt, fetched, now);
+    else
+	retval = fill_ccache(context, ccache, ccache, tgt, fetched, now);
+    if (retval == 0)
+	retval = fetchret;
+
+cleanup:
+    if (fetched)
+	krb5_cc_destroy(context, fetched);
+    return retval;
+}
+
+/*
+ * Renew the TGT of ccache's principal if percent of its lifetime has
+ * passed, and make sure ccache holds tickets for prefetch[0..nprefetch-1].
+ * *next_time is set to when this should next be done.  The ticket must
+ * be renewable; if it is not, KRB5KDC_ERR_BADOPTION is returned once it
+ * is due, and *next_time is when it expires.
+ */
+KRB5_DLLIMP krb5_error_code KRB5_CALLCONV
+krb5_renew_ccache(context, ccache, percent, prefetch, nprefetch, next_time)
+    krb5_context context;
+    krb5_ccache ccache;
+    int percent;
+    krb5_principal FAR *prefetch;
+    int nprefetch;
+    krb5_timestamp FAR *next_time;
+{
+    krb5_error_code retval;
+    krb5_principal client = NULL;
+    krb5_creds mcreds, tgt, newtgt;
+    krb5_timestamp now, due;
+
+    memset((char *)&mcreds, 0, sizeof(mcreds));
+    memset((char *)&tgt, 0, sizeof(tgt));
+    memset((char *)&newtgt, 0, sizeof(newtgt));
+    *next_time = 0;
+
+    if (percent <= 0 || percent > 100)
+	return EINVAL;
+
+    if ((retval = krb5_cc_get_principal(context, ccache, &client)))
+	return retval;
+    mcreds.client = client;
+    if ((retval = krb5_tgtname(context, &client->realm, &client->realm,
+			       &mcreds.server)) ||
+	(retval = krb5_cc_retrieve_cred(context, ccache, 0, &mcreds, &tgt)) ||
+	(retval = krb5_timeofday(context, &now)))
+	goto cleanup;
+
+    if (tgt.times.endtime <= now) {
+	retval = KRB5KRB_AP_ERR_TKT_EXPIRED;
+	goto cleanup;
+    }
+
+    due = renew_due(&tgt, percent);
+    if (now < due) {
+	*next_time = due;
+	retval = prefetch_creds(context, ccache, client, prefetch, nprefetch);
+	goto cleanup;
+    }
+
+    if (!(tgt.ticket_flags & TKT_FLG_RENEWABLE) ||
+	tgt.times.renew_till <= tgt.times.endtime) {
+	*next_time = tgt.times.endtime;
+	retval = KRB5KDC_ERR_BADOPTION;
+	goto cleanup;
+    }
+
+    if ((retval = krb5_get_renewed_creds(context, &newtgt, client, ccache,
+					 NULL)))
+	goto cleanup;
+    *next_time = renew_due(&newtgt, percent);
+    retval = swap_ccache(context, ccache, &newtgt, prefetch, nprefetch, now);
+
+cleanup:
+    if (mcreds.server)
+	krb5_free_principal(context, mcreds.server);
+    krb5_free_cred_contents(context, &tgt);
+    krb5_free_cred_contents(context, &newtgt);
+    if (client)
+	krb5_free_principal(context, client);
+    return retval;
+}
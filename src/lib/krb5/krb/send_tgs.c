@@ -28,6 +28,7 @@
  */
 
 #include "k5-int.h"
+#include "int-proto.h"
 
 /*
  Sends a request to the TGS and waits for a response.
@@ -58,7 +59,8 @@ krb5_send_tgs_basic(context, in_data, in_cred, outbuf)
     krb5_checksum         checksum;
     krb5_authenticator 	  authent;
     krb5_ap_req 	  request;
-    krb5_data		* scratch;
+    krb5_data		  scratch;
+    char		  scratchbuf[512];
     krb5_data           * toutbuf;
 
     /* Generate checksum */
@@ -82,14 +84,22 @@ krb5_send_tgs_basic(context, in_data, in_cred, outbuf)
 	return(retval);
     }
 
-    /* encode the authenticator */
-    if ((retval = encode_krb5_authenticator(&authent, &scratch))) {
-        free(checksum.contents);
-	return(retval);
+    /* encode the authenticator, on the stack if it fits */
+    scratch.data = scratchbuf;
+    scratch.length = sizeof(scratchbuf);
+    retval = encode_krb5_authenticator_into(&authent, &scratch);
+    if (retval == ASN1_OVERFLOW) {
+	if ((scratch.data = malloc(scratch.length)) == NULL)
+	    retval = ENOMEM;
+	else
+	    retval = encode_krb5_authenticator_into(&authent, &scratch);
     }
 
     free(checksum.contents);
 
+    if (retval)
+	goto cleanup_data;
+
     request.authenticator.ciphertext.data = 0;
     request.authenticator.kvno = 0;
     request.ap_options = 0;
@@ -102,7 +112,7 @@ krb5_send_tgs_basic(context, in_data, in_cred, outbuf)
     /* call the encryption routine */ 
     if ((retval = krb5_encrypt_helper(context, &in_cred->keyblock,
 				      KRB5_KEYUSAGE_TGS_REQ_AUTH,
-				      scratch, &request.authenticator)))
+				      &scratch, &request.authenticator)))
 	goto cleanup_ticket;
 
     retval = encode_krb5_ap_req(&request, &toutbuf);
@@ -118,18 +128,24 @@ cleanup_ticket:
     krb5_free_ticket(context, request.ticket);
 
 cleanup_data:
-    memset(scratch->data, 0, scratch->length);
-    free(scratch->data);
-
-cleanup_scratch:
-    free(scratch);
+    if (scratch.data != NULL) {
+	memset(scratch.data, 0, scratch.length);
+	if (scratch.data != scratchbuf)
+	    free(scratch.data);
+    }
 
     return retval;
 }
 
+/*
+ * Builds the request krb5_send_tgs sends, in *request, and fills in
+ * the expected nonce and request time in *rep.  *request should be
+ * freed by the caller when finished.
+ */
 krb5_error_code
-krb5_send_tgs(context, kdcoptions, timestruct, ktypes, sname, addrs,
-	      authorization_data, padata, second_ticket, in_cred, rep)
+krb5int_mk_tgs_req(context, kdcoptions, timestruct, ktypes, sname, addrs,
+		   authorization_data, padata, second_ticket, in_cred, rep,
+		   request)
     krb5_context context;
     const krb5_flags kdcoptions;
     const krb5_ticket_times * timestruct;
@@ -141,10 +157,13 @@ krb5_send_tgs(context, kdcoptions, timestruct, ktypes, sname, addrs,
     const krb5_data * second_ticket;
     krb5_creds * in_cred;
     krb5_response * rep;
+    krb5_data ** request;
 {
     krb5_error_code retval;
     krb5_kdc_req tgsreq;
     krb5_data *scratch, scratch2;
+    krb5_data body;
+    char bodybuf[1024];
     krb5_ticket *sec_ticket = 0;
     krb5_ticket *sec_ticket_arr[2];
     krb5_timestamp time_now;
@@ -218,18 +237,27 @@ krb5_send_tgs(context, kdcoptions, timestruct, ktypes, sname, addrs,
     } else
 	tgsreq.second_ticket = 0;
 
-    /* encode the body; then checksum it */
-    if ((retval = encode_krb5_kdc_req_body(&tgsreq, &scratch)))
-	goto send_tgs_error_2;
+    /* encode the body, on the stack if it fits; then checksum it */
+    body.data = bodybuf;
+    body.length = sizeof(bodybuf);
+    retval = encode_krb5_kdc_req_body_into(&tgsreq, &body);
+    if (retval == ASN1_OVERFLOW) {
+	if ((body.data = malloc(body.length)) == NULL) {
+	    retval = ENOMEM;
+	    goto send_tgs_error_2;
+	}
+	retval = encode_krb5_kdc_req_body_into(&tgsreq, &body);
+    }
 
     /*
      * Get an ap_req.
      */
-    if ((retval = krb5_send_tgs_basic(context, scratch, in_cred, &scratch2))) {
-        krb5_free_data(context, scratch);
+    if (retval == 0)
+	retval = krb5_send_tgs_basic(context, &body, in_cred, &scratch2);
+    if (body.data != bodybuf)
+	free(body.data);
+    if (retval)
 	goto send_tgs_error_2;
-    }
-    krb5_free_data(context, scratch);
 
     ap_req_padata.pa_type = KRB5_PADATA_AP_REQ;
     ap_req_padata.length = scratch2.length;
@@ -263,27 +291,10 @@ krb5_send_tgs(context, kdcoptions, timestruct, ktypes, sname, addrs,
     tgsreq.padata = combined_padata;
 
     /* the TGS_REQ is assembled in tgsreq, so encode it */
-    if ((retval = encode_krb5_tgs_req(&tgsreq, &scratch))) {
-	krb5_xfree(ap_req_padata.contents);
-	krb5_xfree(combined_padata);
-	goto send_tgs_error_2;
-    }
+    retval = encode_krb5_tgs_req(&tgsreq, request);
     krb5_xfree(ap_req_padata.contents);
     krb5_xfree(combined_padata);
 
-    /* now send request & get response from KDC */
-    retval = krb5_sendto_kdc(context, scratch, 
-			     krb5_princ_realm(context, sname),
-			     &rep->response, NULL);
-    krb5_free_data(context, scratch);
-
-    if (retval == 0) {
-        if (krb5_is_tgs_rep(&rep->response))
-	    rep->message_type = KRB5_TGS_REP;
-        else /* assume it's an error */
-	    rep->message_type = KRB5_ERROR;
-    }
-
 send_tgs_error_2:;
     if (sec_ticket) 
 	krb5_free_ticket(context, sec_ticket);
@@ -298,5 +309,44 @@ send_tgs_error_1:;
     }
 
 
+    return retval;
+}
+
+krb5_error_code
+krb5_send_tgs(context, kdcoptions, timestruct, ktypes, sname, addrs,
+	      authorization_data, padata, second_ticket, in_cred, rep)
+    krb5_context context;
+    const krb5_flags kdcoptions;
+    const krb5_ticket_times * timestruct;
+    const krb5_enctype * ktypes;
+    krb5_const_principal sname;
+    krb5_address * const * addrs;
+    krb5_authdata * const * authorization_data;
+    krb5_pa_data * const * padata;
+    const krb5_data * second_ticket;
+    krb5_creds * in_cred;
+    krb5_response * rep;
+{
+    krb5_error_code retval;
+    krb5_data *scratch;
+
+    if ((retval = krb5int_mk_tgs_req(context, kdcoptions, timestruct, ktypes,
+				     sname, addrs, authorization_data, padata,
+				     second_ticket, in_cred, rep, &scratch)))
+	return retval;
+
+    /* now send request & get response from KDC */
+    retval = krb5_sendto_kdc(context, scratch, 
+			     krb5_princ_realm(context, sname),
+			     &rep->response, NULL);
+    krb5_free_data(context, scratch);
+
+    if (retval == 0) {
+        if (krb5_is_tgs_rep(&rep->response))
+	    rep->message_type = KRB5_TGS_REP;
+        else /* assume it's an error */
+	    rep->message_type = KRB5_ERROR;
+    }
+
     return retval;
 }
@@ -121,6 +121,7 @@ krb5_context_size(kcontext, arg, sizep)
      *  krb5_int32			for profile_secure
      * 	krb5_int32			for fcc_default_format
      *  krb5_int32			for scc_default_format
+     *  krb5_int32			for rd_req_cache_size
      *    <>				for os_context
      *    <>				for db_context
      *    <>				for profile
@@ -129,7 +130,7 @@ krb5_context_size(kcontext, arg, sizep)
     kret = EINVAL;
     if ((context = (krb5_context) arg)) {
 	/* Calculate base length */
-	required = (14 * sizeof(krb5_int32) +
+	required = (15 * sizeof(krb5_int32) +
 		    (context->in_tkt_ktype_count * sizeof(krb5_int32)) +
 		    (context->tgs_ktype_count * sizeof(krb5_int32)));
 
@@ -295,6 +296,12 @@ krb5_context_externalize(kcontext, arg, buffer, lenremain)
     if (kret)
 	return (kret);
 
+    /* Now rd_req_cache_size */
+    kret = krb5_ser_pack_int32((krb5_int32) context->rd_req_cache_size,
+			       &bp, &remain);
+    if (kret)
+	return (kret);
+
     /* Now handle os_context, if appropriate */
     if (context->os_context) {
 	kret = krb5_externalize_opaque(kcontext, KV5M_OS_CONTEXT,
@@ -471,6 +478,11 @@ krb5_context_internalize(kcontext, argp, buffer, lenremain)
     if ((kret = krb5_ser_unpack_int32(&ibuf, &bp, &remain)))
 	goto cleanup;
     context->scc_default_format = (int) ibuf;
+
+    /* rd_req_cache_size */
+    if ((kret = krb5_ser_unpack_int32(&ibuf, &bp, &remain)))
+	goto cleanup;
+    context->rd_req_cache_size = (int) ibuf;
     
     /* Attempt to read in the os_context */
     kret = krb5_internalize_opaque(kcontext, KV5M_OS_CONTEXT,
@@ -111,7 +111,6 @@ krb5_walk_realm_tree(context, client, server, tree, realm_branch_char)
     int nocommon = 1;
 
 #ifdef CONFIGURABLE_AUTHENTICATION_PATH
-	const char *cap_names[4];
 	char *cap_client, *cap_server;
 	char **cap_nodes;
         krb5_error_code cap_code;
@@ -125,12 +124,8 @@ krb5_walk_realm_tree(context, client, server, tree, realm_branch_char)
 	}
 	strncpy(cap_server, server->data, server->length);
 	cap_server[server->length] = '\0';
-	cap_names[0] = "capaths";
-	cap_names[1] = cap_client;
-	cap_names[2] = cap_server;
-	cap_names[3] = 0;
-	cap_code = profile_get_values(context->profile, cap_names, &cap_nodes);
-	krb5_xfree(cap_names[1]);    /* done with client string */
+	cap_code = krb5int_capaths(context, cap_client, cap_server, &cap_nodes);
+	krb5_xfree(cap_client);    /* done with client string */
 	if (cap_code == 0) {     /* found a path, so lets use it */
 		links = 0;
 		if (*cap_nodes[0] != '.') { /* a link of . means direct */
@@ -143,7 +138,7 @@ krb5_walk_realm_tree(context, client, server, tree, realm_branch_char)
 						/* cleanup eaiser as well */
 		links++;		/* count the null entry at end */
 	} else {			/* no path use hierarchical method */
-	krb5_xfree(cap_names[2]); /* failed, don't need server string */
+	krb5_xfree(cap_server); /* failed, don't need server string */
 #endif
     clen = client->length;
     slen = server->length;
@@ -59,6 +59,75 @@
 #define	KDBM_FETCH(db, key)	dbm_fetch(db, key)
 #endif /*ANAME_DB*/
 
+/* An auth_to_local value, parsed. */
+#define	AN_RULE_BAD	0
+#define	AN_RULE_DB	1
+#define	AN_RULE_RULE	2
+#define	AN_RULE_DEFAULT	3
+
+#ifdef	AN_TO_LN_RULES
+/* One s/<regexp>/<text>/[g] of a RULE. */
+struct aname_subst {
+    char		*regexp;
+    char		*repl;
+    int			doall;
+#if	HAVE_REGCOMP
+    regex_t		match_exp;
+    int			compiled;
+#endif	/* HAVE_REGCOMP */
+};
+#endif	/* AN_TO_LN_RULES */
+
+struct aname_rule {
+    int			type;
+    char		*arg;		/* DB file name */
+    void		*db;		/* DB, kept open once used */
+#ifdef	AN_TO_LN_RULES
+    int			select;		/* has a [<ncomps>:<format>] part */
+    int			ncomps;
+    char		*format;
+    char		*match;		/* (<regexp>) part, if any */
+#if	HAVE_REGCOMP
+    regex_t		match_exp;
+    int			match_compiled;
+#endif	/* HAVE_REGCOMP */
+    struct aname_subst	*subst;
+    int			nsubst;
+    /*
+     * A syntax error in a part is reported only once the parts before
+     * it have been applied, as it was when rules were parsed as used.
+     */
+    krb5_error_code	select_err;
+    krb5_error_code	match_err;
+    krb5_error_code	subst_err;	/* error after subst[nsubst-1] */
+#endif	/* AN_TO_LN_RULES */
+};
+
+/*
+ * Recent translations, by flattened principal name.  Only the answers
+ * which depend on nothing but the profile and the default realm are
+ * kept: a name, or KRB5_LNAME_NOTRANS.
+ */
+#define	AN_RESULT_SLOTS	16
+
+struct aname_result {
+    char		*pname;
+    krb5_error_code	code;
+    char		*lname;
+};
+
+/*
+ * The auth_to_local rules of the default realm, kept in the context
+ * until the profile or the default realm changes.
+ */
+struct aname_cache {
+    unsigned long	generation;
+    char		*realm;
+    struct aname_rule	*rules;		/* NULL if there are none */
+    int			nrules;
+    struct aname_result	results[AN_RESULT_SLOTS];
+};
+
 /*
  * Find the portion of the flattened principal name that we use for mapping.
  */
@@ -92,10 +161,14 @@ aname_full_to_mapping_name(fprincname)
  *
  * The entries in the database are normal C strings, and include the trailing
  * null in the DBM datum.size.
+ *
+ * The database is opened when first used and kept open in *dbp, which
+ * is closed with the rest of the context's aname cache.
  */
 static krb5_error_code
-db_an_to_ln(context, dbname, aname, lnsize, lname)
+db_an_to_ln(context, dbp, dbname, aname, lnsize, lname)
     krb5_context context;
+    void **dbp;
     char *dbname;
     krb5_const_principal aname;
     const int lnsize;
@@ -113,10 +186,13 @@ db_an_to_ln(context, dbname, aname, lnsize, lname)
     key.dsize = strlen(princ_name)+1;	/* need to store the NULL for
 					   decoding */
 
-    db = KDBM_OPEN(dbname, O_RDONLY, 0600);
-    if (!db) {
-	krb5_xfree(princ_name);
-	return KRB5_LNAME_CANTOPEN;
+    if (!(db = (DBM *) *dbp)) {
+	db = KDBM_OPEN(dbname, O_RDONLY, 0600);
+	if (!db) {
+	    krb5_xfree(princ_name);
+	    return KRB5_LNAME_CANTOPEN;
+	}
+	*dbp = (void *) db;
     }
 
     contents = KDBM_FETCH(db, key);
@@ -134,8 +210,6 @@ db_an_to_ln(context, dbname, aname, lnsize, lname)
 	else
 	    retval = 0;
     }
-    /* can't close until we copy the contents. */
-    (void) KDBM_CLOSE(db);
     return retval;
 #else	/* !_MSDOS && !_WIN32 && !MACINTOSH */
     /*
@@ -145,6 +219,15 @@ db_an_to_ln(context, dbname, aname, lnsize, lname)
     return KRB5_LNAME_NOTRANS;
 #endif	/* !_MSDOS && !_WIN32 && !MACINTOSH */
 }
+
+static void
+db_close(db)
+    void *db;
+{
+#if	(!defined(_MSDOS) && !defined(_WIN32) && !defined(macintosh))
+    (void) KDBM_CLOSE((DBM *) db);
+#endif	/* !_MSDOS && !_WIN32 && !MACINTOSH */
+}
 #endif /*ANAME_DB*/
 
 #ifdef	AN_TO_LN_RULES
@@ -188,79 +271,178 @@ db_an_to_ln(context, dbname, aname, lnsize, lname)
  * compile(3).
  */
 
+/*
+ * aname_parse_rule()	- Break up a RULE into its three parts, and compile
+ *			  its regular expressions.
+ *
+ * Parsing stops at the first syntax error, which is noted in the rule to
+ * be returned when the rule is applied.
+ */
+static krb5_error_code
+aname_parse_rule(text, rule)
+    char		*text;
+    struct aname_rule	*rule;
+{
+    char		*current, *cp, *ep, *tp;
+    int			compind;
+    struct aname_subst	*subst;
+
+    current = text;
+    /*
+     * First part.
+     */
+    if (*current == '[') {
+	if (sscanf(current+1, "%d:", &rule->ncomps) != 1) {
+	    rule->select_err = KRB5_CONFIG_BADFORMAT;
+	    return(0);
+	}
+	rule->select = 1;
+	if (!(cp = strchr(current, ':'))) {
+	    rule->select_err = KRB5_CONFIG_BADFORMAT;
+	    return(0);
+	}
+	/* Check the components named before we get to use them. */
+	for (ep = ++cp; (*ep != ']') && (*ep != '\0'); ep++) {
+	    if (*ep == '$') {
+		if ((sscanf(ep+1, "%d", &compind) != 1) ||
+		    (compind < 1) ||
+		    (compind > rule->ncomps)) {
+		    rule->select_err = KRB5_CONFIG_BADFORMAT;
+		    return(0);
+		}
+		while (isdigit(ep[1]))
+		    ep++;
+	    }
+	}
+	if (*ep != ']') {
+	    rule->select_err = KRB5_CONFIG_BADFORMAT;
+	    return(0);
+	}
+	if (!(rule->format = (char *) malloc((size_t) (ep - cp) + 1)))
+	    return(ENOMEM);
+	strncpy(rule->format, cp, (size_t) (ep - cp));
+	rule->format[ep - cp] = '\0';
+	current = ep + 1;
+    }
+
+    /*
+     * Second part.
+     */
+    if (*current == '(') {
+	cp = current + 1;
+	if (!(ep = strchr(cp, ')'))) {
+	    rule->match_err = KRB5_CONFIG_BADFORMAT;
+	    return(0);
+	}
+	if (!(rule->match = (char *) malloc((size_t) (ep - cp) + 1)))
+	    return(ENOMEM);
+	strncpy(rule->match, cp, (size_t) (ep - cp));
+	rule->match[ep - cp] = '\0';
+#if	HAVE_REGCOMP
+	rule->match_compiled = !regcomp(&rule->match_exp, rule->match,
+					REG_EXTENDED);
+#endif	/* HAVE_REGCOMP */
+	current = ep + 1;
+    }
+
+    /*
+     * Third part.
+     */
+    for (cp = current; *cp; ) {
+	/* Skip leading whitespace */
+	while (isspace(*cp))
+	    cp++;
+
+	/*
+	 * Find our separators.  First two characters must be "s/"
+	 * We must also find another "/" followed by another "/".
+	 */
+	if (!((cp[0] == 's') &&
+	      (cp[1] == '/') &&
+	      (ep = strchr(&cp[2], '/')) &&
+	      (tp = strchr(&ep[1], '/')))) {
+	    /* Bad syntax */
+	    rule->subst_err = KRB5_CONFIG_BADFORMAT;
+	    break;
+	}
+
+	subst = (struct aname_subst *)
+	    realloc(rule->subst, (rule->nsubst + 1) * sizeof(*subst));
+	if (!subst)
+	    return(ENOMEM);
+	rule->subst = subst;
+	subst = &rule->subst[rule->nsubst];
+	memset(subst, 0, sizeof(*subst));
+	rule->nsubst++;
+
+	/* Copy the strings */
+	if (!(subst->regexp = (char *) malloc((size_t) (ep - &cp[2]) + 1)) ||
+	    !(subst->repl = (char *) malloc((size_t) (tp - &ep[1]) + 1)))
+	    return(ENOMEM);
+	strncpy(subst->regexp, &cp[2], (size_t) (ep - &cp[2]));
+	subst->regexp[ep - &cp[2]] = '\0';
+	strncpy(subst->repl, &ep[1], (size_t) (tp - &ep[1]));
+	subst->repl[tp - &ep[1]] = '\0';
+#if	HAVE_REGCOMP
+	subst->compiled = !regcomp(&subst->match_exp, subst->regexp,
+				   REG_EXTENDED);
+#endif	/* HAVE_REGCOMP */
+
+	/* Check for trailing "g" */
+	subst->doall = (tp[1] == 'g') ? 1 : 0;
+	if (subst->doall)
+	    tp++;
+
+	/* Advance past trailer */
+	cp = &tp[1];
+    }
+    return(0);
+}
+
 /*
  * aname_do_match() 	- Does our name match the parenthesized regular
  *			  expression?
  * 
- * Chew up the match portion of the regular expression and update *contextp.
  * If no re_comp() or regcomp(), then always return a match.
  */
 static krb5_error_code
-aname_do_match(string, contextp)
-    char	*string;
-    char	**contextp;
+aname_do_match(string, rule)
+    char		*string;
+    struct aname_rule	*rule;
 {
     krb5_error_code	kret;
-    char		*regexp, *startp, *endp = 0;
-    size_t		regexlen;
 #if	HAVE_REGCOMP
-    regex_t		match_exp;
     regmatch_t		match_match;
 #elif	HAVE_REGEXPR_H
     char		regexp_buffer[RE_BUF_SIZE];
 #endif	/* HAVE_REGEXP_H */
 
-    kret = 0;
+    kret = KRB5_LNAME_NOTRANS;
     /*
-     * Is this a match expression?
+     * Perform the match.
      */
-    if (**contextp == '(') {
-	kret = KRB5_CONFIG_BADFORMAT;
-	startp = (*contextp) + 1;
-	endp = strchr(startp, ')');
-	/* Find the end of the match expression. */
-	if (endp) {
-	    regexlen = (size_t) (endp - startp);
-	    regexp = (char *) malloc((size_t) regexlen+1);
-	    kret = ENOMEM;
-	    if (regexp) {
-		strncpy(regexp, startp, regexlen);
-		regexp[regexlen] = '\0';
-		kret = KRB5_LNAME_NOTRANS;
-		/*
-		 * Perform the match.
-		 */
 #if	HAVE_REGCOMP
-		if (!regcomp(&match_exp, regexp, REG_EXTENDED) &&
-		    !regexec(&match_exp, string, 1, &match_match, 0)) {
-		    if ((match_match.rm_so == 0) &&
-			(match_match.rm_eo == strlen(string)))
-			kret = 0;
-		}
-		regfree(&match_exp);
+    if (rule->match_compiled &&
+	!regexec(&rule->match_exp, string, 1, &match_match, 0)) {
+	if ((match_match.rm_so == 0) &&
+	    (match_match.rm_eo == strlen(string)))
+	    kret = 0;
+    }
 #elif	HAVE_REGEXPR_H
-		compile(regexp,
-			regexp_buffer,
-			&regexp_buffer[RE_BUF_SIZE]);
-		if (step(string, regexp_buffer)) {
-		    if ((loc1 == string) &&
-			(loc2 == &string[strlen(string)]))
-			kret = 0;
-		}
+    compile(rule->match,
+	    regexp_buffer,
+	    &regexp_buffer[RE_BUF_SIZE]);
+    if (step(string, regexp_buffer)) {
+	if ((loc1 == string) &&
+	    (loc2 == &string[strlen(string)]))
+	    kret = 0;
+    }
 #elif	HAVE_RE_COMP
-		if (!re_comp(regexp) && re_exec(string))
-		    kret = 0;
+    if (!re_comp(rule->match) && re_exec(string))
+	kret = 0;
 #else	/* HAVE_RE_COMP */
-		kret = 0;
+    kret = 0;
 #endif	/* HAVE_RE_COMP */
-		free(regexp);
-	    }
-	    endp++;
-	}
-	else
-	    endp = startp;
-    }
-    *contextp = endp;
     return(kret);
 }
 
@@ -274,34 +456,31 @@ aname_do_match(string, contextp)
  * string.
  */
 static void
-do_replacement(regexp, repl, doall, in, out)
-    char	*regexp;
-    char	*repl;
-    int		doall;
-    char	*in;
-    char	*out;
+do_replacement(subst, in, out)
+    struct aname_subst	*subst;
+    char		*in;
+    char		*out;
 {
 #if	HAVE_REGCOMP
-    regex_t	match_exp;
     regmatch_t	match_match;
     int		matched;
     char	*cp;
     char	*op;
 
-    if (!regcomp(&match_exp, regexp, REG_EXTENDED)) {
+    if (subst->compiled) {
 	cp = in;
 	op = out;
 	matched = 0;
 	do {
-	    if (!regexec(&match_exp, cp, 1, &match_match, 0)) {
+	    if (!regexec(&subst->match_exp, cp, 1, &match_match, 0)) {
 		if (match_match.rm_so) {
 		    strncpy(op, cp, match_match.rm_so);
 		    op += match_match.rm_so;
 		}
-		strncpy(op, repl, MAX_FORMAT_BUFFER - 1 - (op - out));
+		strncpy(op, subst->repl, MAX_FORMAT_BUFFER - 1 - (op - out));
 		op += strlen(op);
 		cp += match_match.rm_eo;
-		if (!doall)
+		if (!subst->doall)
 		    strncpy(op, cp, MAX_FORMAT_BUFFER - 1 - (op - out));
 		matched = 1;
 	    }
@@ -309,8 +488,7 @@ do_replacement(regexp, repl, doall, in, out)
 		strncpy(op, cp, MAX_FORMAT_BUFFER - 1 - (op - out));
 		matched = 0;
 	    }
-	} while (doall && matched);
-	regfree(&match_exp);
+	} while (subst->doall && matched);
     }
 #elif	HAVE_REGEXPR_H
     int		matched;
@@ -319,7 +497,7 @@ do_replacement(regexp, repl, doall, in, out)
     char	regexp_buffer[RE_BUF_SIZE];
     size_t	sdispl, edispl;
 
-    compile(regexp,
+    compile(subst->regexp,
 	    regexp_buffer,
 	    &regexp_buffer[RE_BUF_SIZE]);
     cp = in;
@@ -333,10 +511,10 @@ do_replacement(regexp, repl, doall, in, out)
 		strncpy(op, cp, sdispl);
 		op += sdispl;
 	    }
-	    strncpy(op, repl, MAX_FORMAT_BUFFER - 1 - (op - out));
-	    op += strlen(repl);
+	    strncpy(op, subst->repl, MAX_FORMAT_BUFFER - 1 - (op - out));
+	    op += strlen(subst->repl);
 	    cp += edispl;
-	    if (!doall)
+	    if (!subst->doall)
 		strncpy(op, cp, MAX_FORMAT_BUFFER - 1 - (op - out));
 	    matched = 1;
 	}
@@ -344,31 +522,27 @@ do_replacement(regexp, repl, doall, in, out)
 	    strncpy(op, cp, MAX_FORMAT_BUFFER - 1 - (op - out));
 	    matched = 0;
 	}
-    } while (doall && matched);
+    } while (subst->doall && matched);
 #else	/* HAVE_REGEXP_H */
     memcpy(out, in, MAX_FORMAT_BUFFER);
 #endif	/* HAVE_REGCOMP */
 }
 
 /*
- * aname_replacer()	- Perform the specified substitutions on the input
+ * aname_replacer()	- Perform the rule's substitutions on the input
  *			  string and return the result.
- *
- * This routine enforces the "s/<pattern>/<replacement>/[g]" syntax.
  */
 static krb5_error_code
-aname_replacer(string, contextp, result)
-    char	*string;
-    char	**contextp;
-    char	**result;
+aname_replacer(string, rule, result)
+    char		*string;
+    struct aname_rule	*rule;
+    char		**result;
 {
     krb5_error_code	kret;
     char		*in;
     char		*out;
-    char		*cp, *ep, *tp;
-    char		*rule, *repl;
-    size_t		rule_size, repl_size;
-    int			doglobal;
+    char		*ep;
+    int			i;
 
     kret = ENOMEM;
     *result = (char *) NULL;
@@ -383,76 +557,32 @@ aname_replacer(string, contextp, result)
 	out[MAX_FORMAT_BUFFER - 1] = '\0';
 	in[0] = '\0';
 	kret = 0;
-	/*
-	 * Pound through the expression until we're done.
-	 */
-	for (cp = *contextp; *cp; ) {
-	    /* Skip leading whitespace */
-	    while (isspace(*cp))
-		cp++;
+	for (i = 0; i < rule->nsubst; i++) {
+	    /* Swap previous in and out buffers */
+	    ep = in;
+	    in = out;
+	    out = ep;
 
-	    /*
-	     * Find our separators.  First two characters must be "s/"
-	     * We must also find another "/" followed by another "/".
-	     */
-	    if ((cp[0] == 's') &&
-		(cp[1] == '/') &&
-		(ep = strchr(&cp[2], '/')) &&
-		(tp = strchr(&ep[1], '/'))) {
-
-		/* Figure out sizes of strings and allocate them */
-		rule_size = (size_t) (ep - &cp[2]);
-		repl_size = (size_t) (tp - &ep[1]);
-		if ((rule = (char *) malloc(rule_size+1)) &&
-		    (repl = (char *) malloc(repl_size+1))) {
-
-		    /* Copy the strings */
-		    strncpy(rule, &cp[2], rule_size);
-		    strncpy(repl, &ep[1], repl_size);
-		    rule[rule_size] = repl[repl_size] = '\0';
-
-		    /* Check for trailing "g" */
-		    doglobal = (tp[1] == 'g') ? 1 : 0;
-		    if (doglobal)
-			tp++;
-
-		    /* Swap previous in and out buffers */
-		    ep = in;
-		    in = out;
-		    out = ep;
-
-		    /* Do the replacemenbt */
-		    memset(out, '\0', MAX_FORMAT_BUFFER);
-		    do_replacement(rule, repl, doglobal, in, out);
-		    free(rule);
-		    free(repl);
-
-		    /* If we have no output buffer left, this can't be good */
-		    if (strlen(out) == 0) {
-			kret = KRB5_LNAME_NOTRANS;
-			break;
-		    }
-		}
-		else {
-		    /* No memory for copies */
-		    kret = ENOMEM;
-		    break;
-		}
-	    }
-	    else {
-		/* Bad syntax */
-		kret = KRB5_CONFIG_BADFORMAT;
+	    /* Do the replacement */
+	    memset(out, '\0', MAX_FORMAT_BUFFER);
+	    do_replacement(&rule->subst[i], in, out);
+
+	    /* If we have no output buffer left, this can't be good */
+	    if (strlen(out) == 0) {
+		kret = KRB5_LNAME_NOTRANS;
 		break;
 	    }
-	    /* Advance past trailer */
-	    cp = &tp[1];
 	}
+	if (!kret)
+	    kret = rule->subst_err;
 	free(in);
 	if (!kret)
 	    *result = out;
 	else
 	    free(out);
     }
+    else if (in)
+	free(in);
     return(kret);
 }
 
@@ -460,129 +590,103 @@ aname_replacer(string, contextp, result)
  * rule_an_to_ln()	- Handle aname to lname translations for RULE rules.
  *
  * The initial part of this routine handles the formulation of the strings from
- * the principal name.
+ * the principal name.  mname is the flattened principal minus the realm.
  */
 static krb5_error_code
-rule_an_to_ln(context, rule, aname, lnsize, lname)
+rule_an_to_ln(context, rule, aname, mname, lnsize, lname)
     krb5_context		context;
-    char *			rule;
+    struct aname_rule		*rule;
     krb5_const_principal	aname;
+    char			*mname;
     const int			lnsize;
     char *			lname;
 {
     krb5_error_code	kret;
     char		*current;
-    char		*fprincname;
-    char		*selstring = 0;
-    int			num_comps, compind;
+    char		*selstring;
+    int			compind;
     char		*cout;
     krb5_data		*datap;
     char		*outstring;
 
     /*
-     * First flatten the name.
+     * First part.
      */
-    current = rule;
-    if (!(kret = krb5_unparse_name(context, aname, &fprincname))) {
+    if (rule->select && (rule->ncomps != aname->length))
+	return(KRB5_LNAME_NOTRANS);
+    if (rule->select_err)
+	return(rule->select_err);
+    kret = 0;
+    if (rule->select) {
+	if (!(selstring = (char *) malloc(MAX_FORMAT_BUFFER)))
+	    return(ENOMEM);
+	cout = selstring;
+	*cout = '\0';
 	/*
-	 * First part.
+	 * Plow through the string.
 	 */
-	if (*current == '[') {
-	    if (sscanf(current+1,"%d:", &num_comps) == 1) {
-		if (num_comps == aname->length) {
-		    /*
-		     * We have a match based on the number of components.
-		     */
-		    current = strchr(current, ':');
-		    selstring = (char *) malloc(MAX_FORMAT_BUFFER);
-		    if (current && selstring) {
-			current++;
-			cout = selstring;
-			/*
-			 * Plow through the string.
-			 */
-			while ((*current != ']') &&
-			       (*current != '\0')) {
-			    /*
-			     * Expand to a component.
-			     */
-			    if (*current == '$') {
-				if ((sscanf(current+1, "%d", &compind) == 1) &&
-				    (compind <= num_comps) &&
-				    (datap = krb5_princ_component(context,
-								  aname,
-								  compind-1))
-				    ) {
-				    strncpy(cout,
-					    datap->data,
-					    datap->length);
-				    cout += datap->length;
-				    *cout = '\0';
-				    current++;
-				    /* Point past number */
-				    while (isdigit(*current))
-					current++;
-				}
-				else
-				    kret = KRB5_CONFIG_BADFORMAT;
-			    }
-			    else {
-				/* Copy in verbatim. */
-				*cout = *current;
-				cout++;
-				*cout = '\0';
-				current++;
-			    }
-			}
-
-			/*
-			 * Advance past separator if appropriate.
-			 */
-			if (*current == ']')
-			    current++;
-			else
-			    kret = KRB5_CONFIG_BADFORMAT;
-
-			if (kret)
-			    free(selstring);
-		    }
+	for (current = rule->format; *current && !kret; ) {
+	    /*
+	     * Expand to a component.
+	     */
+	    if (*current == '$') {
+		(void) sscanf(current+1, "%d", &compind);
+		datap = krb5_princ_component(context, aname, compind-1);
+		if ((cout - selstring) + datap->length >= MAX_FORMAT_BUFFER) {
+		    kret = KRB5_CONFIG_NOTENUFSPACE;
+		    break;
 		}
-		else
-		    kret = KRB5_LNAME_NOTRANS;
+		strncpy(cout, datap->data, datap->length);
+		cout += datap->length;
+		*cout = '\0';
+		current++;
+		/* Point past number */
+		while (isdigit(*current))
+		    current++;
+	    }
+	    else {
+		/* Copy in verbatim. */
+		if ((cout - selstring) + 1 >= MAX_FORMAT_BUFFER) {
+		    kret = KRB5_CONFIG_NOTENUFSPACE;
+		    break;
+		}
+		*cout = *current;
+		cout++;
+		*cout = '\0';
+		current++;
 	    }
-	    else
-		kret = KRB5_CONFIG_BADFORMAT;
-	}
-	else {
-	    if (!(selstring = aname_full_to_mapping_name(fprincname)))
-		kret = ENOMEM;
 	}
-	krb5_xfree(fprincname);
     }
+    else
+	selstring = mname;
+
+    /*
+     * Second part
+     */
     if (!kret) {
-	/*
-	 * Second part
-	 */
-	if (*current == '(')
-	    kret = aname_do_match(selstring, &current);
+	if (rule->match_err)
+	    kret = rule->match_err;
+	else if (rule->match)
+	    kret = aname_do_match(selstring, rule);
+    }
 
-	/*
-	 * Third part.
-	 */
-	if (!kret) {
-	    outstring = (char *) NULL;
-	    kret = aname_replacer(selstring, &current, &outstring);
-	    if (outstring) {
-		/* Copy out the value if there's enough room */
-		if (strlen(outstring)+1 <= (size_t) lnsize)
-		    strcpy(lname, outstring);
-		else
-		    kret = KRB5_CONFIG_NOTENUFSPACE;
-		free(outstring);
-	    }
+    /*
+     * Third part.
+     */
+    if (!kret) {
+	outstring = (char *) NULL;
+	kret = aname_replacer(selstring, rule, &outstring);
+	if (outstring) {
+	    /* Copy out the value if there's enough room */
+	    if (strlen(outstring)+1 <= (size_t) lnsize)
+		strcpy(lname, outstring);
+	    else
+		kret = KRB5_CONFIG_NOTENUFSPACE;
+	    free(outstring);
 	}
-	free(selstring);
     }
+    if (selstring != mname)
+	free(selstring);
 
     return(kret);
 }
@@ -641,6 +745,326 @@ default_an_to_ln(context, aname, lnsize, lname)
     return retval;
 }
 
+static void
+aname_free_rules(rules, nrules)
+    struct aname_rule	*rules;
+    int			nrules;
+{
+    struct aname_rule	*rule;
+    int			i;
+#ifdef	AN_TO_LN_RULES
+    int			j;
+#endif	/* AN_TO_LN_RULES */
+
+    for (i = 0; i < nrules; i++) {
+	rule = &rules[i];
+	if (rule->arg)
+	    free(rule->arg);
+#ifdef ANAME_DB
+	if (rule->db)
+	    db_close(rule->db);
+#endif /*ANAME_DB*/
+#ifdef	AN_TO_LN_RULES
+	if (rule->format)
+	    free(rule->format);
+	if (rule->match)
+	    free(rule->match);
+#if	HAVE_REGCOMP
+	if (rule->match_compiled)
+	    regfree(&rule->match_exp);
+#endif	/* HAVE_REGCOMP */
+	for (j = 0; j < rule->nsubst; j++) {
+	    if (rule->subst[j].regexp)
+		free(rule->subst[j].regexp);
+	    if (rule->subst[j].repl)
+		free(rule->subst[j].repl);
+#if	HAVE_REGCOMP
+	    if (rule->subst[j].compiled)
+		regfree(&rule->subst[j].match_exp);
+#endif	/* HAVE_REGCOMP */
+	}
+	if (rule->subst)
+	    free(rule->subst);
+#endif	/* AN_TO_LN_RULES */
+    }
+    free(rules);
+}
+
+/*
+ * Read and parse the general auth_to_local rules of the form:
+ *
+ * [realms]->realm->"auth_to_local"
+ *
+ * If there are none, cache->rules is left NULL.
+ */
+static krb5_error_code
+aname_load_rules(context, cache)
+    krb5_context	context;
+    struct aname_cache	*cache;
+{
+    krb5_error_code	kret;
+    const char		*hierarchy[4];
+    char		**mapping_values;
+    struct aname_rule	*rule;
+    int			i, n;
+    char		*typep, *argp;
+
+    hierarchy[0] = "realms";
+    hierarchy[1] = cache->realm;
+    hierarchy[2] = "auth_to_local";
+    hierarchy[3] = (char *) NULL;
+    if (profile_get_values(context->profile, hierarchy, &mapping_values))
+	return(0);
+
+    for (n = 0; mapping_values[n]; n++);
+    kret = ENOMEM;
+    if ((cache->rules = (struct aname_rule *)
+	 calloc((size_t) n, sizeof(struct aname_rule)))) {
+	cache->nrules = n;
+	kret = 0;
+	for (i = 0; (i < n) && !kret; i++) {
+	    rule = &cache->rules[i];
+	    typep = mapping_values[i];
+	    argp = strchr(typep, ':');
+	    if (argp) {
+		*argp = '\0';
+		argp++;
+	    }
+#ifdef ANAME_DB
+	    if (!strcmp(typep, "DB") && argp) {
+		rule->type = AN_RULE_DB;
+		if (!(rule->arg = strdup(argp)))
+		    kret = ENOMEM;
+	    }
+	    else
+#endif
+#ifdef	AN_TO_LN_RULES
+	    if (!strcmp(typep, "RULE") && argp) {
+		rule->type = AN_RULE_RULE;
+		kret = aname_parse_rule(argp, rule);
+	    }
+	    else
+#endif	/* AN_TO_LN_RULES */
+	    if (!strcmp(typep, "DEFAULT") && !argp)
+		rule->type = AN_RULE_DEFAULT;
+	    else
+		rule->type = AN_RULE_BAD;
+	}
+	if (kret) {
+	    aname_free_rules(cache->rules, cache->nrules);
+	    cache->rules = (struct aname_rule *) NULL;
+	    cache->nrules = 0;
+	}
+    }
+    profile_free_list(mapping_values);
+    return(kret);
+}
+
+/*
+ * Return the context's aname cache, making it afresh if the profile or
+ * the default realm has changed since it was made.
+ */
+static struct aname_cache *
+aname_get_cache(context, realm, kretp)
+    krb5_context	context;
+    char		*realm;
+    krb5_error_code	*kretp;
+{
+    struct aname_cache	*cache;
+    unsigned long	generation;
+
+    generation = 0;
+    if (context->profile &&
+	(*kretp = profile_get_generation(context->profile, &generation)))
+	return((struct aname_cache *) NULL);
+
+    cache = (struct aname_cache *) context->aname_cache;
+    if (cache &&
+	(cache->generation == generation) &&
+	!strcmp(cache->realm, realm))
+	return(cache);
+
+    krb5int_aname_cache_free(context);
+    *kretp = ENOMEM;
+    if (!(cache = (struct aname_cache *) calloc(1, sizeof(*cache))))
+	return((struct aname_cache *) NULL);
+    if (!(cache->realm = strdup(realm)) ||
+	(*kretp = aname_load_rules(context, cache))) {
+	if (cache->realm)
+	    free(cache->realm);
+	free(cache);
+	return((struct aname_cache *) NULL);
+    }
+    cache->generation = generation;
+    context->aname_cache = (void *) cache;
+    *kretp = 0;
+    return(cache);
+}
+
+static struct aname_result *
+aname_result_slot(cache, pname)
+    struct aname_cache	*cache;
+    const char		*pname;
+{
+    unsigned int	h;
+
+    for (h = 0; *pname; pname++)
+	h = h * 31 + (unsigned char) *pname;
+    return(&cache->results[h % AN_RESULT_SLOTS]);
+}
+
+/* Remember the translation of pname, if there is room for it. */
+static void
+aname_save_result(cache, pname, code, lname)
+    struct aname_cache	*cache;
+    const char		*pname;
+    krb5_error_code	code;
+    const char		*lname;
+{
+    struct aname_result	*result;
+    char		*newp, *newl;
+
+    newp = strdup(pname);
+    newl = code ? (char *) NULL : strdup(lname);
+    if (!newp || (!code && !newl)) {
+	if (newp)
+	    free(newp);
+	return;
+    }
+    result = aname_result_slot(cache, pname);
+    if (result->pname)
+	free(result->pname);
+    if (result->lname)
+	free(result->lname);
+    result->pname = newp;
+    result->lname = newl;
+    result->code = code;
+}
+
+void
+krb5int_aname_cache_free(context)
+    krb5_context	context;
+{
+    struct aname_cache	*cache;
+    int			i;
+
+    if (!(cache = (struct aname_cache *) context->aname_cache))
+	return;
+    if (cache->rules)
+	aname_free_rules(cache->rules, cache->nrules);
+    for (i = 0; i < AN_RESULT_SLOTS; i++) {
+	if (cache->results[i].pname)
+	    free(cache->results[i].pname);
+	if (cache->results[i].lname)
+	    free(cache->results[i].lname);
+    }
+    free(cache->realm);
+    free(cache);
+    context->aname_cache = (void *) NULL;
+}
+
+/*
+ * Translate aname, whose flattened name minus the realm is mname, using
+ * the explicit mappings and then the rules of the default realm.
+ * *cacheable is cleared if the answer came from a database, which may
+ * give another next time.
+ */
+static krb5_error_code
+aname_map(context, cache, aname, mname, lnsize, lname, cacheable)
+    krb5_context		context;
+    struct aname_cache		*cache;
+    krb5_const_principal	aname;
+    char			*mname;
+    const int			lnsize;
+    char			*lname;
+    int				*cacheable;
+{
+    krb5_error_code	kret;
+    const char		*hierarchy[5];
+    char		**mapping_values;
+    struct aname_rule	*rule;
+    int			i, nvalid;
+    char		*cp;
+
+    /*
+     * Search first for explicit mappings of the form:
+     *
+     * [realms]->realm->"auth_to_local_names"->mapping_name
+     */
+    hierarchy[0] = "realms";
+    hierarchy[1] = cache->realm;
+    hierarchy[2] = "auth_to_local_names";
+    hierarchy[3] = mname;
+    hierarchy[4] = (char *) NULL;
+    if (!(kret = profile_get_values(context->profile,
+				    hierarchy,
+				    &mapping_values))) {
+	/* We found one or more explicit mappings. */
+	for (nvalid=0; mapping_values[nvalid]; nvalid++);
+
+	/* Just use the last one. */
+	/* Trim the value. */
+	cp = &mapping_values[nvalid-1]
+	    [strlen(mapping_values[nvalid-1])];
+	while ((cp > mapping_values[nvalid-1]) && isspace(cp[-1]))
+	    cp--;
+	*cp = '\0';
+
+	/* Copy out the value if there's enough room */
+	if (strlen(mapping_values[nvalid-1])+1 <= (size_t) lnsize)
+	    strcpy(lname, mapping_values[nvalid-1]);
+	else
+	    kret = KRB5_CONFIG_NOTENUFSPACE;
+
+	/* Free residue */
+	profile_free_list(mapping_values);
+	return(kret);
+    }
+
+    /*
+     * OK - There's no explicit mapping.  Now apply the general
+     * auth_to_local rules, which can have one or more of the following
+     * kinds of values:
+     *	DB:<filename>	- Look up principal in aname database.
+     *	RULE:<sed-exp>	- Formulate lname from sed-exp.
+     *	DEFAULT		- Use default rule.
+     * The first rule to find a match is used.
+     */
+    if (!cache->rules) {
+	/*
+	 * No profile relation found, try default mapping.
+	 */
+	return(default_an_to_ln(context, aname, lnsize, lname));
+    }
+
+    for (i = 0; i < cache->nrules; i++) {
+	rule = &cache->rules[i];
+	switch (rule->type) {
+#ifdef ANAME_DB
+	case AN_RULE_DB:
+	    *cacheable = 0;
+	    kret = db_an_to_ln(context, &rule->db, rule->arg,
+			       aname, lnsize, lname);
+	    break;
+#endif
+#ifdef	AN_TO_LN_RULES
+	case AN_RULE_RULE:
+	    kret = rule_an_to_ln(context, rule, aname, mname, lnsize, lname);
+	    break;
+#endif	/* AN_TO_LN_RULES */
+	case AN_RULE_DEFAULT:
+	    kret = default_an_to_ln(context, aname, lnsize, lname);
+	    break;
+	default:
+	    kret = KRB5_CONFIG_BADFORMAT;
+	    break;
+	}
+	if (kret != KRB5_LNAME_NOTRANS)
+	    break;
+    }
+    return(kret);
+}
+
 /*
  Converts an authentication name to a local name suitable for use by
  programs wishing a translation to an environment-specific name (e.g.
@@ -664,11 +1088,9 @@ krb5_aname_to_localname(context, aname, lnsize, lname)
     char		*realm;
     char		*pname;
     char		*mname;
-    const char		*hierarchy[5];
-    char		**mapping_values;
-    int			i, nvalid;
-    char		*cp;
-    char		*typep, *argp;
+    struct aname_cache	*cache;
+    struct aname_result	*result;
+    int			cacheable;
 
     /*
      * First get the default realm.
@@ -676,130 +1098,33 @@ krb5_aname_to_localname(context, aname, lnsize, lname)
     if (!(kret = krb5_get_default_realm(context, &realm))) {
 	/* Flatten the name */
 	if (!(kret = krb5_unparse_name(context, aname, &pname))) {
-	    if ((mname = aname_full_to_mapping_name(pname))) {
-		/*
-		 * Search first for explicit mappings of the form:
-		 *
-		 * [realms]->realm->"auth_to_local_names"->mapping_name
-		 */
-		hierarchy[0] = "realms";
-		hierarchy[1] = realm;
-		hierarchy[2] = "auth_to_local_names";
-		hierarchy[3] = mname;
-		hierarchy[4] = (char *) NULL;
-		if (!(kret = profile_get_values(context->profile,
-						hierarchy,
-						&mapping_values))) {
-		    /* We found one or more explicit mappings. */
-		    for (nvalid=0; mapping_values[nvalid]; nvalid++);
-
-		    /* Just use the last one. */
-		    /* Trim the value. */
-		    cp = &mapping_values[nvalid-1]
-			[strlen(mapping_values[nvalid-1])];
-		    while (isspace(*cp)) cp--;
-		    cp++;
-		    *cp = '\0';
-
-		    /* Copy out the value if there's enough room */
-		    if (strlen(mapping_values[nvalid-1])+1 <= (size_t) lnsize)
-			strcpy(lname, mapping_values[nvalid-1]);
-		    else
-			kret = KRB5_CONFIG_NOTENUFSPACE;
-
-		    /* Free residue */
-		    profile_free_list(mapping_values);
-		}
-		else {
-		    /*
-		     * OK - There's no explicit mapping.  Now check for
-		     * general auth_to_local rules of the form:
-		     *
-		     * [realms]->realm->"auth_to_local"
-		     *
-		     * This can have one or more of the following kinds of
-		     * values:
-		     *	DB:<filename>	- Look up principal in aname database.
-		     *	RULE:<sed-exp>	- Formulate lname from sed-exp.
-		     *	DEFAULT		- Use default rule.
-		     * The first rule to find a match is used.
-		     */
-		    hierarchy[0] = "realms";
-		    hierarchy[1] = realm;
-		    hierarchy[2] = "auth_to_local";
-		    hierarchy[3] = (char *) NULL;
-		    if (!(kret = profile_get_values(context->profile,
-						    hierarchy,
-						    &mapping_values))) {
-			/*
-			 * Loop through all the mapping values.
-			 */
-			for (i=0; mapping_values[i]; i++) {
-			    typep = mapping_values[i];
-			    argp = strchr(typep, ':');
-			    if (argp) {
-				*argp = '\0';
-				argp++;
-			    }
-#ifdef ANAME_DB
-			    if (!strcmp(typep, "DB") && argp) {
-				kret = db_an_to_ln(context,
-						   argp,
-						   aname,
-						   lnsize,
-						   lname);
-				if (kret != KRB5_LNAME_NOTRANS)
-				    break;
-			    }
-			    else
-#endif
-#ifdef	AN_TO_LN_RULES
-			    if (!strcmp(typep, "RULE") && argp) {
-				kret = rule_an_to_ln(context,
-						     argp,
-						     aname,
-						     lnsize,
-						     lname);
-				if (kret != KRB5_LNAME_NOTRANS)
-				    break;
-			    }
-			    else
-#endif	/* AN_TO_LN_RULES */
-			    if (!strcmp(typep, "DEFAULT") && !argp) {
-				kret = default_an_to_ln(context,
-							aname,
-							lnsize,
-							lname);
-				if (kret != KRB5_LNAME_NOTRANS)
-				    break;
-			    }
-			    else {
-				kret = KRB5_CONFIG_BADFORMAT;
-				break;
-			    }
-			}
-
-			/* We're done, clean up the droppings. */
-			profile_free_list(mapping_values);
-		    }
-		    else {
-			/*
-			 * No profile relation found, try default mapping.
-			 */
-			kret = default_an_to_ln(context,
-						aname,
-						lnsize,
-						lname);
+	    if ((cache = aname_get_cache(context, realm, &kret))) {
+		result = aname_result_slot(cache, pname);
+		if (result->pname && !strcmp(result->pname, pname)) {
+		    /* We've seen this one recently. */
+		    kret = result->code;
+		    if (!kret) {
+			if (strlen(result->lname)+1 <= (size_t) lnsize)
+			    strcpy(lname, result->lname);
+			else
+			    kret = KRB5_CONFIG_NOTENUFSPACE;
 		    }
 		}
-		free(mname);
+		else if ((mname = aname_full_to_mapping_name(pname))) {
+		    cacheable = 1;
+		    kret = aname_map(context, cache, aname, mname,
+				     lnsize, lname, &cacheable);
+		    if (cacheable &&
+			(!kret || (kret == KRB5_LNAME_NOTRANS)))
+			aname_save_result(cache, pname, kret, lname);
+		    free(mname);
+		}
+		else
+		    kret = ENOMEM;
 	    }
-	    else
-		kret = ENOMEM;
 	    krb5_xfree(pname);
 	}
 	krb5_xfree(realm);
     }
     return(kret);
 }
-
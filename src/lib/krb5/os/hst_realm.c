@@ -235,7 +235,7 @@ krb5_get_host_realm(context, host, realmsp)
     char FAR * FAR * FAR *realmsp;
 {
     char **retrealms;
-    char *default_realm, *realm, *cp, *temp_realm;
+    char *default_realm, *realm, *cp;
     krb5_error_code retval;
     int l;
     char local_host[MAX_DNS_NAMELEN+1];
@@ -280,37 +280,14 @@ krb5_get_host_realm(context, host, realmsp)
 	 7) D
      */
 
-    cp = local_host;
-    realm = default_realm = (char *)NULL;
-    temp_realm = 0;
-    while (cp) {
-	retval = profile_get_string(context->profile, "domain_realm", cp,
-				    0, (char *)NULL, &temp_realm);
-	if (retval)
-	    return retval;
-	if (temp_realm != (char *)NULL)
-	    break;	/* Match found */
-
-	/* Setup for another test */
-	if (*cp == '.') {
-	    cp++;
-	    if (default_realm == (char *)NULL) {
-		/* If nothing else works, use the host's domain */
-		default_realm = cp;
-	    }
-	} else {
-	    cp = strchr(cp, '.');
-	}
-    }
-    if (temp_realm) {
-        realm = malloc(strlen(temp_realm) + 1);
-        if (!realm) {
-            profile_release_string(temp_realm);
-            return ENOMEM;
-        }
-        strcpy(realm, temp_realm);
-        profile_release_string(temp_realm);
-    }
+    retval = krb5int_domain_realm(context, local_host, &realm);
+    if (retval)
+	return retval;
+
+    /* If nothing else works, use the host's domain */
+    default_realm = strchr(local_host, '.');
+    if (default_realm)
+	default_realm++;
 
 #ifdef KRB5_DNS_LOOKUP
     if (realm == (char *)NULL) {
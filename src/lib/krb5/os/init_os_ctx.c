@@ -452,7 +452,9 @@ krb5_os_init_context(ctx)
 
 	krb5_cc_set_default_name(ctx, NULL);
 
-	retval = os_init_paths(ctx);
+	/* krb5_init_context_from() hands us a profile already read. */
+	if (!ctx->profile)
+		retval = os_init_paths(ctx);
 
 	/*
 	 * If there's an error in the profile, return an error.  Just
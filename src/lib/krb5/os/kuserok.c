@@ -40,6 +40,185 @@
 
 #define MAX_USERNAME 10
 
+/*
+ * The .k5login files read most recently, kept for as long as a stat()
+ * shows the same file, unchanged.  Each holds the lines of the file in
+ * a hash table, so checking a principal against one is a single probe.
+ */
+#define K5LOGIN_CACHE_SIZE 8
+
+struct k5login {
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime, ctime;
+    char **lines;		/* hashed; NULL for an empty slot */
+    int nslots;
+};
+
+static struct k5login k5login_cache[K5LOGIN_CACHE_SIZE];
+static int k5login_next;
+
+static unsigned int
+k5login_hash(str)
+    const char *str;
+{
+    unsigned int h = 0;
+
+    while (*str)
+	h = h * 31 + (unsigned char) *str++;
+    return h;
+}
+
+static void
+k5login_free(k)
+    struct k5login *k;
+{
+    int i;
+
+    if (k->path)
+	free(k->path);
+    for (i = 0; i < k->nslots; i++)
+	if (k->lines[i])
+	    free(k->lines[i]);
+    if (k->lines)
+	free(k->lines);
+    memset((char *) k, 0, sizeof(*k));
+}
+
+/* Is str one of the lines of k? */
+static krb5_boolean
+k5login_member(k, str)
+    struct k5login *k;
+    const char *str;
+{
+    unsigned int i;
+
+    if (k->nslots == 0)
+	return FALSE;
+    i = k5login_hash(str) & (k->nslots - 1);
+    while (k->lines[i]) {
+	if (!strcmp(k->lines[i], str))
+	    return TRUE;
+	i = (i + 1) & (k->nslots - 1);
+    }
+    return FALSE;
+}
+
+/* Add a copy of str to the lines of k, making the table bigger if need be. */
+static krb5_error_code
+k5login_add(k, nlines, str)
+    struct k5login *k;
+    int *nlines;
+    const char *str;
+{
+    char **old, **new, *copy;
+    int oldslots, i;
+    unsigned int j;
+
+    if (2 * (*nlines + 1) > k->nslots) {
+	oldslots = k->nslots;
+	k->nslots = oldslots ? 2 * oldslots : 16;
+	if ((new = (char **) calloc(k->nslots, sizeof(char *))) == NULL) {
+	    k->nslots = oldslots;
+	    return ENOMEM;
+	}
+	old = k->lines;
+	k->lines = new;
+	for (i = 0; i < oldslots; i++) {
+	    if (!old[i])
+		continue;
+	    j = k5login_hash(old[i]) & (k->nslots - 1);
+	    while (new[j])
+		j = (j + 1) & (k->nslots - 1);
+	    new[j] = old[i];
+	}
+	if (old)
+	    free(old);
+    }
+    if (k5login_member(k, str))
+	return 0;
+    if ((copy = strdup(str)) == NULL)
+	return ENOMEM;
+    j = k5login_hash(str) & (k->nslots - 1);
+    while (k->lines[j])
+	j = (j + 1) & (k->nslots - 1);
+    k->lines[j] = copy;
+    (*nlines)++;
+    return 0;
+}
+
+/*
+ * Read the lines of the open file fp, whose stat() is sbuf, into a
+ * cache entry for path.  Lines are compared as fgets() returns them,
+ * so one longer than the buffer counts only for its start.
+ */
+static struct k5login *
+k5login_read(path, fp, sbuf)
+    const char *path;
+    FILE *fp;
+    struct stat *sbuf;
+{
+    struct k5login *k;
+    char linebuf[BUFSIZ];
+    char *newline;
+    int gobble, nlines = 0;
+
+    k = &k5login_cache[k5login_next];
+    k5login_next = (k5login_next + 1) % K5LOGIN_CACHE_SIZE;
+    k5login_free(k);
+
+    if ((k->path = strdup(path)) == NULL)
+	return NULL;
+    k->dev = sbuf->st_dev;
+    k->ino = sbuf->st_ino;
+    k->size = sbuf->st_size;
+    k->mtime = sbuf->st_mtime;
+    k->ctime = sbuf->st_ctime;
+
+    while (fgets(linebuf, BUFSIZ, fp) != NULL) {
+	/* null-terminate the input string */
+	linebuf[BUFSIZ-1] = '\0';
+	newline = NULL;
+	/* nuke the newline if it exists */
+	if ((newline = strchr(linebuf, '\n')))
+	    *newline = '\0';
+	if (k5login_add(k, &nlines, linebuf)) {
+	    k5login_free(k);
+	    return NULL;
+	}
+	/* clean up the rest of the line if necessary */
+	if (!newline)
+	    while (((gobble = getc(fp)) != EOF) && gobble != '\n');
+    }
+    if (ferror(fp)) {
+	k5login_free(k);
+	return NULL;
+    }
+    return k;
+}
+
+/* The cached lines of path, if sbuf shows it has not changed since. */
+static struct k5login *
+k5login_lookup(path, sbuf)
+    const char *path;
+    struct stat *sbuf;
+{
+    struct k5login *k;
+    int i;
+
+    for (i = 0; i < K5LOGIN_CACHE_SIZE; i++) {
+	k = &k5login_cache[i];
+	if (k->path && !strcmp(k->path, path) &&
+	    k->dev == sbuf->st_dev && k->ino == sbuf->st_ino &&
+	    k->size == sbuf->st_size && k->mtime == sbuf->st_mtime &&
+	    k->ctime == sbuf->st_ctime)
+	    return k;
+    }
+    return NULL;
+}
+
 /*
  * Given a Kerberos principal "principal", and a local username "luser",
  * determine whether user is authorized to login according to the
@@ -57,6 +236,8 @@
  * The file entries are in the format produced by krb5_unparse_name(),
  * one entry per line.
  *
+ * The lines of the file are remembered, and the file is read again
+ * only when a stat() of it shows a different or changed file.
  */
 
 krb5_boolean KRB5_CALLCONV
@@ -72,9 +253,7 @@ krb5_kuserok(context, principal, luser)
     FILE *fp;
     char kuser[MAX_USERNAME];
     char *princname;
-    char linebuf[BUFSIZ];
-    char *newline;
-    int gobble;
+    struct k5login *k;
 
     /* no account => no access */
     if ((pwd = getpwnam(luser)) == NULL) {
@@ -100,44 +279,39 @@ krb5_kuserok(context, principal, luser)
     if (krb5_unparse_name(context, principal, &princname))
 	return(FALSE);			/* no hope of matching */
 
-    /* open ~/.k5login */
-    if ((fp = fopen(pbuf, "r")) == NULL) {
-	free(princname);
-	return(FALSE);
+    /* Use what we have of ~/.k5login if it is the same file. */
+    fp = NULL;
+    if (stat(pbuf, &sbuf) || !(k = k5login_lookup(pbuf, &sbuf))) {
+	/* open ~/.k5login */
+	if ((fp = fopen(pbuf, "r")) == NULL) {
+	    free(princname);
+	    return(FALSE);
+	}
+	if (fstat(fileno(fp), &sbuf)) {
+	    fclose(fp);
+	    free(princname);
+	    return(FALSE);
+	}
+	k = NULL;
     }
+
     /*
      * For security reasons, the .k5login file must be owned either by
      * the user himself, or by root.  Otherwise, don't grant access.
      */
-    if (fstat(fileno(fp), &sbuf)) {
-	fclose(fp);
-	free(princname);
-	return(FALSE);
-    }
     if ((sbuf.st_uid != pwd->pw_uid) && sbuf.st_uid) {
-	fclose(fp);
+	if (fp)
+	    fclose(fp);
 	free(princname);
 	return(FALSE);
     }
 
     /* check each line */
-    while (!isok && (fgets(linebuf, BUFSIZ, fp) != NULL)) {
-	/* null-terminate the input string */
-	linebuf[BUFSIZ-1] = '\0';
-	newline = NULL;
-	/* nuke the newline if it exists */
-	if ((newline = strchr(linebuf, '\n')))
-	    *newline = '\0';
-	if (!strcmp(linebuf, princname)) {
-	    isok = TRUE;
-	    continue;
-	}
-	/* clean up the rest of the line if necessary */
-	if (!newline)
-	    while (((gobble = getc(fp)) != EOF) && gobble != '\n');
-    }
+    if (k || (k = k5login_read(pbuf, fp, &sbuf)))
+	isok = k5login_member(k, princname);
     free(princname);
-    fclose(fp);
+    if (fp)
+	fclose(fp);
     return(isok);
 }
 
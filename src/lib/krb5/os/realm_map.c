@@ -0,0 +1,487 @@
+/*
+ * lib/krb5/os/realm_map.c
+ *
+ * Copyright 2000 by the Massachusetts Institute of Technology.
+ * All Rights Reserved.
+ *
+ * Export of this software from the United States of America may
+ *   require a specific license from the United States Government.
+ *   It is the responsibility of any person or organization contemplating
+ *   export to obtain such a license before exporting.
+ *
+ * WITHIN THAT CONSTRAINT, permission to use, copy, modify, and
+ * distribute this software and its documentation for any purpose and
+ * without fee is hereby granted, provided that the above copyright
+ * notice appear in all copies and that both that copyright notice and
+ * this permission notice appear in supporting documentation, and that
+ * the name of M.I.T. not be used in advertising or publicity pertaining
+ * to distribution of the software without specific, written prior
+ * permission.  Furthermore if you modify this software you must label
+ * your software as modified software and not distribute it in such a
+ * fashion that it might be confused with the original M.I.T. software.
+ * M.I.T. makes no representations about the suitability of
+ * this software for any purpose.  It is provided "as is" without express
+ * or implied warranty.
+ *
+ *
+ * krb5int_domain_realm(), krb5int_capaths()
+ *
+ * The [domain_realm] and [capaths] sections of the profile, read once
+ * into hash tables kept with the context.  A host's realm is then
+ * found with one probe per label of its name instead of two profile
+ * lookups per label, and a capaths path with a single probe.  The
+ * tables are read again whenever the profile's generation changes.
+ */
+
+#include "k5-int.h"
+#include <stdio.h>
+
+struct map_entry {
+    char *name;			/* domain, or client realm for capaths */
+    char *name2;		/* server realm for capaths */
+    char *host_realm;		/* from "name = REALM" */
+    char *domain_realm;		/* from ".name = REALM" */
+    char **path;		/* capaths values, null-terminated */
+    int npath;
+};
+
+struct map_table {
+    struct map_entry *entries;
+    int nentries, nalloc;
+    int *slots;			/* index into entries + 1, or 0 */
+    int nslots;
+};
+
+struct realm_map {
+    unsigned long generation;
+    struct map_table domains;
+    struct map_table capaths;
+};
+
+static unsigned int
+map_hash(name, name2)
+    const char *name, *name2;
+{
+    unsigned int h = 0;
+
+    while (*name)
+	h = h * 31 + (unsigned char) *name++;
+    if (name2) {
+	h = h * 31;
+	while (*name2)
+	    h = h * 31 + (unsigned char) *name2++;
+    }
+    return h;
+}
+
+static struct map_entry *
+map_find(table, name, name2)
+    struct map_table *table;
+    const char *name, *name2;
+{
+    struct map_entry *e;
+    unsigned int i;
+
+    if (table->nslots == 0)
+	return NULL;
+    i = map_hash(name, name2) & (table->nslots - 1);
+    while (table->slots[i]) {
+	e = &table->entries[table->slots[i] - 1];
+	if (strcmp(e->name, name) == 0 &&
+	    (name2 == NULL || strcmp(e->name2, name2) == 0))
+	    return e;
+	i = (i + 1) & (table->nslots - 1);
+    }
+    return NULL;
+}
+
+/* Place entry n in the slots, which must have room for it. */
+static void
+map_place(table, n)
+    struct map_table *table;
+    int n;
+{
+    struct map_entry *e = &table->entries[n];
+    unsigned int i;
+
+    i = map_hash(e->name, e->name2) & (table->nslots - 1);
+    while (table->slots[i])
+	i = (i + 1) & (table->nslots - 1);
+    table->slots[i] = n + 1;
+}
+
+/* Find the entry for (name, name2), adding an empty one if there is none. */
+static krb5_error_code
+map_enter(table, name, name2, ret_e)
+    struct map_table *table;
+    const char *name, *name2;
+    struct map_entry **ret_e;
+{
+    struct map_entry *e, *newents;
+    int *newslots, n, i;
+
+    if ((*ret_e = map_find(table, name, name2)))
+	return 0;
+
+    /* Keep the slots at most half full. */
+    if (2 * (table->nentries + 1) > table->nslots) {
+	n = table->nslots ? 2 * table->nslots : 64;
+	if ((newslots = (int *) calloc(n, sizeof(int))) == NULL)
+	    return ENOMEM;
+	if (table->slots)
+	    free(table->slots);
+	table->slots = newslots;
+	table->nslots = n;
+	for (i = 0; i < table->nentries; i++)
+	    map_place(table, i);
+    }
+    if (table->nentries == table->nalloc) {
+	n = table->nalloc ? 2 * table->nalloc : 32;
+	newents = (struct map_entry *) realloc(table->entries,
+					       n * sizeof(struct map_entry));
+	if (newents == NULL)
+	    return ENOMEM;
+	table->entries = newents;
+	table->nalloc = n;
+    }
+
+    e = &table->entries[table->nentries];
+    memset(e, 0, sizeof(*e));
+    if ((e->name = strdup(name)) == NULL)
+	return ENOMEM;
+    if (name2 && (e->name2 = strdup(name2)) == NULL) {
+	free(e->name);
+	return ENOMEM;
+    }
+    map_place(table, table->nentries++);
+    *ret_e = e;
+    return 0;
+}
+
+static void
+map_clear(table)
+    struct map_table *table;
+{
+    struct map_entry *e;
+    int i;
+
+    for (i = 0; i < table->nentries; i++) {
+	e = &table->entries[i];
+	free(e->name);
+	if (e->name2)
+	    free(e->name2);
+	if (e->host_realm)
+	    free(e->host_realm);
+	if (e->domain_realm)
+	    free(e->domain_realm);
+	if (e->path) {
+	    while (e->npath > 0)
+		free(e->path[--e->npath]);
+	    free(e->path);
+	}
+    }
+    if (table->entries)
+	free(table->entries);
+    if (table->slots)
+	free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+/*
+ * A domain name we can look up by its labels: not empty, with no
+ * empty labels and no dot at either end.
+ */
+static int
+good_domain(name)
+    const char *name;
+{
+    const char *cp;
+
+    if (*name == '\0' || *name == '.')
+	return 0;
+    for (cp = name; *cp; cp++)
+	if (*cp == '.' && (cp[1] == '.' || cp[1] == '\0'))
+	    return 0;
+    return 1;
+}
+
+/*
+ * Read [domain_realm].  "host = REALM" and ".domain = REALM" for the
+ * same name share an entry; the first setting of each, in the order a
+ * profile_get_string() would find them, is the one kept.
+ */
+static krb5_error_code
+load_domains(context, map)
+    krb5_context context;
+    struct realm_map *map;
+{
+    static const char *names[] = { "domain_realm", 0 };
+    krb5_error_code retval;
+    struct map_entry *e;
+    void *iter;
+    char *name, *value, **slot, *domain;
+
+    retval = profile_iterator_create(context->profile, names,
+				     PROFILE_ITER_LIST_SECTION |
+				     PROFILE_ITER_RELATIONS_ONLY, &iter);
+    if (retval)
+	return retval;
+    for (;;) {
+	if ((retval = profile_iterator(&iter, &name, &value)) || !name)
+	    break;
+	domain = (*name == '.') ? name + 1 : name;
+	if (value && good_domain(domain) &&
+	    !(retval = map_enter(&map->domains, domain, NULL, &e))) {
+	    slot = (domain != name) ? &e->domain_realm : &e->host_realm;
+	    if (*slot == NULL) {
+		*slot = value;
+		value = NULL;
+	    }
+	}
+	profile_release_string(name);
+	if (value)
+	    profile_release_string(value);
+	if (retval)
+	    break;
+    }
+    profile_iterator_free(&iter);
+    return retval;
+}
+
+static int
+compare_strings(a, b)
+    const void *a, *b;
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/* Read the [capaths] subsection for client into the table. */
+static krb5_error_code
+load_client_paths(context, map, client)
+    krb5_context context;
+    struct realm_map *map;
+    const char *client;
+{
+    const char *names[3];
+    krb5_error_code retval;
+    struct map_entry *e;
+    void *iter;
+    char *name, *value, **newpath;
+
+    names[0] = "capaths";
+    names[1] = client;
+    names[2] = 0;
+    retval = profile_iterator_create(context->profile, names,
+				     PROFILE_ITER_LIST_SECTION |
+				     PROFILE_ITER_RELATIONS_ONLY, &iter);
+    if (retval)
+	return retval;
+    for (;;) {
+	if ((retval = profile_iterator(&iter, &name, &value)) || !name)
+	    break;
+	if (value &&
+	    !(retval = map_enter(&map->capaths, client, name, &e))) {
+	    newpath = (char **) realloc(e->path,
+					(e->npath + 2) * sizeof(char *));
+	    if (newpath == NULL) {
+		retval = ENOMEM;
+	    } else {
+		e->path = newpath;
+		e->path[e->npath++] = value;
+		e->path[e->npath] = NULL;
+		value = NULL;
+	    }
+	}
+	profile_release_string(name);
+	if (value)
+	    profile_release_string(value);
+	if (retval)
+	    break;
+    }
+    profile_iterator_free(&iter);
+    return retval;
+}
+
+/*
+ * Read [capaths].  A client realm may have subsections in several
+ * files, so each is read once with the iterator, which sees them all.
+ */
+static krb5_error_code
+load_capaths(context, map)
+    krb5_context context;
+    struct realm_map *map;
+{
+    static const char *names[] = { "capaths", 0 };
+    krb5_error_code retval;
+    char **clients;
+    int n, i;
+
+    retval = profile_get_subsection_names(context->profile, names, &clients);
+    if (retval == PROF_NO_SECTION || retval == PROF_NO_RELATION)
+	return 0;
+    if (retval)
+	return retval;
+
+    for (n = 0; clients[n]; n++)
+	;
+    qsort(clients, n, sizeof(char *), compare_strings);
+    for (i = 0; i < n && !retval; i++)
+	if (i == 0 || strcmp(clients[i], clients[i - 1]))
+	    retval = load_client_paths(context, map, clients[i]);
+    profile_free_list(clients);
+    return retval;
+}
+
+/*
+ * Return the context's map, reading the profile into it first if it
+ * has not been read or has changed since.  NULL is returned with
+ * *retval 0 if there is no profile to read.
+ */
+static struct realm_map *
+get_map(context, retval)
+    krb5_context context;
+    krb5_error_code *retval;
+{
+    struct realm_map *map = (struct realm_map *) context->realm_map;
+    unsigned long generation;
+
+    *retval = 0;
+    if (context->profile == NULL)
+	return NULL;
+    if ((*retval = profile_get_generation(context->profile, &generation)))
+	return NULL;
+    if (map && map->generation == generation)
+	return map;
+
+    if (map) {
+	map_clear(&map->domains);
+	map_clear(&map->capaths);
+    } else {
+	map = (struct realm_map *) calloc(1, sizeof(struct realm_map));
+	if (map == NULL) {
+	    *retval = ENOMEM;
+	    return NULL;
+	}
+	context->realm_map = map;
+    }
+    if ((*retval = load_domains(context, map)) ||
+	(*retval = load_capaths(context, map))) {
+	krb5int_realm_map_free(context);
+	return NULL;
+    }
+    map->generation = generation;
+    return map;
+}
+
+/*
+ * Set *realm to a copy of the [domain_realm] setting which applies to
+ * host, or to NULL if none does.  host must already be in lower case
+ * with any trailing dot removed.  Given a.b.c, the settings tried are
+ * those for a.b.c, .b.c, b.c, .c and c, in that order.
+ */
+krb5_error_code
+krb5int_domain_realm(context, host, realm)
+    krb5_context context;
+    const char *host;
+    char **realm;
+{
+    krb5_error_code retval;
+    struct realm_map *map;
+    struct map_entry *e;
+    const char *cp, *found = NULL;
+    char *temp_realm;
+
+    *realm = NULL;
+    retval = 0;
+    if (!good_domain(host) || !(map = get_map(context, &retval))) {
+	if (retval)
+	    return retval;
+
+	/* A name the table cannot hold is looked up the slow way. */
+	cp = host;
+	temp_realm = 0;
+	while (cp) {
+	    retval = profile_get_string(context->profile, "domain_realm", cp,
+					0, (char *)NULL, &temp_realm);
+	    if (retval)
+		return retval;
+	    if (temp_realm != (char *)NULL)
+		break;
+	    cp = (*cp == '.') ? cp + 1 : strchr(cp, '.');
+	}
+	if (temp_realm) {
+	    *realm = strdup(temp_realm);
+	    profile_release_string(temp_realm);
+	    if (*realm == NULL)
+		return ENOMEM;
+	}
+	return 0;
+    }
+
+    for (cp = host; cp && !found; cp = strchr(cp, '.')) {
+	if (*cp == '.')
+	    cp++;
+	if ((e = map_find(&map->domains, cp, NULL)) == NULL)
+	    continue;
+	/* ".a.b.c" is not among the names tried for host a.b.c. */
+	if (cp != host && e->domain_realm)
+	    found = e->domain_realm;
+	else
+	    found = e->host_realm;
+    }
+    if (found && (*realm = strdup(found)) == NULL)
+	return ENOMEM;
+    return 0;
+}
+
+/*
+ * Set *nodes to a copy of the [capaths] values for client and server,
+ * as profile_get_values() would, or return PROF_NO_RELATION if there
+ * are none.
+ */
+krb5_error_code
+krb5int_capaths(context, client, server, nodes)
+    krb5_context context;
+    const char *client;
+    const char *server;
+    char ***nodes;
+{
+    krb5_error_code retval;
+    struct realm_map *map;
+    struct map_entry *e;
+    char **list;
+    int i;
+
+    if ((map = get_map(context, &retval)) == NULL)
+	return retval ? retval : PROF_NO_RELATION;
+    if ((e = map_find(&map->capaths, client, server)) == NULL)
+	return PROF_NO_RELATION;
+
+    if ((list = (char **) malloc((e->npath + 1) * sizeof(char *))) == NULL)
+	return ENOMEM;
+    for (i = 0; i < e->npath; i++) {
+	if ((list[i] = strdup(e->path[i])) == NULL) {
+	    while (i > 0)
+		free(list[--i]);
+	    free(list);
+	    return ENOMEM;
+	}
+    }
+    list[i] = NULL;
+    *nodes = list;
+    return 0;
+}
+
+void
+krb5int_realm_map_free(context)
+    krb5_context context;
+{
+    struct realm_map *map = (struct realm_map *) context->realm_map;
+
+    if (map == NULL)
+	return;
+    map_clear(&map->domains);
+    map_clear(&map->capaths);
+    free(map);
+    context->realm_map = NULL;
+}
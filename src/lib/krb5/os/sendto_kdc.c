@@ -67,39 +67,105 @@ krb5_sendto_kdc (context, message, realm, reply, use_master)
     krb5_data * reply;
     int use_master;
 {
-    register int timeout, host, i;
-    struct sockaddr *addr;
+    krb5_error_code retval;
+
+    return krb5int_sendto_kdc_multi(context, 1, &message, &realm, reply,
+				    &retval, use_master);
+}
+
+/* one of the requests being sent by krb5int_sendto_kdc_multi */
+struct kdc_request {
+    const krb5_data * message;
+    krb5_data * reply;
+    krb5_error_code * retval;
+    struct sockaddr * addr;
     int naddr;
-    int sent, nready;
+    SOCKET * socklist;
+    int done;
+};
+
+/*
+ * send each of the nmessages formatted requests messages[i] to a KDC
+ * for realms[i], all at once, and return the responses in replies[i].
+ * The requests are sent to the first KDC for each realm together, and
+ * the replies waited for together, before moving on to the next KDC
+ * for those which got none, so that n requests take about as long as
+ * one.
+ *
+ * retvals[i] is set to what krb5_sendto_kdc would return for
+ * messages[i], and replies[i] is allocated only if that is 0.  The
+ * function returns 0 if any request got a response, and otherwise the
+ * error for the first.
+ */
+krb5_error_code
+krb5int_sendto_kdc_multi (context, nmessages, messages, realms, replies,
+			  retvals, use_master)
+    krb5_context context;
+    int nmessages;
+    const krb5_data * const * messages;
+    const krb5_data * const * realms;
+    krb5_data * replies;
+    krb5_error_code * retvals;
+    int use_master;
+{
+    register int timeout, host, i, j;
+    struct kdc_request *reqs, *req;
+    int maxaddr, pending, sent, nready, maxfd, nlisten;
     krb5_error_code retval;
-    SOCKET *socklist;
     fd_set readable;
     struct timeval waitlen;
+    krb5_int32 now_sec, now_usec, end_sec, end_usec;
     int cc;
 
+    reqs = (struct kdc_request *) calloc(nmessages, sizeof(*reqs));
+    if (reqs == NULL)
+	return ENOMEM;
+
     /*
-     * find KDC location(s) for realm
+     * find KDC location(s) for each realm
      */
 
-    if (retval = krb5_locate_kdc (context, realm, &addr, &naddr, use_master))
-	return retval;
-    if (naddr == 0)
-	return (use_master ? KRB5_KDC_UNREACH : KRB5_REALM_UNKNOWN);
+    maxaddr = 0;
+    pending = 0;
+    for (i = 0; i < nmessages; i++) {
+	req = &reqs[i];
+	req->message = messages[i];
+	req->reply = &replies[i];
+	req->retval = &retvals[i];
+	req->reply->data = 0;
+	req->reply->length = 0;
+	req->done = 1;
 
-    socklist = (SOCKET *)malloc(naddr * sizeof(SOCKET));
-    if (socklist == NULL) {
-	krb5_xfree(addr);
-	return ENOMEM;
-    }
-    for (i = 0; i < naddr; i++)
-	socklist[i] = INVALID_SOCKET;
+	if ((retval = krb5_locate_kdc(context, realms[i], &req->addr,
+				      &req->naddr, use_master))) {
+	    *req->retval = retval;
+	    continue;
+	}
+	if (req->naddr == 0) {
+	    *req->retval = (use_master ? KRB5_KDC_UNREACH : KRB5_REALM_UNKNOWN);
+	    continue;
+	}
 
-    if (!(reply->data = malloc(krb5_max_dgram_size))) {
-	krb5_xfree(addr);
-	krb5_xfree(socklist);
-	return ENOMEM;
+	req->socklist = (SOCKET *)malloc(req->naddr * sizeof(SOCKET));
+	if (req->socklist == NULL) {
+	    *req->retval = ENOMEM;
+	    continue;
+	}
+	for (j = 0; j < req->naddr; j++)
+	    req->socklist[j] = INVALID_SOCKET;
+
+	if (!(req->reply->data = malloc(krb5_max_dgram_size))) {
+	    *req->retval = ENOMEM;
+	    continue;
+	}
+	req->reply->length = krb5_max_dgram_size;
+
+	*req->retval = KRB5_KDC_UNREACH;
+	req->done = 0;
+	pending++;
+	if (req->naddr > maxaddr)
+	    maxaddr = req->naddr;
     }
-    reply->length = krb5_max_dgram_size;
 
 #if 0
     /*
@@ -109,10 +175,8 @@ krb5_sendto_kdc (context, message, realm, reply, use_master)
      * See below for commented out SOCKET_CLEANUP()
      */
     if (SOCKET_INITIALIZE()) {  /* PC needs this for some tcp/ip stacks */
-	krb5_xfree(addr);
-	krb5_xfree(socklist);
-	free(reply->data);
-        return SOCKET_ERRNO;
+	retval = SOCKET_ERRNO;
+	goto out;
     }
 #endif
 
@@ -120,114 +184,181 @@ krb5_sendto_kdc (context, message, realm, reply, use_master)
      * do exponential backoff.
      */
 
-    for (timeout = krb5_skdc_timeout_1; timeout < krb5_max_skdc_timeout;
+    for (timeout = krb5_skdc_timeout_1;
+	 pending && timeout < krb5_max_skdc_timeout;
 	 timeout <<= krb5_skdc_timeout_shift) {
 	sent = 0;
-	for (host = 0; host < naddr; host++) {
-	    /* send to the host, wait timeout seconds for a response,
-	       then move on. */
-	    /* cache some sockets for each host */
-	    if (socklist[host] == INVALID_SOCKET) {
-		/* XXX 4.2/4.3BSD has PF_xxx = AF_xxx, so the socket
-		   creation here will work properly... */
-		/*
-		 * From socket(2):
-		 *
-		 * The protocol specifies a particular protocol to be
-		 * used with the socket.  Normally only a single
-		 * protocol exists to support a particular socket type
-		 * within a given protocol family.
-		 */
-		socklist[host] = socket(addr[host].sa_family, SOCK_DGRAM, 0);
-		if (socklist[host] == INVALID_SOCKET)
-		    continue;		/* try other hosts */
-		/* have a socket to send/recv from */
-		/* On BSD systems, a connected UDP socket will get connection
-		   refused and net unreachable errors while an unconnected
-		   socket will time out, so use connect, send, recv instead of
-		   sendto, recvfrom.  The connect here may return an error if
-		   the destination host is known to be unreachable. */
-		if (connect(socklist[host],
-			    &addr[host], sizeof(addr[host])) == SOCKET_ERROR)
-		  continue;
+	for (host = 0; pending && host < maxaddr; host++) {
+	    /* send each outstanding request to its host, wait timeout
+	       seconds for responses, then move on. */
+	    for (i = 0; i < nmessages; i++) {
+		req = &reqs[i];
+		if (req->done || host >= req->naddr)
+		    continue;
+		/* cache some sockets for each host */
+		if (req->socklist[host] == INVALID_SOCKET) {
+		    /* XXX 4.2/4.3BSD has PF_xxx = AF_xxx, so the socket
+		       creation here will work properly... */
+		    /*
+		     * From socket(2):
+		     *
+		     * The protocol specifies a particular protocol to be
+		     * used with the socket.  Normally only a single
+		     * protocol exists to support a particular socket type
+		     * within a given protocol family.
+		     */
+		    req->socklist[host] = socket(req->addr[host].sa_family,
+						 SOCK_DGRAM, 0);
+		    if (req->socklist[host] == INVALID_SOCKET)
+			continue;	/* try other hosts */
+		    /* have a socket to send/recv from */
+		    /* On BSD systems, a connected UDP socket will get
+		       connection refused and net unreachable errors while
+		       an unconnected socket will time out, so use
+		       connect, send, recv instead of sendto, recvfrom.
+		       The connect here may return an error if the
+		       destination host is known to be unreachable. */
+		    if (connect(req->socklist[host], &req->addr[host],
+				sizeof(req->addr[host])) == SOCKET_ERROR)
+			continue;
+		}
+		(void) send(req->socklist[host], req->message->data,
+			    req->message->length, 0);
 	    }
-	    if (send(socklist[host],
-		       message->data, message->length, 0) != message->length)
-	      continue;
-	retry:
-	    waitlen.tv_usec = 0;
-	    waitlen.tv_sec = timeout;
-	    FD_ZERO(&readable);
-	    FD_SET(socklist[host], &readable);
-	    if (nready = select(SOCKET_NFDS(socklist[host]),
-				&readable,
-				0,
-				0,
-				&waitlen)) {
+
+	    if ((retval = krb5_crypto_us_timeofday(&end_sec, &end_usec)))
+		goto out;
+	    end_sec += timeout;
+
+	    while (pending) {
+		/* wait for any request's sockets on this or an earlier
+		   host, for what is left of timeout */
+		if ((retval = krb5_crypto_us_timeofday(&now_sec, &now_usec)))
+		    goto out;
+		if ((now_sec > end_sec) ||
+		    ((now_sec == end_sec) && (now_usec >= end_usec)))
+		    break;
+		waitlen.tv_sec = end_sec - now_sec;
+		waitlen.tv_usec = end_usec - now_usec;
+		if (waitlen.tv_usec < 0) {
+		    waitlen.tv_usec += 1000000;
+		    waitlen.tv_sec--;
+		}
+
+		FD_ZERO(&readable);
+		maxfd = 0;
+		nlisten = 0;
+		for (i = 0; i < nmessages; i++) {
+		    req = &reqs[i];
+		    if (req->done)
+			continue;
+		    for (j = 0; j <= host && j < req->naddr; j++) {
+			if (req->socklist[j] == INVALID_SOCKET)
+			    continue;
+			FD_SET(req->socklist[j], &readable);
+			nlisten++;
+			if (SOCKET_NFDS(req->socklist[j]) > maxfd)
+			    maxfd = SOCKET_NFDS(req->socklist[j]);
+		    }
+		}
+		if (nlisten == 0)
+		    break;		/* nothing left to listen to */
+
+		nready = select(maxfd, &readable, 0, 0, &waitlen);
+		if (nready == 0) {
+		    /* timeout */
+		    sent = 1;
+		    break;
+		}
 		if (nready == SOCKET_ERROR) {
 		    if (SOCKET_ERRNO == SOCKET_EINTR)
-			goto retry;
+			continue;
 		    retval = SOCKET_ERRNO;
 		    goto out;
 		}
-		if ((cc = recv(socklist[host],
-			       reply->data, reply->length, 0)) == SOCKET_ERROR)
-		  {
-		    /* man page says error could be:
-		       EBADF: won't happen
-		       ENOTSOCK: it's a socket.
-		       EWOULDBLOCK: not marked non-blocking, and we selected.
-		       EINTR: could happen
-		       EFAULT: we allocated the reply packet.
-
-		       In addition, net related errors like ECONNREFUSED
-		       are possble (but undocumented).  Assume anything
-		       other than EINTR is a permanent error for the
-		       server (i.e. don't set sent = 1).
-		       */
 
-		    if (SOCKET_ERRNO == SOCKET_EINTR)
-		      sent = 1;
-		    continue;
-		  }
+		for (i = 0; i < nmessages; i++) {
+		    req = &reqs[i];
+		    if (req->done)
+			continue;
+		    for (j = 0; j <= host && j < req->naddr; j++) {
+			if (req->socklist[j] == INVALID_SOCKET ||
+			    !FD_ISSET(req->socklist[j], &readable))
+			    continue;
+			if ((cc = recv(req->socklist[j], req->reply->data,
+				       req->reply->length, 0)) == SOCKET_ERROR) {
+			    /* man page says error could be:
+			       EBADF: won't happen
+			       ENOTSOCK: it's a socket.
+			       EWOULDBLOCK: not marked non-blocking, and we
+			       selected.
+			       EINTR: could happen
+			       EFAULT: we allocated the reply packet.
 
-		/* We might consider here verifying that the reply
-		   came from one of the KDC's listed for that address type,
-		   but that check can be fouled by some implementations of
-		   some network types which might show a loopback return
-		   address, for example, if the KDC is on the same host
-		   as the client. */
+			       In addition, net related errors like
+			       ECONNREFUSED are possble (but undocumented).
+			       Assume anything other than EINTR is a
+			       permanent error for the server, and stop
+			       listening to it. */
+			    if (SOCKET_ERRNO != SOCKET_EINTR) {
+				(void) closesocket(req->socklist[j]);
+				req->socklist[j] = INVALID_SOCKET;
+			    }
+			    continue;
+			}
 
-		reply->length = cc;
-		retval = 0;
+			/* We might consider here verifying that the reply
+			   came from one of the KDC's listed for that
+			   address type, but that check can be fouled by
+			   some implementations of some network types
+			   which might show a loopback return address, for
+			   example, if the KDC is on the same host as the
+			   client. */
 
-		goto out;
-	    } else if (nready == 0) {
-		/* timeout */
-	        sent = 1;
+			req->reply->length = cc;
+			*req->retval = 0;
+			req->done = 1;
+			pending--;
+			break;
+		    }
+		}
 	    }
-	    /* not ready, go on to next server */
+	    /* not all answered, go on to next server */
 	}
 	if (!sent) {
 	    /* never were able to send to any servers; give up */
-	    retval = KRB5_KDC_UNREACH;
 	    break;
 	}
     }
-    retval = KRB5_KDC_UNREACH;
+    retval = 0;
+
  out:
-    for (i = 0; i < naddr; i++)
-	if (socklist[i] != INVALID_SOCKET)
-	    (void) closesocket (socklist[i]);
+    for (i = 0; i < nmessages; i++) {
+	req = &reqs[i];
+	if (retval)
+	    *req->retval = retval;
+	if (req->socklist) {
+	    for (j = 0; j < req->naddr; j++)
+		if (req->socklist[j] != INVALID_SOCKET)
+		    (void) closesocket (req->socklist[j]);
+	    krb5_xfree(req->socklist);
+	}
+	if (req->addr)
+	    krb5_xfree(req->addr);
+	if (*req->retval && req->reply->data) {
+	    free(req->reply->data);
+	    req->reply->data = 0;
+	    req->reply->length = 0;
+	}
+    }
 #if 0
     SOCKET_CLEANUP();                           /* Done with sockets for now */
 #endif
-    krb5_xfree(addr);
-    krb5_xfree(socklist);
-    if (retval) {
-	free(reply->data);
-	reply->data = 0;
-	reply->length = 0;
-    }
-    return retval;
+    krb5_xfree(reqs);
+
+    /* succeed if anything was answered */
+    for (i = 0; i < nmessages; i++)
+	if (retvals[i] == 0)
+	    return 0;
+    return retvals[0];
 }
@@ -45,8 +45,14 @@
 #include "k5-int.h"
 #include "com_err.h"
 #include "kprop.h"
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+#define KPROP_ZLIB
+#include <zlib.h>
+#endif
 
 static char *kprop_version = KPROP_PROT_VERSION;
+static char *kprop_version_2 = KPROP_PROT_VERSION_2;
+static char *kprop_version_3 = KPROP_PROT_VERSION_3;
 
 char	*progname = 0;
 int     debug = 0;
@@ -56,6 +62,13 @@ char	*realm = 0;
 char	*file = KPROP_DEFAULT_FILE;
 short	port = 0;
 
+/* Where the update log stood when the dump was made, from its ok file. */
+char	*log_file = 0;
+krb5_ui_4 dump_generation, dump_serial;
+
+int	protocol = 1;		/* Version of the protocol in use */
+int	use_zlib = 0;		/* Whether to compress the data */
+
 krb5_principal	my_principal;		/* The Kerberos principal we'll be */
 				/* running under, initialized in */
 				/* get_tickets() */
@@ -73,16 +86,26 @@ static void usage
 	PROTOTYPE((void));
 krb5_error_code open_connection 
 	PROTOTYPE((char *, int *, char *, int));
-void	kerberos_authenticate 
+krb5_error_code kerberos_authenticate 
 	PROTOTYPE((krb5_context, krb5_auth_context *, 
-		   int, krb5_principal, krb5_creds **));
+		   int, krb5_principal, krb5_creds **, char *));
+int	connect_slave
+	PROTOTYPE((krb5_context, char *, krb5_auth_context *, krb5_creds **));
 int	open_database 
 	PROTOTYPE((krb5_context, char *, int *));
 void	close_database 
 	PROTOTYPE((krb5_context, int));
 void	xmit_database 
+	PROTOTYPE((krb5_context, krb5_auth_context, krb5_creds *, 
+		   int, int, int, int, krb5_ui_4, krb5_ui_4));
+void	xmit_update
 	PROTOTYPE((krb5_context, krb5_auth_context, krb5_creds *, 
 		   int, int, int));
+void	xmit_block
+	PROTOTYPE((krb5_context, krb5_auth_context, krb5_creds *, 
+		   int, char *, int, int));
+void	check_recv_error
+	PROTOTYPE((krb5_context, krb5_data *, char *));
 void	send_error 
 	PROTOTYPE((krb5_context, krb5_creds *, int, char *, krb5_error_code));
 void	update_last_prop_file 
@@ -105,7 +128,6 @@ main(argc, argv)
 	krb5_context context;
 	krb5_creds *my_creds;
 	krb5_auth_context auth_context;
-	char	Errmsg[256];
 	
 	retval = krb5_init_context(&context);
 	if (retval) {
@@ -116,20 +138,30 @@ main(argc, argv)
 	get_tickets(context);
 
 	database_fd = open_database(context, file, &database_size);
-	if (retval = open_connection(slave_host, &fd, Errmsg, sizeof(Errmsg))) {
-		com_err(progname, retval, "%s while opening connection to %s",
-			Errmsg, slave_host);
-		exit(1);
+
+	/*
+	 * Use the latest version of the protocol the slave knows.  From
+	 * version 2 on, if the dump says where the update log stood, the
+	 * slave is offered just the changes it is missing; a slave which
+	 * only knows version 1 gets the whole dump as before.
+	 */
+	protocol = 3;
+	fd = connect_slave(context, kprop_version_3, &auth_context, &my_creds);
+	if (fd < 0 && log_file) {
+		protocol = 2;
+		fd = connect_slave(context, kprop_version_2, &auth_context,
+				   &my_creds);
 	}
-	if (fd < 0) {
-		fprintf(stderr, "%s: %s while opening connection to %s\n",
-			progname, Errmsg, slave_host);
-		exit(1);
+	if (fd >= 0)
+		xmit_update(context, auth_context, my_creds, fd, database_fd,
+			    database_size);
+	else {
+		protocol = 1;
+		fd = connect_slave(context, kprop_version, &auth_context,
+				   &my_creds);
+		xmit_database(context, auth_context, my_creds, fd,
+			      database_fd, database_size, 0, 0, 0);
 	}
-	kerberos_authenticate(context, &auth_context, fd, my_principal, 
-			      &my_creds);
-	xmit_database(context, auth_context, my_creds, fd, database_fd, 
-		      database_size);
 	update_last_prop_file(slave_host, file);
 	printf("Database propagation to %s: SUCCEEDED\n", slave_host);
 	krb5_free_cred_contents(context, my_creds);
@@ -381,12 +413,55 @@ open_connection(host, fd, Errmsg, ErrmsgSz)
 }
 
 
-void kerberos_authenticate(context, auth_context, fd, me, new_creds)
+/*
+ * Connect and authenticate to the slave using the given version of the
+ * protocol.  Returns the socket, or -1 if the slave would not accept
+ * that version.
+ */
+int
+connect_slave(context, version, auth_context, my_creds)
+    krb5_context context;
+    char *version;
+    krb5_auth_context *auth_context;
+    krb5_creds **my_creds;
+{
+	int	fd;
+	krb5_error_code	retval;
+	char	Errmsg[256];
+
+	if ((retval = open_connection(slave_host, &fd, Errmsg, sizeof(Errmsg)))) {
+		com_err(progname, retval, "%s while opening connection to %s",
+			Errmsg, slave_host);
+		exit(1);
+	}
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s while opening connection to %s\n",
+			progname, Errmsg, slave_host);
+		exit(1);
+	}
+	if (kerberos_authenticate(context, auth_context, fd, my_principal, 
+				  my_creds, version)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * Authenticate to the slave.  Failures are fatal, except that when
+ * trying a later version of the protocol the error is returned so
+ * that the caller can fall back to the original one.  Old versions of
+ * kpropd may simply drop the connection rather than reject the version
+ * cleanly, so this is done whatever the error.
+ */
+krb5_error_code
+kerberos_authenticate(context, auth_context, fd, me, new_creds, version)
     krb5_context context;
     krb5_auth_context *auth_context;
     int	fd;
     krb5_principal me;
     krb5_creds ** new_creds;
+    char *version;
 {
 	krb5_error_code	retval;
 	krb5_error	*error = NULL;
@@ -405,9 +480,19 @@ void kerberos_authenticate(context, auth_context, fd, me, new_creds)
     }
 
 	if (retval = krb5_sendauth(context, auth_context, (void *)&fd, 
-				   kprop_version, me, creds.server,
+				   version, me, creds.server,
 				   AP_OPTS_MUTUAL_REQUIRED, NULL, &creds, NULL,
 				   &error, &rep_result, new_creds)) {
+		if (version != kprop_version) {
+			if (debug)
+				printf("%s refused protocol %s: %s\n",
+				       slave_host, version,
+				       error_message(retval));
+			if (error)
+				krb5_free_error(context, error);
+			krb5_auth_con_free(context, *auth_context);
+			return retval;
+		}
 		com_err(progname, retval, "while authenticating to server");
 		if (error) {
 			if (error->error == KRB_ERR_GENERIC) {
@@ -429,6 +514,7 @@ void kerberos_authenticate(context, auth_context, fd, me, new_creds)
 		exit(1);
 	}
 	krb5_free_ap_rep_enc_part(context, rep_result);
+	return 0;
 }
 
 char * dbpathname;
@@ -451,6 +537,9 @@ open_database(context, data_fn, size)
 	struct stat 	stbuf, stbuf_ok;
 	char		*data_ok_fn;
 	static char ok[] = ".dump_ok";
+	FILE		*okf;
+	char		okbuf[MAXPATHLEN + 64], *cp;
+	unsigned long	gen, serial;
 
 	dbpathname = strdup(data_fn);
 	if (!dbpathname) {
@@ -491,12 +580,29 @@ open_database(context, data_fn, size)
 		free(data_ok_fn);
 		exit(1);
 	}
-	free(data_ok_fn);
 	if (stbuf.st_mtime > stbuf_ok.st_mtime) {
 		com_err(progname, 0, "'%s' more recent than '%s'.",
 			data_fn, data_ok_fn);
 		exit(1);
 	}
+	/*
+	 * kdb5_util dump leaves the update log position of the dump in
+	 * the ok file: "generation\tserial\tlogfile".
+	 */
+	if ((okf = fopen(data_ok_fn, "r")) != NULL) {
+		if (fgets(okbuf, sizeof(okbuf), okf) &&
+		    sscanf(okbuf, "%lu\t%lu\t", &gen, &serial) == 2 &&
+		    (cp = strchr(okbuf, '\t')) &&
+		    (cp = strchr(cp + 1, '\t')) && cp[1] != '\n' &&
+		    cp[1] != '\0') {
+			cp[strcspn(cp, "\n")] = '\0';
+			dump_generation = gen;
+			dump_serial = serial;
+			log_file = strdup(cp + 1);
+		}
+		fclose(okf);
+	}
+	free(data_ok_fn);
 	*size = stbuf.st_size;
 	return(fd);
 }
@@ -514,29 +620,200 @@ close_database(context, fd)
     return;
 }
   
+/*
+ * If the slave sent a KRB_ERROR message in inbuf, display it and exit.
+ */
+void
+check_recv_error(context, inbuf, what)
+    krb5_context context;
+    krb5_data *inbuf;
+    char *what;
+{
+	krb5_error_code	retval;
+	krb5_error	*error;
+
+	if (!krb5_is_krb_error(inbuf))
+		return;
+	if ((retval = krb5_rd_error(context, inbuf, &error))) {
+		com_err(progname, retval,
+			"while decoding error response from server");
+		exit(1);
+	}
+	if (error->error == KRB_ERR_GENERIC) {
+		if (error->text.data)
+			fprintf(stderr,
+				"Generic remote error: %s\n",
+				error->text.data);
+	} else if (error->error) {
+		com_err(progname, error->error + ERROR_TABLE_BASE_krb5,
+			"signalled from server%s", what);
+		if (error->text.data)
+			fprintf(stderr,
+				"Error text from server: %s\n",
+				error->text.data);
+	}
+	krb5_free_error(context, error);
+	exit(1);
+}
+
+/*
+ * Version 2 of the protocol: the slave starts by telling us, in a
+ * KRB_SAFE message, the update log generation and serial number its
+ * database was last loaded at.  If the update log still holds every
+ * change since then we send only those, to be applied with "kdb5_util
+ * load -update"; otherwise the slave gets the whole dump.  In version
+ * 3 the message also says whether the slave can take compressed data.
+ */
+void
+xmit_update(context, auth_context, my_creds, fd, database_fd, database_size)
+    krb5_context context;
+    krb5_auth_context auth_context;
+    krb5_creds *my_creds;
+    int	fd;
+    int	database_fd;
+    int	database_size;
+{
+	krb5_data	inbuf, outbuf;
+	krb5_ui_4	pos[3], gen, serial, flags, newserial;
+	krb5_error_code	retval;
+	struct stat	stbuf;
+	FILE		*tmp;
+
+	if ((retval = krb5_read_message(context, (void *) &fd, &inbuf))) {
+		com_err(progname, retval,
+			"while reading position from server");
+		exit(1);
+	}
+	check_recv_error(context, &inbuf, " instead of its position");
+	if ((retval = krb5_rd_safe(context,auth_context,&inbuf,&outbuf,NULL))) {
+		com_err(progname, retval,
+			"while decoding position from server");
+		send_error(context, my_creds, fd,
+			   "while decoding position", retval);
+		exit(1);
+	}
+	if (outbuf.length != (protocol >= 3 ? 3 : 2) * sizeof(pos[0])) {
+		com_err(progname, 0, "Kpropd sent a malformed position");
+		send_error(context, my_creds, fd, "malformed position",
+			   KRB5KRB_ERR_GENERIC);
+		exit(1);
+	}
+	memcpy((char *)pos, outbuf.data, outbuf.length);
+	gen = ntohl(pos[0]);
+	serial = ntohl(pos[1]);
+	flags = (protocol >= 3) ? ntohl(pos[2]) : 0;
+	free(outbuf.data);
+	free(inbuf.data);
+#ifdef KPROP_ZLIB
+	use_zlib = (flags & KPROP_FLAG_ZLIB) != 0;
+#endif
+
+	retval = KRB5_KDB_LOG_GAP;
+	if (log_file && gen && (tmp = tmpfile()) != NULL) {
+		retval = krb5_db_log_copy(context, log_file, gen, serial,
+					  fileno(tmp), &newserial);
+		if (!retval && fstat(fileno(tmp), &stbuf))
+			retval = errno;
+		if (!retval) {
+			if (debug)
+				printf("Sending updates %lu to %lu of %lu\n",
+				       (unsigned long) serial + 1,
+				       (unsigned long) newserial,
+				       (unsigned long) gen);
+			(void) lseek(fileno(tmp), 0, SEEK_SET);
+			xmit_database(context, auth_context, my_creds, fd,
+				      fileno(tmp), (int) stbuf.st_size,
+				      KPROP_XFER_UPDATE, gen, newserial);
+		}
+		fclose(tmp);
+	}
+	if (retval) {
+		if (debug)
+			printf("Sending full dump: %s\n",
+			       error_message(retval));
+		xmit_database(context, auth_context, my_creds, fd,
+			      database_fd, database_size, KPROP_XFER_FULL,
+			      dump_generation, dump_serial);
+	}
+}
+
+/*
+ * Send one block of the database, encrypted using KRB_PRIV.  offset is
+ * where it starts in the database, for error messages.
+ */
+void
+xmit_block(context, auth_context, my_creds, fd, data, length, offset)
+    krb5_context context;
+    krb5_auth_context auth_context;
+    krb5_creds *my_creds;
+    int	fd;
+    char *data;
+    int length;
+    int offset;
+{
+	krb5_data	inbuf, outbuf;
+	krb5_error_code	retval;
+	char		buf[100];
+
+	inbuf.data = data;
+	inbuf.length = length;
+	if ((retval = krb5_mk_priv(context, auth_context, &inbuf,
+				   &outbuf, NULL))) {
+		sprintf(buf,
+			"while encoding database block starting at %d",
+			offset);
+		com_err(progname, retval, buf);
+		send_error(context, my_creds, fd, buf, retval);
+		exit(1);
+	}
+	if ((retval = krb5_write_message(context, (void *)&fd,&outbuf))) {
+		krb5_free_data_contents(context, &outbuf);
+		com_err(progname, retval,
+			"while sending database block starting at %d",
+			offset);
+		exit(1);
+	}
+	krb5_free_data_contents(context, &outbuf);
+}
+
 /*
  * Now we send over the database.  We use the following protocol:
  * Send over a KRB_SAFE message with the size.  Then we send over the
  * database in blocks of KPROP_BLKSIZE, encrypted using KRB_PRIV.
  * Then we expect to see a KRB_SAFE message with the size sent back.
  * 
+ * In version 2 of the protocol the size message also carries what kind
+ * of transfer this is and the update log position the slave will be
+ * at after loading it (kind is 0 for version 1).  Version 3 adds the
+ * flags, and sends the data in blocks of KPROP_BIGBUFSIZ, compressed
+ * if the slave said it could take that.
+ *
  * At any point in the protocol, we may send a KRB_ERROR message; this
  * will abort the entire operation.
  */
 void
-xmit_database(context, auth_context, my_creds, fd, database_fd, database_size)
+xmit_database(context, auth_context, my_creds, fd, database_fd, database_size,
+	      kind, gen, serial)
     krb5_context context;
     krb5_auth_context auth_context;
     krb5_creds *my_creds;
     int	fd;
     int	database_fd;
     int	database_size;
+    int kind;
+    krb5_ui_4 gen, serial;
 {
 	krb5_int32	send_size, sent_size, n;
+	krb5_ui_4	header[5];
 	krb5_data	inbuf, outbuf;
-	char		buf[KPROP_BUFSIZ];
+	char		*buf;
+	int		bufsize;
 	krb5_error_code	retval;
-	krb5_error	*error;
+#ifdef KPROP_ZLIB
+	z_stream	zs;
+	char		*zbuf = NULL;
+	int		zret;
+#endif
 	
 	/*
 	 * Send over the size
@@ -544,6 +821,15 @@ xmit_database(context, auth_context, my_creds, fd, database_fd, database_size)
 	send_size = htonl(database_size);
 	inbuf.data = (char *) &send_size;
 	inbuf.length = sizeof(send_size); /* must be 4, really */
+	if (kind) {
+		header[0] = send_size;
+		header[1] = htonl(kind);
+		header[2] = htonl(gen);
+		header[3] = htonl(serial);
+		header[4] = htonl(use_zlib ? KPROP_FLAG_ZLIB : 0);
+		inbuf.data = (char *) header;
+		inbuf.length = (protocol >= 3 ? 5 : 4) * sizeof(header[0]);
+	}
 	/* KPROP_CKSUMTYPE */
 	if (retval = krb5_mk_safe(context, auth_context, &inbuf, 
 				  &outbuf, NULL)) {
@@ -569,31 +855,70 @@ xmit_database(context, auth_context, my_creds, fd, database_fd, database_size)
 	/*
 	 * Send over the file, block by block....
 	 */
-	inbuf.data = buf;
-	sent_size = 0;
-	while (n = read(database_fd, buf, sizeof(buf))) {
-		inbuf.length = n;
-		if (retval = krb5_mk_priv(context, auth_context, &inbuf,
-					  &outbuf, NULL)) {
-			sprintf(buf,
-				"while encoding database block starting at %d",
-				sent_size);
-			com_err(progname, retval, buf);
-			send_error(context, my_creds, fd, buf, retval);
-			exit(1);
-		}
-		if (retval = krb5_write_message(context, (void *)&fd,&outbuf)) {
-			krb5_free_data_contents(context, &outbuf);
-			com_err(progname, retval,
-				"while sending database block starting at %d",
-				sent_size);
+	bufsize = (protocol >= 3) ? KPROP_BIGBUFSIZ : KPROP_BUFSIZ;
+	if ((buf = (char *) malloc(bufsize)) == NULL) {
+		com_err(progname, ENOMEM, "while allocating database buffer");
+		send_error(context, my_creds, fd,
+			   "while allocating database buffer", ENOMEM);
+		exit(1);
+	}
+#ifdef KPROP_ZLIB
+	if (use_zlib) {
+		memset((char *) &zs, 0, sizeof(zs));
+		if ((zbuf = (char *) malloc(bufsize)) == NULL ||
+		    deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK) {
+			com_err(progname, ENOMEM,
+				"while setting up compression");
+			send_error(context, my_creds, fd,
+				   "while setting up compression", ENOMEM);
 			exit(1);
 		}
-		krb5_free_data_contents(context, &outbuf);
+	}
+#endif
+	sent_size = 0;
+	while ((n = read(database_fd, buf, bufsize)) > 0) {
+#ifdef KPROP_ZLIB
+		if (use_zlib) {
+			/*
+			 * Flush each block so that the slave can use all
+			 * of it as soon as it arrives.
+			 */
+			zs.next_in = (Bytef *) buf;
+			zs.avail_in = n;
+			do {
+				zs.next_out = (Bytef *) zbuf;
+				zs.avail_out = bufsize;
+				zret = deflate(&zs, Z_SYNC_FLUSH);
+				if (zret != Z_OK && zret != Z_BUF_ERROR) {
+					com_err(progname, 0,
+						"while compressing database block starting at %d: %s",
+						sent_size, zs.msg ? zs.msg : "");
+					send_error(context, my_creds, fd,
+						   "while compressing database",
+						   KRB5KRB_ERR_GENERIC);
+					exit(1);
+				}
+				if (zs.avail_out < bufsize)
+					xmit_block(context, auth_context,
+						   my_creds, fd, zbuf,
+						   bufsize - zs.avail_out,
+						   sent_size);
+			} while (zs.avail_out == 0);
+		} else
+#endif
+		xmit_block(context, auth_context, my_creds, fd, buf, n,
+			   sent_size);
 		sent_size += n;
 		if (debug)
 			printf("%d bytes sent.\n", sent_size);
 	}
+#ifdef KPROP_ZLIB
+	if (use_zlib)
+		deflateEnd(&zs);
+	if (zbuf)
+		free(zbuf);
+#endif
+	free(buf);
 	if (sent_size != database_size) {
 		com_err(progname, 0, "Premature EOF found for database file!");
 		send_error(context, my_creds, fd,"Premature EOF found for database file!",
@@ -613,28 +938,7 @@ xmit_database(context, auth_context, my_creds, fd, database_fd, database_size)
 	 * If we got an error response back from the server, display
 	 * the error message
 	 */
-	if (krb5_is_krb_error(&inbuf)) {
-		if (retval = krb5_rd_error(context, &inbuf, &error)) {
-			com_err(progname, retval,
-				"while decoding error response from server");
-			exit(1);
-		}
-		if (error->error == KRB_ERR_GENERIC) {
-			if (error->text.data)
-				fprintf(stderr,
-					"Generic remote error: %s\n",
-					error->text.data);
-		} else if (error->error) {
-			com_err(progname, error->error + ERROR_TABLE_BASE_krb5,
-				"signalled from server");
-			if (error->text.data)
-				fprintf(stderr,
-					"Error text from server: %s\n",
-					error->text.data);
-		}
-		krb5_free_error(context, error);
-		exit(1);
-	}
+	check_recv_error(context, &inbuf, "");
 	if (retval = krb5_rd_safe(context,auth_context,&inbuf,&outbuf,NULL)) {
 		com_err(progname, retval,
 			"while decoding final size packet from server");
@@ -33,6 +33,35 @@
 
 #define KPROP_PROT_VERSION "kprop5_01"
 
+/*
+ * Version 2 of the protocol lets kpropd say which update of the
+ * master's database it has, so that kprop can send just the newer
+ * changes from the master's update log.  After authentication kpropd
+ * sends a KRB_SAFE message with its position, and kprop's size message
+ * is followed by the kind of transfer and the position the slave will
+ * be at once it has loaded it.  A position is a generation and a
+ * serial number, each four bytes in network order; generation 0 means
+ * the position is unknown.
+ */
+#define KPROP_PROT_VERSION_2 "kprop5_02"
+
+#define KPROP_XFER_FULL		1	/* a dump of the whole database */
+#define KPROP_XFER_UPDATE	2	/* changes from the update log */
+
+/*
+ * Version 3 adds a word of flags after the position kpropd sends,
+ * saying what it can accept, and after the position in kprop's size
+ * message, saying what is being sent.  The data is sealed in records
+ * of up to KPROP_BIGBUFSIZ bytes, and with KPROP_FLAG_ZLIB it is one
+ * zlib stream, flushed at the end of each record so that kpropd can
+ * pass the data on to kdb5_util as it arrives.  The size is always
+ * that of the uncompressed data.
+ */
+#define KPROP_PROT_VERSION_3 "kprop5_03"
+
+#define KPROP_FLAG_ZLIB		0x1	/* zlib compressed data */
+
 #define KPROP_BUFSIZ 32768
+#define KPROP_BIGBUFSIZ (1024 * 1024)
 
 /* pathnames are in osconf.h, included via k5-int.h */
@@ -81,10 +81,16 @@
 #include <errno.h>
 
 #include "kprop.h"
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+#define KPROP_ZLIB
+#include <zlib.h>
+#endif
 
 #define SYSLOG_CLASS LOG_DAEMON
 
 static char *kprop_version = KPROP_PROT_VERSION;
+static char *kprop_version_2 = KPROP_PROT_VERSION_2;
+static char *kprop_version_3 = KPROP_PROT_VERSION_3;
 
 char	*progname;
 int     debug = 0;
@@ -98,6 +104,10 @@ krb5_auth_context auth_context;
 char	*realm = NULL;		/* Our realm */
 char	*file = KPROPD_DEFAULT_FILE;
 char	*temp_file_name;
+char	*position_file_name;	/* Update log position of our database */
+int	protocol = 1;		/* Version of the protocol kprop speaks */
+int	loader_pid = 0;		/* kdb5_util loading as data arrives */
+int	loader_fd = -1;		/* Pipe to its standard input */
 char	*kdb5_util = KPROPD_DEFAULT_KDB5_UTIL;
 char	*kerb_database = NULL;
 char	*acl_file_name = KPROPD_ACL_FILE;
@@ -123,15 +133,37 @@ krb5_boolean authorized_principal
 	PROTOTYPE((krb5_context,
     		   krb5_principal,
 		   krb5_enctype));
+void	send_position
+	PROTOTYPE((krb5_context,
+		   int));
 void	recv_database
 	PROTOTYPE((krb5_context,
 		   int,
 		   int,
-		   krb5_data *));
+		   krb5_data *,
+		   int *,
+		   krb5_ui_4 *,
+		   krb5_ui_4 *));
+void	store_block
+	PROTOTYPE((krb5_context,
+		   int,
+		   char *,
+		   int,
+		   int));
 void	load_database
 	PROTOTYPE((krb5_context,
     		   char *,
-    		   char *));
+    		   char *,
+		   int));
+int	start_load
+	PROTOTYPE((krb5_context,
+    		   char *,
+    		   char *,
+		   int,
+		   int *));
+void	wait_load
+	PROTOTYPE((krb5_context,
+		   int));
 void	send_error
 	PROTOTYPE((krb5_context,
     		   int,
@@ -266,6 +298,9 @@ void doit(fd)
 	int lock_fd;
 	int omask;
 	krb5_enctype etype;
+	int kind;
+	krb5_ui_4 gen, serial;
+	FILE *posf;
 
 	fromlen = sizeof (from);
 	if (getpeername(fd, (struct sockaddr *) &from, &fromlen) < 0) {
@@ -328,7 +363,15 @@ void doit(fd)
 			temp_file_name);
 		exit(1);
 	}
-	recv_database(kpropd_context, fd, database_fd, &confmsg);
+	if (protocol >= 2)
+		send_position(kpropd_context, fd);
+	/*
+	 * Forget where we were in the master's update log until the new
+	 * data is safely loaded; then remember where that leaves us.
+	 */
+	(void) unlink(position_file_name);
+	recv_database(kpropd_context, fd, database_fd, &confmsg,
+		      &kind, &gen, &serial);
 	if (rename(temp_file_name, file)) {
 		com_err(progname, errno, "While renaming %s to %s",
 			temp_file_name, file);
@@ -340,7 +383,25 @@ void doit(fd)
 		    temp_file_name);
 	    exit(1);
 	}
-	load_database(kpropd_context, kdb5_util, file);
+	if (loader_pid) {
+		/* kdb5_util has been loading the data as it arrived; the
+		   "." line tells it that all of it has. */
+		if (loader_fd >= 0)
+			(void) write(loader_fd, ".\n", 2);
+		(void) close(loader_fd);
+		wait_load(kpropd_context, loader_pid);
+	} else
+		load_database(kpropd_context, kdb5_util, file,
+			      kind == KPROP_XFER_UPDATE);
+	if (gen && (posf = fopen(position_file_name, "w")) != NULL) {
+		fprintf(posf, "%lu\t%lu\n", (unsigned long) gen,
+			(unsigned long) serial);
+		if (fclose(posf) == EOF) {
+			com_err(progname, errno, "while writing '%s'",
+				position_file_name);
+			(void) unlink(position_file_name);
+		}
+	}
 	retval = krb5_lock_file(kpropd_context, lock_fd, KRB5_LOCKMODE_UNLOCK);
 	if (retval) {
 	    com_err(progname, retval, "while unlocking '%s'", temp_file_name);
@@ -394,6 +455,7 @@ void PRS(argv)
 	char	my_host_name[MAXHOSTNAMELEN], buf[BUFSIZ];
 	krb5_error_code	retval;
 	static const char	tmp[] = ".temp";
+	static const char	pos[] = ".position";
 	
 	retval = krb5_init_context(&kpropd_context);
 	if (retval) {
@@ -519,6 +581,14 @@ void PRS(argv)
 	}
 	strcpy(temp_file_name, file);
 	strcat(temp_file_name, tmp);
+	if ((position_file_name = (char *) malloc(strlen(file) +
+						  strlen(pos) + 1)) == NULL) {
+		com_err(progname, ENOMEM,
+			"while allocating filename for position file");
+		exit(1);
+	}
+	strcpy(position_file_name, file);
+	strcat(position_file_name, pos);
 }
 
 /*
@@ -537,6 +607,7 @@ kerberos_authenticate(context, fd, clientp, etype, sin)
     struct sockaddr_in	  r_sin;
     int			  sin_length;
     krb5_keytab		  keytab = NULL;
+    krb5_data		  version;
 
     /*
      * Set recv_addr and send_addr
@@ -565,7 +636,7 @@ kerberos_authenticate(context, fd, clientp, etype, sin)
 	    com_err(progname, retval, "While unparsing client name");
 	    exit(1);
 	}
-	printf("krb5_recvauth(%d, %s, %s, ...)\n", fd, kprop_version, name);
+	printf("krb5_recvauth_version(%d, %s, ...)\n", fd, name);
 	free(name);
     }
 
@@ -595,11 +666,25 @@ kerberos_authenticate(context, fd, clientp, etype, sin)
 	}
     }
 
-    if (retval = krb5_recvauth(context, &auth_context, (void *) &fd,
-			       kprop_version, server, 0, keytab, &ticket)){
+    if ((retval = krb5_recvauth_version(context, &auth_context,
+					(void *) &fd, server, 0, keytab,
+					&ticket, &version))) {
 	syslog(LOG_ERR, "Error in krb5_recvauth: %s", error_message(retval));
 	exit(1);
     }
+    if (version.length == strlen(kprop_version_3) + 1 &&
+	!memcmp(version.data, kprop_version_3, version.length))
+	protocol = 3;
+    else if (version.length == strlen(kprop_version_2) + 1 &&
+	     !memcmp(version.data, kprop_version_2, version.length))
+	protocol = 2;
+    else if (version.length != strlen(kprop_version) + 1 ||
+	     memcmp(version.data, kprop_version, version.length)) {
+	syslog(LOG_ERR, "Unknown kprop protocol version %.*s",
+	       (int) version.length, version.data);
+	exit(1);
+    }
+    krb5_xfree(version.data);
 
     if (retval = krb5_copy_principal(context, 
 				     ticket->enc_part2->client, clientp)) {
@@ -690,18 +775,85 @@ authorized_principal(context, p, auth_etype)
     return FALSE;
 }
 
+/*
+ * Tell kprop, in a KRB_SAFE message, the generation and serial number
+ * of the last change from its update log which our database holds, or
+ * zeroes if we do not know, and for version 3 of the protocol what we
+ * can accept.
+ */
 void
-recv_database(context, fd, database_fd, confmsg)
+send_position(context, fd)
+    krb5_context context;
+    int	fd;
+{
+	krb5_ui_4	pos[3];
+	unsigned long	gen, serial;
+	krb5_data	inbuf, outbuf;
+	krb5_error_code	retval;
+	FILE		*posf;
+
+	pos[0] = pos[1] = 0;
+#ifdef KPROP_ZLIB
+	pos[2] = htonl(KPROP_FLAG_ZLIB);
+#else
+	pos[2] = 0;
+#endif
+	if ((posf = fopen(position_file_name, "r")) != NULL) {
+		if (fscanf(posf, "%lu\t%lu", &gen, &serial) == 2) {
+			pos[0] = htonl(gen);
+			pos[1] = htonl(serial);
+		}
+		fclose(posf);
+	}
+	if (debug)
+		printf("Our position is %lu/%lu\n",
+		       (unsigned long) ntohl(pos[0]),
+		       (unsigned long) ntohl(pos[1]));
+
+	inbuf.data = (char *) pos;
+	inbuf.length = (protocol >= 3 ? 3 : 2) * sizeof(pos[0]);
+	if ((retval = krb5_mk_safe(context, auth_context, &inbuf, &outbuf,
+				   NULL))) {
+		com_err(progname, retval, "while encoding position");
+		send_error(context, fd, retval, "while encoding position");
+		exit(1);
+	}
+	if ((retval = krb5_write_message(context, (void *) &fd, &outbuf))) {
+		krb5_free_data_contents(context, &outbuf);
+		com_err(progname, retval, "while sending position");
+		exit(1);
+	}
+	krb5_free_data_contents(context, &outbuf);
+}
+
+/*
+ * Receive the database.  With version 2 of the protocol the size
+ * message also says whether this is a full dump or changes from the
+ * update log, and the update log position it brings us to; *kind and
+ * *gen are 0 for version 1.  With version 3 the data may be compressed,
+ * and kdb5_util is started on it straight away, so that the database
+ * is loaded while the rest of it arrives.
+ */
+void
+recv_database(context, fd, database_fd, confmsg, kind, gen, serial)
     krb5_context context;
     int	fd;
     int	database_fd;
     krb5_data *confmsg;
+    int *kind;
+    krb5_ui_4 *gen, *serial;
 {
 	int	database_size;
 	int	received_size, n;
 	char		buf[1024];
 	krb5_data	inbuf, outbuf;
 	krb5_error_code	retval;
+	krb5_ui_4	header[5], flags;
+#ifdef KPROP_ZLIB
+	z_stream	zs;
+	char		*zbuf = NULL;
+	int		zret;
+#endif
 
 	/*
 	 * Receive and decode size from client
@@ -721,6 +873,50 @@ recv_database(context, fd, database_fd, confmsg)
 			"while decoding database size from client");
 		exit(1);
 	}
+	*kind = 0;
+	*gen = *serial = 0;
+	flags = 0;
+	if (protocol >= 2) {
+		if (outbuf.length != (protocol >= 3 ? 5 : 4) * sizeof(header[0])) {
+			send_error(context, fd, KRB5KRB_ERR_GENERIC,
+				   "malformed database size message");
+			com_err(progname, 0,
+				"malformed database size message from client");
+			exit(1);
+		}
+		memcpy((char *) header, outbuf.data, outbuf.length);
+		*kind = ntohl(header[1]);
+		*gen = ntohl(header[2]);
+		*serial = ntohl(header[3]);
+		if (protocol >= 3)
+			flags = ntohl(header[4]);
+		if (*kind != KPROP_XFER_FULL && *kind != KPROP_XFER_UPDATE) {
+			send_error(context, fd, KRB5KRB_ERR_GENERIC,
+				   "unknown kind of transfer");
+			com_err(progname, 0,
+				"unknown kind of transfer %d from client",
+				*kind);
+			exit(1);
+		}
+#ifdef KPROP_ZLIB
+		if (flags & ~KPROP_FLAG_ZLIB) {
+#else
+		if (flags) {
+#endif
+			send_error(context, fd, KRB5KRB_ERR_GENERIC,
+				   "unknown transfer flags");
+			com_err(progname, 0,
+				"unknown transfer flags %lx from client",
+				(unsigned long) flags);
+			exit(1);
+		}
+		if (debug)
+			printf("Receiving %s%s, position %lu/%lu\n",
+			       *kind == KPROP_XFER_UPDATE ? "updates" :
+			       "full dump",
+			       (flags & KPROP_FLAG_ZLIB) ? " compressed" : "",
+			       (unsigned long) *gen, (unsigned long) *serial);
+	}
 	memcpy((char *) &database_size, outbuf.data, sizeof(database_size));
 	krb5_free_data_contents(context, &inbuf);
 	krb5_free_data_contents(context, &outbuf);
@@ -735,6 +931,23 @@ recv_database(context, fd, database_fd, confmsg)
 	exit(1);
     }
 
+#ifdef KPROP_ZLIB
+	if (flags & KPROP_FLAG_ZLIB) {
+		memset((char *) &zs, 0, sizeof(zs));
+		if ((zbuf = (char *) malloc(KPROP_BIGBUFSIZ)) == NULL ||
+		    inflateInit(&zs) != Z_OK) {
+			send_error(context, fd, ENOMEM,
+				   "while setting up decompression");
+			com_err(progname, ENOMEM,
+				"while setting up decompression");
+			exit(1);
+		}
+	}
+#endif
+	if (protocol >= 3)
+		loader_pid = start_load(context, kdb5_util, NULL,
+					*kind == KPROP_XFER_UPDATE, &loader_fd);
+
 	/*
 	 * Now start receiving the database from the net
 	 */
@@ -760,22 +973,45 @@ recv_database(context, fd, database_fd, confmsg)
 			krb5_free_data_contents(context, &inbuf);
 			exit(1);
 		}
-		n = write(database_fd, outbuf.data, outbuf.length);
 		krb5_free_data_contents(context, &inbuf);
-		krb5_free_data_contents(context, &outbuf);
-		if (n < 0) {
-			sprintf(buf,
-				"while writing database block starting at offset %d",
-				received_size);
-			send_error(context, fd, errno, buf);
-		} else if (n != outbuf.length) {
-			sprintf(buf,
-				"incomplete write while writing database block starting at \noffset %d (%d written, %d expected)",
-				received_size, n, outbuf.length);
-			send_error(context, fd, KRB5KRB_ERR_GENERIC, buf);
+#ifdef KPROP_ZLIB
+		if (zbuf) {
+			zs.next_in = (Bytef *) outbuf.data;
+			zs.avail_in = outbuf.length;
+			do {
+				zs.next_out = (Bytef *) zbuf;
+				zs.avail_out = KPROP_BIGBUFSIZ;
+				zret = inflate(&zs, Z_SYNC_FLUSH);
+				if (zret != Z_OK && zret != Z_BUF_ERROR) {
+					sprintf(buf,
+						"while decompressing database block starting at offset %d",
+						received_size);
+					com_err(progname, 0, "%s: %s", buf,
+						zs.msg ? zs.msg : "");
+					send_error(context, fd,
+						   KRB5KRB_ERR_GENERIC, buf);
+					exit(1);
+				}
+				n = KPROP_BIGBUFSIZ - zs.avail_out;
+				store_block(context, fd, zbuf, n,
+					    received_size);
+				received_size += n;
+			} while (zs.avail_out == 0);
+			krb5_free_data_contents(context, &outbuf);
+			continue;
 		}
+#endif
+		store_block(context, fd, outbuf.data, outbuf.length,
+			    received_size);
 		received_size += outbuf.length;
+		krb5_free_data_contents(context, &outbuf);
+	}
+#ifdef KPROP_ZLIB
+	if (zbuf) {
+		inflateEnd(&zs);
+		free(zbuf);
 	}
+#endif
 	/*
 	 * OK, we've seen the entire file.  Did we get too many bytes?
 	 */
@@ -801,6 +1037,50 @@ recv_database(context, fd, database_fd, confmsg)
 	}
 }
 
+/*
+ * Write a block of the database to the file, and to kdb5_util if it is
+ * loading the data as it arrives.  If kdb5_util has gone away we stop
+ * feeding it; its exit status will say what went wrong.
+ */
+void
+store_block(context, fd, data, length, offset)
+    krb5_context context;
+    int fd;
+    char *data;
+    int length;
+    int offset;
+{
+	int	n;
+	char	buf[1024];
+
+	n = write(database_fd, data, length);
+	if (n < 0) {
+		sprintf(buf,
+			"while writing database block starting at offset %d",
+			offset);
+		send_error(context, fd, errno, buf);
+	} else if (n != length) {
+		sprintf(buf,
+			"incomplete write while writing database block starting at \noffset %d (%d written, %d expected)",
+			offset, n, length);
+		send_error(context, fd, KRB5KRB_ERR_GENERIC, buf);
+	}
+	if (loader_fd >= 0 && length > 0) {
+		for (n = 0; n < length; ) {
+			int count;
+
+			if ((count = write(loader_fd, data + n,
+					   length - n)) < 0) {
+				if (errno == EINTR)
+					continue;
+				(void) close(loader_fd);
+				loader_fd = -1;
+				break;
+			}
+			n += count;
+		}
+	}
+}
 
 void
 send_error(context, fd, err_code, err_text)
@@ -874,27 +1154,53 @@ recv_error(context, inbuf)
 	exit(1);
 }
 
+/*
+ * Load the received file with kdb5_util; if update is set it holds
+ * changes from the master's update log, to be applied to the database
+ * we have.
+ */
 void
-load_database(context, kdb5_util, database_file_name)
+load_database(context, kdb5_util, database_file_name, update)
     krb5_context context;
     char *kdb5_util;
     char *database_file_name;
+    int update;
+{
+	wait_load(context, start_load(context, kdb5_util, database_file_name,
+				      update, NULL));
+}
+
+/*
+ * If kpropd gives up while kdb5_util is loading what it has been sent
+ * so far, tell kdb5_util to abandon the load.  Should kpropd die
+ * without getting here, kdb5_util still sees its input end without the
+ * "." line that follows a complete transfer, and installs nothing.
+ */
+static void
+kill_loader()
+{
+	if (loader_pid)
+		(void) kill(loader_pid, SIGTERM);
+}
+
+/*
+ * Start kdb5_util loading database_file_name, or if that is NULL what
+ * is written to the pipe returned in *pipe_fd.  Returns the process id.
+ */
+int
+start_load(context, kdb5_util, database_file_name, update, pipe_fd)
+    krb5_context context;
+    char *kdb5_util;
+    char *database_file_name;
+    int update;
+    int *pipe_fd;
 {
 	static char	*edit_av[10];
-	int	error_ret, save_stderr;
+	int	save_stderr, null_fd;
 	int	child_pid;
 	int 	count;
-
-	/* <sys/param.h> has been included, so BSD will be defined on
-	   BSD systems */
-#if BSD > 0 && BSD <= 43
-#ifndef WEXITSTATUS
-#define	WEXITSTATUS(w) (w).w_retcode
-#endif
-	union wait	waitb;
-#else
-	int	waitb;
-#endif
+	int	pfd[2];
+	static int	registered = 0;
 	krb5_error_code	retval;
 
 	if (debug)
@@ -907,27 +1213,50 @@ load_database(context, kdb5_util, database_file_name)
 		edit_av[count++] = realm;	
 	}
 	edit_av[count++] = "load";
+	if (update)
+		edit_av[count++] = "-update";
 	if (kerb_database) {
 		edit_av[count++] = "-d";
 		edit_av[count++] = kerb_database;
 	}
-	edit_av[count++] = database_file_name;
+	edit_av[count++] = database_file_name ? database_file_name : "-";
 	edit_av[count++] = NULL;
 
+	if (pipe_fd) {
+		if (pipe(pfd) < 0) {
+			com_err(progname, errno,
+				"while creating pipe to %s", kdb5_util);
+			exit(1);
+		}
+		/* We find out that kdb5_util failed from its exit status. */
+		(void) signal(SIGPIPE, SIG_IGN);
+		if (!registered) {
+			atexit(kill_loader);
+			registered = 1;
+		}
+	}
+
 	switch(child_pid = fork()) {
 	case -1:
 		com_err(progname, errno, "while trying to fork %s",
 			kdb5_util);
 		exit(1);
 	case 0:
+		if (pipe_fd) {
+			dup2(pfd[0], 0);
+			close(pfd[0]);
+			close(pfd[1]);
+		}
 		if (!debug) {
 			save_stderr = dup(2);
-			close(0);
-			close(1);
-			close(2);
-			open("/dev/null", O_RDWR);
-			dup(0);
-			dup(0);
+			if ((null_fd = open("/dev/null", O_RDWR)) >= 0) {
+				if (!pipe_fd)
+					dup2(null_fd, 0);
+				dup2(null_fd, 1);
+				dup2(null_fd, 2);
+				if (null_fd > 2)
+					close(null_fd);
+			}
 		}
 
 		execv(kdb5_util, edit_av);
@@ -941,12 +1270,42 @@ load_database(context, kdb5_util, database_file_name)
 	default:
 		if (debug)
 		    printf("Child PID is %d\n", child_pid);
-		if (wait(&waitb) < 0) {
-			com_err(progname, errno, "while waiting for %s",
-				kdb5_util);
-			exit(1);
-		}
 	}
+	if (pipe_fd) {
+		close(pfd[0]);
+		*pipe_fd = pfd[1];
+	}
+	return child_pid;
+}
+
+/*
+ * Wait for kdb5_util to finish loading the database, and exit if it
+ * failed.
+ */
+void
+wait_load(context, child_pid)
+    krb5_context context;
+    int child_pid;
+{
+	int	error_ret;
+
+	/* <sys/param.h> has been included, so BSD will be defined on
+	   BSD systems */
+#if BSD > 0 && BSD <= 43
+#ifndef WEXITSTATUS
+#define	WEXITSTATUS(w) (w).w_retcode
+#endif
+	union wait	waitb;
+#else
+	int	waitb;
+#endif
+
+	if (wait(&waitb) < 0) {
+		com_err(progname, errno, "while waiting for %s",
+			kdb5_util);
+		exit(1);
+	}
+	loader_pid = 0;
 	
 	if (error_ret = WEXITSTATUS(waitb)) {
 		com_err(progname, 0, "%s returned a bad exit status (%d)",
@@ -0,0 +1,198 @@
+/*
+ * tests/asn.1/asn1_bench.c
+ *
+ * Encode and decode throughput for every PDU in pdus.c.
+ *
+ * usage: asn1_bench [-t msec] [-p principal] [-w dir] [name ...]
+ *
+ * Each PDU's ktest sample is encoded, and then encoding the sample
+ * and decoding its encoding are each timed for at least msec
+ * milliseconds (default 100).  The sample principal may be changed
+ * with -p, as for krb5_encode_test, to vary the size of the
+ * encodings.  If names are given, only those PDUs are run.
+ *
+ * One line is printed per test, with tab-separated fields:
+ *
+ *	operation  pdu  bytes  iterations  ops/sec  MB/sec
+ *
+ * With -w, nothing is timed; instead each sample encoding is written
+ * to dir/pdu, prefixed with the octet asn1_fuzz uses to choose the
+ * decoder, as a seed corpus for asn1_fuzz.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/time.h>
+#include "k5-int.h"
+#include "com_err.h"
+#include "ktest.h"
+#include "pdus.h"
+
+krb5_context test_context;
+long mintime = 100;
+
+/* operation being timed, and its arguments */
+struct bench {
+  const struct pdu *pdu;
+  void *sample;
+  krb5_data *code;
+};
+
+typedef krb5_error_code (*bench_func) PROTOTYPE((struct bench *));
+
+static void fail(what, name, code)
+     char * what;
+     char * name;
+     krb5_error_code code;
+{
+  com_err("asn1_bench", code, "while %s %s", what, name);
+  exit(1);
+}
+
+static double now()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec + tv.tv_usec/1000000.0);
+}
+
+static krb5_error_code do_encode(b)
+     struct bench * b;
+{
+  krb5_error_code retval;
+  krb5_data *code;
+
+  retval = (*b->pdu->encode)(b->sample, &code);
+  if(retval) return retval;
+  krb5_free_data(test_context, code);
+  return 0;
+}
+
+static krb5_error_code do_decode(b)
+     struct bench * b;
+{
+  krb5_error_code retval;
+  void *rep;
+
+  retval = (*b->pdu->decode)(b->code, &rep);
+  if(retval) return retval;
+  if(b->pdu->free)
+    (*b->pdu->free)(test_context, rep);
+  return 0;
+}
+
+/* run func until at least mintime has gone by, doubling the
+   iteration count each round, and report the last round */
+static void run(what, b, func)
+     char * what;
+     struct bench * b;
+     bench_func func;
+{
+  long iter, i;
+  double start, elapsed;
+  krb5_error_code retval;
+
+  for(iter = 1; ; iter *= 2){
+    start = now();
+    for(i = 0; i < iter; i++){
+      retval = (*func)(b);
+      if(retval) fail(what, b->pdu->name, retval);
+    }
+    elapsed = now() - start;
+    if(elapsed*1000 >= mintime)
+      break;
+  }
+
+  printf("%s\t%s\t%u\t%ld\t%.1f\t%.2f\n", what, b->pdu->name,
+	 b->code->length, iter, iter/elapsed,
+	 iter*(double)b->code->length/elapsed/(1024*1024));
+  fflush(stdout);
+}
+
+static void write_seed(dir, b, index)
+     char * dir;
+     struct bench * b;
+     int index;
+{
+  char *path;
+  FILE *f;
+
+  path = malloc(strlen(dir) + strlen(b->pdu->name) + 2);
+  if(path == NULL) fail("writing", b->pdu->name, ENOMEM);
+  sprintf(path, "%s/%s", dir, b->pdu->name);
+  f = fopen(path, "wb");
+  if(f == NULL) fail("creating", path, errno);
+  if(putc(index, f) == EOF ||
+     fwrite(b->code->data, 1, b->code->length, f) != b->code->length ||
+     fclose(f) == EOF)
+    fail("writing", path, errno);
+  free(path);
+}
+
+int main(argc, argv)
+     int argc;
+     char ** argv;
+{
+  krb5_error_code retval;
+  struct bench b;
+  char *dir = NULL;
+  int c, i, j;
+  extern int optind;
+  extern char *optarg;
+
+  while((c = getopt(argc, argv, "t:p:w:")) != -1){
+    switch(c){
+    case 't':
+      mintime = atol(optarg);
+      break;
+    case 'p':
+      sample_principal_name = optarg;
+      break;
+    case 'w':
+      dir = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t msec] [-p principal] [-w dir] [name ...]\n",
+	      argv[0]);
+      exit(1);
+    }
+  }
+
+  retval = krb5_init_context(&test_context);
+  if(retval) fail("initializing", "krb5", retval);
+
+  if(dir == NULL)
+    printf("# operation\tpdu\tbytes\titerations\tops/sec\tMB/sec\n");
+
+  for(i = 0; i < npdus; i++){
+    b.pdu = &pdus[i];
+    if(b.pdu->make == NULL)
+      continue;
+    if(optind < argc){
+      for(j = optind; j < argc; j++)
+	if(strcmp(argv[j], b.pdu->name) == 0)
+	  break;
+      if(j == argc)
+	continue;
+    }
+
+    retval = pdu_make_sample(b.pdu, &b.sample);
+    if(retval) fail("making sample", b.pdu->name, retval);
+    retval = (*b.pdu->encode)(b.sample, &b.code);
+    if(retval) fail("encoding", b.pdu->name, retval);
+
+    if(dir != NULL){
+      write_seed(dir, &b, i);
+    } else {
+      run("encode", &b, do_encode);
+      run("decode", &b, do_decode);
+    }
+    krb5_free_data(test_context, b.code);
+  }
+
+  krb5_free_context(test_context);
+  return 0;
+}
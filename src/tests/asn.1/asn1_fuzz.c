@@ -0,0 +1,186 @@
+/*
+ * tests/asn.1/asn1_fuzz.c
+ *
+ * Fuzzing target for the Kerberos ASN.1 decoders.
+ *
+ * The first octet of an input chooses a PDU from pdus.c (modulo the
+ * number of PDUs), and the rest is passed to that PDU's decoder.  If
+ * it decodes, the result is encoded again and freed.
+ *
+ * Built with -DLIBFUZZER and linked with libFuzzer (see "make fuzz"),
+ * this is a coverage-guided fuzzer.  Otherwise it is a standalone
+ * driver:
+ *
+ * usage: asn1_fuzz [-n count] [-s seed] file ...
+ *
+ * which runs each file once, and then runs count random mutations of
+ * them.  "asn1_bench -w dir" writes a seed corpus.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "k5-int.h"
+#include "com_err.h"
+#include "pdus.h"
+
+krb5_context test_context;
+
+int LLVMFuzzerTestOneInput(data, size)
+     const unsigned char * data;
+     size_t size;
+{
+  const struct pdu *pdu;
+  krb5_data code, *again;
+  void *rep;
+
+  if(test_context == NULL && krb5_init_context(&test_context))
+    abort();
+  if(size < 1)
+    return 0;
+  pdu = &pdus[data[0] % npdus];
+
+  /* an exact copy, so that reading past the end can be caught */
+  code.length = size - 1;
+  code.data = malloc(size);
+  if(code.data == NULL)
+    return 0;
+  memcpy(code.data, data + 1, code.length);
+
+  rep = NULL;
+  if((*pdu->decode)(&code, &rep) == 0 && rep != NULL){
+    if(pdu->encode && (*pdu->encode)(rep, &again) == 0)
+      krb5_free_data(test_context, again);
+    (*pdu->free)(test_context, rep);
+  }
+  free(code.data);
+  return 0;
+}
+
+#ifndef LIBFUZZER
+
+struct input {
+  char *name;
+  unsigned char *data;
+  size_t size;
+};
+
+static void read_input(name, in)
+     char * name;
+     struct input * in;
+{
+  FILE *f;
+  long size;
+
+  in->name = name;
+  if((f = fopen(name, "rb")) == NULL ||
+     fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 ||
+     fseek(f, 0, SEEK_SET) != 0){
+    com_err("asn1_fuzz", errno, "while reading %s", name);
+    exit(1);
+  }
+  in->size = size;
+  in->data = malloc(in->size + 1);
+  if(in->data == NULL ||
+     fread(in->data, 1, in->size, f) != in->size){
+    com_err("asn1_fuzz", errno, "while reading %s", name);
+    exit(1);
+  }
+  fclose(f);
+}
+
+/* Damage a copy of in the way decoders are most likely to trip over:
+   overwrite, flip or drop a few octets, or cut it short.  The first
+   octet is left alone so the input stays with its PDU. */
+static size_t mutate(in, buf)
+     const struct input * in;
+     unsigned char * buf;
+{
+  size_t size = in->size, pos;
+  int n;
+
+  memcpy(buf, in->data, size);
+  for(n = 1 + rand() % 4; n > 0 && size > 1; n--){
+    pos = 1 + rand() % (size - 1);
+    switch(rand() % 5){
+    case 0:
+      buf[pos] = rand();
+      break;
+    case 1:
+      buf[pos] ^= 1 << (rand() % 8);
+      break;
+    case 2:
+      /* length octets are the interesting ones */
+      buf[pos] = (rand() % 2) ? 0x80 | (rand() % 5) : 0xff;
+      break;
+    case 3:
+      memmove(buf + pos, buf + pos + 1, size - pos - 1);
+      size--;
+      break;
+    case 4:
+      size = pos;
+      break;
+    }
+  }
+  return size;
+}
+
+int main(argc, argv)
+     int argc;
+     char ** argv;
+{
+  struct input *inputs;
+  unsigned char *buf;
+  size_t maxsize = 0;
+  long count = 0, i;
+  int c, ninputs, j;
+  extern int optind;
+  extern char *optarg;
+
+  while((c = getopt(argc, argv, "n:s:")) != -1){
+    switch(c){
+    case 'n':
+      count = atol(optarg);
+      break;
+    case 's':
+      srand(atoi(optarg));
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n count] [-s seed] file ...\n", argv[0]);
+      exit(1);
+    }
+  }
+  ninputs = argc - optind;
+  if(ninputs == 0){
+    fprintf(stderr, "usage: %s [-n count] [-s seed] file ...\n", argv[0]);
+    exit(1);
+  }
+
+  inputs = (struct input *)malloc(ninputs * sizeof(struct input));
+  if(inputs == NULL){
+    com_err("asn1_fuzz", ENOMEM, "while reading inputs");
+    exit(1);
+  }
+  for(j = 0; j < ninputs; j++){
+    read_input(argv[optind + j], &inputs[j]);
+    if(inputs[j].size > maxsize)
+      maxsize = inputs[j].size;
+    LLVMFuzzerTestOneInput(inputs[j].data, inputs[j].size);
+  }
+
+  buf = malloc(maxsize + 1);
+  if(buf == NULL){
+    com_err("asn1_fuzz", ENOMEM, "while mutating inputs");
+    exit(1);
+  }
+  for(i = 0; i < count; i++){
+    j = rand() % ninputs;
+    LLVMFuzzerTestOneInput(buf, mutate(&inputs[j], buf));
+  }
+
+  printf("asn1_fuzz: %d inputs, %ld mutations\n", ninputs, count);
+  return 0;
+}
+
+#endif /* LIBFUZZER */
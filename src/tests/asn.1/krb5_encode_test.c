@@ -115,7 +115,45 @@ main(argc, argv)
     com_err("krb5_encode_test", retval,"while encoding %s", typestring);\
     exit(1);\
   }\
+  check_into(&(value),code,typestring,encoder##_into);\
   encoder_print_results(code, typestring, description);
+
+/* the _into encoder must report the exact length, refuse a buffer one
+   octet short, and produce the same octets into an exact-size buffer */
+#define check_into(rep,code,typestring,encoder)\
+  {\
+    krb5_data into;\
+    into.data = NULL;\
+    into.length = 0;\
+    retval = encoder(rep,&into);\
+    if(retval != ASN1_OVERFLOW || into.length != (code)->length){\
+      com_err("krb5_encode_test", retval,"while sizing %s", typestring);\
+      exit(1);\
+    }\
+    into.data = malloc(into.length);\
+    if(into.data == NULL){\
+      com_err("krb5_encode_test", ENOMEM,"while sizing %s", typestring);\
+      exit(1);\
+    }\
+    into.length--;\
+    retval = encoder(rep,&into);\
+    if(retval != ASN1_OVERFLOW || into.length != (code)->length){\
+      com_err("krb5_encode_test", retval,"while encoding %s into short buffer", typestring);\
+      exit(1);\
+    }\
+    retval = encoder(rep,&into);\
+    if(retval){\
+      com_err("krb5_encode_test", retval,"while encoding %s into buffer", typestring);\
+      exit(1);\
+    }\
+    if(into.length != (code)->length ||\
+       memcmp(into.data,(code)->data,into.length) != 0){\
+      fprintf(stderr,"krb5_encode_test: encode_krb5_%s_into differs\n",\
+	      typestring);\
+      exit(1);\
+    }\
+    free(into.data);\
+  }
       
   /****************************************************************/
   /* encode_krb5_authenticator */
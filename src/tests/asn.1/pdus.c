@@ -0,0 +1,194 @@
+#include "pdus.h"
+#include "ktest.h"
+#include <stdlib.h>
+
+/* k5-int.h misnames this one decode_krb5_sam_key */
+krb5_error_code decode_krb5_enc_sam_key
+	PROTOTYPE((const krb5_data *code, krb5_sam_key **rep));
+
+/* samples whose message type ktest leaves for the caller to set */
+
+static krb5_error_code make_as_req(kr)
+     krb5_kdc_req * kr;
+{
+  krb5_error_code retval;
+
+  retval = ktest_make_sample_kdc_req(kr);
+  kr->msg_type = KRB5_AS_REQ;
+  return retval;
+}
+
+static krb5_error_code make_tgs_req(kr)
+     krb5_kdc_req * kr;
+{
+  krb5_error_code retval;
+
+  retval = ktest_make_sample_kdc_req(kr);
+  kr->msg_type = KRB5_TGS_REQ;
+  return retval;
+}
+
+static krb5_error_code make_as_rep(kdcr)
+     krb5_kdc_rep * kdcr;
+{
+  krb5_error_code retval;
+
+  retval = ktest_make_sample_kdc_rep(kdcr);
+  kdcr->msg_type = KRB5_AS_REP;
+  return retval;
+}
+
+static krb5_error_code make_tgs_rep(kdcr)
+     krb5_kdc_rep * kdcr;
+{
+  krb5_error_code retval;
+
+  retval = ktest_make_sample_kdc_rep(kdcr);
+  kdcr->msg_type = KRB5_TGS_REP;
+  return retval;
+}
+
+/* structures the library has no free routine for */
+
+static void free_passwd_phrase_element(context, val)
+     krb5_context context;
+     passwd_phrase_element * val;
+{
+  if(val->passwd) krb5_free_data(context, val->passwd);
+  if(val->phrase) krb5_free_data(context, val->phrase);
+  free(val);
+}
+
+static void free_alt_method(context, val)
+     krb5_context context;
+     krb5_alt_method * val;
+{
+  if(val->data) free(val->data);
+  free(val);
+}
+
+static void free_enc_data(context, val)
+     krb5_context context;
+     krb5_enc_data * val;
+{
+  if(val->ciphertext.data) free(val->ciphertext.data);
+  free(val);
+}
+
+static void free_sam_key(context, val)
+     krb5_context context;
+     krb5_sam_key * val;
+{
+  krb5_free_keyblock_contents(context, &val->sam_key);
+  free(val);
+}
+
+/* decode_krb5_kdc_req_peek fills in a caller's structure */
+static krb5_error_code peek_kdc_req(code, rep)
+     const krb5_data * code;
+     void ** rep;
+{
+  krb5_kdc_req_peek peek;
+
+  *rep = NULL;
+  return decode_krb5_kdc_req_peek(code, &peek);
+}
+
+#define entry(name,type,maker,freer,array)\
+  { #name, sizeof(type), array, (pdu_make_func) maker,\
+    (pdu_encode_func) encode_krb5_##name,\
+    (pdu_decode_func) decode_krb5_##name, (pdu_free_func) freer }
+
+#define decoder_entry(name,decoder,freer)\
+  { name, 0, 0, NULL, NULL, (pdu_decode_func) decoder,\
+    (pdu_free_func) freer }
+
+/* New entries go at the end, since a fuzzing input picks its PDU by
+   index. */
+struct pdu pdus[] = {
+  entry(authenticator, krb5_authenticator, ktest_make_sample_authenticator,
+	krb5_free_authenticator, 0),
+  entry(ticket, krb5_ticket, ktest_make_sample_ticket, krb5_free_ticket, 0),
+  entry(encryption_key, krb5_keyblock, ktest_make_sample_keyblock,
+	krb5_free_keyblock, 0),
+  entry(enc_tkt_part, krb5_enc_tkt_part, ktest_make_sample_enc_tkt_part,
+	krb5_free_enc_tkt_part, 0),
+  entry(enc_kdc_rep_part, krb5_enc_kdc_rep_part,
+	ktest_make_sample_enc_kdc_rep_part, krb5_free_enc_kdc_rep_part, 0),
+  entry(as_rep, krb5_kdc_rep, make_as_rep, krb5_free_kdc_rep, 0),
+  entry(tgs_rep, krb5_kdc_rep, make_tgs_rep, krb5_free_kdc_rep, 0),
+  entry(ap_req, krb5_ap_req, ktest_make_sample_ap_req, krb5_free_ap_req, 0),
+  entry(ap_rep, krb5_ap_rep, ktest_make_sample_ap_rep, krb5_free_ap_rep, 0),
+  entry(ap_rep_enc_part, krb5_ap_rep_enc_part,
+	ktest_make_sample_ap_rep_enc_part, krb5_free_ap_rep_enc_part, 0),
+  entry(as_req, krb5_kdc_req, make_as_req, krb5_free_kdc_req, 0),
+  entry(tgs_req, krb5_kdc_req, make_tgs_req, krb5_free_kdc_req, 0),
+  entry(kdc_req_body, krb5_kdc_req, ktest_make_sample_kdc_req_body,
+	krb5_free_kdc_req, 0),
+  entry(safe, krb5_safe, ktest_make_sample_safe, krb5_free_safe, 0),
+  entry(priv, krb5_priv, ktest_make_sample_priv, krb5_free_priv, 0),
+  entry(enc_priv_part, krb5_priv_enc_part, ktest_make_sample_priv_enc_part,
+	krb5_free_priv_enc_part, 0),
+  entry(cred, krb5_cred, ktest_make_sample_cred, krb5_free_cred, 0),
+  entry(enc_cred_part, krb5_cred_enc_part, ktest_make_sample_cred_enc_part,
+	krb5_free_cred_enc_part, 0),
+  entry(error, krb5_error, ktest_make_sample_error, krb5_free_error, 0),
+  entry(authdata, krb5_authdata **, ktest_make_sample_authorization_data,
+	krb5_free_authdata, 1),
+  entry(pwd_sequence, passwd_phrase_element,
+	ktest_make_sample_passwd_phrase_element, free_passwd_phrase_element, 0),
+  entry(pwd_data, krb5_pwd_data, ktest_make_sample_krb5_pwd_data,
+	krb5_free_pwd_data, 0),
+  entry(padata_sequence, krb5_pa_data **, ktest_make_sample_pa_data_array,
+	krb5_free_pa_data, 1),
+  entry(alt_method, krb5_alt_method, ktest_make_sample_alt_method,
+	free_alt_method, 0),
+  entry(etype_info, krb5_etype_info_entry **, ktest_make_sample_etype_info,
+	krb5_free_etype_info, 1),
+  entry(enc_data, krb5_enc_data, ktest_make_sample_enc_data,
+	free_enc_data, 0),
+  entry(pa_enc_ts, krb5_pa_enc_ts, ktest_make_sample_pa_enc_ts,
+	krb5_free_pa_enc_ts, 0),
+  entry(sam_challenge, krb5_sam_challenge, ktest_make_sample_sam_challenge,
+	krb5_free_sam_challenge, 0),
+  entry(sam_response, krb5_sam_response, ktest_make_sample_sam_response,
+	krb5_free_sam_response, 0),
+  decoder_entry("enc_sam_key", decode_krb5_enc_sam_key, free_sam_key),
+  decoder_entry("enc_sam_response_enc", decode_krb5_enc_sam_response_enc,
+		krb5_free_enc_sam_response_enc),
+  decoder_entry("predicted_sam_response",
+		decode_krb5_predicted_sam_response,
+		krb5_free_predicted_sam_response),
+  { "as_req_borrowed", sizeof(krb5_kdc_req), 0, (pdu_make_func) make_as_req,
+    (pdu_encode_func) encode_krb5_as_req,
+    (pdu_decode_func) decode_krb5_as_req_borrowed,
+    (pdu_free_func) krb5_free_borrowed },
+  { "tgs_req_borrowed", sizeof(krb5_kdc_req), 0,
+    (pdu_make_func) make_tgs_req, (pdu_encode_func) encode_krb5_tgs_req,
+    (pdu_decode_func) decode_krb5_tgs_req_borrowed,
+    (pdu_free_func) krb5_free_borrowed },
+  { "kdc_req_peek", sizeof(krb5_kdc_req), 0, (pdu_make_func) make_as_req,
+    (pdu_encode_func) encode_krb5_as_req, peek_kdc_req, NULL },
+};
+
+int npdus = sizeof(pdus)/sizeof(pdus[0]);
+
+krb5_error_code pdu_make_sample(pdu, rep)
+     const struct pdu * pdu;
+     void ** rep;
+{
+  void *sample;
+  krb5_error_code retval;
+
+  if(pdu->array)
+    return (*pdu->make)(rep);
+  sample = calloc(1, pdu->size);
+  if(sample == NULL) return ENOMEM;
+  retval = (*pdu->make)(sample);
+  if(retval){
+    free(sample);
+    return retval;
+  }
+  *rep = sample;
+  return 0;
+}
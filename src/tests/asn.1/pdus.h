@@ -0,0 +1,42 @@
+#ifndef __PDUS_H__
+#define __PDUS_H__
+
+#include "k5-int.h"
+
+/* One entry for each Kerberos PDU the library can decode, used by
+   asn1_bench and asn1_fuzz.  All of the structures are handled
+   through void pointers.
+
+   make fills in a sample structure of size octets (a pointer to the
+   array, for PDUs which are arrays), or is NULL if ktest has no
+   sample.  encode takes the structure (or the array) and decode
+   returns one, which is released with free.  free is NULL if decode
+   returns nothing to be freed. */
+
+typedef krb5_error_code (*pdu_make_func) PROTOTYPE((void *sample));
+typedef krb5_error_code (*pdu_encode_func)
+	PROTOTYPE((const void *rep, krb5_data **code));
+typedef krb5_error_code (*pdu_decode_func)
+	PROTOTYPE((const krb5_data *code, void **rep));
+typedef void (*pdu_free_func) PROTOTYPE((krb5_context context, void *rep));
+
+struct pdu {
+  char *name;
+  unsigned int size;
+  int array;			/* sample is a pointer to an array */
+  pdu_make_func make;
+  pdu_encode_func encode;
+  pdu_decode_func decode;
+  pdu_free_func free;
+};
+
+extern struct pdu pdus[];
+extern int npdus;
+
+krb5_error_code pdu_make_sample
+	PROTOTYPE((const struct pdu *pdu, void **rep));
+/* requires  pdu->make != NULL
+   effects   Returns a new sample structure (or array) for pdu in *rep,
+	      suitable for pdu->encode. */
+
+#endif
@@ -474,3 +474,25 @@ __bt_fd(dbp)
 	}
 	return (t->bt_fd);
 }
+
+/*
+ * __BT_MPOOLSTAT -- Get the buffer pool statistics of a btree.
+ *
+ * Parameters:
+ *	dbp:	pointer to access method
+ *	st:	where to put the statistics
+ *
+ * Returns:
+ *	RET_SUCCESS
+ */
+int
+__bt_mpoolstat(dbp, st)
+	const DB *dbp;
+	DB_MPOOL_STAT *st;
+{
+	BTREE *t;
+
+	t = dbp->internal;
+	mpool_getstat(t->bt_mp, st);
+	return (RET_SUCCESS);
+}
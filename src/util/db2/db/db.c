@@ -73,6 +73,25 @@ kdb2_dbopen(fname, flags, mode, type, openinfo)
 	return (NULL);
 }
 
+/*
+ * Get the buffer pool statistics of an open database.
+ */
+int
+kdb2_dbmpoolstat(dbp, st)
+	const DB *dbp;
+	DB_MPOOL_STAT *st;
+{
+	switch (dbp->type) {
+	case DB_BTREE:
+	case DB_RECNO:
+		return (__bt_mpoolstat(dbp, st));
+	case DB_HASH:
+		return (__hash_mpoolstat(dbp, st));
+	}
+	errno = EINVAL;
+	return (RET_ERROR);
+}
+
 static int
 __dberr()
 {
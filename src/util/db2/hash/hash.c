@@ -303,6 +303,21 @@ hash_fd(dbp)
 	return (hashp->fp);
 }
 
+int
+__hash_mpoolstat(dbp, st)
+	const DB *dbp;
+	DB_MPOOL_STAT *st;
+{
+	HTAB *hashp;
+
+	if (!dbp)
+		return (ERROR);
+
+	hashp = (HTAB *)dbp->internal;
+	mpool_getstat(hashp->mp, st);
+	return (SUCCESS);
+}
+
 /************************** LOCAL CREATION ROUTINES **********************/
 static HTAB *
 init_hash(hashp, file, info)
@@ -139,11 +139,15 @@ typedef u_int32_t	recno_t;
 #define __hash_open	__kdb2_hash_open
 #define __rec_open	__kdb2_rec_open
 #define __dbpanic	__kdb2_dbpanic
+#define __bt_mpoolstat	__kdb2_bt_mpoolstat
+#define __hash_mpoolstat	__kdb2_hash_mpoolstat
 
 DB	*__bt_open __P((const char *, int, int, const BTREEINFO *, int));
 DB	*__hash_open __P((const char *, int, int, const HASHINFO *, int));
 DB	*__rec_open __P((const char *, int, int, const RECNOINFO *, int));
 void	 __dbpanic __P((DB *dbp));
+int	 __bt_mpoolstat __P((const DB *, DB_MPOOL_STAT *));
+int	 __hash_mpoolstat __P((const DB *, DB_MPOOL_STAT *));
 
 /*
  * There is no portable way to figure out the maximum value of a file
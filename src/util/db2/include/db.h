@@ -165,9 +165,21 @@ typedef struct {
 #define	__END_DECLS
 #endif
 
+/* Buffer pool statistics, returned by dbmpoolstat(). */
+typedef struct {
+	u_long	pagesize;	/* page size */
+	u_long	curcache;	/* pages now cached */
+	u_long	maxcache;	/* pages cached before any are evicted */
+	u_long	hits;		/* pages found in the cache */
+	u_long	misses;		/* pages read from the file */
+	u_long	evictions;	/* pages evicted to make room */
+} DB_MPOOL_STAT;
+
 #define dbopen	kdb2_dbopen
+#define dbmpoolstat	kdb2_dbmpoolstat
 __BEGIN_DECLS
 DB *dbopen __P((const char *, int, int, DBTYPE, const void *));
+int dbmpoolstat __P((const DB *, DB_MPOOL_STAT *));
 __END_DECLS
 
 #endif /* !_DB_H_ */
@@ -81,8 +81,17 @@ mpool_open(key, fd, pagesize, maxcache)
 	/* Allocate and initialize the MPOOL cookie. */
 	if ((mp = (MPOOL *)calloc(1, sizeof(MPOOL))) == NULL)
 		return (NULL);
+	/* Keep the hash chains short, however big the cache. */
+	for (mp->nhash = HASHSIZE;
+	    mp->nhash < maxcache / HASHPERCHAIN; mp->nhash <<= 1)
+		;
+	mp->hqh = (struct _hqh *)malloc(mp->nhash * sizeof(struct _hqh));
+	if (mp->hqh == NULL) {
+		free(mp);
+		return (NULL);
+	}
 	CIRCLEQ_INIT(&mp->lqh);
-	for (entry = 0; entry < HASHSIZE; ++entry)
+	for (entry = 0; entry < mp->nhash; ++entry)
 		CIRCLEQ_INIT(&mp->hqh[entry]);
 	mp->maxcache = maxcache;
 	mp->npages = sb.st_size / pagesize;
@@ -142,7 +151,7 @@ mpool_new(mp, pgnoaddr, flags)
 
 	bp->flags = MPOOL_PINNED | MPOOL_INUSE;
 
-	head = &mp->hqh[HASHKEY(bp->pgno)];
+	head = &mp->hqh[HASHKEY(mp, bp->pgno)];
 	CIRCLEQ_INSERT_HEAD(head, bp, hq);
 	CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
 	return (bp->page);
@@ -167,7 +176,7 @@ mpool_delete(mp, page)
 #endif
 
 	/* Remove from the hash and lru queues. */
-	head = &mp->hqh[HASHKEY(bp->pgno)];
+	head = &mp->hqh[HASHKEY(mp, bp->pgno)];
 	CIRCLEQ_REMOVE(head, bp, hq);
 	CIRCLEQ_REMOVE(&mp->lqh, bp, q);
 
@@ -207,7 +216,7 @@ mpool_get(mp, pgno, flags)
 		 * Move the page to the head of the hash chain and the tail
 		 * of the lru chain.
 		 */
-		head = &mp->hqh[HASHKEY(bp->pgno)];
+		head = &mp->hqh[HASHKEY(mp, bp->pgno)];
 		CIRCLEQ_REMOVE(head, bp, hq);
 		CIRCLEQ_INSERT_HEAD(head, bp, hq);
 		CIRCLEQ_REMOVE(&mp->lqh, bp, q);
@@ -254,7 +263,7 @@ mpool_get(mp, pgno, flags)
 	 * Add the page to the head of the hash chain and the tail
 	 * of the lru chain.
 	 */
-	head = &mp->hqh[HASHKEY(bp->pgno)];
+	head = &mp->hqh[HASHKEY(mp, bp->pgno)];
 	CIRCLEQ_INSERT_HEAD(head, bp, hq);
 	CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
 
@@ -311,6 +320,7 @@ mpool_close(mp)
 	}
 
 	/* Free the MPOOL cookie. */
+	free(mp->hqh);
 	free(mp);
 	return (RET_SUCCESS);
 }
@@ -364,11 +374,9 @@ mpool_bkt(mp)
 			if (bp->flags & MPOOL_DIRTY &&
 			    mpool_write(mp, bp) == RET_ERROR)
 				return (NULL);
-#ifdef STATISTICS
 			++mp->pageflush;
-#endif
 			/* Remove from the hash and lru queues. */
-			head = &mp->hqh[HASHKEY(bp->pgno)];
+			head = &mp->hqh[HASHKEY(mp, bp->pgno)];
 			CIRCLEQ_REMOVE(head, bp, hq);
 			CIRCLEQ_REMOVE(&mp->lqh, bp, q);
 #ifdef DEBUG
@@ -437,21 +445,34 @@ mpool_look(mp, pgno)
 	struct _hqh *head;
 	BKT *bp;
 
-	head = &mp->hqh[HASHKEY(pgno)];
+	head = &mp->hqh[HASHKEY(mp, pgno)];
 	for (bp = head->cqh_first; bp != (void *)head; bp = bp->hq.cqe_next)
 		if ((bp->pgno == pgno) &&
-			(bp->flags & MPOOL_INUSE == MPOOL_INUSE)) {
-#ifdef STATISTICS
+			((bp->flags & MPOOL_INUSE) == MPOOL_INUSE)) {
 			++mp->cachehit;
-#endif
 			return (bp);
 		}
-#ifdef STATISTICS
 	++mp->cachemiss;
-#endif
 	return (NULL);
 }
 
+/*
+ * mpool_getstat
+ *	Return the cache statistics.
+ */
+void
+mpool_getstat(mp, st)
+	MPOOL *mp;
+	DB_MPOOL_STAT *st;
+{
+	st->pagesize = mp->pagesize;
+	st->curcache = mp->curcache;
+	st->maxcache = mp->maxcache;
+	st->hits = mp->cachehit;
+	st->misses = mp->cachemiss;
+	st->evictions = mp->pageflush;
+}
+
 #ifdef STATISTICS
 /*
  * mpool_stat
@@ -42,8 +42,9 @@
  * Inactive pages are threaded on a free chain.  Each reference to a memory
  * pool is handed an opaque MPOOL cookie which stores all of this information.
  */
-#define	HASHSIZE	128
-#define	HASHKEY(pgno)	((pgno - 1) % HASHSIZE)
+#define	HASHSIZE	128		/* fewest hash chains */
+#define	HASHPERCHAIN	4		/* most cached pages per chain */
+#define	HASHKEY(mp, pgno)	((pgno - 1) % (mp)->nhash)
 
 /* The BKT structures are the elements of the queues. */
 typedef struct _bkt {
@@ -61,7 +62,8 @@ typedef struct _bkt {
 typedef struct MPOOL {
 	CIRCLEQ_HEAD(_lqh, _bkt) lqh;	/* lru queue head */
 					/* hash queue array */
-	CIRCLEQ_HEAD(_hqh, _bkt) hqh[HASHSIZE];
+	CIRCLEQ_HEAD(_hqh, _bkt) *hqh;
+	db_pgno_t	nhash;			/* number of hash chains */
 	db_pgno_t	curcache;		/* current number of cached pages */
 	db_pgno_t	maxcache;		/* max number of cached pages */
 	db_pgno_t	npages;			/* number of pages in the file */
@@ -72,11 +74,11 @@ typedef struct MPOOL {
 					/* page out conversion routine */
 	void    (*pgout) __P((void *, db_pgno_t, void *));
 	void	*pgcookie;		/* cookie for page in/out routines */
+	u_long	cachehit;		/* pages found in the cache */
+	u_long	cachemiss;		/* pages not found in the cache */
+	u_long	pageflush;		/* pages evicted to make room */
 #ifdef STATISTICS
-	u_long	cachehit;
-	u_long	cachemiss;
 	u_long	pagealloc;
-	u_long	pageflush;
 	u_long	pageget;
 	u_long	pagenew;
 	u_long	pageput;
@@ -100,6 +102,7 @@ typedef struct MPOOL {
 #define mpool_sync	kdb2_mpool_sync
 #define mpool_close	kdb2_mpool_close
 #define mpool_stat	kdb2_mpool_stat
+#define mpool_getstat	kdb2_mpool_getstat
 
 __BEGIN_DECLS
 MPOOL	*mpool_open __P((void *, int, db_pgno_t, db_pgno_t));
@@ -111,6 +114,7 @@ int	 mpool_delete __P((MPOOL *, void *));
 int	 mpool_put __P((MPOOL *, void *, u_int));
 int	 mpool_sync __P((MPOOL *));
 int	 mpool_close __P((MPOOL *));
+void	 mpool_getstat __P((MPOOL *, DB_MPOOL_STAT *));
 #ifdef STATISTICS
 void	 mpool_stat __P((MPOOL *));
 #endif
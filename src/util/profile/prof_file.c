@@ -102,6 +102,7 @@ errcode_t profile_open_file(filespec, ret_prof)
 	prf->filespec = filespec;
 	prf->magic = PROF_MAGIC_FILE;
 #endif
+	prf->refcount = 1;
 
 	retval = profile_update_file(prf);
 	if (retval) {
@@ -113,18 +114,69 @@ errcode_t profile_open_file(filespec, ret_prof)
 	return 0;
 }
 
+/*
+ * Make a profile file for filespec from a tree already parsed from it
+ * when it had the modification time timestamp, as passed in by
+ * profile_ser_internalize().  The file is read again only if it has
+ * since changed.
+ */
+errcode_t profile_make_file(filespec, root, timestamp, ret_prof)
+	const_profile_filespec_t filespec;
+	struct profile_node *root;
+	time_t timestamp;
+	prf_file_t *ret_prof;
+{
+	prf_file_t	prf;
+
+	prf = malloc(sizeof(struct _prf_file_t));
+	if (!prf)
+		return ENOMEM;
+	memset(prf, 0, sizeof(struct _prf_file_t));
+
+#ifdef PROFILE_USES_PATHS
+	prf->filespec = malloc(strlen(filespec) + 1);
+	if (!prf->filespec) {
+		free(prf);
+		return ENOMEM;
+	}
+	strcpy(prf->filespec, filespec);
+#else
+	prf->filespec = filespec;
+#endif
+	prf->magic = PROF_MAGIC_FILE;
+	prf->refcount = 1;
+	prf->root = root;
+	prf->timestamp = root ? timestamp : 0;
+	prf->upd_serial++;
+	if (rw_access(prf->filespec))
+		prf->flags |= PROFILE_FILE_RW;
+
+	*ret_prof = prf;
+	return 0;
+}
+
 errcode_t profile_update_file(prf)
 	prf_file_t prf;
 {
 	errcode_t retval;
 #ifdef HAVE_STAT
 	struct stat st;
+	time_t now;
 #endif
 	FILE *f;
 
 #ifdef HAVE_STAT
+	/*
+	 * Every lookup comes through here, so don't look at the file
+	 * again if we did so very recently.
+	 */
+	now = time(0);
+	if (prf->root && now >= prf->last_stat &&
+	    now - prf->last_stat < PROFILE_STAT_INTERVAL)
+		return 0;
 	if (stat(prf->filespec, &st))
 		return errno;
+	prf->last_stat = now;
 	if (st.st_mtime == prf->timestamp)
 		return 0;
 	if (prf->root) {
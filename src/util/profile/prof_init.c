@@ -12,17 +12,6 @@
 
 #include "prof_int.h"
 
-/* Find a 4-byte integer type */
-#if	(SIZEOF_SHORT == 4)
-typedef short	prof_int32;
-#elif	(SIZEOF_INT == 4)
-typedef int	prof_int32;
-#elif	(SIZEOF_LONG == 4)
-typedef	int	prof_int32;
-#else	/* SIZEOF_LONG == 4 */
-error(do not have a 4-byte integer type)
-#endif	/* SIZEOF_LONG == 4 */
-
 KRB5_DLLIMP errcode_t KRB5_CALLCONV
 profile_init(files, ret_profile)
 	const_profile_filespec_t *files;
@@ -137,6 +126,66 @@ profile_init_path(filelist, ret_profile)
 }
 #endif
 
+/*
+ * Make *ret_profile a new handle on the files already read into
+ * old_profile, without reading them again.  The two share the parsed
+ * files, which are only freed with the last handle; while they are
+ * shared, attempts to modify them fail with PROF_READ_ONLY.
+ */
+KRB5_DLLIMP errcode_t KRB5_CALLCONV
+profile_copy(old_profile, ret_profile)
+	profile_t	old_profile;
+	profile_t	*ret_profile;
+{
+	profile_t	profile;
+	errcode_t	retval;
+
+	if (!old_profile || old_profile->magic != PROF_MAGIC_PROFILE)
+		return PROF_MAGIC_PROFILE;
+
+	if ((retval = profile_flush(old_profile)))
+		return retval;
+
+	profile = malloc(sizeof(struct _profile_t));
+	if (!profile)
+		return ENOMEM;
+	memset(profile, 0, sizeof(struct _profile_t));
+	profile->magic = PROF_MAGIC_PROFILE;
+	profile->first_file = old_profile->first_file;
+	if (profile->first_file)
+		profile->first_file->refcount++;
+
+	*ret_profile = profile;
+	return 0;
+}
+
+/*
+ * Set *ret_gen to a number which changes whenever the contents of
+ * profile may have: when one of its files has changed and is read
+ * again, or the profile is modified.  Callers which keep something
+ * worked out from a profile can tell from it when to work it out again.
+ */
+KRB5_DLLIMP errcode_t KRB5_CALLCONV
+profile_get_generation(profile, ret_gen)
+	profile_t	profile;
+	unsigned long	*ret_gen;
+{
+	prf_file_t	p;
+	unsigned long	gen = 0;
+	errcode_t	retval;
+
+	if (!profile || profile->magic != PROF_MAGIC_PROFILE)
+		return PROF_MAGIC_PROFILE;
+
+	for (p = profile->first_file; p; p = p->next) {
+		if ((retval = profile_update_file(p)))
+			return retval;
+		gen += p->upd_serial;
+	}
+	*ret_gen = gen;
+	return 0;
+}
+
 KRB5_DLLIMP errcode_t KRB5_CALLCONV
 profile_flush(profile)
 	profile_t	profile;
@@ -159,7 +208,10 @@ profile_abandon(profile)
 	if (!profile || profile->magic != PROF_MAGIC_PROFILE)
 		return;
 
-	for (p = profile->first_file; p; p = next) {
+	p = profile->first_file;
+	if (p && --p->refcount > 0)
+		p = 0;
+	for (; p; p = next) {
 		next = p->next;
 		profile_free_file(p);
 	}
@@ -176,7 +228,10 @@ profile_release(profile)
 	if (!profile || profile->magic != PROF_MAGIC_PROFILE)
 		return;
 
-	for (p = profile->first_file; p; p = next) {
+	p = profile->first_file;
+	if (p && --p->refcount > 0)
+		p = 0;
+	for (; p; p = next) {
 		next = p->next;
 		profile_close_file(p);
 	}
@@ -186,6 +241,11 @@ profile_release(profile)
 
 /*
  * Here begins the profile serialization functions.
+ *
+ * Along with the name of each file, its modification time and parsed
+ * tree are serialized, so that a profile can be handed to another
+ * process (an exec'd child, say) which need not read and parse the
+ * files again until they change.
  */
 errcode_t profile_ser_size(unused, profile, sizep)
     const char *unused;
@@ -194,22 +254,26 @@ errcode_t profile_ser_size(unused, profile, sizep)
 {
     size_t	required;
     prf_file_t	pfp;
+    errcode_t	retval;
 
     required = 3*sizeof(prof_int32);
     for (pfp = profile->first_file; pfp; pfp = pfp->next) {
-	required += sizeof(prof_int32);
+	required += 3*sizeof(prof_int32);
 #ifdef PROFILE_USES_PATHS
 	if (pfp->filespec)
 	    required += strlen(pfp->filespec);
 #else
 	required += sizeof (profile_filespec_t);
 #endif
+	if (pfp->root &&
+	    (retval = profile_ser_node_size(pfp->root, &required)))
+	    return retval;
     }
     *sizep += required;
     return 0;
 }
 
-static void pack_int32(oval, bufpp, remainp)
+void profile_pack_int32(oval, bufpp, remainp)
     prof_int32		oval;
     unsigned char	**bufpp;
     size_t		*remainp;
@@ -246,13 +310,13 @@ errcode_t profile_ser_externalize(unused, profile, bufpp, remainp)
 	    fcount = 0;
 	    for (pfp = profile->first_file; pfp; pfp = pfp->next)
 		fcount++;
-	    pack_int32(PROF_MAGIC_PROFILE, &bp, &remain);
-	    pack_int32(fcount, &bp, &remain);
+	    profile_pack_int32(PROF_MAGIC_PROFILE, &bp, &remain);
+	    profile_pack_int32(fcount, &bp, &remain);
 	    for (pfp = profile->first_file; pfp; pfp = pfp->next) {
 #ifdef PROFILE_USES_PATHS
 		slen = (pfp->filespec) ?
 		    (prof_int32) strlen(pfp->filespec) : 0;
-		pack_int32(slen, &bp, &remain);
+		profile_pack_int32(slen, &bp, &remain);
 		if (slen) {
 		    memcpy(bp, pfp->filespec, (size_t) slen);
 		    bp += slen;
@@ -260,13 +324,19 @@ errcode_t profile_ser_externalize(unused, profile, bufpp, remainp)
 		}
 #else
 		slen = sizeof (FSSpec);
-		pack_int32(slen, &bp, &remain);
+		profile_pack_int32(slen, &bp, &remain);
 		memcpy (bp, &(pfp->filespec), (size_t) slen);
 		bp += slen;
 		remain -= (size_t) slen;
 #endif
+		profile_pack_int32((prof_int32) pfp->timestamp, &bp, &remain);
+		profile_pack_int32(pfp->root ? 1 : 0, &bp, &remain);
+		if (pfp->root &&
+		    (retval = profile_ser_node_externalize(pfp->root, &bp,
+							   &remain)))
+		    return retval;
 	    }
-	    pack_int32(PROF_MAGIC_PROFILE, &bp, &remain);
+	    profile_pack_int32(PROF_MAGIC_PROFILE, &bp, &remain);
 	    retval = 0;
 	    *bufpp = bp;
 	    *remainp = remain;
@@ -275,7 +345,7 @@ errcode_t profile_ser_externalize(unused, profile, bufpp, remainp)
     return(retval);
 }
 
-static int unpack_int32(intp, bufpp, remainp)
+int profile_unpack_int32(intp, bufpp, remainp)
     prof_int32		*intp;
     unsigned char	**bufpp;
     size_t		*remainp;
@@ -303,14 +373,21 @@ errcode_t profile_ser_internalize(unused, profilep, bufpp, remainp)
 	unsigned char	*bp;
 	size_t		remain;
 	int			i;
-	prof_int32		fcount, tmp;
-	profile_filespec_t		*flist = 0;
+	prof_int32		fcount, tmp, timestamp;
+	profile_t		profile = 0;
+	prf_file_t		new_file, last = 0;
+	struct profile_node	*root;
+#ifdef PROFILE_USES_PATHS
+	char			*filespec = 0;
+#else
+	FSSpec			filespec;
+#endif
 
 	bp = *bufpp;
 	remain = *remainp;
 
 	if (remain >= 12)
-		(void) unpack_int32(&tmp, &bp, &remain);
+		(void) profile_unpack_int32(&tmp, &bp, &remain);
 	else
 		tmp = 0;
 	
@@ -319,51 +396,74 @@ errcode_t profile_ser_internalize(unused, profilep, bufpp, remainp)
 		goto cleanup;
 	}
 	
-	(void) unpack_int32(&fcount, &bp, &remain);
-	retval = ENOMEM;
+	(void) profile_unpack_int32(&fcount, &bp, &remain);
 
-	flist = (profile_filespec_t *) malloc(sizeof(profile_filespec_t) * (fcount + 1));
-	if (!flist)
+	if ((retval = profile_init(NULL, &profile)))
 		goto cleanup;
-	
-	memset(flist, 0, sizeof(char *) * (fcount+1));
+
 	for (i=0; i<fcount; i++) {
-		if (!unpack_int32(&tmp, &bp, &remain)) {
+		retval = EINVAL;
+		if (profile_unpack_int32(&tmp, &bp, &remain) ||
+		    tmp < 0 || remain < (size_t) tmp)
+			goto cleanup;
 #ifdef PROFILE_USES_PATHS
-			flist[i] = (char *) malloc((size_t) (tmp+1));
-			if (!flist[i])
-				goto cleanup;
-			memcpy(flist[i], bp, (size_t) tmp);
-			flist[i][tmp] = '\0';
+		filespec = (char *) malloc((size_t) (tmp+1));
+		if (!filespec) {
+			retval = ENOMEM;
+			goto cleanup;
+		}
+		memcpy(filespec, bp, (size_t) tmp);
+		filespec[tmp] = '\0';
 #else
-			memcpy (&flist[i], bp, (size_t) tmp);
+		memcpy (&filespec, bp, (size_t) tmp);
 #endif
-			bp += tmp;
-			remain -= (size_t) tmp;
+		bp += tmp;
+		remain -= (size_t) tmp;
+
+		if (profile_unpack_int32(&timestamp, &bp, &remain) ||
+		    profile_unpack_int32(&tmp, &bp, &remain))
+			goto cleanup;
+		root = 0;
+		if (tmp &&
+		    (retval = profile_ser_node_internalize(0, &root, &bp,
+							   &remain)))
+			goto cleanup;
+		if ((retval = profile_make_file(filespec, root,
+						(time_t) timestamp,
+						&new_file))) {
+			if (root)
+				profile_free_node(root);
+			goto cleanup;
 		}
+#ifdef PROFILE_USES_PATHS
+		free(filespec);
+		filespec = 0;
+#endif
+		if (last)
+			last->next = new_file;
+		else
+			profile->first_file = new_file;
+		last = new_file;
 	}
 
-	if (unpack_int32(&tmp, &bp, &remain) ||
+	if (profile_unpack_int32(&tmp, &bp, &remain) ||
 	    (tmp != PROF_MAGIC_PROFILE)) {
 		retval = EINVAL;
 		goto cleanup;
 	}
 
-	if ((retval = profile_init(flist, profilep)))
-		goto cleanup;
-	
+	*profilep = profile;
+	profile = 0;
 	*bufpp = bp;
 	*remainp = remain;
+	retval = 0;
     
 cleanup:
-	if (flist) {
 #ifdef PROFILE_USES_PATHS
-		for (i=0; i<fcount; i++) {
-			if (flist[i])
-				free(flist[i]);
-		}
+	if (filespec)
+		free(filespec);
 #endif
-		free(flist);
-	}
+	if (profile)
+		profile_abandon(profile);
 	return(retval);
 }
@@ -33,6 +33,17 @@
 
 typedef long prf_magic_t;
 
+/* Find a 4-byte integer type */
+#if	(SIZEOF_SHORT == 4)
+typedef short	prof_int32;
+#elif	(SIZEOF_INT == 4)
+typedef int	prof_int32;
+#elif	(SIZEOF_LONG == 4)
+typedef	int	prof_int32;
+#else	/* SIZEOF_LONG == 4 */
+error(do not have a 4-byte integer type)
+#endif	/* SIZEOF_LONG == 4 */
+
 /*
  * This is the structure which stores the profile information for a
  * particular configuration file.
@@ -43,13 +54,20 @@ struct _prf_file_t {
 	profile_filespec_t filespec;
 	struct profile_node *root;
 	time_t		timestamp;
+	time_t		last_stat;	/* when the file was last checked */
 	int		flags;
 	int		upd_serial;
+	int		refcount;	/* profiles sharing this file list */
 	struct _prf_file_t *next;
 };
 
 typedef struct _prf_file_t *prf_file_t;
 
+/*
+ * A file is checked for changes at most once in this many seconds.
+ */
+#define PROFILE_STAT_INTERVAL	1
+
 /*
  * The profile flags
  */
@@ -170,11 +188,26 @@ errcode_t profile_set_relation_value
 errcode_t profile_rename_node
 	PROTOTYPE((struct profile_node *node, const char *new_name));
 
+errcode_t profile_ser_node_size
+	PROTOTYPE((struct profile_node *node, size_t *sizep));
+
+errcode_t profile_ser_node_externalize
+	PROTOTYPE((struct profile_node *node, unsigned char **bufpp,
+		   size_t *remainp));
+
+errcode_t profile_ser_node_internalize
+	PROTOTYPE((int group_level, struct profile_node **ret_node,
+		   unsigned char **bufpp, size_t *remainp));
+
 /* prof_file.c */
 
 errcode_t profile_open_file
 	PROTOTYPE ((const_profile_filespec_t file, prf_file_t *ret_prof));
 
+errcode_t profile_make_file
+	PROTOTYPE ((const_profile_filespec_t file, struct profile_node *root,
+		    time_t timestamp, prf_file_t *ret_prof));
+
 errcode_t profile_update_file
 	PROTOTYPE ((prf_file_t profile));
 
@@ -189,6 +222,13 @@ errcode_t profile_close_file
 
 /* prof_init.c -- included from profile.h */
 
+void profile_pack_int32
+	PROTOTYPE ((prof_int32 oval, unsigned char **bufpp, size_t *remainp));
+
+int profile_unpack_int32
+	PROTOTYPE ((prof_int32 *intp, unsigned char **bufpp,
+		    size_t *remainp));
+
 /* prof_get.c */
 
 errcode_t profile_get_value
@@ -36,6 +36,10 @@ static errcode_t rw_setup(profile)
 	if (!(file->flags & PROFILE_FILE_RW))
 		return PROF_READ_ONLY;
 
+	/* The files of a profile_copy()'d profile are shared read-only */
+	if (file->refcount > 1)
+		return PROF_READ_ONLY;
+
 	/* Don't update the file if we've already made modifications */
 	if (file->flags & PROFILE_FILE_DIRTY)
 		return 0;
@@ -95,6 +99,7 @@ profile_update_relation(profile, names, old_value, new_value)
 		return retval;
 
 	profile->first_file->flags |= PROFILE_FILE_DIRTY;
+	profile->first_file->upd_serial++;
 	
 	return 0;
 }
@@ -141,6 +146,7 @@ profile_clear_relation(profile, names)
 	} while (state);
 
 	profile->first_file->flags |= PROFILE_FILE_DIRTY;
+	profile->first_file->upd_serial++;
 	
 	return 0;
 }
@@ -191,6 +197,7 @@ profile_rename_section(profile, names, new_name)
 		return retval;
 
 	profile->first_file->flags |= PROFILE_FILE_DIRTY;
+	profile->first_file->upd_serial++;
 	
 	return 0;
 }
@@ -246,6 +253,7 @@ profile_add_relation(profile, names, new_value)
 		return retval;
 
 	profile->first_file->flags |= PROFILE_FILE_DIRTY;
+	profile->first_file->upd_serial++;
 	
 	return 0;
 }
@@ -14,6 +14,12 @@
  * A relation has as its value a pointer to allocated memory
  * containing a string.  Its first_child pointer must be null.
  *
+ * The children of a section are kept sorted by name, so that all the
+ * nodes of one name are together.  A section with many children also
+ * has a hash index of them by name, made when it is first searched,
+ * so that looking up a name does not mean walking through all of
+ * them.
+ *
  */
 
 
@@ -36,8 +42,13 @@ struct profile_node {
 	struct profile_node *first_child;
 	struct profile_node *parent;
 	struct profile_node *next, *prev;
+	struct profile_node **index;	/* first child of each name */
+	int index_size;		/* 0 if not made, -1 if too few children */
 };
 
+/* Sections with fewer children than this are just searched. */
+#define PROF_INDEX_MIN		8
+
 #define CHECK_MAGIC(node) \
 	  if ((node)->magic != PROF_MAGIC_NODE) \
 		  return PROF_MAGIC_NODE;
@@ -62,6 +73,8 @@ void profile_free_node(node)
 		next = child->next;
 		profile_free_node(child);
 	}
+	if (node->index)
+		free(node->index);
 	node->magic = 0;
 	
 	free(node);
@@ -100,6 +113,94 @@ errcode_t profile_create_node(name, value, ret_node)
 	return 0;
 }
 
+static unsigned int hash_name(name)
+	const char *name;
+{
+	unsigned int h = 0;
+
+	while (*name)
+		h = h * 31 + (unsigned char) *name++;
+	return h;
+}
+
+/*
+ * Forget the index of a section whose children have changed.
+ */
+static void drop_index(section)
+	struct profile_node *section;
+{
+	if (section->index)
+		free(section->index);
+	section->index = 0;
+	section->index_size = 0;
+}
+
+/*
+ * Make the index of a section's children, if it has enough of them.
+ * The index is an open-addressed hash table, at most half full, of
+ * the first child of each name.  If memory is short, the section is
+ * simply searched.
+ */
+static void make_index(section)
+	struct profile_node *section;
+{
+	struct profile_node *p, **index;
+	int names, size;
+	unsigned int h;
+
+	for (p = section->first_child, names = 0; p; p = p->next)
+		if (!p->prev || strcmp(p->prev->name, p->name))
+			names++;
+	if (names < PROF_INDEX_MIN) {
+		section->index_size = -1;
+		return;
+	}
+
+	for (size = PROF_INDEX_MIN; size < 2 * names; size *= 2)
+		;
+	index = malloc(size * sizeof(struct profile_node *));
+	if (!index)
+		return;
+	memset(index, 0, size * sizeof(struct profile_node *));
+	for (p = section->first_child; p; p = p->next) {
+		if (p->prev && !strcmp(p->prev->name, p->name))
+			continue;
+		for (h = hash_name(p->name) & (size - 1); index[h];
+		     h = (h + 1) & (size - 1))
+			;
+		index[h] = p;
+	}
+	section->index = index;
+	section->index_size = size;
+}
+
+/*
+ * Return the first child of section named name, or null if it has
+ * none.  The rest with that name follow it.
+ */
+static struct profile_node *find_first_child(section, name)
+	struct profile_node *section;
+	const char *name;
+{
+	struct profile_node *p;
+	unsigned int h, mask;
+
+	if (section->index_size == 0)
+		make_index(section);
+	if (section->index) {
+		mask = section->index_size - 1;
+		for (h = hash_name(name) & mask; (p = section->index[h]);
+		     h = (h + 1) & mask)
+			if (!strcmp(p->name, name))
+				return p;
+		return 0;
+	}
+	for (p = section->first_child; p; p = p->next)
+		if (!strcmp(p->name, name))
+			return p;
+	return 0;
+}
+
 /*
  * This function verifies that all of the representation invarients of
  * the profile are true.  If not, we have a programming bug somewhere,
@@ -173,6 +274,7 @@ errcode_t profile_add_node(section, name, value, ret_node)
 		last->next = new;
 	else
 		section->first_child = new;
+	drop_index(section);
 	if (ret_node)
 		*ret_node = new;
 	return 0;
@@ -249,12 +351,16 @@ errcode_t profile_find_node(section, name, value, section_flag, state, node)
 	p = *state;
 	if (p) {
 		CHECK_MAGIC(p);
-	} else
+	} else if (name)
+		p = find_first_child(section, name);
+	else
 		p = section->first_child;
 	
 	for (; p; p = p->next) {
-		if (name && (strcmp(p->name, name)))
-			continue;
+		if (name && (strcmp(p->name, name))) {
+			p = 0;		/* no more of that name */
+			break;
+		}
 		if (section_flag) {
 			if (p->value)
 				continue;
@@ -279,8 +385,10 @@ errcode_t profile_find_node(section, name, value, section_flag, state, node)
 	 * there's guaranteed to be another match that's returned.
 	 */
 	for (p = p->next; p; p = p->next) {
-		if (name && (strcmp(p->name, name)))
-			continue;
+		if (name && (strcmp(p->name, name))) {
+			p = 0;
+			break;
+		}
 		if (section_flag) {
 			if (p->value)
 				continue;
@@ -499,9 +607,15 @@ get_new_file:
 		 */
 		section = iter->file->root;
 		for (cpp = iter->names; cpp[iter->done_idx]; cpp++) {
-			for (p=section->first_child; p; p = p->next)
-				if (!strcmp(p->name, *cpp) && !p->value)
+			for (p = find_first_child(section, *cpp); p;
+			     p = p->next) {
+				if (strcmp(p->name, *cpp)) {
+					p = 0;
+					break;
+				}
+				if (!p->value)
 					break;
+			}
 			if (!p) {
 				section = 0;
 				break;
@@ -516,15 +630,18 @@ get_new_file:
 			goto get_new_file;
 		}
 		iter->name = *cpp;
-		iter->node = section->first_child;
+		iter->node = *cpp ? find_first_child(section, *cpp) :
+			section->first_child;
 	}
 	/*
 	 * OK, now we know iter->node is set up correctly.  Let's do
 	 * the search.
 	 */
 	for (p = iter->node; p; p = p->next) {
-		if (iter->name && strcmp(p->name, iter->name))
-			continue;
+		if (iter->name && strcmp(p->name, iter->name)) {
+			p = 0;		/* no more of that name */
+			break;
+		}
 		if ((iter->flags & PROFILE_ITER_SECTIONS_ONLY) &&
 		    p->value)
 			continue;
@@ -576,6 +693,7 @@ errcode_t profile_remove_node(node)
 	if (node->next)
 		node->next->prev = node->prev;
 
+	drop_index(node->parent);
 	profile_free_node(node);
 
 	return 0;
@@ -672,5 +790,154 @@ errcode_t profile_rename_node(node, new_name)
 
 	free(node->name);
 	node->name = new_string;
+	drop_index(node->parent);
+	return 0;
+}
+
+/*
+ * Serialize the tree under node for profile_ser_externalize(), and
+ * build it again for profile_ser_internalize().  Each node is its
+ * flags, name, value if it is a relation, and the number of its
+ * children, followed by the children.
+ */
+#define PROF_SER_NODE_VALUE	0x0001
+#define PROF_SER_NODE_FINAL	0x0002
+
+errcode_t profile_ser_node_size(node, sizep)
+	struct profile_node	*node;
+	size_t			*sizep;
+{
+	struct profile_node	*p;
+	errcode_t		retval;
+
+	CHECK_MAGIC(node);
+
+	*sizep += 3*sizeof(prof_int32) + strlen(node->name);
+	if (node->value)
+		*sizep += sizeof(prof_int32) + strlen(node->value);
+	for (p = node->first_child; p; p = p->next)
+		if ((retval = profile_ser_node_size(p, sizep)))
+			return retval;
 	return 0;
 }
+
+static void ser_pack_string(str, bufpp, remainp)
+	const char		*str;
+	unsigned char		**bufpp;
+	size_t			*remainp;
+{
+	size_t	len = strlen(str);
+
+	profile_pack_int32((prof_int32) len, bufpp, remainp);
+	memcpy(*bufpp, str, len);
+	*bufpp += len;
+	*remainp -= len;
+}
+
+static errcode_t ser_unpack_string(ret_str, bufpp, remainp)
+	char			**ret_str;
+	unsigned char		**bufpp;
+	size_t			*remainp;
+{
+	prof_int32	len;
+
+	if (profile_unpack_int32(&len, bufpp, remainp) ||
+	    len < 0 || *remainp < (size_t) len)
+		return EINVAL;
+	*ret_str = malloc((size_t) len + 1);
+	if (!*ret_str)
+		return ENOMEM;
+	memcpy(*ret_str, *bufpp, (size_t) len);
+	(*ret_str)[len] = '\0';
+	*bufpp += len;
+	*remainp -= (size_t) len;
+	return 0;
+}
+
+/*
+ * The caller has checked with profile_ser_node_size() that there is
+ * room for the tree.
+ */
+errcode_t profile_ser_node_externalize(node, bufpp, remainp)
+	struct profile_node	*node;
+	unsigned char		**bufpp;
+	size_t			*remainp;
+{
+	struct profile_node	*p;
+	prof_int32		flags, count;
+	errcode_t		retval;
+
+	CHECK_MAGIC(node);
+
+	flags = 0;
+	if (node->value)
+		flags |= PROF_SER_NODE_VALUE;
+	if (node->final)
+		flags |= PROF_SER_NODE_FINAL;
+	profile_pack_int32(flags, bufpp, remainp);
+	ser_pack_string(node->name, bufpp, remainp);
+	if (node->value)
+		ser_pack_string(node->value, bufpp, remainp);
+
+	for (count = 0, p = node->first_child; p; p = p->next)
+		count++;
+	profile_pack_int32(count, bufpp, remainp);
+	for (p = node->first_child; p; p = p->next)
+		if ((retval = profile_ser_node_externalize(p, bufpp, remainp)))
+			return retval;
+	return 0;
+}
+
+errcode_t profile_ser_node_internalize(group_level, ret_node, bufpp, remainp)
+	int			group_level;
+	struct profile_node	**ret_node;
+	unsigned char		**bufpp;
+	size_t			*remainp;
+{
+	struct profile_node	*node, *child, *last;
+	prof_int32		flags, count;
+	errcode_t		retval;
+
+	if (profile_unpack_int32(&flags, bufpp, remainp))
+		return EINVAL;
+
+	node = malloc(sizeof(struct profile_node));
+	if (!node)
+		return ENOMEM;
+	memset(node, 0, sizeof(struct profile_node));
+	node->magic = PROF_MAGIC_NODE;
+	node->group_level = group_level;
+	if (flags & PROF_SER_NODE_FINAL)
+		node->final = 1;
+
+	if ((retval = ser_unpack_string(&node->name, bufpp, remainp)))
+		goto cleanup;
+	if ((flags & PROF_SER_NODE_VALUE) &&
+	    (retval = ser_unpack_string(&node->value, bufpp, remainp)))
+		goto cleanup;
+
+	retval = EINVAL;
+	if (profile_unpack_int32(&count, bufpp, remainp) ||
+	    (count && node->value))
+		goto cleanup;
+	for (last = 0; count > 0; count--) {
+		if ((retval = profile_ser_node_internalize(group_level + 1,
+							   &child, bufpp,
+							   remainp)))
+			goto cleanup;
+		child->parent = node;
+		child->prev = last;
+		if (last)
+			last->next = child;
+		else
+			node->first_child = child;
+		last = child;
+	}
+
+	*ret_node = node;
+	return 0;
+
+cleanup:
+	profile_free_node(node);
+	return retval;
+}